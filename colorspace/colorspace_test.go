@@ -0,0 +1,109 @@
+package colorspace
+
+import (
+	"bytes"
+	"math/rand"
+	"testing"
+)
+
+func TestYBRFullToRGB(t *testing.T) {
+	tests := []struct {
+		name string
+		ybr  []byte
+		want []byte
+	}{
+		{name: "Should convert gray", ybr: []byte{128, 128, 128}, want: []byte{128, 128, 128}},
+		{name: "Should convert white", ybr: []byte{255, 128, 128}, want: []byte{255, 255, 255}},
+		{name: "Should convert red", ybr: []byte{76, 85, 255}, want: []byte{254, 0, 0}},
+		{name: "Should clamp out of range values", ybr: []byte{255, 255, 255}, want: []byte{255, 121, 255}},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			got := make([]byte, len(tt.ybr))
+			YBRFullToRGB(got, tt.ybr)
+			if !bytes.Equal(got, tt.want) {
+				t.Errorf("YBRFullToRGB() = %v, want %v", got, tt.want)
+			}
+			planes := make([]byte, len(tt.ybr))
+			YBRPlanesToRGB(planes, tt.ybr[0:1], tt.ybr[1:2], tt.ybr[2:3])
+			if !bytes.Equal(planes, tt.want) {
+				t.Errorf("YBRPlanesToRGB() = %v, want %v", planes, tt.want)
+			}
+		})
+	}
+}
+
+func TestRGBToYBRFull(t *testing.T) {
+	rng := rand.New(rand.NewSource(1))
+	rgb := make([]byte, 3*4096)
+	rng.Read(rgb)
+	ybr := make([]byte, len(rgb))
+	RGBToYBRFull(ybr, rgb)
+	back := make([]byte, len(rgb))
+	YBRFullToRGB(back, ybr)
+	for i := range rgb {
+		if d := int(back[i]) - int(rgb[i]); d < -2 || d > 2 {
+			t.Fatalf("RGBToYBRFull() sample %d = %d after the round trip, want %d", i, back[i], rgb[i])
+		}
+	}
+	gray := []byte{0, 0, 0, 128, 128, 128, 255, 255, 255}
+	RGBToYBRFull(gray, gray)
+	if want := []byte{0, 128, 128, 128, 128, 128, 255, 128, 128}; !bytes.Equal(gray, want) {
+		t.Errorf("RGBToYBRFull() = %v, want %v", gray, want)
+	}
+}
+
+func TestYBRFull422ToRGB(t *testing.T) {
+	rng := rand.New(rand.NewSource(2))
+	src := make([]byte, 4*1000)
+	rng.Read(src)
+	full := make([]byte, 6*1000)
+	for k := 0; k < 1000; k++ {
+		y1, y2, cb, cr := src[4*k], src[4*k+1], src[4*k+2], src[4*k+3]
+		copy(full[6*k:], []byte{y1, cb, cr, y2, cb, cr})
+	}
+	want := make([]byte, len(full))
+	YBRFullToRGB(want, full)
+	got := make([]byte, len(full))
+	YBRFull422ToRGB(got, src)
+	if !bytes.Equal(got, want) {
+		t.Errorf("YBRFull422ToRGB() differs from YBRFullToRGB() of the upsampled pixels")
+	}
+}
+
+func TestPlanarToInterleaved(t *testing.T) {
+	tests := []struct {
+		name           string
+		samples        int
+		bytesPerSample int
+	}{
+		{name: "Should interleave RGB 8 bit", samples: 3, bytesPerSample: 1},
+		{name: "Should interleave RGB 16 bit", samples: 3, bytesPerSample: 2},
+		{name: "Should interleave 4 samples", samples: 4, bytesPerSample: 1},
+		{name: "Should interleave 2 samples 16 bit", samples: 2, bytesPerSample: 2},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			const pixels = 1001
+			planar := make([]byte, pixels*tt.samples*tt.bytesPerSample)
+			rand.New(rand.NewSource(int64(tt.samples))).Read(planar)
+			interleaved := make([]byte, len(planar))
+			PlanarToInterleaved(interleaved, planar, tt.samples, tt.bytesPerSample)
+			plane := pixels * tt.bytesPerSample
+			for p := 0; p < pixels; p++ {
+				for s := 0; s < tt.samples; s++ {
+					at := (p*tt.samples + s) * tt.bytesPerSample
+					want := planar[s*plane+p*tt.bytesPerSample : s*plane+(p+1)*tt.bytesPerSample]
+					if !bytes.Equal(interleaved[at:at+tt.bytesPerSample], want) {
+						t.Fatalf("PlanarToInterleaved() pixel %d sample %d = %v, want %v", p, s, interleaved[at:at+tt.bytesPerSample], want)
+					}
+				}
+			}
+			back := make([]byte, len(planar))
+			InterleavedToPlanar(back, interleaved, tt.samples, tt.bytesPerSample)
+			if !bytes.Equal(back, planar) {
+				t.Errorf("InterleavedToPlanar() differs from the source")
+			}
+		})
+	}
+}
@@ -0,0 +1,63 @@
+package colorspace
+
+// PlanarToInterleaved - one frame with a plane per sample (planar configuration 1) in src to
+// interleaved pixels (planar configuration 0) in dst, bytesPerSample 1 or 2
+func PlanarToInterleaved(dst []byte, src []byte, samples int, bytesPerSample int) {
+	plane := len(src) / samples
+	switch {
+	case samples == 3 && bytesPerSample == 1:
+		r, g, b := src[:plane], src[plane:2*plane], src[2*plane:3*plane]
+		dst = dst[:3*plane]
+		for k := range r {
+			p := dst[3*k : 3*k+3 : 3*k+3]
+			p[0], p[1], p[2] = r[k], g[k], b[k]
+		}
+	case samples == 3 && bytesPerSample == 2:
+		r, g, b := src[:plane], src[plane:2*plane], src[2*plane:3*plane]
+		dst = dst[:3*plane]
+		for k := 0; k < plane; k += 2 {
+			p := dst[3*k : 3*k+6 : 3*k+6]
+			p[0], p[1] = r[k], r[k+1]
+			p[2], p[3] = g[k], g[k+1]
+			p[4], p[5] = b[k], b[k+1]
+		}
+	default:
+		for s := 0; s < samples; s++ {
+			in := src[s*plane : (s+1)*plane]
+			for k := 0; k < plane; k += bytesPerSample {
+				copy(dst[k*samples+s*bytesPerSample:], in[k:k+bytesPerSample])
+			}
+		}
+	}
+}
+
+// InterleavedToPlanar - one frame of interleaved pixels (planar configuration 0) in src to a plane
+// per sample (planar configuration 1) in dst, bytesPerSample 1 or 2
+func InterleavedToPlanar(dst []byte, src []byte, samples int, bytesPerSample int) {
+	plane := len(src) / samples
+	switch {
+	case samples == 3 && bytesPerSample == 1:
+		r, g, b := dst[:plane], dst[plane:2*plane], dst[2*plane:3*plane]
+		src = src[:3*plane]
+		for k := range r {
+			p := src[3*k : 3*k+3 : 3*k+3]
+			r[k], g[k], b[k] = p[0], p[1], p[2]
+		}
+	case samples == 3 && bytesPerSample == 2:
+		r, g, b := dst[:plane], dst[plane:2*plane], dst[2*plane:3*plane]
+		src = src[:3*plane]
+		for k := 0; k < plane; k += 2 {
+			p := src[3*k : 3*k+6 : 3*k+6]
+			r[k], r[k+1] = p[0], p[1]
+			g[k], g[k+1] = p[2], p[3]
+			b[k], b[k+1] = p[4], p[5]
+		}
+	default:
+		for s := 0; s < samples; s++ {
+			out := dst[s*plane : (s+1)*plane]
+			for k := 0; k < plane; k += bytesPerSample {
+				copy(out[k:k+bytesPerSample], src[k*samples+s*bytesPerSample:])
+			}
+		}
+	}
+}
@@ -0,0 +1,99 @@
+package colorspace
+
+// YBR_FULL to RGB in 16 bit fixed point as in IJG's jdcolor.c: the products per Cb and Cr value and
+// a range limit for the sums as tables
+var ybrCrR, ybrCbG, ybrCrG, ybrCbB [256]int32
+
+// RGB to YBR_FULL in 16 bit fixed point as in IJG's jccolor.c: the products per R, G and B value,
+// rounding and the 128 offset of Cb and Cr folded in
+var rY, gY, bY, rCb, gCb, bCbrCr, gCr, bCr [256]int32
+
+var rangeLimit [1024]byte
+
+const rangeOffset = 384
+
+func init() {
+	const half = 1 << 15
+	for i := int32(0); i < 256; i++ {
+		c := i - 128
+		ybrCrR[i] = (91881*c + half) >> 16  // 1.402
+		ybrCbB[i] = (116130*c + half) >> 16 // 1.772
+		ybrCbG[i] = -22554 * c              // 0.344136
+		ybrCrG[i] = -46802*c + half         // 0.714136
+
+		rY[i] = 19595 * i                        // 0.299
+		gY[i] = 38470 * i                        // 0.587
+		bY[i] = 7471*i + half                    // 0.114
+		rCb[i] = -11059 * i                      // 0.16874
+		gCb[i] = -21709 * i                      // 0.33126
+		bCbrCr[i] = 32768*i + 128<<16 + half - 1 // 0.5, B for Cb and R for Cr
+		gCr[i] = -27439 * i                      // 0.41869
+		bCr[i] = -5329 * i                       // 0.08131
+	}
+	for i := range rangeLimit {
+		rangeLimit[i] = byte(min(max(i-rangeOffset, 0), 255))
+	}
+}
+
+// YBRFullToRGB - interleaved 8 bit YBR_FULL pixels of src to RGB in dst, dst may be src
+func YBRFullToRGB(dst []byte, src []byte) {
+	n := len(src) / 3
+	src = src[:3*n]
+	dst = dst[:3*n]
+	for k := 0; k < 3*n; k += 3 {
+		s := src[k : k+3 : k+3]
+		y := int32(s[0]) + rangeOffset
+		cb, cr := s[1], s[2]
+		p := dst[k : k+3 : k+3]
+		p[0] = rangeLimit[y+ybrCrR[cr]]
+		p[1] = rangeLimit[y+(ybrCbG[cb]+ybrCrG[cr])>>16]
+		p[2] = rangeLimit[y+ybrCbB[cb]]
+	}
+}
+
+// YBRFull422ToRGB - 8 bit YBR_FULL_422 pixels of src, Y1 Y2 Cb Cr for every two pixels of a row,
+// to interleaved RGB in dst, which holds 3 bytes for every 2 of src
+func YBRFull422ToRGB(dst []byte, src []byte) {
+	n := len(src) / 4
+	src = src[:4*n]
+	dst = dst[:6*n]
+	for k := 0; k < n; k++ {
+		s := src[4*k : 4*k+4 : 4*k+4]
+		cb, cr := s[2], s[3]
+		r, g, b := ybrCrR[cr], (ybrCbG[cb]+ybrCrG[cr])>>16, ybrCbB[cb]
+		p := dst[6*k : 6*k+6 : 6*k+6]
+		y := int32(s[0]) + rangeOffset
+		p[0], p[1], p[2] = rangeLimit[y+r], rangeLimit[y+g], rangeLimit[y+b]
+		y = int32(s[1]) + rangeOffset
+		p[3], p[4], p[5] = rangeLimit[y+r], rangeLimit[y+g], rangeLimit[y+b]
+	}
+}
+
+// YBRPlanesToRGB - 8 bit YBR_FULL samples held in one plane per component to interleaved RGB in dst
+func YBRPlanesToRGB(dst []byte, y []byte, cb []byte, cr []byte) {
+	cb = cb[:len(y)]
+	cr = cr[:len(y)]
+	dst = dst[:3*len(y)]
+	for k := range y {
+		p := dst[3*k : 3*k+3 : 3*k+3]
+		l := int32(y[k]) + rangeOffset
+		p[0] = rangeLimit[l+ybrCrR[cr[k]]]
+		p[1] = rangeLimit[l+(ybrCbG[cb[k]]+ybrCrG[cr[k]])>>16]
+		p[2] = rangeLimit[l+ybrCbB[cb[k]]]
+	}
+}
+
+// RGBToYBRFull - interleaved 8 bit RGB pixels of src to YBR_FULL in dst, dst may be src
+func RGBToYBRFull(dst []byte, src []byte) {
+	n := len(src) / 3
+	src = src[:3*n]
+	dst = dst[:3*n]
+	for k := 0; k < 3*n; k += 3 {
+		s := src[k : k+3 : k+3]
+		r, g, b := s[0], s[1], s[2]
+		p := dst[k : k+3 : k+3]
+		p[0] = byte((rY[r] + gY[g] + bY[b]) >> 16)
+		p[1] = byte((rCb[r] + gCb[g] + bCbrCr[b]) >> 16)
+		p[2] = byte((bCbrCr[r] + gCr[g] + bCr[b]) >> 16)
+	}
+}
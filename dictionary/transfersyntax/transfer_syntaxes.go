@@ -376,6 +376,30 @@ var HEVCM10P51 = &TransferSyntax{
 	Type:        "Transfer Syntax",
 }
 
+// HTJ2KLossless - (1.2.840.10008.1.2.4.201) High-Throughput JPEG 2000 Image Compression (Lossless Only)
+var HTJ2KLossless = &TransferSyntax{
+	UID:         "1.2.840.10008.1.2.4.201",
+	Name:        "HTJ2KLossless",
+	Description: "High-Throughput JPEG 2000 Image Compression (Lossless Only)",
+	Type:        "Transfer Syntax",
+}
+
+// HTJ2KLosslessRPCL - (1.2.840.10008.1.2.4.202) High-Throughput JPEG 2000 with RPCL Options Image Compression (Lossless Only)
+var HTJ2KLosslessRPCL = &TransferSyntax{
+	UID:         "1.2.840.10008.1.2.4.202",
+	Name:        "HTJ2KLosslessRPCL",
+	Description: "High-Throughput JPEG 2000 with RPCL Options Image Compression (Lossless Only)",
+	Type:        "Transfer Syntax",
+}
+
+// HTJ2K - (1.2.840.10008.1.2.4.203) High-Throughput JPEG 2000 Image Compression
+var HTJ2K = &TransferSyntax{
+	UID:         "1.2.840.10008.1.2.4.203",
+	Name:        "HTJ2K",
+	Description: "High-Throughput JPEG 2000 Image Compression",
+	Type:        "Transfer Syntax",
+}
+
 // RLELossless - (1.2.840.10008.1.2.5) RLE Lossless
 var RLELossless = &TransferSyntax{
 	UID:         "1.2.840.10008.1.2.5",
@@ -480,6 +504,9 @@ var transferSyntaxes = []*TransferSyntax{
 	MPEG4HP42STEREOF,
 	HEVCMP51,
 	HEVCM10P51,
+	HTJ2KLossless,
+	HTJ2KLosslessRPCL,
+	HTJ2K,
 	RLELossless,
 	RFC2557MIMEEncapsulation,
 	XMLEncoding,
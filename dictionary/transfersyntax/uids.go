@@ -7,6 +7,8 @@ type TransferSyntax struct {
 	Type        string
 }
 
+// The HTJ2K syntaxes are known but not supported: there is no Part 15 block coder to encode or
+// decode them, ChangeTransferSynx refuses their pixel data with openjpeg.ErrHTJ2K
 var supportedTransferSyntaxes = []*TransferSyntax{
 	ImplicitVRLittleEndian,
 	ExplicitVRLittleEndian,
@@ -17,6 +19,9 @@ var supportedTransferSyntaxes = []*TransferSyntax{
 	JPEGExtended12Bit,
 	JPEG2000Lossless,
 	JPEG2000,
+	JPEGLSLossless,
+	JPEGLSNearLossless,
+	RLELossless,
 }
 
 func GetTransferSyntaxFromName(name string) *TransferSyntax {
@@ -58,6 +58,16 @@ func TestGetTransferSyntaxFromUID(t *testing.T) {
 				Type:        "Transfer Syntax",
 			},
 		},
+		{
+			name: "Should get HTJ2K lossless transfer syntax",
+			args: args{uid: "1.2.840.10008.1.2.4.201"},
+			want: &TransferSyntax{
+				UID:         "1.2.840.10008.1.2.4.201",
+				Name:        "HTJ2KLossless",
+				Description: "High-Throughput JPEG 2000 Image Compression (Lossless Only)",
+				Type:        "Transfer Syntax",
+			},
+		},
 		{
 			name: "Should get nil from invalid transfer syntax UID",
 			args: args{uid: "1.2.840.10008.1.2.00000"},
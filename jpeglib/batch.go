@@ -0,0 +1,183 @@
+package jpeglib
+
+/*
+#include "dcmjpeg/batch.h"
+
+// defined in dcmjpeg/dijg*.c and dcmjpeg/eijg*.c, compiled by the platform files
+int decoder8_batch(codec_frame *frames, int count, int threads);
+int decoder8_batch_ycbcr(codec_frame *frames, int count, int threads);
+int decoder12_batch(codec_frame *frames, int count, int threads);
+int decoder16_batch(codec_frame *frames, int count, int threads);
+int encoder8_batch(codec_frame *frames, int count, unsigned short width, unsigned short height, unsigned short samplesPerPixel, int mode, int restartRows, int threads);
+int encoder12_batch(codec_frame *frames, int count, unsigned short width, unsigned short height, unsigned short samplesPerPixel, int mode, int restartRows, int threads);
+int encoder16_batch(codec_frame *frames, int count, unsigned short width, unsigned short height, unsigned short samplesPerPixel, int mode, int threads);
+*/
+import "C"
+import (
+	"errors"
+	"fmt"
+	"runtime"
+	"unsafe"
+)
+
+// Frame - one frame of a batch call. Input holds the source data and Output receives the result,
+// after the call Size is the number of bytes written to Output and Err the outcome of the frame.
+// Fragments, for decoders, hold the rest of a frame split over several fragments: the source
+// manager reads them after Input in place, with no copy
+type Frame struct {
+	Input     []byte
+	Fragments [][]byte
+	Output    []byte
+	Size      int
+	Err       error
+}
+
+// DIJG8decodeBatch - JPEG Files to RAW, every frame in one cgo call decoded on up to threads
+// native threads, 0 uses one per CPU. With fewer frames than threads, frames restarted at whole
+// MCU rows are split into stripes decoded on threads of their own. Returns the first frame error
+func DIJG8decodeBatch(frames []Frame, threads int) error {
+	return decodeRestart(frames, threads, 1, func(frames []Frame, threads int) error {
+		return runBatch(frames, threads, false, "Decode8, JPEG", func(cframes *C.codec_frame, count C.int, threads C.int) {
+			C.decoder8_batch(cframes, count, threads)
+		})
+	})
+}
+
+// DIJG8decodeBatchYCbCr - JPEG Files to RAW as DIJG8decodeBatch, but YCbCr frames are kept as
+// coded, interleaved YBR_FULL, instead of converted to RGB
+func DIJG8decodeBatchYCbCr(frames []Frame, threads int) error {
+	return decodeRestart(frames, threads, 1, func(frames []Frame, threads int) error {
+		return runBatch(frames, threads, false, "Decode8, JPEG", func(cframes *C.codec_frame, count C.int, threads C.int) {
+			C.decoder8_batch_ycbcr(cframes, count, threads)
+		})
+	})
+}
+
+// DIJG12decodeBatch - JPEG Files to RAW, see DIJG8decodeBatch
+func DIJG12decodeBatch(frames []Frame, threads int) error {
+	return decodeRestart(frames, threads, 2, func(frames []Frame, threads int) error {
+		return runBatch(frames, threads, false, "Decode12 JPEG", func(cframes *C.codec_frame, count C.int, threads C.int) {
+			C.decoder12_batch(cframes, count, threads)
+		})
+	})
+}
+
+// DIJG16decodeBatch - JPEG Files to RAW, see DIJG8decodeBatch
+func DIJG16decodeBatch(frames []Frame, threads int) error {
+	return runBatch(frames, threads, false, "Decode16 JPEG", func(cframes *C.codec_frame, count C.int, threads C.int) {
+		C.decoder16_batch(cframes, count, threads)
+	})
+}
+
+// EIJG8encodeBatch - RAW Files to JPEG, frames of the same geometry encoded in one cgo call on up to
+// threads native threads, each straight into its Output. Lossy frames get restartRows MCU rows per
+// restart interval, 0 for none, see JPEGEncoder8.SetRestartRows. A frame that does not fit gets
+// ErrBufferTooSmall with the size its Output needs. Returns the first frame error
+func EIJG8encodeBatch(frames []Frame, width uint16, height uint16, samples uint16, mode int, restartRows int, threads int) error {
+	return runBatch(frames, threads, true, "Encode8, JPEG", func(cframes *C.codec_frame, count C.int, threads C.int) {
+		C.encoder8_batch(cframes, count, C.ushort(width), C.ushort(height), C.ushort(samples), C.int(mode), C.int(restartRows), threads)
+	})
+}
+
+// EIJG12encodeBatch - RAW Files to JPEG, see EIJG8encodeBatch
+func EIJG12encodeBatch(frames []Frame, width uint16, height uint16, samples uint16, mode int, restartRows int, threads int) error {
+	return runBatch(frames, threads, true, "Encode12 JPEG", func(cframes *C.codec_frame, count C.int, threads C.int) {
+		C.encoder12_batch(cframes, count, C.ushort(width), C.ushort(height), C.ushort(samples), C.int(mode), C.int(restartRows), threads)
+	})
+}
+
+// EIJG16encodeBatch - RAW Files to JPEG, see EIJG8encodeBatch
+func EIJG16encodeBatch(frames []Frame, width uint16, height uint16, samples uint16, mode int, threads int) error {
+	return runBatch(frames, threads, true, "Encode16 JPEG", func(cframes *C.codec_frame, count C.int, threads C.int) {
+		C.encoder16_batch(cframes, count, C.ushort(width), C.ushort(height), C.ushort(samples), C.int(mode), threads)
+	})
+}
+
+// runBatch - copies the frame descriptors to C memory with their Go buffers pinned, so one cgo
+// call hands every frame to the native threads, then reads the results back
+func runBatch(frames []Frame, threads int, encode bool, name string, run func(cframes *C.codec_frame, count C.int, threads C.int)) error {
+	if len(frames) == 0 {
+		return nil
+	}
+	for i := range frames {
+		if len(frames[i].Input) == 0 || (!encode && len(frames[i].Output) == 0) {
+			return fmt.Errorf("ERROR, %s failed, frame %d has no data", name, i)
+		}
+	}
+	if threads <= 0 {
+		threads = runtime.NumCPU()
+	}
+
+	var pinner runtime.Pinner
+	defer pinner.Unpin()
+	// zeroed: storing a Go pointer over a stale one left in reused C memory makes the write barrier
+	// hand the GC a pointer to a freed object
+	cframes := (*C.codec_frame)(C.calloc(C.size_t(len(frames)), C.size_t(unsafe.Sizeof(C.codec_frame{}))))
+	if cframes == nil {
+		return fmt.Errorf("ERROR, %s failed, out of memory", name)
+	}
+	defer C.free(unsafe.Pointer(cframes))
+	descriptors := unsafe.Slice(cframes, len(frames))
+	// the further fragments of every frame in one C array, each frame points at its own run
+	var fragments []C.codec_fragment
+	count := 0
+	for i := range frames {
+		count += len(frames[i].Fragments)
+	}
+	if count > 0 {
+		cfragments := (*C.codec_fragment)(C.calloc(C.size_t(count), C.size_t(unsafe.Sizeof(C.codec_fragment{}))))
+		if cfragments == nil {
+			return fmt.Errorf("ERROR, %s failed, out of memory", name)
+		}
+		defer C.free(unsafe.Pointer(cfragments))
+		fragments = unsafe.Slice(cfragments, count)
+	}
+	for i := range frames {
+		f := &frames[i]
+		d := &descriptors[i]
+		pinner.Pin(&f.Input[0])
+		d.input = (*C.uchar)(unsafe.Pointer(&f.Input[0]))
+		d.input_size = C.int(len(f.Input))
+		d.output = nil
+		if len(f.Output) > 0 {
+			pinner.Pin(&f.Output[0])
+			d.output = (*C.uchar)(unsafe.Pointer(&f.Output[0]))
+		}
+		d.output_size = C.int(len(f.Output))
+		if len(f.Fragments) > 0 {
+			d.fragments = &fragments[0]
+			d.fragment_count = C.int(len(f.Fragments))
+			for k, fragment := range f.Fragments {
+				if len(fragment) > 0 {
+					pinner.Pin(&fragment[0])
+					fragments[k].data = (*C.uchar)(unsafe.Pointer(&fragment[0]))
+					fragments[k].size = C.int(len(fragment))
+				}
+			}
+			fragments = fragments[len(f.Fragments):]
+		}
+	}
+
+	run(cframes, C.int(len(frames)), C.int(threads))
+
+	var first error
+	for i := range frames {
+		f := &frames[i]
+		d := &descriptors[i]
+		f.Size = int(d.size)
+		f.Err = nil
+		switch {
+		case d.status != 1:
+			f.Size = 0
+			f.Err = errors.New("ERROR, " + name + " failed")
+		case encode && f.Size > len(f.Output):
+			f.Err = ErrBufferTooSmall
+		case f.Size <= 0:
+			f.Err = errors.New("ERROR, " + name + " failed")
+		}
+		if first == nil && f.Err != nil {
+			first = f.Err
+		}
+	}
+	return first
+}
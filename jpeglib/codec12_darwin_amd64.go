@@ -1,34 +1,41 @@
 package jpeglib
 
 // #cgo CFLAGS: -I dcmjpeg/libijg12 -I dcmjpeg/darwin_amd64
-// #cgo LDFLAGS: -L dcmjpeg/darwin_amd64 -lijg12
+// #cgo LDFLAGS: -L dcmjpeg/darwin_amd64 -lijg12 -lpthread
 // #include "dcmjpeg/dijg12.c"
 // #include "dcmjpeg/eijg12.c"
 import  "C"
 import (
 	"errors"
-	"unsafe"
 )
 
 // DIJG12decode - JPEG File to RAW
 func DIJG12decode(jpegData []byte, jpegSize uint32, outputData []byte, outputSize uint32) error {
-	if C.decode12((*C.uchar)(unsafe.Pointer(&jpegData[0])), C.int(jpegSize), (*C.uchar)(unsafe.Pointer(&outputData[0])), C.int(outputSize)) == 1 {
-		return nil
+	dec, _ := jpegDecoder12Pool.Get().(*JPEGDecoder12)
+	if dec == nil {
+		return errors.New("ERROR, Decode12 JPEG failed")
 	}
-	return errors.New("ERROR, Decode12 JPEG failed")
+	defer jpegDecoder12Pool.Put(dec)
+	return dec.Decode(jpegData, jpegSize, outputData, outputSize)
 }
 
 // EIJG12encode - RAW File to JPEG
 func EIJG12encode(rawData []uint8, width uint16, height uint16, samples uint16, outData *[]byte, outSize *int, mode int) error {
-	var jpegData *C.uchar
-	var jpegSize C.int
-	if C.encode12((*C.ushort)(unsafe.Pointer(&rawData[0])), C.ushort(width), C.ushort(height), C.ushort(samples), &jpegData, &jpegSize, C.int(mode)) == 1 {
-		if jpegSize > 0 {
-			*outData = C.GoBytes(unsafe.Pointer(jpegData), jpegSize)
-			*outSize = int(jpegSize)
-			C.free(unsafe.Pointer(jpegData))
-			return nil
-		}
+	enc, _ := jpegEncoder12Pool.Get().(*JPEGEncoder12)
+	if enc == nil {
+		return errors.New("ERROR, Encode12 JPEG failed")
 	}
-	return errors.New("ERROR, Encode12 JPEG failed")
+	defer jpegEncoder12Pool.Put(enc)
+	return enc.Encode(rawData, width, height, samples, outData, outSize, mode)
+}
+
+// EIJG12encodeTo - RAW File to JPEG, written straight into outData. Returns the bytes written,
+// or ErrBufferTooSmall together with the size outData needs to hold the whole frame
+func EIJG12encodeTo(rawData []uint8, width uint16, height uint16, samples uint16, outData []byte, mode int) (int, error) {
+	enc, _ := jpegEncoder12Pool.Get().(*JPEGEncoder12)
+	if enc == nil {
+		return 0, errors.New("ERROR, Encode12 JPEG failed")
+	}
+	defer jpegEncoder12Pool.Put(enc)
+	return enc.EncodeTo(rawData, width, height, samples, outData, mode)
 }
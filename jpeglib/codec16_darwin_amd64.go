@@ -1,34 +1,41 @@
 package jpeglib
 
 // #cgo CFLAGS: -I dcmjpeg/libijg16 -I dcmjpeg/darwin_amd64
-// #cgo LDFLAGS: -L dcmjpeg/darwin_amd64 -lijg16
+// #cgo LDFLAGS: -L dcmjpeg/darwin_amd64 -lijg16 -lpthread
 // #include "dcmjpeg/dijg16.c"
 // #include "dcmjpeg/eijg16.c"
 import  "C"
 import (
 	"errors"
-	"unsafe"
 )
 
 // DIJG16decode - JPEG File to RAW
 func DIJG16decode(jpegData []byte, jpegSize uint32, outputData []byte, outputSize uint32) error {
-	if C.decode16((*C.uchar)(unsafe.Pointer(&jpegData[0])), C.int(jpegSize), (*C.uchar)(unsafe.Pointer(&outputData[0])), C.int(outputSize)) == 1 {
-		return nil
+	dec, _ := jpegDecoder16Pool.Get().(*JPEGDecoder16)
+	if dec == nil {
+		return errors.New("ERROR, Decode16 JPEG failed")
 	}
-	return errors.New("ERROR, Decode16 JPEG failed")
+	defer jpegDecoder16Pool.Put(dec)
+	return dec.Decode(jpegData, jpegSize, outputData, outputSize)
 }
 
 // EIJG16encode - RAW File to JPEG
 func EIJG16encode(rawData []uint8, width uint16, height uint16, samples uint16, outData *[]byte, outSize *int, mode int) error {
-	var jpegData *C.uchar
-	var jpegSize C.int
-	if C.encode16((*C.ushort)(unsafe.Pointer(&rawData[0])), C.ushort(width), C.ushort(height), C.ushort(samples), &jpegData, &jpegSize, C.int(mode)) == 1 {
-		if jpegSize > 0 {
-			*outData = C.GoBytes(unsafe.Pointer(jpegData), jpegSize)
-			*outSize = int(jpegSize)
-			C.free(unsafe.Pointer(jpegData))
-			return nil
-		}
+	enc, _ := jpegEncoder16Pool.Get().(*JPEGEncoder16)
+	if enc == nil {
+		return errors.New("ERROR, Encode16 JPEG failed")
 	}
-	return errors.New("ERROR, Encode16 JPEG failed")
+	defer jpegEncoder16Pool.Put(enc)
+	return enc.Encode(rawData, width, height, samples, outData, outSize, mode)
+}
+
+// EIJG16encodeTo - RAW File to JPEG, written straight into outData. Returns the bytes written,
+// or ErrBufferTooSmall together with the size outData needs to hold the whole frame
+func EIJG16encodeTo(rawData []uint8, width uint16, height uint16, samples uint16, outData []byte, mode int) (int, error) {
+	enc, _ := jpegEncoder16Pool.Get().(*JPEGEncoder16)
+	if enc == nil {
+		return 0, errors.New("ERROR, Encode16 JPEG failed")
+	}
+	defer jpegEncoder16Pool.Put(enc)
+	return enc.EncodeTo(rawData, width, height, samples, outData, mode)
 }
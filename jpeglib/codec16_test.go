@@ -1,6 +1,7 @@
 package jpeglib
 
 import (
+	"bytes"
 	"testing"
 )
 
@@ -65,3 +66,110 @@ func Test_DIJG16encode(t *testing.T) {
 		})
 	}
 }
+
+func Test_DIJG16decodeSIMD(t *testing.T) {
+	type args struct {
+		fileName string
+		width    uint16
+		height   uint16
+		samples  uint16
+		encode   bool
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should decode a gray lossless frame identically on every instruction set",
+			args:    args{fileName: "../samples/dicom.jpl", width: 1992, height: 1936, samples: 1},
+			wantErr: false,
+		},
+		{
+			name:    "Should decode an interleaved lossless frame of odd width identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1573, height: 567, samples: 3, encode: true},
+			wantErr: false,
+		},
+	}
+	defer setSIMDLevel(-1)
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var jpegData []byte
+
+			if LoadFromFile(tt.args.fileName, &jpegData) {
+				if tt.args.encode {
+					var jpegSize int
+					rawData := jpegData
+					jpegData = nil
+					if err := EIJG16encode(rawData, tt.args.width, tt.args.height, tt.args.samples, &jpegData, &jpegSize, 0); err != nil {
+						t.Fatalf("EIJG16encode() error = %v", err)
+					}
+					jpegData = jpegData[:jpegSize]
+				}
+				outSize := int(tt.args.width) * int(tt.args.height) * int(tt.args.samples) * 2
+				setSIMDLevel(simdScalar)
+				libData := make([]byte, outSize)
+				if err := DIJG16decode(jpegData, uint32(len(jpegData)), libData, uint32(outSize)); err != nil {
+					t.Fatalf("DIJG16decode() error = %v", err)
+				}
+				for _, level := range []int{simdAVX2, simdNEON} {
+					if setSIMDLevel(level) != level {
+						continue
+					}
+					outData := make([]byte, outSize)
+					if err := DIJG16decode(jpegData, uint32(len(jpegData)), outData, uint32(outSize)); (err != nil) != tt.wantErr {
+						t.Fatalf("DIJG16decode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					if !bytes.Equal(outData, libData) {
+						t.Errorf("DIJG16decode() level %d output differs from libijg16", level)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_DIJG16predictorsSIMD(t *testing.T) {
+	type args struct {
+		width int
+	}
+	tests := []struct {
+		name string
+		args args
+	}{
+		{
+			name: "Should undifference rows of one sample",
+			args: args{width: 1},
+		},
+		{
+			name: "Should undifference rows past a vector",
+			args: args{width: 13},
+		},
+		{
+			name: "Should undifference rows of whole vectors and one sample",
+			args: args{width: 65},
+		},
+		{
+			name: "Should undifference wide rows",
+			args: args{width: 1992},
+		},
+	}
+	defer setSIMDLevel(-1)
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			for _, level := range []int{simdAVX2, simdNEON} {
+				if setSIMDLevel(level) != level {
+					continue
+				}
+				for predictor := 1; predictor <= 7; predictor++ {
+					for _, overflow := range []bool{false, true} {
+						seed := uint32(level*64 + predictor*8 + tt.args.width)
+						if got := predictorMatches(predictor, overflow, tt.args.width, seed); got == 0 {
+							t.Errorf("predictorMatches() level %d predictor %d overflow %v differs from libijg16", level, predictor, overflow)
+						}
+					}
+				}
+			}
+		})
+	}
+}
@@ -1,34 +1,41 @@
 package jpeglib
 
 // #cgo CFLAGS: -I dcmjpeg/libijg8 -I dcmjpeg/darwin_amd64
-// #cgo LDFLAGS: -L dcmjpeg/darwin_amd64 -lijg8
+// #cgo LDFLAGS: -L dcmjpeg/darwin_amd64 -lijg8 -lpthread
 // #include "dcmjpeg/dijg8.c"
 // #include "dcmjpeg/eijg8.c"
 import  "C"
 import (
 	"errors"
-	"unsafe"
 )
 
 // DIJG8decode - JPEG File to RAW
 func DIJG8decode(jpegData []byte, jpegSize uint32, outputData []byte, outputSize uint32) error {
-	if C.decode8((*C.uchar)(unsafe.Pointer(&jpegData[0])), C.int(jpegSize), (*C.uchar)(unsafe.Pointer(&outputData[0])), C.int(outputSize)) == 1 {
-		return nil
+	dec, _ := jpegDecoder8Pool.Get().(*JPEGDecoder8)
+	if dec == nil {
+		return errors.New("ERROR, Decode8, JPEG failed")
 	}
-	return errors.New("ERROR, Decode8, JPEG failed")
+	defer jpegDecoder8Pool.Put(dec)
+	return dec.Decode(jpegData, jpegSize, outputData, outputSize)
 }
 
 // EIJG8encode - RAW File to JPEG
 func EIJG8encode(rawData []byte, width uint16, height uint16, samples uint16, outData *[]byte, outSize *int, mode int) error {
-	var jpegData *C.uchar
-	var jpegSize C.int
-	if C.encode8((*C.uchar)(unsafe.Pointer(&rawData[0])), C.ushort(width), C.ushort(height), C.ushort(samples), &jpegData, &jpegSize, C.int(mode)) == 1 {
-		if jpegSize > 0 {
-			*outData = C.GoBytes(unsafe.Pointer(jpegData), jpegSize)
-			*outSize = int(jpegSize)
-			C.free(unsafe.Pointer(jpegData))
-			return nil
-		}
+	enc, _ := jpegEncoder8Pool.Get().(*JPEGEncoder8)
+	if enc == nil {
+		return errors.New("ERROR, Encode8, JPEG failed")
 	}
-	return errors.New("ERROR, Encode8, JPEG failed")
+	defer jpegEncoder8Pool.Put(enc)
+	return enc.Encode(rawData, width, height, samples, outData, outSize, mode)
+}
+
+// EIJG8encodeTo - RAW File to JPEG, written straight into outData. Returns the bytes written,
+// or ErrBufferTooSmall together with the size outData needs to hold the whole frame
+func EIJG8encodeTo(rawData []byte, width uint16, height uint16, samples uint16, outData []byte, mode int) (int, error) {
+	enc, _ := jpegEncoder8Pool.Get().(*JPEGEncoder8)
+	if enc == nil {
+		return 0, errors.New("ERROR, Encode8, JPEG failed")
+	}
+	defer jpegEncoder8Pool.Put(enc)
+	return enc.EncodeTo(rawData, width, height, samples, outData, mode)
 }
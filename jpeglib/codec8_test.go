@@ -1,8 +1,12 @@
 package jpeglib
 
 import (
+	"bytes"
+	"errors"
 	"os"
 	"testing"
+
+	"github.com/innovative-io/io-dicom/colorspace"
 )
 
 func TestDIJG8decode(t *testing.T) {
@@ -67,6 +71,639 @@ func Test_DIJG8encode(t *testing.T) {
 	}
 }
 
+func Test_EIJG8encodeTo(t *testing.T) {
+	type args struct {
+		fileName string
+		mode     int
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should encode jpeg 8 lossless image into a caller buffer",
+			args:    args{fileName: "../samples/test.raw", mode: 4},
+			wantErr: false,
+		},
+		{
+			name:    "Should encode jpeg 8 baseline image into a caller buffer",
+			args:    args{fileName: "../samples/test.raw", mode: 0},
+			wantErr: false,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var jpegData []byte
+			var jpegSize int
+			rawData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &rawData) {
+				if err := EIJG8encode(rawData, 1576, 1134, 3, &jpegData, &jpegSize, tt.args.mode); err != nil {
+					t.Fatalf("EIJG8encode() error = %v", err)
+				}
+				size, err := EIJG8encodeTo(rawData, 1576, 1134, 3, make([]byte, 1024), tt.args.mode)
+				if !errors.Is(err, ErrBufferTooSmall) || size != jpegSize {
+					t.Fatalf("EIJG8encodeTo() size = %v, error = %v, want %v and ErrBufferTooSmall", size, err, jpegSize)
+				}
+				outData := make([]byte, size)
+				size, err = EIJG8encodeTo(rawData, 1576, 1134, 3, outData, tt.args.mode)
+				if (err != nil) != tt.wantErr {
+					t.Errorf("EIJG8encodeTo() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				if !bytes.Equal(outData[:size], jpegData) {
+					t.Errorf("EIJG8encodeTo() output differs from EIJG8encode()")
+				}
+			}
+		})
+	}
+}
+
+func Test_JPEGEncoder8(t *testing.T) {
+	type args struct {
+		fileName string
+		modes    []int
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should reuse one encoder and decoder across lossless and baseline frames",
+			args:    args{fileName: "../samples/test.raw", modes: []int{4, 0, 4, 0}},
+			wantErr: false,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			rawData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &rawData) {
+				enc, err := NewJPEGEncoder8()
+				if err != nil {
+					t.Fatalf("NewJPEGEncoder8() error = %v", err)
+				}
+				defer enc.Close()
+				dec, err := NewJPEGDecoder8()
+				if err != nil {
+					t.Fatalf("NewJPEGDecoder8() error = %v", err)
+				}
+				defer dec.Close()
+				for _, mode := range tt.args.modes {
+					var jpegData, want []byte
+					var jpegSize, wantSize int
+					if err := enc.Encode(rawData, 1576, 1134, 3, &jpegData, &jpegSize, mode); (err != nil) != tt.wantErr {
+						t.Fatalf("JPEGEncoder8.Encode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					if err := EIJG8encode(rawData, 1576, 1134, 3, &want, &wantSize, mode); err != nil {
+						t.Fatalf("EIJG8encode() error = %v", err)
+					}
+					if !bytes.Equal(jpegData, want) {
+						t.Errorf("JPEGEncoder8.Encode() mode %d output differs from a fresh encoder", mode)
+					}
+					outData := make([]byte, len(rawData))
+					if err := dec.Decode(jpegData, uint32(jpegSize), outData, uint32(len(outData))); (err != nil) != tt.wantErr {
+						t.Fatalf("JPEGDecoder8.Decode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					if mode == 4 && !bytes.Equal(outData, rawData) {
+						t.Errorf("JPEGDecoder8.Decode() lossless frame differs from the source")
+					}
+					if err := dec.Decode(jpegData[:16], 16, outData, uint32(len(outData))); err == nil {
+						t.Errorf("JPEGDecoder8.Decode() truncated frame, want error")
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_EIJG8encodeBatch(t *testing.T) {
+	type args struct {
+		fileName string
+		count    int
+		threads  int
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should encode and decode a batch of lossless frames on native threads",
+			args:    args{fileName: "../samples/test.raw", count: 6, threads: 3},
+			wantErr: false,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			rawData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &rawData) {
+				var want []byte
+				var wantSize int
+				if err := EIJG8encode(rawData, 1576, 1134, 3, &want, &wantSize, 4); err != nil {
+					t.Fatalf("EIJG8encode() error = %v", err)
+				}
+				frames := make([]Frame, tt.args.count)
+				for i := range frames {
+					frames[i].Input = rawData
+					frames[i].Output = make([]byte, len(rawData)+2048)
+				}
+				frames[0].Output = frames[0].Output[:16]
+				if err := EIJG8encodeBatch(frames, 1576, 1134, 3, 4, 0, tt.args.threads); err != ErrBufferTooSmall {
+					t.Fatalf("EIJG8encodeBatch() error = %v, want %v", err, ErrBufferTooSmall)
+				}
+				if frames[0].Size != wantSize {
+					t.Errorf("EIJG8encodeBatch() short frame size = %d, want %d", frames[0].Size, wantSize)
+				}
+				for i := 1; i < len(frames); i++ {
+					if frames[i].Err != nil || !bytes.Equal(frames[i].Output[:frames[i].Size], want) {
+						t.Errorf("EIJG8encodeBatch() frame %d error = %v, output differs from EIJG8encode", i, frames[i].Err)
+					}
+				}
+				decoded := make([]Frame, tt.args.count-1)
+				for i := range decoded {
+					decoded[i].Input = frames[i+1].Output[:frames[i+1].Size]
+					decoded[i].Output = make([]byte, len(rawData))
+				}
+				if err := DIJG8decodeBatch(decoded, tt.args.threads); (err != nil) != tt.wantErr {
+					t.Fatalf("DIJG8decodeBatch() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				for i := range decoded {
+					if !bytes.Equal(decoded[i].Output, rawData) {
+						t.Errorf("DIJG8decodeBatch() frame %d differs from the source", i)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_DIJG8decodeScaled(t *testing.T) {
+	type args struct {
+		fileName string
+		denom    int
+	}
+	tests := []struct {
+		name       string
+		args       args
+		wantWidth  int
+		wantHeight int
+		wantErr    bool
+	}{
+		{
+			name:       "Should decode jpeg 8 image at full size",
+			args:       args{fileName: "../samples/test8.jpg", denom: 1},
+			wantWidth:  1576,
+			wantHeight: 1134,
+			wantErr:    false,
+		},
+		{
+			name:       "Should decode jpeg 8 image at half size",
+			args:       args{fileName: "../samples/test8.jpg", denom: 2},
+			wantWidth:  788,
+			wantHeight: 567,
+			wantErr:    false,
+		},
+		{
+			name:       "Should decode jpeg 8 image at an eighth of its size",
+			args:       args{fileName: "../samples/test8.jpg", denom: 8},
+			wantWidth:  197,
+			wantHeight: 142,
+			wantErr:    false,
+		},
+		{
+			name:    "Should not decode jpeg 8 image at a third of its size",
+			args:    args{fileName: "../samples/test8.jpg", denom: 3},
+			wantErr: true,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var jpegData []byte
+
+			if LoadFromFile(tt.args.fileName, &jpegData) {
+				outData, width, height, err := DIJG8decodeScaled(jpegData, tt.args.denom)
+				if (err != nil) != tt.wantErr {
+					t.Fatalf("DIJG8decodeScaled() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				if tt.wantErr {
+					return
+				}
+				if width != tt.wantWidth || height != tt.wantHeight || len(outData) != width*height*3 {
+					t.Errorf("DIJG8decodeScaled() = %dx%d, %d bytes, want %dx%d", width, height, len(outData), tt.wantWidth, tt.wantHeight)
+				}
+				if tt.args.denom == 1 {
+					full := make([]byte, 1576*1134*3)
+					if err := DIJG8decode(jpegData, uint32(len(jpegData)), full, uint32(len(full))); err != nil || !bytes.Equal(outData, full) {
+						t.Errorf("DIJG8decodeScaled() full size differs from DIJG8decode(), error = %v", err)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_JPEGprobe(t *testing.T) {
+	var jpegData []byte
+	LoadFromFile("../samples/test8.jpg", &jpegData)
+	var losslessData []byte
+	LoadFromFile("../samples/dicom.jpl", &losslessData)
+
+	tests := []struct {
+		name    string
+		data    []byte
+		want    JPEGInfo
+		wantErr bool
+	}{
+		{
+			name: "Should read the frame header of a baseline image",
+			data: jpegData,
+			want: JPEGInfo{Width: 1576, Height: 1134, Components: 3, Precision: 8, Process: 0, MaxH: 2, MaxV: 2},
+		},
+		{
+			name: "Should read the frame header of a lossless image",
+			data: losslessData,
+			want: JPEGInfo{Width: 1992, Height: 1936, Components: 1, Precision: 16, Process: 3, MaxH: 1, MaxV: 1},
+		},
+		{
+			name:    "Should not read a header cut short",
+			data:    jpegData[:100],
+			wantErr: true,
+		},
+		{
+			name:    "Should not read a J2K codestream",
+			data:    []byte{0xFF, 0x4F, 0xFF, 0x51, 0x00, 0x02},
+			wantErr: true,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			got, err := JPEGprobe(tt.data)
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("JPEGprobe() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			if tt.wantErr {
+				return
+			}
+			if got != tt.want {
+				t.Errorf("JPEGprobe() = %+v, want %+v", got, tt.want)
+			}
+			outData := make([]byte, got.RawSize())
+			decode := DIJG8decode
+			if got.Precision > 8 {
+				decode = DIJG16decode
+			}
+			if err := decode(tt.data, uint32(len(tt.data)), outData, uint32(len(outData))); err != nil {
+				t.Errorf("decode into RawSize() bytes error = %v", err)
+			}
+		})
+	}
+}
+
+func Test_DIJG8decodeBatchYCbCr(t *testing.T) {
+	type args struct {
+		fileName string
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should keep a YCbCr jpeg 8 image in YCbCr",
+			args:    args{fileName: "../samples/test8.jpg"},
+			wantErr: false,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var jpegData []byte
+
+			if LoadFromFile(tt.args.fileName, &jpegData) {
+				outSize := 1576 * 1134 * 3
+				rgb := []Frame{{Input: jpegData, Output: make([]byte, outSize)}}
+				ybr := []Frame{{Input: jpegData, Output: make([]byte, outSize)}}
+				if err := DIJG8decodeBatch(rgb, 1); err != nil {
+					t.Fatalf("DIJG8decodeBatch() error = %v", err)
+				}
+				if err := DIJG8decodeBatchYCbCr(ybr, 1); (err != nil) != tt.wantErr {
+					t.Fatalf("DIJG8decodeBatchYCbCr() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				if bytes.Equal(ybr[0].Output, rgb[0].Output) {
+					t.Fatalf("DIJG8decodeBatchYCbCr() converted the frame to RGB")
+				}
+				colorspace.YBRFullToRGB(ybr[0].Output, ybr[0].Output)
+				for i := range rgb[0].Output {
+					if d := int(ybr[0].Output[i]) - int(rgb[0].Output[i]); d < -1 || d > 1 {
+						t.Fatalf("DIJG8decodeBatchYCbCr() sample %d = %d as RGB, want %d", i, ybr[0].Output[i], rgb[0].Output[i])
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_DIJG8decodeBatchRestart(t *testing.T) {
+	type args struct {
+		fileName    string
+		width       uint16
+		height      uint16
+		samples     uint16
+		restartRows int
+		threads     int
+	}
+	tests := []struct {
+		name       string
+		args       args
+		wantStripe bool
+	}{
+		{
+			name:       "Should decode a color frame restarted every MCU row in stripes",
+			args:       args{fileName: "../samples/test.raw", width: 1576, height: 1134, samples: 3, restartRows: 1, threads: 4},
+			wantStripe: true,
+		},
+		{
+			name:       "Should decode a gray frame restarted every 3 MCU rows in stripes",
+			args:       args{fileName: "../samples/test.raw", width: 1575, height: 1134, samples: 1, restartRows: 3, threads: 3},
+			wantStripe: true,
+		},
+		{
+			name:       "Should decode a frame without restart markers whole",
+			args:       args{fileName: "../samples/test.raw", width: 1576, height: 1134, samples: 3, restartRows: 0, threads: 4},
+			wantStripe: false,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var rawData []byte
+
+			if LoadFromFile(tt.args.fileName, &rawData) {
+				var jpegData []byte
+				var jpegSize int
+				enc, err := NewJPEGEncoder8()
+				if err != nil {
+					t.Fatalf("NewJPEGEncoder8() error = %v", err)
+				}
+				defer enc.Close()
+				enc.SetRestartRows(tt.args.restartRows)
+				if err := enc.Encode(rawData, tt.args.width, tt.args.height, tt.args.samples, &jpegData, &jpegSize, 0); err != nil {
+					t.Fatalf("JPEGEncoder8.Encode() error = %v", err)
+				}
+				batch := []Frame{{Input: rawData, Output: make([]byte, jpegSize)}}
+				if err := EIJG8encodeBatch(batch, tt.args.width, tt.args.height, tt.args.samples, 0, tt.args.restartRows, 1); err != nil {
+					t.Fatalf("EIJG8encodeBatch() error = %v", err)
+				}
+				if !bytes.Equal(batch[0].Output[:batch[0].Size], jpegData) {
+					t.Errorf("EIJG8encodeBatch() with %d restart rows differs from JPEGEncoder8.Encode", tt.args.restartRows)
+				}
+				outSize := int(tt.args.width) * int(tt.args.height) * int(tt.args.samples)
+				if _, ok := restartStripes(jpegData, make([]byte, outSize), 1, tt.args.threads); ok != tt.wantStripe {
+					t.Fatalf("restartStripes() = %v, want %v", ok, tt.wantStripe)
+				}
+				whole := []Frame{{Input: jpegData, Output: make([]byte, outSize)}}
+				if err := DIJG8decodeBatch(whole, 1); err != nil {
+					t.Fatalf("DIJG8decodeBatch() error = %v", err)
+				}
+				striped := []Frame{{Input: jpegData, Output: make([]byte, outSize)}}
+				if err := DIJG8decodeBatch(striped, tt.args.threads); err != nil {
+					t.Fatalf("DIJG8decodeBatch() on %d threads error = %v", tt.args.threads, err)
+				}
+				if striped[0].Size != outSize || !bytes.Equal(striped[0].Output, whole[0].Output) {
+					t.Errorf("DIJG8decodeBatch() on %d threads differs from the frame decoded on one", tt.args.threads)
+				}
+			}
+		})
+	}
+}
+
+func Test_DIJG8decodeBatchFragments(t *testing.T) {
+	type args struct {
+		fileName string
+		cuts     []int
+	}
+	tests := []struct {
+		name string
+		args args
+	}{
+		{
+			name: "Should decode a jpeg 8 image split in the middle of its entropy coded data",
+			args: args{fileName: "../samples/test8.jpg", cuts: []int{100000, 200000}},
+		},
+		{
+			name: "Should decode a jpeg 8 image split inside the markers it reads and skips",
+			args: args{fileName: "../samples/test8.jpg", cuts: []int{3, 24, 25}},
+		},
+		{
+			name: "Should decode a jpeg 8 image with empty fragments",
+			args: args{fileName: "../samples/test8.jpg", cuts: []int{50000, 50000, 50001}},
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var jpegData []byte
+
+			if LoadFromFile(tt.args.fileName, &jpegData) {
+				outSize := 1576 * 1134 * 3
+				whole := []Frame{{Input: jpegData, Output: make([]byte, outSize)}}
+				if err := DIJG8decodeBatch(whole, 1); err != nil {
+					t.Fatalf("DIJG8decodeBatch() error = %v", err)
+				}
+				var fragments [][]byte
+				for k, cut := range tt.args.cuts {
+					next := len(jpegData)
+					if k+1 < len(tt.args.cuts) {
+						next = tt.args.cuts[k+1]
+					}
+					fragments = append(fragments, jpegData[cut:next])
+				}
+				// twice, so a decoder runs a fragmented frame after another one
+				split := []Frame{
+					{Input: jpegData[:tt.args.cuts[0]], Fragments: fragments, Output: make([]byte, outSize)},
+					{Input: jpegData[:tt.args.cuts[0]], Fragments: fragments, Output: make([]byte, outSize)},
+				}
+				if err := DIJG8decodeBatch(split, 1); err != nil {
+					t.Fatalf("DIJG8decodeBatch() fragments error = %v", err)
+				}
+				for i := range split {
+					if !bytes.Equal(split[i].Output, whole[0].Output) {
+						t.Errorf("DIJG8decodeBatch() frame %d from fragments differs from the whole frame", i)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_DIJG8decodeSIMD(t *testing.T) {
+	type args struct {
+		fileName string
+		width    uint16
+		height   uint16
+		samples  uint16
+		encode   bool
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should decode a subsampled YCbCr frame identically on every instruction set",
+			args:    args{fileName: "../samples/test8.jpg", width: 1576, height: 1134, samples: 3},
+			wantErr: false,
+		},
+		{
+			name:    "Should decode a gray baseline frame identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1575, height: 1134, samples: 1, encode: true},
+			wantErr: false,
+		},
+		{
+			name:    "Should decode an RGB baseline frame of odd width identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1573, height: 1133, samples: 3, encode: true},
+			wantErr: false,
+		},
+	}
+	defer setSIMDLevel(-1)
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var jpegData []byte
+
+			if LoadFromFile(tt.args.fileName, &jpegData) {
+				if tt.args.encode {
+					var jpegSize int
+					rawData := jpegData
+					jpegData = nil
+					if err := EIJG8encode(rawData, tt.args.width, tt.args.height, tt.args.samples, &jpegData, &jpegSize, 0); err != nil {
+						t.Fatalf("EIJG8encode() error = %v", err)
+					}
+				}
+				outSize := int(tt.args.width) * int(tt.args.height) * int(tt.args.samples)
+				setSIMDLevel(simdScalar)
+				libData := make([]byte, outSize)
+				if err := DIJG8decode(jpegData, uint32(len(jpegData)), libData, uint32(outSize)); err != nil {
+					t.Fatalf("DIJG8decode() error = %v", err)
+				}
+				for _, level := range []int{simdAVX2, simdNEON} {
+					if setSIMDLevel(level) != level {
+						continue
+					}
+					outData := make([]byte, outSize)
+					if err := DIJG8decode(jpegData, uint32(len(jpegData)), outData, uint32(outSize)); (err != nil) != tt.wantErr {
+						t.Fatalf("DIJG8decode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					if !bytes.Equal(outData, libData) {
+						t.Errorf("DIJG8decode() level %d output differs from libijg8", level)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_EIJG8encodeSIMD(t *testing.T) {
+	type args struct {
+		fileName string
+		width    uint16
+		height   uint16
+		samples  uint16
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should encode a gray baseline frame identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1575, height: 1134, samples: 1},
+			wantErr: false,
+		},
+		{
+			name:    "Should encode an RGB baseline frame identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1576, height: 1134, samples: 3},
+			wantErr: false,
+		},
+	}
+	defer setSIMDLevel(-1)
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var rawData []byte
+
+			if LoadFromFile(tt.args.fileName, &rawData) {
+				var libData []byte
+				var libSize int
+				setSIMDLevel(simdScalar)
+				if err := EIJG8encode(rawData, tt.args.width, tt.args.height, tt.args.samples, &libData, &libSize, 0); err != nil {
+					t.Fatalf("EIJG8encode() error = %v", err)
+				}
+				for _, level := range []int{simdAVX2, simdNEON} {
+					if setSIMDLevel(level) != level {
+						continue
+					}
+					var jpegData []byte
+					var jpegSize int
+					if err := EIJG8encode(rawData, tt.args.width, tt.args.height, tt.args.samples, &jpegData, &jpegSize, 0); (err != nil) != tt.wantErr {
+						t.Fatalf("EIJG8encode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					if !bytes.Equal(jpegData[:jpegSize], libData[:libSize]) {
+						t.Errorf("EIJG8encode() level %d output differs from libijg8", level)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_DIJG8kernelsSIMD(t *testing.T) {
+	type args struct {
+		magnitude int
+		quant     int
+		width     int
+	}
+	tests := []struct {
+		name string
+		args args
+	}{
+		{
+			name: "Should transform blocks of small coefficients and convert a row of one pixel",
+			args: args{magnitude: 64, quant: 255, width: 1},
+		},
+		{
+			name: "Should transform blocks of coefficients up to the valid range and convert a row past a vector",
+			args: args{magnitude: 1024, quant: 1, width: 13},
+		},
+		{
+			name: "Should transform blocks of coefficients up to the kernel limit and convert a row of whole vectors",
+			args: args{magnitude: 1173, quant: 1, width: 64},
+		},
+		{
+			name: "Should hand blocks of large coefficients to the library and convert a wide row",
+			args: args{magnitude: 32767, quant: 65535, width: 1573},
+		},
+	}
+	defer setSIMDLevel(-1)
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			for _, level := range []int{simdAVX2, simdNEON} {
+				if setSIMDLevel(level) != level {
+					continue
+				}
+				seed := uint32(level*16 + tt.args.width)
+				if got := idctMatches(tt.args.magnitude, tt.args.quant, seed); got == 0 {
+					t.Errorf("idctMatches() level %d differs from libijg8", level)
+				}
+				if got := fdctMatches(seed); got == 0 {
+					t.Errorf("fdctMatches() level %d differs from libijg8", level)
+				}
+				if got := colorMatches(tt.args.width, seed); got == 0 {
+					t.Errorf("colorMatches() level %d differs from libijg8", level)
+				}
+			}
+		})
+	}
+}
+
 func LoadFromFile(FileName string, buffer *[]byte) bool {
 	file, err := os.Open(FileName)
 	if err != nil {
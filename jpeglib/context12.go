@@ -0,0 +1,162 @@
+package jpeglib
+
+/*
+#include <stdlib.h>
+
+// defined in dcmjpeg/dijg12.c and dcmjpeg/eijg12.c, compiled by the platform file
+struct DJDIJG12DecoderStruct;
+struct DJDIJG12DecoderStruct *decoder12_create(void);
+void decoder12_destroy(struct DJDIJG12DecoderStruct *dec);
+int decoder12_decode(struct DJDIJG12DecoderStruct *dec, unsigned char *jpeg_data, int jpeg_size, unsigned char *output_data, int output_size);
+
+struct EIJG12EncoderStruct;
+struct EIJG12EncoderStruct *encoder12_create(void);
+void encoder12_destroy(struct EIJG12EncoderStruct *enc);
+void encoder12_set_restart_rows(struct EIJG12EncoderStruct *enc, int rows);
+int encoder12_encode(struct EIJG12EncoderStruct *enc, unsigned short *image_buffer, unsigned short width, unsigned short height, unsigned short samplesPerPixel, unsigned char **jpegBuf, int *jpegSize, int mode);
+int encoder12_encode_to(struct EIJG12EncoderStruct *enc, unsigned short *image_buffer, unsigned short width, unsigned short height, unsigned short samplesPerPixel, unsigned char *outBuf, int outCapacity, int *jpegSize, int mode);
+*/
+import "C"
+import (
+	"errors"
+	"runtime"
+	"sync"
+	"unsafe"
+)
+
+// JPEGDecoder12 - reusable 12 bit JPEG decoder, keeps the IJG decompressor and its memory pools
+// between frames. A decoder is not safe for concurrent use, share it through a sync.Pool
+type JPEGDecoder12 struct {
+	dec *C.struct_DJDIJG12DecoderStruct
+}
+
+// JPEGEncoder12 - reusable 12 bit JPEG encoder, keeps the IJG compressor, its tables and the
+// destination manager between frames. An encoder is not safe for concurrent use
+type JPEGEncoder12 struct {
+	enc *C.struct_EIJG12EncoderStruct
+}
+
+// jpegDecoder12Pool - decoders shared by DIJG12decode across frames and goroutines
+var jpegDecoder12Pool = sync.Pool{
+	New: func() interface{} {
+		dec, _ := NewJPEGDecoder12()
+		return dec
+	},
+}
+
+// jpegEncoder12Pool - encoders shared by EIJG12encode and EIJG12encodeTo
+var jpegEncoder12Pool = sync.Pool{
+	New: func() interface{} {
+		enc, _ := NewJPEGEncoder12()
+		return enc
+	},
+}
+
+// NewJPEGDecoder12 - create a reusable 12 bit JPEG decoder
+func NewJPEGDecoder12() (*JPEGDecoder12, error) {
+	dec := C.decoder12_create()
+	if dec == nil {
+		return nil, errors.New("ERROR, NewJPEGDecoder12, can't create decoder")
+	}
+	d := &JPEGDecoder12{dec: dec}
+	runtime.SetFinalizer(d, (*JPEGDecoder12).Close)
+	return d, nil
+}
+
+// Decode - JPEG File to RAW
+func (d *JPEGDecoder12) Decode(jpegData []byte, jpegSize uint32, outputData []byte, outputSize uint32) error {
+	if d.dec == nil {
+		return errors.New("ERROR, Decode12 JPEG decoder closed")
+	}
+	ok := C.decoder12_decode(d.dec, (*C.uchar)(unsafe.Pointer(&jpegData[0])), C.int(jpegSize), (*C.uchar)(unsafe.Pointer(&outputData[0])), C.int(outputSize)) == 1
+	runtime.KeepAlive(d)
+	if ok {
+		return nil
+	}
+	return errors.New("ERROR, Decode12 JPEG failed")
+}
+
+// Close - release the C side decoder, it can not be used afterwards
+func (d *JPEGDecoder12) Close() {
+	if d.dec != nil {
+		C.decoder12_destroy(d.dec)
+		d.dec = nil
+		runtime.SetFinalizer(d, nil)
+	}
+}
+
+// NewJPEGEncoder12 - create a reusable 12 bit JPEG encoder
+func NewJPEGEncoder12() (*JPEGEncoder12, error) {
+	enc := C.encoder12_create()
+	if enc == nil {
+		return nil, errors.New("ERROR, NewJPEGEncoder12, can't create encoder")
+	}
+	e := &JPEGEncoder12{enc: enc}
+	runtime.SetFinalizer(e, (*JPEGEncoder12).Close)
+	return e, nil
+}
+
+// Encode - RAW File to JPEG
+func (e *JPEGEncoder12) Encode(rawData []uint8, width uint16, height uint16, samples uint16, outData *[]byte, outSize *int, mode int) error {
+	var jpegData *C.uchar
+	var jpegSize C.int
+	if e.enc == nil {
+		return errors.New("ERROR, Encode12 JPEG encoder closed")
+	}
+	ok := C.encoder12_encode(e.enc, (*C.ushort)(unsafe.Pointer(&rawData[0])), C.ushort(width), C.ushort(height), C.ushort(samples), &jpegData, &jpegSize, C.int(mode)) == 1
+	runtime.KeepAlive(e)
+	if ok {
+		if jpegSize > 0 {
+			*outData = C.GoBytes(unsafe.Pointer(jpegData), jpegSize)
+			*outSize = int(jpegSize)
+			C.free(unsafe.Pointer(jpegData))
+			return nil
+		}
+		C.free(unsafe.Pointer(jpegData))
+	}
+	return errors.New("ERROR, Encode12 JPEG failed")
+}
+
+// EncodeTo - RAW File to JPEG, written straight into outData. Returns the bytes written,
+// or ErrBufferTooSmall together with the size outData needs to hold the whole frame
+func (e *JPEGEncoder12) EncodeTo(rawData []uint8, width uint16, height uint16, samples uint16, outData []byte, mode int) (int, error) {
+	var out *C.uchar
+	var jpegSize C.int
+	if e.enc == nil {
+		return 0, errors.New("ERROR, Encode12 JPEG encoder closed")
+	}
+	if len(outData) > 0 {
+		out = (*C.uchar)(unsafe.Pointer(&outData[0]))
+	}
+	ok := C.encoder12_encode_to(e.enc, (*C.ushort)(unsafe.Pointer(&rawData[0])), C.ushort(width), C.ushort(height), C.ushort(samples), out, C.int(len(outData)), &jpegSize, C.int(mode)) == 1
+	runtime.KeepAlive(e)
+	if ok {
+		if int(jpegSize) > len(outData) {
+			return int(jpegSize), ErrBufferTooSmall
+		}
+		if jpegSize > 0 {
+			return int(jpegSize), nil
+		}
+	}
+	return 0, errors.New("ERROR, Encode12 JPEG failed")
+}
+
+// SetRestartRows - MCU rows between restart markers in the lossy frames this encoder writes,
+// 0 for none. Frames with restart markers at whole MCU rows are decoded on several threads by
+// the batch decoders, at the cost of 2 bytes per interval
+func (e *JPEGEncoder12) SetRestartRows(rows int) {
+	if e.enc == nil {
+		return
+	}
+	C.encoder12_set_restart_rows(e.enc, C.int(rows))
+	runtime.KeepAlive(e)
+}
+
+// Close - release the C side encoder, it can not be used afterwards
+func (e *JPEGEncoder12) Close() {
+	if e.enc != nil {
+		C.encoder12_destroy(e.enc)
+		e.enc = nil
+		runtime.SetFinalizer(e, nil)
+	}
+}
@@ -0,0 +1,150 @@
+package jpeglib
+
+/*
+#include <stdlib.h>
+
+// defined in dcmjpeg/dijg16.c and dcmjpeg/eijg16.c, compiled by the platform file
+struct DJDIJG16DecoderStruct;
+struct DJDIJG16DecoderStruct *decoder16_create(void);
+void decoder16_destroy(struct DJDIJG16DecoderStruct *dec);
+int decoder16_decode(struct DJDIJG16DecoderStruct *dec, unsigned char *jpeg_data, int jpeg_size, unsigned char *output_data, int output_size);
+
+struct EIJG16EncoderStruct;
+struct EIJG16EncoderStruct *encoder16_create(void);
+void encoder16_destroy(struct EIJG16EncoderStruct *enc);
+int encoder16_encode(struct EIJG16EncoderStruct *enc, unsigned short *image_buffer, unsigned short width, unsigned short height, unsigned short samplesPerPixel, unsigned char **jpegBuf, int *jpegSize, int mode);
+int encoder16_encode_to(struct EIJG16EncoderStruct *enc, unsigned short *image_buffer, unsigned short width, unsigned short height, unsigned short samplesPerPixel, unsigned char *outBuf, int outCapacity, int *jpegSize, int mode);
+*/
+import "C"
+import (
+	"errors"
+	"runtime"
+	"sync"
+	"unsafe"
+)
+
+// JPEGDecoder16 - reusable 16 bit JPEG decoder, keeps the IJG decompressor and its memory pools
+// between frames. A decoder is not safe for concurrent use, share it through a sync.Pool
+type JPEGDecoder16 struct {
+	dec *C.struct_DJDIJG16DecoderStruct
+}
+
+// JPEGEncoder16 - reusable 16 bit JPEG encoder, keeps the IJG compressor, its tables and the
+// destination manager between frames. An encoder is not safe for concurrent use
+type JPEGEncoder16 struct {
+	enc *C.struct_EIJG16EncoderStruct
+}
+
+// jpegDecoder16Pool - decoders shared by DIJG16decode across frames and goroutines
+var jpegDecoder16Pool = sync.Pool{
+	New: func() interface{} {
+		dec, _ := NewJPEGDecoder16()
+		return dec
+	},
+}
+
+// jpegEncoder16Pool - encoders shared by EIJG16encode and EIJG16encodeTo
+var jpegEncoder16Pool = sync.Pool{
+	New: func() interface{} {
+		enc, _ := NewJPEGEncoder16()
+		return enc
+	},
+}
+
+// NewJPEGDecoder16 - create a reusable 16 bit JPEG decoder
+func NewJPEGDecoder16() (*JPEGDecoder16, error) {
+	dec := C.decoder16_create()
+	if dec == nil {
+		return nil, errors.New("ERROR, NewJPEGDecoder16, can't create decoder")
+	}
+	d := &JPEGDecoder16{dec: dec}
+	runtime.SetFinalizer(d, (*JPEGDecoder16).Close)
+	return d, nil
+}
+
+// Decode - JPEG File to RAW
+func (d *JPEGDecoder16) Decode(jpegData []byte, jpegSize uint32, outputData []byte, outputSize uint32) error {
+	if d.dec == nil {
+		return errors.New("ERROR, Decode16 JPEG decoder closed")
+	}
+	ok := C.decoder16_decode(d.dec, (*C.uchar)(unsafe.Pointer(&jpegData[0])), C.int(jpegSize), (*C.uchar)(unsafe.Pointer(&outputData[0])), C.int(outputSize)) == 1
+	runtime.KeepAlive(d)
+	if ok {
+		return nil
+	}
+	return errors.New("ERROR, Decode16 JPEG failed")
+}
+
+// Close - release the C side decoder, it can not be used afterwards
+func (d *JPEGDecoder16) Close() {
+	if d.dec != nil {
+		C.decoder16_destroy(d.dec)
+		d.dec = nil
+		runtime.SetFinalizer(d, nil)
+	}
+}
+
+// NewJPEGEncoder16 - create a reusable 16 bit JPEG encoder
+func NewJPEGEncoder16() (*JPEGEncoder16, error) {
+	enc := C.encoder16_create()
+	if enc == nil {
+		return nil, errors.New("ERROR, NewJPEGEncoder16, can't create encoder")
+	}
+	e := &JPEGEncoder16{enc: enc}
+	runtime.SetFinalizer(e, (*JPEGEncoder16).Close)
+	return e, nil
+}
+
+// Encode - RAW File to JPEG
+func (e *JPEGEncoder16) Encode(rawData []uint8, width uint16, height uint16, samples uint16, outData *[]byte, outSize *int, mode int) error {
+	var jpegData *C.uchar
+	var jpegSize C.int
+	if e.enc == nil {
+		return errors.New("ERROR, Encode16 JPEG encoder closed")
+	}
+	ok := C.encoder16_encode(e.enc, (*C.ushort)(unsafe.Pointer(&rawData[0])), C.ushort(width), C.ushort(height), C.ushort(samples), &jpegData, &jpegSize, C.int(mode)) == 1
+	runtime.KeepAlive(e)
+	if ok {
+		if jpegSize > 0 {
+			*outData = C.GoBytes(unsafe.Pointer(jpegData), jpegSize)
+			*outSize = int(jpegSize)
+			C.free(unsafe.Pointer(jpegData))
+			return nil
+		}
+		C.free(unsafe.Pointer(jpegData))
+	}
+	return errors.New("ERROR, Encode16 JPEG failed")
+}
+
+// EncodeTo - RAW File to JPEG, written straight into outData. Returns the bytes written,
+// or ErrBufferTooSmall together with the size outData needs to hold the whole frame
+func (e *JPEGEncoder16) EncodeTo(rawData []uint8, width uint16, height uint16, samples uint16, outData []byte, mode int) (int, error) {
+	var out *C.uchar
+	var jpegSize C.int
+	if e.enc == nil {
+		return 0, errors.New("ERROR, Encode16 JPEG encoder closed")
+	}
+	if len(outData) > 0 {
+		out = (*C.uchar)(unsafe.Pointer(&outData[0]))
+	}
+	ok := C.encoder16_encode_to(e.enc, (*C.ushort)(unsafe.Pointer(&rawData[0])), C.ushort(width), C.ushort(height), C.ushort(samples), out, C.int(len(outData)), &jpegSize, C.int(mode)) == 1
+	runtime.KeepAlive(e)
+	if ok {
+		if int(jpegSize) > len(outData) {
+			return int(jpegSize), ErrBufferTooSmall
+		}
+		if jpegSize > 0 {
+			return int(jpegSize), nil
+		}
+	}
+	return 0, errors.New("ERROR, Encode16 JPEG failed")
+}
+
+// Close - release the C side encoder, it can not be used afterwards
+func (e *JPEGEncoder16) Close() {
+	if e.enc != nil {
+		C.encoder16_destroy(e.enc)
+		e.enc = nil
+		runtime.SetFinalizer(e, nil)
+	}
+}
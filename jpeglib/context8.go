@@ -0,0 +1,162 @@
+package jpeglib
+
+/*
+#include <stdlib.h>
+
+// defined in dcmjpeg/dijg8.c and dcmjpeg/eijg8.c, compiled by the platform file
+struct DJDIJG8DecoderStruct;
+struct DJDIJG8DecoderStruct *decoder8_create(void);
+void decoder8_destroy(struct DJDIJG8DecoderStruct *dec);
+int decoder8_decode(struct DJDIJG8DecoderStruct *dec, unsigned char *jpeg_data, int jpeg_size, unsigned char *output_data, int output_size);
+
+struct EIJG8EncoderStruct;
+struct EIJG8EncoderStruct *encoder8_create(void);
+void encoder8_destroy(struct EIJG8EncoderStruct *enc);
+void encoder8_set_restart_rows(struct EIJG8EncoderStruct *enc, int rows);
+int encoder8_encode(struct EIJG8EncoderStruct *enc, unsigned char *image_buffer, unsigned short width, unsigned short height, unsigned short samplesPerPixel, unsigned char **jpegBuf, int *jpegSize, int mode);
+int encoder8_encode_to(struct EIJG8EncoderStruct *enc, unsigned char *image_buffer, unsigned short width, unsigned short height, unsigned short samplesPerPixel, unsigned char *outBuf, int outCapacity, int *jpegSize, int mode);
+*/
+import "C"
+import (
+	"errors"
+	"runtime"
+	"sync"
+	"unsafe"
+)
+
+// JPEGDecoder8 - reusable 8 bit JPEG decoder, keeps the IJG decompressor and its memory pools
+// between frames. A decoder is not safe for concurrent use, share it through a sync.Pool
+type JPEGDecoder8 struct {
+	dec *C.struct_DJDIJG8DecoderStruct
+}
+
+// JPEGEncoder8 - reusable 8 bit JPEG encoder, keeps the IJG compressor, its tables and the
+// destination manager between frames. An encoder is not safe for concurrent use
+type JPEGEncoder8 struct {
+	enc *C.struct_EIJG8EncoderStruct
+}
+
+// jpegDecoder8Pool - decoders shared by DIJG8decode across frames and goroutines
+var jpegDecoder8Pool = sync.Pool{
+	New: func() interface{} {
+		dec, _ := NewJPEGDecoder8()
+		return dec
+	},
+}
+
+// jpegEncoder8Pool - encoders shared by EIJG8encode and EIJG8encodeTo
+var jpegEncoder8Pool = sync.Pool{
+	New: func() interface{} {
+		enc, _ := NewJPEGEncoder8()
+		return enc
+	},
+}
+
+// NewJPEGDecoder8 - create a reusable 8 bit JPEG decoder
+func NewJPEGDecoder8() (*JPEGDecoder8, error) {
+	dec := C.decoder8_create()
+	if dec == nil {
+		return nil, errors.New("ERROR, NewJPEGDecoder8, can't create decoder")
+	}
+	d := &JPEGDecoder8{dec: dec}
+	runtime.SetFinalizer(d, (*JPEGDecoder8).Close)
+	return d, nil
+}
+
+// Decode - JPEG File to RAW
+func (d *JPEGDecoder8) Decode(jpegData []byte, jpegSize uint32, outputData []byte, outputSize uint32) error {
+	if d.dec == nil {
+		return errors.New("ERROR, Decode8, JPEG decoder closed")
+	}
+	ok := C.decoder8_decode(d.dec, (*C.uchar)(unsafe.Pointer(&jpegData[0])), C.int(jpegSize), (*C.uchar)(unsafe.Pointer(&outputData[0])), C.int(outputSize)) == 1
+	runtime.KeepAlive(d)
+	if ok {
+		return nil
+	}
+	return errors.New("ERROR, Decode8, JPEG failed")
+}
+
+// Close - release the C side decoder, it can not be used afterwards
+func (d *JPEGDecoder8) Close() {
+	if d.dec != nil {
+		C.decoder8_destroy(d.dec)
+		d.dec = nil
+		runtime.SetFinalizer(d, nil)
+	}
+}
+
+// NewJPEGEncoder8 - create a reusable 8 bit JPEG encoder
+func NewJPEGEncoder8() (*JPEGEncoder8, error) {
+	enc := C.encoder8_create()
+	if enc == nil {
+		return nil, errors.New("ERROR, NewJPEGEncoder8, can't create encoder")
+	}
+	e := &JPEGEncoder8{enc: enc}
+	runtime.SetFinalizer(e, (*JPEGEncoder8).Close)
+	return e, nil
+}
+
+// Encode - RAW File to JPEG
+func (e *JPEGEncoder8) Encode(rawData []byte, width uint16, height uint16, samples uint16, outData *[]byte, outSize *int, mode int) error {
+	var jpegData *C.uchar
+	var jpegSize C.int
+	if e.enc == nil {
+		return errors.New("ERROR, Encode8, JPEG encoder closed")
+	}
+	ok := C.encoder8_encode(e.enc, (*C.uchar)(unsafe.Pointer(&rawData[0])), C.ushort(width), C.ushort(height), C.ushort(samples), &jpegData, &jpegSize, C.int(mode)) == 1
+	runtime.KeepAlive(e)
+	if ok {
+		if jpegSize > 0 {
+			*outData = C.GoBytes(unsafe.Pointer(jpegData), jpegSize)
+			*outSize = int(jpegSize)
+			C.free(unsafe.Pointer(jpegData))
+			return nil
+		}
+		C.free(unsafe.Pointer(jpegData))
+	}
+	return errors.New("ERROR, Encode8, JPEG failed")
+}
+
+// EncodeTo - RAW File to JPEG, written straight into outData. Returns the bytes written,
+// or ErrBufferTooSmall together with the size outData needs to hold the whole frame
+func (e *JPEGEncoder8) EncodeTo(rawData []byte, width uint16, height uint16, samples uint16, outData []byte, mode int) (int, error) {
+	var out *C.uchar
+	var jpegSize C.int
+	if e.enc == nil {
+		return 0, errors.New("ERROR, Encode8, JPEG encoder closed")
+	}
+	if len(outData) > 0 {
+		out = (*C.uchar)(unsafe.Pointer(&outData[0]))
+	}
+	ok := C.encoder8_encode_to(e.enc, (*C.uchar)(unsafe.Pointer(&rawData[0])), C.ushort(width), C.ushort(height), C.ushort(samples), out, C.int(len(outData)), &jpegSize, C.int(mode)) == 1
+	runtime.KeepAlive(e)
+	if ok {
+		if int(jpegSize) > len(outData) {
+			return int(jpegSize), ErrBufferTooSmall
+		}
+		if jpegSize > 0 {
+			return int(jpegSize), nil
+		}
+	}
+	return 0, errors.New("ERROR, Encode8, JPEG failed")
+}
+
+// SetRestartRows - MCU rows between restart markers in the lossy frames this encoder writes,
+// 0 for none. Frames with restart markers at whole MCU rows are decoded on several threads by
+// the batch decoders, at the cost of 2 bytes per interval
+func (e *JPEGEncoder8) SetRestartRows(rows int) {
+	if e.enc == nil {
+		return
+	}
+	C.encoder8_set_restart_rows(e.enc, C.int(rows))
+	runtime.KeepAlive(e)
+}
+
+// Close - release the C side encoder, it can not be used afterwards
+func (e *JPEGEncoder8) Close() {
+	if e.enc != nil {
+		C.encoder8_destroy(e.enc)
+		e.enc = nil
+		runtime.SetFinalizer(e, nil)
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef DCMJPEG_BATCH_H
+#define DCMJPEG_BATCH_H
+
+#include <stdlib.h>
+#include <pthread.h>
+
+/* The batch runner of the IJG codecs here and of the OpenJPEG codec in openjpeg/j2klib */
+
+/* A further piece of an input split over several buffers */
+typedef struct codec_fragment {
+  unsigned char *data;
+  int size;
+} codec_fragment;
+
+/* One frame of a batch call. The codec reads input and writes output; status is 1 on success
+   and size the bytes written, for encoders the bytes output needs when it was too small.
+   A decoder input split over several fragments continues in fragments, read after input */
+typedef struct codec_frame {
+  unsigned char *input;
+  int input_size;
+  unsigned char *output;
+  int output_size;
+  int status;
+  int size;
+  codec_fragment *fragments;
+  int fragment_count;
+} codec_frame;
+
+#define BATCH_MAX_THREADS 64
+#define BATCH_STACK_SIZE (4 * 1024 * 1024)
+
+/* A batch of frames shared by the worker threads, each worker takes the next frame atomically */
+typedef struct codec_batch {
+  codec_frame *frames;
+  int count;
+  int next;
+  void *(*create)(void);
+  void (*destroy)(void *ctx);
+  void (*run)(void *ctx, codec_frame *frame, const void *args);
+  const void *args;
+} codec_batch;
+
+/* Worker loop: one codec context per thread, reused for every frame the thread takes */
+static void *codec_batch_worker(void *arg) {
+  codec_batch *batch = (codec_batch *) arg;
+  void *ctx = batch->create();
+  for (;;) {
+    int i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+    if (i >= batch->count)
+      break;
+    batch->frames[i].status = 0;
+    batch->frames[i].size = 0;
+    if (ctx != NULL)
+      batch->run(ctx, &batch->frames[i], batch->args);
+  }
+  if (ctx != NULL)
+    batch->destroy(ctx);
+  return NULL;
+}
+
+/* Runs every frame of the batch on up to threads native threads, the calling thread included.
+   Returns the number of frames that failed. Inline so that files using only the types above
+   compile without an unused copy */
+static inline int codec_batch_run(codec_batch *batch, int threads) {
+  pthread_t workers[BATCH_MAX_THREADS];
+  pthread_attr_t attr;
+  int started = 0;
+  int failed = 0;
+
+  if (threads > batch->count)
+    threads = batch->count;
+  if (threads > BATCH_MAX_THREADS)
+    threads = BATCH_MAX_THREADS;
+  if (threads < 1)
+    threads = 1;
+  batch->next = 0;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, BATCH_STACK_SIZE);
+  for (int t = 1; t < threads; t++) {
+    /* fewer threads when the system refuses more, the remaining workers take up the frames */
+    if (pthread_create(&workers[started], &attr, codec_batch_worker, batch) != 0)
+      break;
+    started++;
+  }
+  pthread_attr_destroy(&attr);
+
+  codec_batch_worker(batch);
+  for (int t = 0; t < started; t++)
+    pthread_join(workers[t], NULL);
+
+  for (int i = 0; i < batch->count; i++)
+    if (!batch->frames[i].status)
+      failed++;
+  return failed;
+}
+
+#endif
@@ -0,0 +1,431 @@
+#ifndef DCMJPEG_DCT8_H
+#define DCMJPEG_DCT8_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd.h"
+#include "jpegint8.h"
+
+/*
+ * SIMD kernels of the 8 bit codec. libijg8 runs jpeg_idct_islow, jpeg_fdct_islow and the YCbCr to
+ * RGB conversion one row or column and one sample at a time. The linux platform files link with
+ * --wrap for jpeg8_idct_islow, jpeg8_fdct_islow and jinit8_color_deconverter, so the DCT calls of
+ * jddctmgr and jcdctmgr land here and the color deconverter gets a row converter at the level
+ * ijg_simd_level picks. The scalar level calls the library itself. The kernels repeat the
+ * library's integer arithmetic, so samples and coefficients are the same bits as the library's.
+ */
+
+/* the level of simd.h, shared with the kernels of lossless16.h */
+int ijg_simd_forced = -1;
+
+/*
+ * Forces the kernels to one instruction set, -1 restores the automatic choice. Returns the level
+ * now in use, unsupported levels are ignored. Meant for tests comparing the kernels.
+ */
+int JPEGSetSIMDLevel(int level) {
+  if (level < 0)
+    ijg_simd_forced = -1;
+  else if (ijg_simd_supported(level))
+    ijg_simd_forced = level;
+  return ijg_simd_level();
+}
+
+/* jidctint.c, jfdctint.c */
+#define DCT_CONST_BITS 13
+#define DCT_PASS1_BITS 2
+#define FIX_0_298631336 2446
+#define FIX_0_390180644 3196
+#define FIX_0_541196100 4433
+#define FIX_0_765366865 6270
+#define FIX_0_899976223 7373
+#define FIX_1_175875602 9633
+#define FIX_1_501321110 12299
+#define FIX_1_847759065 15137
+#define FIX_1_961570560 16069
+#define FIX_2_053119869 16819
+#define FIX_2_562915447 20995
+#define FIX_3_072711026 25172
+
+/*
+ * Largest dequantized coefficient of a block the kernel takes: with every input within it no sum
+ * of either pass leaves 32 bits. Valid 8 bit frames stay within 1024, larger ones go to the library
+ */
+#define DCT_IDCT_MAX 1173
+
+/* jdcolor.c, FIX(1.40200), FIX(0.34414), FIX(0.71414), FIX(1.77200) */
+#define YCC_SCALEBITS 16
+#define YCC_HALF (1 << (YCC_SCALEBITS - 1))
+#define YCC_CR_R 91881
+#define YCC_CB_G 22554
+#define YCC_CR_G 46802
+#define YCC_CB_B 116130
+
+static inline JSAMPLE ycc_limit(int v) {
+  return (JSAMPLE) (v < 0 ? 0 : (v > MAXJSAMPLE ? MAXJSAMPLE : v));
+}
+
+/* ycc_rgb_convert of one pixel */
+static inline void ycc_rgb_pixel(int y, int cb, int cr, JSAMPLE *out) {
+  cb -= CENTERJSAMPLE;
+  cr -= CENTERJSAMPLE;
+  out[0] = ycc_limit(y + ((YCC_CR_R * cr + YCC_HALF) >> YCC_SCALEBITS));
+  out[1] = ycc_limit(y + ((-YCC_CB_G * cb - YCC_CR_G * cr + YCC_HALF) >> YCC_SCALEBITS));
+  out[2] = ycc_limit(y + ((YCC_CB_B * cb + YCC_HALF) >> YCC_SCALEBITS));
+}
+
+#if defined(__linux__) && (defined(IJG_SIMD_X86) || defined(IJG_SIMD_NEON))
+
+#if defined(IJG_SIMD_X86)
+
+typedef unsigned char ijg_vb8 __attribute__((vector_size(8), may_alias));
+
+/* 8 ints to bytes, saturated to 0 .. 255 */
+IJG_TARGET_AVX2 static inline ijg_vb8 dct_limit_avx2(const ijg_vi8 *v) {
+  __m128i w = _mm_packs_epi32(_mm256_castsi256_si128((__m256i) v[0]), _mm256_extracti128_si256((__m256i) v[0], 1));
+  return (ijg_vb8) _mm_cvtsi128_si64(_mm_packus_epi16(w, w));
+}
+
+/* 8x8 ints, rows to columns */
+IJG_TARGET_AVX2 static inline void dct_transpose_avx2(ijg_vi8 b[8][1]) {
+  __m256i t0 = _mm256_unpacklo_epi32((__m256i) b[0][0], (__m256i) b[1][0]);
+  __m256i t1 = _mm256_unpackhi_epi32((__m256i) b[0][0], (__m256i) b[1][0]);
+  __m256i t2 = _mm256_unpacklo_epi32((__m256i) b[2][0], (__m256i) b[3][0]);
+  __m256i t3 = _mm256_unpackhi_epi32((__m256i) b[2][0], (__m256i) b[3][0]);
+  __m256i t4 = _mm256_unpacklo_epi32((__m256i) b[4][0], (__m256i) b[5][0]);
+  __m256i t5 = _mm256_unpackhi_epi32((__m256i) b[4][0], (__m256i) b[5][0]);
+  __m256i t6 = _mm256_unpacklo_epi32((__m256i) b[6][0], (__m256i) b[7][0]);
+  __m256i t7 = _mm256_unpackhi_epi32((__m256i) b[6][0], (__m256i) b[7][0]);
+  __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+  __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+  __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+  __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+  __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+  __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+  __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+  __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+  b[0][0] = (ijg_vi8) _mm256_permute2x128_si256(u0, u4, 0x20);
+  b[1][0] = (ijg_vi8) _mm256_permute2x128_si256(u1, u5, 0x20);
+  b[2][0] = (ijg_vi8) _mm256_permute2x128_si256(u2, u6, 0x20);
+  b[3][0] = (ijg_vi8) _mm256_permute2x128_si256(u3, u7, 0x20);
+  b[4][0] = (ijg_vi8) _mm256_permute2x128_si256(u0, u4, 0x31);
+  b[5][0] = (ijg_vi8) _mm256_permute2x128_si256(u1, u5, 0x31);
+  b[6][0] = (ijg_vi8) _mm256_permute2x128_si256(u2, u6, 0x31);
+  b[7][0] = (ijg_vi8) _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+/* 8 pixels of R, G and B planes to 24 interleaved bytes */
+IJG_TARGET_AVX2 static inline void dct_store_rgb_avx2(JSAMPLE *p, ijg_vb8 r, ijg_vb8 g, ijg_vb8 b) {
+  long long lr, lg, lb;
+  memcpy(&lr, &r, 8);
+  memcpy(&lg, &g, 8);
+  memcpy(&lb, &b, 8);
+  __m128i rg = _mm_set_epi64x(lg, lr);
+  __m128i bb = _mm_set_epi64x(0, lb);
+  __m128i lo = _mm_or_si128(
+      _mm_shuffle_epi8(rg, _mm_setr_epi8(0, 8, -1, 1, 9, -1, 2, 10, -1, 3, 11, -1, 4, 12, -1, 5)),
+      _mm_shuffle_epi8(bb, _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1)));
+  __m128i hi = _mm_or_si128(
+      _mm_shuffle_epi8(rg, _mm_setr_epi8(13, -1, 6, 14, -1, 7, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(bb, _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1)));
+  _mm_storeu_si128((__m128i *) p, lo);
+  _mm_storel_epi64((__m128i *) (p + 16), hi);
+}
+
+#define DCT_NAME(x) dct_##x##_avx2
+#define DCT_TARGET IJG_TARGET_AVX2
+#define DCT_LANES 8
+#define DCT_VI ijg_vi8
+#define DCT_VI_U ijg_vi8u
+#define DCT_LOAD_S16(p, v) ((v)[0] = (ijg_vi8) _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (p))))
+#define DCT_LOAD_U8(p, v) ((v)[0] = (ijg_vi8) _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (p))))
+#define DCT_LIMIT(v) dct_limit_avx2(v)
+#define DCT_ANY(v) (!_mm256_testz_si256((__m256i) (v), (__m256i) (v)))
+#define DCT_TRANSPOSE(b) dct_transpose_avx2(b)
+#define DCT_STORE_RGB(p, r, g, b) dct_store_rgb_avx2(p, r, g, b)
+#include "dct_lanes.h"
+
+#elif defined(IJG_SIMD_NEON)
+
+typedef unsigned char ijg_vb8 __attribute__((vector_size(8), may_alias));
+
+static inline void dct_load_s16_neon(const JCOEF *p, ijg_vi4 *v) {
+  int16x8_t w = vld1q_s16(p);
+  v[0] = (ijg_vi4) vmovl_s16(vget_low_s16(w));
+  v[1] = (ijg_vi4) vmovl_s16(vget_high_s16(w));
+}
+
+static inline void dct_load_u8_neon(const JSAMPLE *p, ijg_vi4 *v) {
+  uint16x8_t w = vmovl_u8(vld1_u8(p));
+  v[0] = (ijg_vi4) vmovl_u16(vget_low_u16(w));
+  v[1] = (ijg_vi4) vmovl_u16(vget_high_u16(w));
+}
+
+/* 8 ints to bytes, saturated to 0 .. 255 */
+static inline ijg_vb8 dct_limit_neon(const ijg_vi4 *v) {
+  int16x8_t w = vcombine_s16(vqmovn_s32((int32x4_t) v[0]), vqmovn_s32((int32x4_t) v[1]));
+  return (ijg_vb8) vqmovun_s16(w);
+}
+
+/* 4x4 ints of rows a, b, c, d to columns */
+static inline void dct_transpose4_neon(ijg_vi4 *a, ijg_vi4 *b, ijg_vi4 *c, ijg_vi4 *d) {
+  int32x4x2_t ab = vtrnq_s32((int32x4_t) *a, (int32x4_t) *b);
+  int32x4x2_t cd = vtrnq_s32((int32x4_t) *c, (int32x4_t) *d);
+  *a = (ijg_vi4) vcombine_s32(vget_low_s32(ab.val[0]), vget_low_s32(cd.val[0]));
+  *b = (ijg_vi4) vcombine_s32(vget_low_s32(ab.val[1]), vget_low_s32(cd.val[1]));
+  *c = (ijg_vi4) vcombine_s32(vget_high_s32(ab.val[0]), vget_high_s32(cd.val[0]));
+  *d = (ijg_vi4) vcombine_s32(vget_high_s32(ab.val[1]), vget_high_s32(cd.val[1]));
+}
+
+/* 8x8 ints, rows to columns: the 4x4 tiles transposed and the two off the diagonal swapped */
+static inline void dct_transpose_neon(ijg_vi4 b[8][2]) {
+  dct_transpose4_neon(&b[0][0], &b[1][0], &b[2][0], &b[3][0]);
+  dct_transpose4_neon(&b[4][1], &b[5][1], &b[6][1], &b[7][1]);
+  dct_transpose4_neon(&b[0][1], &b[1][1], &b[2][1], &b[3][1]);
+  dct_transpose4_neon(&b[4][0], &b[5][0], &b[6][0], &b[7][0]);
+  for (int r = 0; r < 4; r++) {
+    ijg_vi4 t = b[r][1];
+    b[r][1] = b[r + 4][0];
+    b[r + 4][0] = t;
+  }
+}
+
+static inline void dct_store_rgb_neon(JSAMPLE *p, ijg_vb8 r, ijg_vb8 g, ijg_vb8 b) {
+  uint8x8x3_t rgb = {{(uint8x8_t) r, (uint8x8_t) g, (uint8x8_t) b}};
+  vst3_u8(p, rgb);
+}
+
+#define DCT_NAME(x) dct_##x##_neon
+#define DCT_TARGET
+#define DCT_LANES 4
+#define DCT_VI ijg_vi4
+#define DCT_VI_U ijg_vi4u
+#define DCT_LOAD_S16(p, v) dct_load_s16_neon(p, v)
+#define DCT_LOAD_U8(p, v) dct_load_u8_neon(p, v)
+#define DCT_LIMIT(v) dct_limit_neon(v)
+#define DCT_ANY(v) (vmaxvq_u32((uint32x4_t) (v)) != 0)
+#define DCT_TRANSPOSE(b) dct_transpose_neon(b)
+#define DCT_STORE_RGB(p, r, g, b) dct_store_rgb_neon(p, r, g, b)
+#include "dct_lanes.h"
+
+#endif
+
+/* runs the kernels at the current level, 0 when the library has to */
+static int dct_idct_simd(JCOEFPTR coef, const int *quant, JSAMPARRAY out, JDIMENSION col) {
+  switch (ijg_simd_level()) {
+#if defined(IJG_SIMD_X86)
+  case IJG_SIMD_AVX2:
+    return dct_idct_islow_avx2(coef, quant, out, col);
+#elif defined(IJG_SIMD_NEON)
+  case IJG_SIMD_NEON:
+    return dct_idct_islow_neon(coef, quant, out, col);
+#endif
+  }
+  return 0;
+}
+
+static int dct_fdct_simd(int *data) {
+  switch (ijg_simd_level()) {
+#if defined(IJG_SIMD_X86)
+  case IJG_SIMD_AVX2:
+    dct_fdct_islow_avx2(data);
+    return 1;
+#elif defined(IJG_SIMD_NEON)
+  case IJG_SIMD_NEON:
+    dct_fdct_islow_neon(data);
+    return 1;
+#endif
+  }
+  return 0;
+}
+
+/* color_convert of the deconverter for YCbCr to RGB */
+static void dct_ycc_rgb_convert(j_decompress_ptr cinfo, JSAMPIMAGE input_buf, JDIMENSION input_row, JSAMPARRAY output_buf, int num_rows) {
+  int level = ijg_simd_level();
+  for (; num_rows > 0; num_rows--, input_row++, output_buf++) {
+    const JSAMPLE *y = input_buf[0][input_row], *cb = input_buf[1][input_row], *cr = input_buf[2][input_row];
+    switch (level) {
+#if defined(IJG_SIMD_X86)
+    case IJG_SIMD_AVX2:
+      dct_ycc_rgb_row_avx2(y, cb, cr, *output_buf, cinfo->output_width);
+      continue;
+#elif defined(IJG_SIMD_NEON)
+    case IJG_SIMD_NEON:
+      dct_ycc_rgb_row_neon(y, cb, cr, *output_buf, cinfo->output_width);
+      continue;
+#endif
+    }
+    for (JDIMENSION col = 0; col < cinfo->output_width; col++)
+      ycc_rgb_pixel(y[col], cb[col], cr[col], *output_buf + 3 * col);
+  }
+}
+
+void __real_jpeg8_idct_islow(j_decompress_ptr cinfo, jpeg_component_info *compptr, JCOEFPTR coef_block, JSAMPARRAY output_buf, JDIMENSION output_col);
+void __real_jpeg8_fdct_islow(int *data);
+void __real_jinit8_color_deconverter(j_decompress_ptr cinfo);
+
+void __wrap_jpeg8_idct_islow(j_decompress_ptr cinfo, jpeg_component_info *compptr, JCOEFPTR coef_block, JSAMPARRAY output_buf, JDIMENSION output_col) {
+  if (!dct_idct_simd(coef_block, (const int *) compptr->dct_table, output_buf, output_col))
+    __real_jpeg8_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+}
+
+/* the encoder's samples are centered on 0, no sum of either pass leaves 32 bits */
+void __wrap_jpeg8_fdct_islow(int *data) {
+  if (!dct_fdct_simd(data))
+    __real_jpeg8_fdct_islow(data);
+}
+
+void __wrap_jinit8_color_deconverter(j_decompress_ptr cinfo) {
+  __real_jinit8_color_deconverter(cinfo);
+  if (cinfo->jpeg_color_space == JCS_YCbCr && cinfo->out_color_space == JCS_RGB && !cinfo->quantize_colors &&
+      ijg_simd_level() != IJG_SIMD_SCALAR)
+    cinfo->cconvert->color_convert = dct_ycc_rgb_convert;
+}
+
+/* sample_range_limit as prepare_range_limit_table of jdmaster.c fills it, 5 * 256 + 128 samples */
+static JSAMPLE *dct_range_limit(JSAMPLE *table) {
+  JSAMPLE *limit = table + (MAXJSAMPLE + 1);
+  memset(table, 0, MAXJSAMPLE + 1);
+  for (int i = 0; i <= MAXJSAMPLE; i++)
+    limit[i] = (JSAMPLE) i;
+  for (int i = CENTERJSAMPLE; i < 2 * (MAXJSAMPLE + 1); i++)
+    limit[CENTERJSAMPLE + i] = MAXJSAMPLE;
+  memset(limit + CENTERJSAMPLE + 2 * (MAXJSAMPLE + 1), 0, 2 * (MAXJSAMPLE + 1) - CENTERJSAMPLE);
+  memcpy(limit + 4 * (MAXJSAMPLE + 1), limit, CENTERJSAMPLE);
+  return limit;
+}
+
+static unsigned dct_rand(unsigned *seed) {
+  *seed = *seed * 1103515245u + 12345u;
+  return *seed >> 16;
+}
+
+/*
+ * Runs the inverse DCT on blocks of coefficients up to magnitude, a quarter of them not 0, and
+ * quantization values up to quant, once at the current level and once in the library. Returns 1
+ * when both give the same samples, 0 when not, -1 when the library is the current level. Meant
+ * for tests, magnitudes past DCT_IDCT_MAX check the blocks going back to the library.
+ */
+int JPEGIDCTMatches(int magnitude, int quant, unsigned seed) {
+  struct jpeg_decompress_struct cinfo;
+  jpeg_component_info comp;
+  JSAMPLE table[5 * (MAXJSAMPLE + 1) + CENTERJSAMPLE];
+  JCOEF coef[DCTSIZE2];
+  int qtable[DCTSIZE2];
+  JSAMPLE simd[DCTSIZE2], lib[DCTSIZE2];
+  JSAMPROW simd_rows[DCTSIZE], lib_rows[DCTSIZE];
+  int matches = 1;
+
+  if (ijg_simd_level() == IJG_SIMD_SCALAR)
+    return -1;
+  memset(&cinfo, 0, sizeof(cinfo));
+  memset(&comp, 0, sizeof(comp));
+  cinfo.sample_range_limit = dct_range_limit(table);
+  comp.dct_table = qtable;
+  for (int r = 0; r < DCTSIZE; r++) {
+    simd_rows[r] = simd + r * DCTSIZE;
+    lib_rows[r] = lib + r * DCTSIZE;
+  }
+  for (int n = 0; n < 1000 && matches; n++) {
+    for (int i = 0; i < DCTSIZE2; i++) {
+      coef[i] = 0;
+      if (i == 0 || dct_rand(&seed) % 4 == 0)
+        coef[i] = (JCOEF) ((int) (dct_rand(&seed) % (2 * magnitude + 1)) - magnitude);
+      qtable[i] = 1 + (int) (dct_rand(&seed) % quant);
+    }
+    if (!dct_idct_simd(coef, qtable, simd_rows, 0))
+      __real_jpeg8_idct_islow(&cinfo, &comp, coef, simd_rows, 0);
+    __real_jpeg8_idct_islow(&cinfo, &comp, coef, lib_rows, 0);
+    matches = memcmp(simd, lib, sizeof(simd)) == 0;
+  }
+  return matches;
+}
+
+/*
+ * Runs the forward DCT on blocks of centered samples, once at the current level and once in the
+ * library. Returns 1 when both give the same coefficients, 0 when not, -1 when the library is the
+ * current level. Meant for tests.
+ */
+int JPEGFDCTMatches(unsigned seed) {
+  int simd[DCTSIZE2], lib[DCTSIZE2];
+  int matches = 1;
+
+  if (ijg_simd_level() == IJG_SIMD_SCALAR)
+    return -1;
+  for (int n = 0; n < 1000 && matches; n++) {
+    for (int i = 0; i < DCTSIZE2; i++)
+      simd[i] = lib[i] = (int) (dct_rand(&seed) % (MAXJSAMPLE + 1)) - CENTERJSAMPLE;
+    dct_fdct_simd(simd);
+    __real_jpeg8_fdct_islow(lib);
+    matches = memcmp(simd, lib, sizeof(simd)) == 0;
+  }
+  return matches;
+}
+
+/*
+ * Converts rows of width YCbCr pixels to RGB, once at the current level and once with the
+ * library's color deconverter. Returns 1 when both give the same pixels, 0 when not or the
+ * library failed, -1 when the library is the current level. Meant for tests.
+ */
+int JPEGColorMatches(int width, unsigned seed) {
+  struct jpeg_decompress_struct cinfo;
+  struct DJDIJG8ErrorStruct jerr;
+  JSAMPLE table[5 * (MAXJSAMPLE + 1) + CENTERJSAMPLE];
+  JSAMPROW planes[3][4], simd_rows[4], lib_rows[4];
+  JSAMPARRAY image[3] = {planes[0], planes[1], planes[2]};
+  JSAMPLE *mem;
+  int matches = 0;
+
+  if (ijg_simd_level() == IJG_SIMD_SCALAR)
+    return -1;
+  if (width <= 0 || (mem = (JSAMPLE *) malloc((size_t) width * 4 * 9)) == NULL)
+    return 0;
+  for (int r = 0; r < 4; r++) {
+    for (int c = 0; c < 3; c++)
+      planes[c][r] = mem + (size_t) width * (3 * r + c);
+    simd_rows[r] = mem + (size_t) width * 12 + (size_t) width * 3 * r;
+    lib_rows[r] = mem + (size_t) width * 24 + (size_t) width * 3 * r;
+  }
+  for (int i = 0; i < width * 12; i++)
+    mem[i] = (JSAMPLE) dct_rand(&seed);
+
+  memset(&cinfo, 0, sizeof(cinfo));
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = DJDIJG8ErrorExit;
+  if (setjmp(jerr.setjmp_buffer)) {
+    jpeg_destroy_decompress(&cinfo);
+    free(mem);
+    return 0;
+  }
+  jpeg_create_decompress(&cinfo);
+  cinfo.jpeg_color_space = JCS_YCbCr;
+  cinfo.out_color_space = JCS_RGB;
+  cinfo.num_components = 3;
+  cinfo.output_width = (JDIMENSION) width;
+  cinfo.sample_range_limit = dct_range_limit(table);
+  __real_jinit8_color_deconverter(&cinfo);
+  (*cinfo.cconvert->color_convert)(&cinfo, image, 0, lib_rows, 4);
+  dct_ycc_rgb_convert(&cinfo, image, 0, simd_rows, 4);
+  matches = memcmp(simd_rows[0], lib_rows[0], (size_t) width * 12) == 0;
+  jpeg_destroy_decompress(&cinfo);
+  free(mem);
+  return matches;
+}
+
+#else
+
+int JPEGIDCTMatches(int magnitude, int quant, unsigned seed) {
+  return -1;
+}
+
+int JPEGFDCTMatches(unsigned seed) {
+  return -1;
+}
+
+int JPEGColorMatches(int width, unsigned seed) {
+  return -1;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Integer DCT and color kernels on DCT_LANES lanes at once, included by dct8.h once per
+ * instruction set with these defined:
+ *
+ *   DCT_NAME(x)                name of x for the instruction set
+ *   DCT_TARGET                 target attribute of the functions
+ *   DCT_LANES                  lanes of a vector, 4 or 8
+ *   DCT_VI                     int vector, DCT_VI_U one at any address
+ *   DCT_LOAD_S16(p, v)         widens the 8 shorts at p to v[0 .. 8 / DCT_LANES - 1]
+ *   DCT_LOAD_U8(p, v)          widens the 8 samples at p to v[0 .. 8 / DCT_LANES - 1]
+ *   DCT_LIMIT(v)               the 8 ints of v clamped to 0 .. 255 as an ijg_vb8
+ *   DCT_ANY(v)                 nonzero when a lane of v is
+ *   DCT_TRANSPOSE(b)           transposes the 8x8 block b, DCT_VI b[8][8 / DCT_LANES]
+ *   DCT_STORE_RGB(p, r, g, b)  interleaves 8 pixels of ijg_vb8 channels to p
+ *
+ * A block is 8 rows of 8 / DCT_LANES vectors. Every lane runs the arithmetic of jidctint.c,
+ * jfdctint.c and ycc_rgb_convert of jdcolor.c in IJG 6b on one row or column, so the samples and
+ * coefficients are the same bits as the library's.
+ */
+
+#define DCT_HALVES (8 / DCT_LANES)
+
+/* 1-D inverse DCT of x[0], x[stride] .. x[7 * stride] in place, descaled by shift */
+static DCT_TARGET inline __attribute__((always_inline)) void DCT_NAME(idct_1d)(DCT_VI *x, int stride, int shift) {
+  DCT_VI z1, z2, z3, z4, z5, tmp0, tmp1, tmp2, tmp3, tmp10, tmp11, tmp12, tmp13;
+  int round = 1 << (shift - 1);
+
+  /* even part */
+  z2 = x[2 * stride];
+  z3 = x[6 * stride];
+  z1 = (z2 + z3) * FIX_0_541196100;
+  tmp2 = z1 + z3 * -FIX_1_847759065;
+  tmp3 = z1 + z2 * FIX_0_765366865;
+  tmp0 = (x[0] + x[4 * stride]) << DCT_CONST_BITS;
+  tmp1 = (x[0] - x[4 * stride]) << DCT_CONST_BITS;
+  tmp10 = tmp0 + tmp3;
+  tmp13 = tmp0 - tmp3;
+  tmp11 = tmp1 + tmp2;
+  tmp12 = tmp1 - tmp2;
+
+  /* odd part */
+  tmp0 = x[7 * stride];
+  tmp1 = x[5 * stride];
+  tmp2 = x[3 * stride];
+  tmp3 = x[1 * stride];
+  z1 = tmp0 + tmp3;
+  z2 = tmp1 + tmp2;
+  z3 = tmp0 + tmp2;
+  z4 = tmp1 + tmp3;
+  z5 = (z3 + z4) * FIX_1_175875602;
+  tmp0 = tmp0 * FIX_0_298631336;
+  tmp1 = tmp1 * FIX_2_053119869;
+  tmp2 = tmp2 * FIX_3_072711026;
+  tmp3 = tmp3 * FIX_1_501321110;
+  z1 = z1 * -FIX_0_899976223;
+  z2 = z2 * -FIX_2_562915447;
+  z3 = z3 * -FIX_1_961570560 + z5;
+  z4 = z4 * -FIX_0_390180644 + z5;
+  tmp0 += z1 + z3;
+  tmp1 += z2 + z4;
+  tmp2 += z2 + z3;
+  tmp3 += z1 + z4;
+
+  x[0] = (tmp10 + tmp3 + round) >> shift;
+  x[7 * stride] = (tmp10 - tmp3 + round) >> shift;
+  x[1 * stride] = (tmp11 + tmp2 + round) >> shift;
+  x[6 * stride] = (tmp11 - tmp2 + round) >> shift;
+  x[2 * stride] = (tmp12 + tmp1 + round) >> shift;
+  x[5 * stride] = (tmp12 - tmp1 + round) >> shift;
+  x[3 * stride] = (tmp13 + tmp0 + round) >> shift;
+  x[4 * stride] = (tmp13 - tmp0 + round) >> shift;
+}
+
+/* 1-D forward DCT of x[0], x[stride] .. x[7 * stride] in place, pass 1 of the rows or 2 of the columns */
+static DCT_TARGET inline __attribute__((always_inline)) void DCT_NAME(fdct_1d)(DCT_VI *x, int stride, int pass) {
+  DCT_VI z1, z2, z3, z4, z5, tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp10, tmp11, tmp12, tmp13;
+  int shift = pass == 1 ? DCT_CONST_BITS - DCT_PASS1_BITS : DCT_CONST_BITS + DCT_PASS1_BITS;
+  int round = 1 << (shift - 1);
+
+  tmp0 = x[0] + x[7 * stride];
+  tmp7 = x[0] - x[7 * stride];
+  tmp1 = x[1 * stride] + x[6 * stride];
+  tmp6 = x[1 * stride] - x[6 * stride];
+  tmp2 = x[2 * stride] + x[5 * stride];
+  tmp5 = x[2 * stride] - x[5 * stride];
+  tmp3 = x[3 * stride] + x[4 * stride];
+  tmp4 = x[3 * stride] - x[4 * stride];
+
+  /* even part */
+  tmp10 = tmp0 + tmp3;
+  tmp13 = tmp0 - tmp3;
+  tmp11 = tmp1 + tmp2;
+  tmp12 = tmp1 - tmp2;
+  if (pass == 1) {
+    x[0] = (tmp10 + tmp11) << DCT_PASS1_BITS;
+    x[4 * stride] = (tmp10 - tmp11) << DCT_PASS1_BITS;
+  } else {
+    x[0] = (tmp10 + tmp11 + (1 << (DCT_PASS1_BITS - 1))) >> DCT_PASS1_BITS;
+    x[4 * stride] = (tmp10 - tmp11 + (1 << (DCT_PASS1_BITS - 1))) >> DCT_PASS1_BITS;
+  }
+  z1 = (tmp12 + tmp13) * FIX_0_541196100;
+  x[2 * stride] = (z1 + tmp13 * FIX_0_765366865 + round) >> shift;
+  x[6 * stride] = (z1 + tmp12 * -FIX_1_847759065 + round) >> shift;
+
+  /* odd part */
+  z1 = tmp4 + tmp7;
+  z2 = tmp5 + tmp6;
+  z3 = tmp4 + tmp6;
+  z4 = tmp5 + tmp7;
+  z5 = (z3 + z4) * FIX_1_175875602;
+  tmp4 = tmp4 * FIX_0_298631336;
+  tmp5 = tmp5 * FIX_2_053119869;
+  tmp6 = tmp6 * FIX_3_072711026;
+  tmp7 = tmp7 * FIX_1_501321110;
+  z1 = z1 * -FIX_0_899976223;
+  z2 = z2 * -FIX_2_562915447;
+  z3 = z3 * -FIX_1_961570560 + z5;
+  z4 = z4 * -FIX_0_390180644 + z5;
+  x[7 * stride] = (tmp4 + z1 + z3 + round) >> shift;
+  x[5 * stride] = (tmp5 + z2 + z4 + round) >> shift;
+  x[3 * stride] = (tmp6 + z2 + z3 + round) >> shift;
+  x[1 * stride] = (tmp7 + z1 + z4 + round) >> shift;
+}
+
+/*
+ * jpeg_idct_islow of one block, 0 when a dequantized coefficient is too large for 32 bit lanes and
+ * the library has to: it computes in IJG_INT32, a long
+ */
+static DCT_TARGET int DCT_NAME(idct_islow)(JCOEFPTR coef, const int *quant, JSAMPARRAY out, JDIMENSION col) {
+  DCT_VI b[8][DCT_HALVES];
+  DCT_VI over = {0};
+
+  for (int r = 0; r < 8; r++) {
+    DCT_LOAD_S16(&coef[r * 8], b[r]);
+    for (int h = 0; h < DCT_HALVES; h++) {
+      b[r][h] *= *(const DCT_VI_U *) &quant[r * 8 + h * DCT_LANES];
+      over |= (b[r][h] > DCT_IDCT_MAX) | (b[r][h] < -DCT_IDCT_MAX);
+    }
+  }
+  if (DCT_ANY(over))
+    return 0;
+
+  /* pass 1 down the columns, pass 2 along the rows, then back to rows of samples */
+  for (int h = 0; h < DCT_HALVES; h++)
+    DCT_NAME(idct_1d)(&b[0][h], DCT_HALVES, DCT_CONST_BITS - DCT_PASS1_BITS);
+  DCT_TRANSPOSE(b);
+  for (int h = 0; h < DCT_HALVES; h++)
+    DCT_NAME(idct_1d)(&b[0][h], DCT_HALVES, DCT_CONST_BITS + DCT_PASS1_BITS + 3);
+  DCT_TRANSPOSE(b);
+
+  /* range_limit of the 10 bit results as jdmaster.c builds it, they wrap at 1024 */
+  for (int r = 0; r < 8; r++) {
+    for (int h = 0; h < DCT_HALVES; h++)
+      b[r][h] = (((b[r][h] & 1023) ^ 512) - 512) + CENTERJSAMPLE;
+    ijg_vb8 s = DCT_LIMIT(b[r]);
+    memcpy(out[r] + col, &s, 8);
+  }
+  return 1;
+}
+
+/* jpeg_fdct_islow of one block in place */
+static DCT_TARGET void DCT_NAME(fdct_islow)(int *data) {
+  DCT_VI b[8][DCT_HALVES];
+
+  for (int r = 0; r < 8; r++)
+    for (int h = 0; h < DCT_HALVES; h++)
+      b[r][h] = *(const DCT_VI_U *) &data[r * 8 + h * DCT_LANES];
+
+  /* pass 1 along the rows, pass 2 down the columns */
+  DCT_TRANSPOSE(b);
+  for (int h = 0; h < DCT_HALVES; h++)
+    DCT_NAME(fdct_1d)(&b[0][h], DCT_HALVES, 1);
+  DCT_TRANSPOSE(b);
+  for (int h = 0; h < DCT_HALVES; h++)
+    DCT_NAME(fdct_1d)(&b[0][h], DCT_HALVES, 2);
+
+  for (int r = 0; r < 8; r++)
+    for (int h = 0; h < DCT_HALVES; h++)
+      *(DCT_VI_U *) &data[r * 8 + h * DCT_LANES] = b[r][h];
+}
+
+/* ycc_rgb_convert of one row of width pixels, 8 at a time and the last ones as the library */
+static DCT_TARGET void DCT_NAME(ycc_rgb_row)(const JSAMPLE *y, const JSAMPLE *cb, const JSAMPLE *cr, JSAMPLE *out, JDIMENSION width) {
+  JDIMENSION col = 0;
+
+  for (; col + 8 <= width; col += 8) {
+    DCT_VI vy[DCT_HALVES], vb[DCT_HALVES], vr[DCT_HALVES], c[DCT_HALVES];
+    DCT_LOAD_U8(&y[col], vy);
+    DCT_LOAD_U8(&cb[col], vb);
+    DCT_LOAD_U8(&cr[col], vr);
+    for (int h = 0; h < DCT_HALVES; h++) {
+      vb[h] -= CENTERJSAMPLE;
+      vr[h] -= CENTERJSAMPLE;
+      c[h] = vy[h] + ((vr[h] * YCC_CR_R + YCC_HALF) >> YCC_SCALEBITS);
+    }
+    ijg_vb8 r = DCT_LIMIT(c);
+    for (int h = 0; h < DCT_HALVES; h++)
+      c[h] = vy[h] + ((vb[h] * -YCC_CB_G + vr[h] * -YCC_CR_G + YCC_HALF) >> YCC_SCALEBITS);
+    ijg_vb8 g = DCT_LIMIT(c);
+    for (int h = 0; h < DCT_HALVES; h++)
+      c[h] = vy[h] + ((vb[h] * YCC_CB_B + YCC_HALF) >> YCC_SCALEBITS);
+    ijg_vb8 b = DCT_LIMIT(c);
+    DCT_STORE_RGB(out + 3 * col, r, g, b);
+  }
+  for (; col < width; col++)
+    ycc_rgb_pixel(y[col], cb[col], cr[col], out + 3 * col);
+}
+
+#undef DCT_HALVES
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <setjmp.h>
 #include "jpeglib12.h"
+#include "batch.h"
 
 // private error handler struct
 struct DJDIJG12ErrorStruct{
@@ -16,6 +17,8 @@ struct DJDIJG12SourceManagerStruct{
 	long skip_bytes;
 	unsigned char *next_buffer;
 	unsigned int next_buffer_size;
+	const codec_fragment *fragments; // read after next_buffer, a frame split over several fragments
+	int fragment_count;
 	};
 
 void DJDIJG12ErrorExit(j_common_ptr cinfo){
@@ -34,8 +37,20 @@ void DJDIJG12termSource(j_decompress_ptr cinfo)
 boolean DJDIJG12fillInputBuffer(j_decompress_ptr cinfo) {
   struct DJDIJG12SourceManagerStruct *src = (struct DJDIJG12SourceManagerStruct*) cinfo->src;
 
-  // if we already have the next buffer, switch buffers
-  if (src->next_buffer) {
+  for (;;) {
+    // the current buffer is used up, go on with the next fragment of the frame
+    while (src->next_buffer == NULL && src->fragment_count > 0) {
+      if (src->fragments->size > 0) {
+        src->next_buffer      = src->fragments->data;
+        src->next_buffer_size = (unsigned int) src->fragments->size;
+      }
+      src->fragments++;
+      src->fragment_count--;
+    }
+    if (src->next_buffer == NULL)
+      return FALSE;
+
+    // if we already have the next buffer, switch buffers
     src->pub.next_input_byte    = src->next_buffer;
     src->pub.bytes_in_buffer    = (unsigned int) src->next_buffer_size;
     src->next_buffer            = NULL;
@@ -45,24 +60,20 @@ boolean DJDIJG12fillInputBuffer(j_decompress_ptr cinfo) {
     // In this case we must skip the remaining number of bytes here.
     if (src->skip_bytes > 0)
     {
-      if (src->pub.bytes_in_buffer < (unsigned long) src->skip_bytes)
+      if (src->pub.bytes_in_buffer <= (unsigned long) src->skip_bytes)
       {
         src->skip_bytes            -= (unsigned int) src->pub.bytes_in_buffer;
         src->pub.next_input_byte   += src->pub.bytes_in_buffer;
         src->pub.bytes_in_buffer    = 0;
-        // cause a suspension return
-        return FALSE;
-      }
-      else
-      {
-        src->pub.bytes_in_buffer   -= (unsigned int) src->skip_bytes;
-        src->pub.next_input_byte   += src->skip_bytes;
-        src->skip_bytes             = 0;
+        // the skip runs on into the next fragment, or causes a suspension return
+        continue;
       }
+      src->pub.bytes_in_buffer   -= (unsigned int) src->skip_bytes;
+      src->pub.next_input_byte   += src->skip_bytes;
+      src->skip_bytes             = 0;
     }
     return TRUE;
-    }
-return FALSE;
+  }
 }
 
 void DJDIJG12skipInputData(j_decompress_ptr cinfo, long num_bytes) {
@@ -82,78 +93,138 @@ void DJDIJG12skipInputData(j_decompress_ptr cinfo, long num_bytes) {
   }
 }
 
-boolean decode12(unsigned char *jpeg_data, int jpeg_size, unsigned char *output_data, int output_size) {
+// reusable decoder: the decompressor and its permanent pools survive between frames
+struct DJDIJG12DecoderStruct{
   struct jpeg_decompress_struct cinfo;
   struct DJDIJG12ErrorStruct jerr;
   struct DJDIJG12SourceManagerStruct src;
+  };
+
+struct DJDIJG12DecoderStruct *decoder12_create(void) {
+  struct DJDIJG12DecoderStruct *dec = calloc(1, sizeof(struct DJDIJG12DecoderStruct));
+  if (dec == NULL)
+    return NULL;
+
+  dec->src.pub.init_source = DJDIJG12initSource;
+  dec->src.pub.fill_input_buffer = DJDIJG12fillInputBuffer;
+  dec->src.pub.skip_input_data   = DJDIJG12skipInputData;
+  dec->src.pub.resync_to_restart = jpeg_resync_to_restart;
+  dec->src.pub.term_source = DJDIJG12termSource;
+
+  dec->cinfo.err = jpeg_std_error(&dec->jerr.pub);
+  dec->jerr.pub.error_exit = DJDIJG12ErrorExit;
+  if(setjmp(dec->jerr.setjmp_buffer)){
+    jpeg_destroy_decompress(&dec->cinfo);
+    free(dec);
+    return NULL;
+    }
+  jpeg_create_decompress(&dec->cinfo);
+  dec->cinfo.src = &dec->src.pub;
+  return dec;
+}
+
+void decoder12_destroy(struct DJDIJG12DecoderStruct *dec) {
+  if (dec == NULL)
+    return;
+  jpeg_destroy_decompress(&dec->cinfo);
+  free(dec);
+}
 
-  src.pub.init_source = DJDIJG12initSource;
-  src.pub.fill_input_buffer = DJDIJG12fillInputBuffer;
-  src.pub.skip_input_data   = DJDIJG12skipInputData;
-  src.pub.resync_to_restart = jpeg_resync_to_restart;
-  src.pub.term_source = DJDIJG12termSource;
-  src.pub.bytes_in_buffer   = 0;
-  src.pub.next_input_byte   = NULL;
-  src.skip_bytes             = 0;
-  src.next_buffer            = NULL;
-  src.next_buffer_size       = 0;
-
-  cinfo.err = jpeg_std_error(&jerr.pub);
-  jerr.pub.error_exit = DJDIJG12ErrorExit;
-  if(setjmp(jerr.setjmp_buffer)){
+// decodes one frame, on failure the decompressor is aborted and stays usable for the next one.
+// A frame split over several fragments continues in fragments after jpeg_data, they are read in place
+static boolean decoder12_decode_fragments(struct DJDIJG12DecoderStruct *dec, unsigned char *jpeg_data, int jpeg_size, const codec_fragment *fragments, int fragment_count, unsigned char *output_data, int output_size) {
+  j_decompress_ptr cinfo = &dec->cinfo;
+  struct DJDIJG12SourceManagerStruct *src = &dec->src;
+
+  src->pub.bytes_in_buffer   = 0;
+  src->pub.next_input_byte   = NULL;
+  src->skip_bytes             = 0;
+  src->next_buffer            = jpeg_data;
+  src->next_buffer_size       = jpeg_size;
+  src->fragments              = fragments;
+  src->fragment_count         = fragment_count;
+
+  if(setjmp(dec->jerr.setjmp_buffer)){
     char buffer[JMSG_LENGTH_MAX];
-    cinfo.err->format_message((j_common_ptr)&cinfo, buffer);
+    cinfo->err->format_message((j_common_ptr)cinfo, buffer);
     printf("ERROR, Exception, decode12, %s\r\n", buffer);
-    jpeg_destroy_decompress(&cinfo);
+    jpeg_abort_decompress(cinfo);
     return FALSE;
     }
 
-  jpeg_create_decompress(&cinfo);
-  cinfo.src = &src.pub;
-  src.next_buffer = jpeg_data;
-  src.next_buffer_size = jpeg_size;
-  jpeg_read_header(&cinfo, TRUE);
-  
-  printf("INFO, %d, %d\r\n", cinfo.image_width, cinfo.image_height);
+  jpeg_read_header(cinfo, TRUE);
 
-  JSAMPARRAY buffer = NULL;
-  int bufsize = 0;
+  JSAMPARRAY rows = NULL;
   size_t rowsize = 0;
-  void *jsampBuffer;
-
-  if (jpeg_start_decompress(&cinfo)==TRUE) {
-    bufsize = cinfo.output_width * cinfo.output_components; // number of JSAMPLEs per row
-    rowsize = bufsize * sizeof(JSAMPLE); // number of bytes per row
-    buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr) &cinfo, JPOOL_IMAGE, bufsize, 1);
-    if (buffer == NULL){
-      puts("ERROR, decode, buffer==NULL");       
-      return FALSE;
-      }
-    jsampBuffer = buffer;
-  } else {
-    bufsize = cinfo.output_width * cinfo.output_components;
-    rowsize = bufsize * sizeof(JSAMPLE);
-    buffer = (JSAMPARRAY) jsampBuffer;
+
+  if (jpeg_start_decompress(cinfo) == FALSE) {
+    puts("ERROR, decode, jpeg_start_decompress");
+    jpeg_abort_decompress(cinfo);
+    return FALSE;
   }
+  rowsize = (size_t) cinfo->output_width * cinfo->output_components * sizeof(JSAMPLE); // number of bytes per row
 
-  if (output_size < rowsize * cinfo.output_height) {
-    puts("ERROR, decode, output_size < rowsize*cinfo.output_height");    
+  if ((size_t) output_size < rowsize * cinfo->output_height) {
+    puts("ERROR, decode, output_size < rowsize*cinfo.output_height");
+    jpeg_abort_decompress(cinfo);
     return FALSE;
     }
 
-  while (cinfo.output_scanline < cinfo.output_height) {
-    if (0 == jpeg_read_scanlines(&cinfo, buffer, 1)){
-      puts("ERROR, decode, jpeg_read_scanlines");    
+  // decode straight into output_data: one row pointer per output row, the library
+  // fills as many rows per call as it has ready (rec_outbuf_height or more)
+  rows = (JSAMPARRAY) (*cinfo->mem->alloc_small)((j_common_ptr) cinfo, JPOOL_IMAGE, cinfo->output_height * sizeof(JSAMPROW));
+  for (JDIMENSION row = 0; row < cinfo->output_height; row++)
+    rows[row] = (JSAMPROW) (output_data + row * rowsize);
+
+  while (cinfo->output_scanline < cinfo->output_height) {
+    if (0 == jpeg_read_scanlines(cinfo, rows + cinfo->output_scanline, cinfo->output_height - cinfo->output_scanline)){
+      puts("ERROR, decode, jpeg_read_scanlines");
+      jpeg_abort_decompress(cinfo);
       return FALSE;
     }
-  memcpy(output_data + (cinfo.output_scanline-1) * rowsize, *buffer, rowsize);
   }
 
-  if (FALSE == jpeg_finish_decompress(&cinfo)) {
-    puts("ERROR, decode, jpeg_finish_decompress");  
+  if (FALSE == jpeg_finish_decompress(cinfo)) {
+    puts("ERROR, decode, jpeg_finish_decompress");
+    jpeg_abort_decompress(cinfo);
     return FALSE;
   }
     
-  jpeg_destroy_decompress(&cinfo);  
   return TRUE;
 }
+
+boolean decoder12_decode(struct DJDIJG12DecoderStruct *dec, unsigned char *jpeg_data, int jpeg_size, unsigned char *output_data, int output_size) {
+  return decoder12_decode_fragments(dec, jpeg_data, jpeg_size, NULL, 0, output_data, output_size);
+}
+
+static void *decoder12_batch_create(void) {
+  return decoder12_create();
+}
+
+static void decoder12_batch_destroy(void *ctx) {
+  decoder12_destroy((struct DJDIJG12DecoderStruct *) ctx);
+}
+
+static void decoder12_batch_frame(void *ctx, codec_frame *frame, const void *args) {
+  frame->status = decoder12_decode_fragments((struct DJDIJG12DecoderStruct *) ctx, frame->input, frame->input_size, frame->fragments, frame->fragment_count, frame->output, frame->output_size);
+  frame->size = frame->status ? frame->output_size : 0;
+}
+
+// decodes count frames on up to threads native threads, returns the number of frames that failed
+int decoder12_batch(codec_frame *frames, int count, int threads) {
+  codec_batch batch = {frames, count, 0, decoder12_batch_create, decoder12_batch_destroy, decoder12_batch_frame, NULL};
+  return codec_batch_run(&batch, threads);
+}
+
+boolean decode12(unsigned char *jpeg_data, int jpeg_size, unsigned char *output_data, int output_size) {
+  struct DJDIJG12DecoderStruct *dec = decoder12_create();
+  boolean result;
+
+  if (dec == NULL) {
+    puts("ERROR, decode, decoder12_create");
+    return FALSE;
+    }
+  result = decoder12_decode(dec, jpeg_data, jpeg_size, output_data, output_size);
+  decoder12_destroy(dec);
+  return result;
+}
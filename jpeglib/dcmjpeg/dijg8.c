@@ -3,6 +3,7 @@
 #include <string.h>
 #include <setjmp.h>
 #include "jpeglib8.h"
+#include "batch.h"
 //#include "libijg8/jerror8.h"
 
 // private error handler struct
@@ -17,12 +18,16 @@ struct DJDIJG8SourceManagerStruct{
 	long skip_bytes;
 	unsigned char *next_buffer;
 	unsigned int next_buffer_size;
+	const codec_fragment *fragments; // read after next_buffer, a frame split over several fragments
+	int fragment_count;
 	};
 
 void DJDIJG8ErrorExit(j_common_ptr cinfo){
 	 struct DJDIJG8ErrorStruct  *jerr = (struct DJDIJG8ErrorStruct *) cinfo->err;
 	 longjmp(jerr->setjmp_buffer, 1);
 	 }
+
+#include "dct8.h"
    
 void DJDIJG8initSource(j_decompress_ptr cinfo)
 {
@@ -35,8 +40,20 @@ void DJDIJG8termSource(j_decompress_ptr cinfo)
 boolean DJDIJG8fillInputBuffer(j_decompress_ptr cinfo) {
   struct DJDIJG8SourceManagerStruct *src = (struct DJDIJG8SourceManagerStruct*) cinfo->src;
 
-  // if we already have the next buffer, switch buffers
-  if (src->next_buffer) {
+  for (;;) {
+    // the current buffer is used up, go on with the next fragment of the frame
+    while (src->next_buffer == NULL && src->fragment_count > 0) {
+      if (src->fragments->size > 0) {
+        src->next_buffer      = src->fragments->data;
+        src->next_buffer_size = (unsigned int) src->fragments->size;
+      }
+      src->fragments++;
+      src->fragment_count--;
+    }
+    if (src->next_buffer == NULL)
+      return FALSE;
+
+    // if we already have the next buffer, switch buffers
     src->pub.next_input_byte    = src->next_buffer;
     src->pub.bytes_in_buffer    = (unsigned int) src->next_buffer_size;
     src->next_buffer            = NULL;
@@ -46,24 +63,20 @@ boolean DJDIJG8fillInputBuffer(j_decompress_ptr cinfo) {
     // In this case we must skip the remaining number of bytes here.
     if (src->skip_bytes > 0)
     {
-      if (src->pub.bytes_in_buffer < (unsigned long) src->skip_bytes)
+      if (src->pub.bytes_in_buffer <= (unsigned long) src->skip_bytes)
       {
         src->skip_bytes            -= (unsigned int) src->pub.bytes_in_buffer;
         src->pub.next_input_byte   += src->pub.bytes_in_buffer;
         src->pub.bytes_in_buffer    = 0;
-        // cause a suspension return
-        return FALSE;
-      }
-      else
-      {
-        src->pub.bytes_in_buffer   -= (unsigned int) src->skip_bytes;
-        src->pub.next_input_byte   += src->skip_bytes;
-        src->skip_bytes             = 0;
+        // the skip runs on into the next fragment, or causes a suspension return
+        continue;
       }
+      src->pub.bytes_in_buffer   -= (unsigned int) src->skip_bytes;
+      src->pub.next_input_byte   += src->skip_bytes;
+      src->skip_bytes             = 0;
     }
     return TRUE;
-    }
-return FALSE;
+  }
 }
 
 void DJDIJG8skipInputData(j_decompress_ptr cinfo, long num_bytes) {
@@ -83,85 +96,235 @@ void DJDIJG8skipInputData(j_decompress_ptr cinfo, long num_bytes) {
   }
 }
 
-boolean decode8(unsigned char *jpeg_data, int jpeg_size, unsigned char *output_data, int output_size) {
+// reusable decoder: the decompressor and its permanent pools survive between frames
+struct DJDIJG8DecoderStruct{
   struct jpeg_decompress_struct cinfo;
   struct DJDIJG8ErrorStruct jerr;
   struct DJDIJG8SourceManagerStruct src;
+  };
+
+struct DJDIJG8DecoderStruct *decoder8_create(void) {
+  struct DJDIJG8DecoderStruct *dec = calloc(1, sizeof(struct DJDIJG8DecoderStruct));
+  if (dec == NULL)
+    return NULL;
+
+  dec->src.pub.init_source = DJDIJG8initSource;
+  dec->src.pub.fill_input_buffer = DJDIJG8fillInputBuffer;
+  dec->src.pub.skip_input_data   = DJDIJG8skipInputData;
+  dec->src.pub.resync_to_restart = jpeg_resync_to_restart;
+  dec->src.pub.term_source = DJDIJG8termSource;
+
+  dec->cinfo.err = jpeg_std_error(&dec->jerr.pub);
+  dec->jerr.pub.error_exit = DJDIJG8ErrorExit;
+  if(setjmp(dec->jerr.setjmp_buffer)){
+    jpeg_destroy_decompress(&dec->cinfo);
+    free(dec);
+    return NULL;
+    }
+  jpeg_create_decompress(&dec->cinfo);
+  dec->cinfo.src = &dec->src.pub;
+  return dec;
+}
+
+void decoder8_destroy(struct DJDIJG8DecoderStruct *dec) {
+  if (dec == NULL)
+    return;
+  jpeg_destroy_decompress(&dec->cinfo);
+  free(dec);
+}
+
+// decodes one frame, on failure the decompressor is aborted and stays usable for the next one.
+// A frame split over several fragments continues in fragments after jpeg_data, they are read in
+// place. With keep_ycbcr YCbCr frames are left as coded instead of converted to RGB
+static boolean decoder8_decode_as(struct DJDIJG8DecoderStruct *dec, unsigned char *jpeg_data, int jpeg_size, const codec_fragment *fragments, int fragment_count, unsigned char *output_data, int output_size, int keep_ycbcr) {
+  j_decompress_ptr cinfo = &dec->cinfo;
+  struct DJDIJG8SourceManagerStruct *src = &dec->src;
 
-  src.pub.init_source = DJDIJG8initSource;
-  src.pub.fill_input_buffer = DJDIJG8fillInputBuffer;
-  src.pub.skip_input_data   = DJDIJG8skipInputData;
-  src.pub.resync_to_restart = jpeg_resync_to_restart;
-  src.pub.term_source = DJDIJG8termSource;
-  src.pub.bytes_in_buffer   = 0;
-  src.pub.next_input_byte   = NULL;
-  src.skip_bytes             = 0;
-  src.next_buffer            = NULL;
-  src.next_buffer_size       = 0;
-
-  cinfo.err = jpeg_std_error(&jerr.pub);
-  jerr.pub.error_exit = DJDIJG8ErrorExit;
-  if(setjmp(jerr.setjmp_buffer)){
+  src->pub.bytes_in_buffer   = 0;
+  src->pub.next_input_byte   = NULL;
+  src->skip_bytes             = 0;
+  src->next_buffer            = jpeg_data;
+  src->next_buffer_size       = jpeg_size;
+  src->fragments              = fragments;
+  src->fragment_count         = fragment_count;
+
+  if(setjmp(dec->jerr.setjmp_buffer)){
     char buffer[JMSG_LENGTH_MAX];
-    cinfo.err->format_message((j_common_ptr)&cinfo, buffer);
+    cinfo->err->format_message((j_common_ptr)cinfo, buffer);
     printf("ERROR, Exception, decode8, %s\r\n", buffer);
-    jpeg_destroy_decompress(&cinfo);
+    jpeg_abort_decompress(cinfo);
     return FALSE;
     }
 
-  jpeg_create_decompress(&cinfo);
-  cinfo.src = &src.pub;
-  src.next_buffer = jpeg_data;
-  src.next_buffer_size = jpeg_size;
-  jpeg_read_header(&cinfo, TRUE);
+  jpeg_read_header(cinfo, TRUE);
   
-  if((cinfo.process==2)&&(cinfo.jpeg_color_space==JCS_YCbCr)) // JPEG Lossless
-	 cinfo.jpeg_color_space= JCS_RGB;
-
-  printf("INFO, %d, %d\r\n", cinfo.image_width, cinfo.image_height);
+  if((cinfo->process==2)&&(cinfo->jpeg_color_space==JCS_YCbCr)) // JPEG Lossless
+	 cinfo->jpeg_color_space= JCS_RGB;
+  if (keep_ycbcr && cinfo->jpeg_color_space == JCS_YCbCr)
+    cinfo->out_color_space = JCS_YCbCr;
 
-  JSAMPARRAY buffer = NULL;
-  int bufsize = 0;
+  JSAMPARRAY rows = NULL;
   size_t rowsize = 0;
-  void *jsampBuffer;
-
-  if (jpeg_start_decompress(&cinfo)==TRUE) {
-    bufsize = cinfo.output_width * cinfo.output_components; // number of JSAMPLEs per row
-    rowsize = bufsize * sizeof(JSAMPLE); // number of bytes per row
-    buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr) &cinfo, JPOOL_IMAGE, bufsize, 1);
-    if (buffer == NULL){
-      puts("ERROR, decode, buffer==NULL");       
-      return FALSE;
-      }
-    jsampBuffer = buffer;
-  } else {
-    bufsize = cinfo.output_width * cinfo.output_components;
-    rowsize = bufsize * sizeof(JSAMPLE);
-    buffer = (JSAMPARRAY) jsampBuffer;
+
+  if (jpeg_start_decompress(cinfo) == FALSE) {
+    puts("ERROR, decode, jpeg_start_decompress");
+    jpeg_abort_decompress(cinfo);
+    return FALSE;
   }
+  rowsize = (size_t) cinfo->output_width * cinfo->output_components * sizeof(JSAMPLE); // number of bytes per row
 
-  if (output_size < rowsize * cinfo.output_height) {
-    puts("ERROR, decode, output_size < rowsize*cinfo.output_height");    
+  if ((size_t) output_size < rowsize * cinfo->output_height) {
+    puts("ERROR, decode, output_size < rowsize*cinfo.output_height");
+    jpeg_abort_decompress(cinfo);
     return FALSE;
     }
 
-  while (cinfo.output_scanline < cinfo.output_height) {
-    if (0 == jpeg_read_scanlines(&cinfo, buffer, 1)){
-      puts("ERROR, decode, jpeg_read_scanlines");    
+  // decode straight into output_data: one row pointer per output row, the library
+  // fills as many rows per call as it has ready (rec_outbuf_height or more)
+  rows = (JSAMPARRAY) (*cinfo->mem->alloc_small)((j_common_ptr) cinfo, JPOOL_IMAGE, cinfo->output_height * sizeof(JSAMPROW));
+  for (JDIMENSION row = 0; row < cinfo->output_height; row++)
+    rows[row] = (JSAMPROW) (output_data + row * rowsize);
+
+  while (cinfo->output_scanline < cinfo->output_height) {
+    if (0 == jpeg_read_scanlines(cinfo, rows + cinfo->output_scanline, cinfo->output_height - cinfo->output_scanline)){
+      puts("ERROR, decode, jpeg_read_scanlines");
+      jpeg_abort_decompress(cinfo);
       return FALSE;
     }
-  memcpy(output_data + (cinfo.output_scanline-1) * rowsize, *buffer, rowsize);
   }
 
-  if (FALSE == jpeg_finish_decompress(&cinfo)) {
-    puts("ERROR, decode, jpeg_finish_decompress");  
+  if (FALSE == jpeg_finish_decompress(cinfo)) {
+    puts("ERROR, decode, jpeg_finish_decompress");
+    jpeg_abort_decompress(cinfo);
     return FALSE;
   }
     
-  jpeg_destroy_decompress(&cinfo);  
   return TRUE;
 }
+
+boolean decoder8_decode(struct DJDIJG8DecoderStruct *dec, unsigned char *jpeg_data, int jpeg_size, unsigned char *output_data, int output_size) {
+  return decoder8_decode_as(dec, jpeg_data, jpeg_size, NULL, 0, output_data, output_size, 0);
+}
  
+
+/*
+ * Decodes one frame at 1/denom of its size in each direction, denom 1, 2, 4 or 8, into a buffer
+ * allocated here and handed to the caller with its size and dimensions. IJG scales in the IDCT, so
+ * the coefficients of the dropped frequencies are never transformed and the upsampling runs on the
+ * small image. Lossless frames have no IDCT and only decode at full size.
+ */
+boolean decoder8_decode_scaled(struct DJDIJG8DecoderStruct *dec, unsigned char *jpeg_data, int jpeg_size, int denom, unsigned char **raw, int *raw_size, int *width, int *height) {
+  j_decompress_ptr cinfo = &dec->cinfo;
+  struct DJDIJG8SourceManagerStruct *src = &dec->src;
+  unsigned char * volatile output = NULL;
+  JSAMPARRAY rows;
+  size_t rowsize;
+
+  if (denom != 1 && denom != 2 && denom != 4 && denom != 8)
+    return FALSE;
+
+  src->pub.bytes_in_buffer   = 0;
+  src->pub.next_input_byte   = NULL;
+  src->skip_bytes             = 0;
+  src->next_buffer            = jpeg_data;
+  src->next_buffer_size       = jpeg_size;
+  src->fragments              = NULL;
+  src->fragment_count         = 0;
+
+  if(setjmp(dec->jerr.setjmp_buffer)){
+    char buffer[JMSG_LENGTH_MAX];
+    cinfo->err->format_message((j_common_ptr)cinfo, buffer);
+    printf("ERROR, Exception, decode8 scaled, %s\r\n", buffer);
+    jpeg_abort_decompress(cinfo);
+    free(output);
+    return FALSE;
+    }
+
+  jpeg_read_header(cinfo, TRUE);
+  if (cinfo->process == JPROC_LOSSLESS) {
+    if (denom != 1) {
+      jpeg_abort_decompress(cinfo);
+      return FALSE;
+    }
+    if (cinfo->jpeg_color_space == JCS_YCbCr)
+      cinfo->jpeg_color_space = JCS_RGB;
+  }
+  cinfo->scale_num = 1;
+  cinfo->scale_denom = denom;
+
+  if (jpeg_start_decompress(cinfo) == FALSE) {
+    jpeg_abort_decompress(cinfo);
+    return FALSE;
+  }
+  rowsize = (size_t) cinfo->output_width * cinfo->output_components * sizeof(JSAMPLE);
+  output = malloc(rowsize * cinfo->output_height);
+  if (output == NULL) {
+    jpeg_abort_decompress(cinfo);
+    return FALSE;
+  }
+  rows = (JSAMPARRAY) (*cinfo->mem->alloc_small)((j_common_ptr) cinfo, JPOOL_IMAGE, cinfo->output_height * sizeof(JSAMPROW));
+  for (JDIMENSION row = 0; row < cinfo->output_height; row++)
+    rows[row] = (JSAMPROW) (output + row * rowsize);
+
+  while (cinfo->output_scanline < cinfo->output_height) {
+    if (0 == jpeg_read_scanlines(cinfo, rows + cinfo->output_scanline, cinfo->output_height - cinfo->output_scanline)) {
+      jpeg_abort_decompress(cinfo);
+      free(output);
+      return FALSE;
+    }
+  }
+  if (FALSE == jpeg_finish_decompress(cinfo)) {
+    jpeg_abort_decompress(cinfo);
+    free(output);
+    return FALSE;
+  }
+  *raw = output;
+  *raw_size = (int) (rowsize * cinfo->output_height);
+  *width = (int) cinfo->output_width;
+  *height = (int) cinfo->output_height;
+  return TRUE;
+}
+
+static void *decoder8_batch_create(void) {
+  return decoder8_create();
+}
+
+static void decoder8_batch_destroy(void *ctx) {
+  decoder8_destroy((struct DJDIJG8DecoderStruct *) ctx);
+}
+
+static void decoder8_batch_frame(void *ctx, codec_frame *frame, const void *args) {
+  int keep_ycbcr = args != NULL && *(const int *) args;
+  frame->status = decoder8_decode_as((struct DJDIJG8DecoderStruct *) ctx, frame->input, frame->input_size, frame->fragments, frame->fragment_count, frame->output, frame->output_size, keep_ycbcr);
+  frame->size = frame->status ? frame->output_size : 0;
+}
+
+// decodes count frames on up to threads native threads, returns the number of frames that failed
+int decoder8_batch(codec_frame *frames, int count, int threads) {
+  codec_batch batch = {frames, count, 0, decoder8_batch_create, decoder8_batch_destroy, decoder8_batch_frame, NULL};
+  return codec_batch_run(&batch, threads);
+}
+
+// as decoder8_batch, YCbCr frames are left as coded instead of converted to RGB
+int decoder8_batch_ycbcr(codec_frame *frames, int count, int threads) {
+  int keep_ycbcr = 1;
+  codec_batch batch = {frames, count, 0, decoder8_batch_create, decoder8_batch_destroy, decoder8_batch_frame, &keep_ycbcr};
+  return codec_batch_run(&batch, threads);
+}
+
+boolean decode8(unsigned char *jpeg_data, int jpeg_size, unsigned char *output_data, int output_size) {
+  struct DJDIJG8DecoderStruct *dec = decoder8_create();
+  boolean result;
+
+  if (dec == NULL) {
+    puts("ERROR, decode, decoder8_create");
+    return FALSE;
+    }
+  result = decoder8_decode(dec, jpeg_data, jpeg_size, output_data, output_size);
+  decoder8_destroy(dec);
+  return result;
+}
+
 /*
 int FileSize(FILE *fp){
   int size;
@@ -186,7 +349,6 @@ int JPDecode(char *filename){
   jpeg_data = malloc(jpeg_size);
   fread(jpeg_data, 1, jpeg_size, fp);
   fclose(fp);
-  printf("INFO, JPDecode: %d\r\n", jpeg_size);
   
   output_size = 1576*1134*3;
   output_data = malloc(output_size);
@@ -211,9 +373,6 @@ int JRDecode(unsigned char *jpeg_data, int jpeg_size){
   int output_size;
   FILE *fp;
 
-  printf("INFO, JRDecode: %d, %d\r\n", jpeg_data[0], jpeg_data[1]);
-  printf("INFO, JRDecode: %d\r\n", jpeg_size);
-  
   output_size = 1576*1134*3;
   output_data = malloc(output_size);
   if(decode8(jpeg_data, jpeg_size, output_data, output_size)==TRUE){
@@ -4,123 +4,248 @@
 #include <setjmp.h>
 #include "oftypes.h"
 #include "jpeglib12.h"
+#include "jerror12.h"
+#include "batch.h"
 
 #define BUFFER_SIZE 16384
 
 typedef struct {
      struct jpeg_destination_mgr pub; /* base class */
-     unsigned char *buffer; /* buffer start address */
-     int bufsize; /* size of buffer */
-     unsigned char *jpeg_image;
-     int jpeg_size;
+     unsigned char *jpeg_image; /* output buffer, handed to the caller on success */
+     size_t capacity; /* allocated size of jpeg_image */
+     size_t jpeg_size; /* bytes written, set by term_destination */
+     int caller_owned; /* jpeg_image belongs to the caller: never grown, only counted past its end */
+     int spilling; /* the caller buffer is full, output goes to spill */
+     size_t overflow; /* bytes written to spill and dropped so far */
+     JOCTET spill[BUFFER_SIZE];
 } memory_destination_mgr;
 
 typedef memory_destination_mgr* mem_dest_ptr;
 
+/* Initial output allocation: a fraction of the raw frame, so most frames never grow */
+size_t encode_size_hint12(Uint16 width, Uint16 height, Uint16 samplesPerPixel, int bytesPerSample, int lossless) {
+     size_t raw = (size_t) width * height * samplesPerPixel * bytesPerSample;
+     size_t hint = lossless ? raw / 2 : raw / 8;
+     return hint < BUFFER_SIZE ? BUFFER_SIZE : hint;
+}
+
 /* This function is called by the library before any data gets written */
 void init_destination12 (j_compress_ptr cinfo) {
      mem_dest_ptr dest = (mem_dest_ptr) cinfo->dest;
-     dest->pub.next_output_byte = dest->buffer;
-     dest->pub.free_in_buffer = BUFFER_SIZE; /* input buffer size */
+     dest->spilling = dest->capacity == 0;
+     dest->overflow = 0;
+     dest->pub.next_output_byte = dest->spilling ? dest->spill : dest->jpeg_image;
+     dest->pub.free_in_buffer = dest->spilling ? BUFFER_SIZE : dest->capacity;
 }
 
+/* The output buffer is full: double it in place, the compressor keeps writing after the old end.
+   A caller-owned buffer is never grown, the rest of the stream is only counted so the caller
+   learns the size it needs */
 boolean empty_output_buffer12 (j_compress_ptr cinfo) {
      mem_dest_ptr dest = (mem_dest_ptr) cinfo->dest;
-     if(dest->jpeg_size>0){
-          unsigned char *temp = malloc(dest->jpeg_size);
-          memcpy(temp, dest->jpeg_image, dest->jpeg_size);
-          free(dest->jpeg_image);
-          dest->jpeg_image = malloc(dest->jpeg_size+BUFFER_SIZE);
-          memcpy(dest->jpeg_image, temp, dest->jpeg_size);
-          free(temp);
-     }              
-     memcpy(dest->jpeg_image+dest->jpeg_size, dest->buffer, BUFFER_SIZE);
-     dest->jpeg_size=dest->jpeg_size+BUFFER_SIZE;
-     dest->pub.next_output_byte = dest->buffer;
-     dest->pub.free_in_buffer = BUFFER_SIZE;
+     size_t used = dest->capacity;
+     if (dest->caller_owned) {
+          if (dest->spilling)
+               dest->overflow += BUFFER_SIZE;
+          dest->spilling = 1;
+          dest->pub.next_output_byte = dest->spill;
+          dest->pub.free_in_buffer = BUFFER_SIZE;
+          return TRUE;
+          }
+     unsigned char *grown = realloc(dest->jpeg_image, 2 * dest->capacity);
+     if (grown == NULL)
+          ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 10);
+     dest->jpeg_image = grown;
+     dest->capacity = 2 * dest->capacity;
+     dest->pub.next_output_byte = dest->jpeg_image + used;
+     dest->pub.free_in_buffer = dest->capacity - used;
      return TRUE;
 }
 
 void term_destination12 (j_compress_ptr cinfo) {
-     int count;
      mem_dest_ptr dest = (mem_dest_ptr) cinfo->dest;
-     count = BUFFER_SIZE - dest->pub.free_in_buffer;
-     if (count) {                            
-          unsigned char *temp = malloc(dest->jpeg_size);
-          memcpy(temp, dest->jpeg_image, dest->jpeg_size);
-          free(dest->jpeg_image);
-          dest->jpeg_image = malloc(dest->jpeg_size+count);
-          memcpy(dest->jpeg_image, temp, dest->jpeg_size);
-          free(temp);                  
-          memcpy(dest->jpeg_image+dest->jpeg_size, dest->buffer, count);
-          dest->jpeg_size=dest->jpeg_size+count;
-    }
+     if (dest->spilling)
+          dest->jpeg_size = dest->capacity + dest->overflow + (BUFFER_SIZE - dest->pub.free_in_buffer);
+     else
+          dest->jpeg_size = dest->capacity - dest->pub.free_in_buffer;
 }
 
-boolean encode12(Uint16 *image_buffer, Uint16 width, Uint16 height, Uint16 samplesPerPixel, Uint8 **jpegBuf, int *jpegSize, int mode) {
+/* Compresses one frame into the caller's outBuf when jpegBuf is NULL, otherwise into a buffer allocated here
+   and handed back through jpegBuf */
+static boolean compress12(j_compress_ptr cinfo, Uint16 *image_buffer, Uint16 width, Uint16 height, Uint16 samplesPerPixel, Uint8 *outBuf, size_t outCapacity, Uint8 **jpegBuf, size_t *jpegSize, int mode, int restartRows) {
      int quality=90;
-     struct jpeg_compress_struct cinfo;
-     struct jpeg_error_mgr jerr;
   	mem_dest_ptr dest;
      JSAMPROW row_pointer[1];
      int row_stride;
-     cinfo.err = jpeg_std_error(&jerr);
 
-     jpeg_create_compress(&cinfo);
      /* set method callbacks */
-     /* first call for this instance - need to setup */
-     if (cinfo.dest == 0) {
-          cinfo.dest = (struct jpeg_destination_mgr *)
-          (*cinfo.mem->alloc_small) ((j_common_ptr) &cinfo, JPOOL_PERMANENT, sizeof (memory_destination_mgr));
+     /* first call for this instance - need to setup, reused encoders keep it */
+     if (cinfo->dest == 0) {
+          cinfo->dest = (struct jpeg_destination_mgr *)
+          (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT, sizeof (memory_destination_mgr));
           }
 
-     dest = (mem_dest_ptr) cinfo.dest;
-     dest->buffer = malloc(BUFFER_SIZE);
-     dest->jpeg_image = malloc(BUFFER_SIZE);
+     dest = (mem_dest_ptr) cinfo->dest;
+     dest->caller_owned = jpegBuf == NULL;
+     if (dest->caller_owned) {
+          dest->capacity = outCapacity;
+          dest->jpeg_image = outBuf;
+          }
+     else {
+          dest->capacity = encode_size_hint12(width, height, samplesPerPixel, sizeof(JSAMPLE), 0);
+          dest->jpeg_image = malloc(dest->capacity);
+          }
      dest->jpeg_size = 0;
+     if (dest->jpeg_image == NULL && !dest->caller_owned) {
+          return FALSE;
+          }
      dest->pub.init_destination = init_destination12;
      dest->pub.empty_output_buffer = empty_output_buffer12;
      dest->pub.term_destination = term_destination12;
      
-     cinfo.image_width = width;
-     cinfo.image_height = height;
-     cinfo.input_components = samplesPerPixel;
+     cinfo->image_width = width;
+     cinfo->image_height = height;
+     cinfo->input_components = samplesPerPixel;
 
      if(samplesPerPixel==3)
-	     cinfo.in_color_space = JCS_RGB;
+	     cinfo->in_color_space = JCS_RGB;
 	if(samplesPerPixel==1)
-	     cinfo.in_color_space = JCS_GRAYSCALE;
+	     cinfo->in_color_space = JCS_GRAYSCALE;
 
-     jpeg_set_defaults(&cinfo);
+     jpeg_set_defaults(cinfo);
 
 //    case EJM_baseline:
-	jpeg_set_quality(&cinfo, quality, 1);
+	jpeg_set_quality(cinfo, quality, 1);
+     cinfo->restart_in_rows = restartRows;
 //    case EJM_lossless:
      // always disables any kind of color space conversion
-//     jpeg_simple_lossless(&cinfo, psv, pt);
+//     jpeg_simple_lossless(cinfo, psv, pt);
 
-	if(cinfo.jpeg_color_space == JCS_YCbCr){
-          cinfo.comp_info[0].h_samp_factor=1;
-          cinfo.comp_info[0].v_samp_factor=1;
+	if(cinfo->jpeg_color_space == JCS_YCbCr){
+          cinfo->comp_info[0].h_samp_factor=1;
+          cinfo->comp_info[0].v_samp_factor=1;
           }
      for(int sfi=1; sfi< MAX_COMPONENTS; sfi++){
-          cinfo.comp_info[sfi].h_samp_factor=1;
-          cinfo.comp_info[sfi].v_samp_factor=1;
+          cinfo->comp_info[sfi].h_samp_factor=1;
+          cinfo->comp_info[sfi].v_samp_factor=1;
           }
 
-     jpeg_start_compress(&cinfo,TRUE);
+     jpeg_start_compress(cinfo,TRUE);
      row_stride = width * samplesPerPixel;
-     while (cinfo.next_scanline < cinfo.image_height){
-          row_pointer[0] = &image_buffer[cinfo.next_scanline * row_stride];
-          jpeg_write_scanlines(&cinfo, row_pointer, 1);
+     while (cinfo->next_scanline < cinfo->image_height){
+          row_pointer[0] = &image_buffer[cinfo->next_scanline * row_stride];
+          jpeg_write_scanlines(cinfo, row_pointer, 1);
      }
 
-     jpeg_finish_compress(&cinfo);
-     *jpegBuf = malloc(dest->jpeg_size);
-     memcpy(*jpegBuf, dest->jpeg_image, dest->jpeg_size);
+     jpeg_finish_compress(cinfo);
+     /* hand the destination buffer over as is, the caller frees it */
+     if (!dest->caller_owned)
+          *jpegBuf = dest->jpeg_image;
      *jpegSize = dest->jpeg_size;
-     free(dest->buffer);
-     free(dest->jpeg_image);
-     jpeg_destroy_compress(&cinfo);
      return TRUE;
 }
+
+// reusable encoder: the compressor, its tables and destination manager survive between frames
+struct EIJG12EncoderStruct {
+     struct jpeg_compress_struct cinfo;
+     struct jpeg_error_mgr jerr;
+     int restart_rows; /* MCU rows per restart interval of lossy frames, 0 for none */
+};
+
+struct EIJG12EncoderStruct *encoder12_create(void) {
+     struct EIJG12EncoderStruct *enc = calloc(1, sizeof(struct EIJG12EncoderStruct));
+     if (enc == NULL)
+          return NULL;
+     enc->cinfo.err = jpeg_std_error(&enc->jerr);
+     jpeg_create_compress(&enc->cinfo);
+     return enc;
+}
+
+void encoder12_destroy(struct EIJG12EncoderStruct *enc) {
+     if (enc == NULL)
+          return;
+     jpeg_destroy_compress(&enc->cinfo);
+     free(enc);
+}
+
+/* Sets the MCU rows between restart markers of the lossy frames this encoder compresses, 0 for none.
+   Restart markers let a decoder split the frame and decode the intervals on several threads */
+void encoder12_set_restart_rows(struct EIJG12EncoderStruct *enc, int rows) {
+     enc->restart_rows = rows < 0 ? 0 : rows;
+}
+
+boolean encoder12_encode(struct EIJG12EncoderStruct *enc, Uint16 *image_buffer, Uint16 width, Uint16 height, Uint16 samplesPerPixel, Uint8 **jpegBuf, int *jpegSize, int mode) {
+     size_t size = 0;
+     if (!compress12(&enc->cinfo, image_buffer, width, height, samplesPerPixel, NULL, 0, jpegBuf, &size, mode, enc->restart_rows))
+          return FALSE;
+     *jpegSize = (int) size;
+     return TRUE;
+}
+
+/* Compresses one frame straight into the caller's outBuf. On return jpegSize holds the size of
+   the whole codestream; when it is larger than outCapacity only the first outCapacity bytes were
+   stored and the caller has to retry with a buffer of at least jpegSize bytes */
+boolean encoder12_encode_to(struct EIJG12EncoderStruct *enc, Uint16 *image_buffer, Uint16 width, Uint16 height, Uint16 samplesPerPixel, Uint8 *outBuf, int outCapacity, int *jpegSize, int mode) {
+     size_t size = 0;
+     if (outCapacity < 0)
+          outCapacity = 0;
+     if (!compress12(&enc->cinfo, image_buffer, width, height, samplesPerPixel, outBuf, (size_t) outCapacity, NULL, &size, mode, enc->restart_rows))
+          return FALSE;
+     *jpegSize = (int) size;
+     return TRUE;
+}
+
+/* frame geometry and coding settings shared by every frame of an encoder batch */
+typedef struct {
+     Uint16 width;
+     Uint16 height;
+     Uint16 samplesPerPixel;
+     int mode;
+     int restart_rows;
+} encoder12_batch_args;
+
+static void *encoder12_batch_create(void) {
+     return encoder12_create();
+}
+
+static void encoder12_batch_destroy(void *ctx) {
+     encoder12_destroy((struct EIJG12EncoderStruct *) ctx);
+}
+
+static void encoder12_batch_frame(void *ctx, codec_frame *frame, const void *args) {
+     const encoder12_batch_args *a = (const encoder12_batch_args *) args;
+     struct EIJG12EncoderStruct *enc = (struct EIJG12EncoderStruct *) ctx;
+     enc->restart_rows = a->restart_rows;
+     frame->status = encoder12_encode_to(enc, (Uint16 *) frame->input, a->width, a->height, a->samplesPerPixel,
+          frame->output, frame->output_size, &frame->size, a->mode);
+}
+
+/* Encodes count frames of the same geometry on up to threads native threads, each one straight
+   into its output buffer, lossy frames with restartRows MCU rows per restart interval. A frame whose
+   size is larger than output_size did not fit, see encode12_to.
+   Returns the number of frames that failed */
+int encoder12_batch(codec_frame *frames, int count, Uint16 width, Uint16 height, Uint16 samplesPerPixel, int mode, int restartRows, int threads) {
+     encoder12_batch_args args = {width, height, samplesPerPixel, mode, restartRows < 0 ? 0 : restartRows};
+     codec_batch batch = {frames, count, 0, encoder12_batch_create, encoder12_batch_destroy, encoder12_batch_frame, &args};
+     return codec_batch_run(&batch, threads);
+}
+
+boolean encode12(Uint16 *image_buffer, Uint16 width, Uint16 height, Uint16 samplesPerPixel, Uint8 **jpegBuf, int *jpegSize, int mode) {
+     struct EIJG12EncoderStruct *enc = encoder12_create();
+     boolean result;
+     if (enc == NULL)
+          return FALSE;
+     result = encoder12_encode(enc, image_buffer, width, height, samplesPerPixel, jpegBuf, jpegSize, mode);
+     encoder12_destroy(enc);
+     return result;
+}
+
+boolean encode12_to(Uint16 *image_buffer, Uint16 width, Uint16 height, Uint16 samplesPerPixel, Uint8 *outBuf, int outCapacity, int *jpegSize, int mode) {
+     struct EIJG12EncoderStruct *enc = encoder12_create();
+     boolean result;
+     if (enc == NULL)
+          return FALSE;
+     result = encoder12_encode_to(enc, image_buffer, width, height, samplesPerPixel, outBuf, outCapacity, jpegSize, mode);
+     encoder12_destroy(enc);
+     return result;
+}
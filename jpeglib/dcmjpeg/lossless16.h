@@ -0,0 +1,402 @@
+#ifndef DCMJPEG_LOSSLESS16_H
+#define DCMJPEG_LOSSLESS16_H
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd.h"
+#include "jpegint16.h"
+#include "jlossls16.h"
+#include "jdhuff16.h"
+
+/*
+ * Lossless decoding of the 16 bit codec. libijg16 decodes a row of differences one MCU at a time
+ * through jpeg_fill_bit_buffer, which keeps no more than 32 bits in the bit buffer, and then
+ * undifferences it one sample at a time. The linux platform files link with --wrap for
+ * jinit16_lhuff_decoder and jinit16_undifferencer: the Huffman decoder gets a decode_mcus that
+ * keeps a 64 bit buffer filled in line and decodes whole rows with it, and the undifferencer gets
+ * a row kernel per predictor at the level ijg_simd_level picks. The scalar level keeps the library
+ * modules. Samples are the same bits as the library's.
+ */
+
+#if defined(__linux__) && (defined(IJG_SIMD_X86) || defined(IJG_SIMD_NEON))
+
+/* PREDICTOR5A of jlossls16.h, running's predictor argument */
+#define LOSSLESS_PREDICTOR5A 8
+
+/* the term of the row above a sample of predictors 1, 4, 5 and 5a adds to Ra */
+static inline int lossless_term(int predictor, const JDIFF *prev, JDIMENSION x) {
+  switch (predictor) {
+  case 4:
+    return prev[x] - prev[x - 1];
+  case 5:
+    return (prev[x] - prev[x - 1]) >> 1;
+  case LOSSLESS_PREDICTOR5A:
+    return ((INT16) prev[x] - (INT16) prev[x - 1]) >> 1;
+  }
+  return 0;
+}
+
+/* predictors 6 and 7 halve a sum with Ra, so their rows stay one sample at a time */
+static void lossless_undifference6(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  int ra = out[0] = (diff[0] + prev[0]) & 0xFFFF;
+  for (JDIMENSION x = 1; x < width; x++)
+    out[x] = ra = (diff[x] + prev[x] + ((ra - prev[x - 1]) >> 1)) & 0xFFFF;
+}
+
+static void lossless_undifference6a(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  int ra = out[0] = (diff[0] + prev[0]) & 0xFFFF;
+  for (JDIMENSION x = 1; x < width; x++)
+    out[x] = ra = (diff[x] + (INT16) prev[x] + (((INT16) ra - (INT16) prev[x - 1]) >> 1)) & 0xFFFF;
+}
+
+static void lossless_undifference7(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  int ra = out[0] = (diff[0] + prev[0]) & 0xFFFF;
+  for (JDIMENSION x = 1; x < width; x++)
+    out[x] = ra = (diff[x] + ((ra + prev[x]) >> 1)) & 0xFFFF;
+}
+
+static void lossless_undifference7a(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  int ra = out[0] = (diff[0] + prev[0]) & 0xFFFF;
+  for (JDIMENSION x = 1; x < width; x++)
+    out[x] = ra = (diff[x] + (((INT16) ra + (INT16) prev[x]) >> 1)) & 0xFFFF;
+}
+
+#if defined(IJG_SIMD_X86)
+
+/* running sum of the 8 lanes: within each half, then the low half's last lane into the high half */
+IJG_TARGET_AVX2 static inline ijg_vi8 lossless_scan_avx2(ijg_vi8 v) {
+  __m256i s = (__m256i) v;
+  s = _mm256_add_epi32(s, _mm256_slli_si256(s, 4));
+  s = _mm256_add_epi32(s, _mm256_slli_si256(s, 8));
+  return (ijg_vi8) _mm256_add_epi32(s, _mm256_shuffle_epi32(_mm256_permute2x128_si256(s, s, 0x08), 0xFF));
+}
+
+#define LL_NAME(x) lossless_##x##_avx2
+#define LL_TARGET IJG_TARGET_AVX2
+#define LL_LANES 8
+#define LL_VI ijg_vi8
+#define LL_VI_U ijg_vi8u
+#define LL_SCAN(v) lossless_scan_avx2(v)
+#define LL_LAST(v) ((ijg_vi8) _mm256_permutevar8x32_epi32((__m256i) (v), _mm256_set1_epi32(7)))
+#include "lossless_lanes.h"
+
+#elif defined(IJG_SIMD_NEON)
+
+static inline ijg_vi4 lossless_scan_neon(ijg_vi4 v) {
+  int32x4_t zero = vdupq_n_s32(0), s = (int32x4_t) v;
+  s = vaddq_s32(s, vextq_s32(zero, s, 3));
+  return (ijg_vi4) vaddq_s32(s, vextq_s32(zero, s, 2));
+}
+
+#define LL_NAME(x) lossless_##x##_neon
+#define LL_TARGET
+#define LL_LANES 4
+#define LL_VI ijg_vi4
+#define LL_VI_U ijg_vi4u
+#define LL_SCAN(v) lossless_scan_neon(v)
+#define LL_LAST(v) ((ijg_vi4) vdupq_laneq_s32((int32x4_t) (v), 3))
+#include "lossless_lanes.h"
+
+#endif
+
+/* the library's own modules, the same static functions for every decompressor: read once from the
+   first decompressor set up, under pthread_once, so decoders set up on several threads never write
+   them while others call them */
+static JDIMENSION (*lossless_lib_decode_mcus)(j_decompress_ptr cinfo, JDIFFIMAGE diff_buf, JDIMENSION MCU_row_num, JDIMENSION MCU_col_num, JDIMENSION nMCU);
+static void (*lossless_lib_predict_start_pass)(j_decompress_ptr cinfo);
+static void (*lossless_lib_predict_process_restart)(j_decompress_ptr cinfo);
+static pthread_once_t lossless_lib_huff_once = PTHREAD_ONCE_INIT;
+static pthread_once_t lossless_lib_predict_once = PTHREAD_ONCE_INIT;
+
+/* the codec the library just set up on this thread, pthread_once takes no argument */
+static __thread j_lossless_d_ptr lossless_lib_codec;
+
+static void lossless_lib_huff_init(void) {
+  lossless_lib_decode_mcus = lossless_lib_codec->entropy_decode_mcus;
+}
+
+static void lossless_lib_predict_init(void) {
+  lossless_lib_predict_start_pass = lossless_lib_codec->predict_start_pass;
+  lossless_lib_predict_process_restart = lossless_lib_codec->predict_process_restart;
+}
+
+/* after the library set up the first row of a scan or restart interval, ours at the current level */
+static void lossless_first_rows(j_decompress_ptr cinfo) {
+  j_lossless_d_ptr losslsd = (j_lossless_d_ptr) cinfo->codec;
+  predict_undifference_method_ptr first_row = NULL;
+
+  switch (ijg_simd_level()) {
+#if defined(IJG_SIMD_X86)
+  case IJG_SIMD_AVX2:
+    first_row = lossless_undifference_first_row_avx2;
+    break;
+#elif defined(IJG_SIMD_NEON)
+  case IJG_SIMD_NEON:
+    first_row = lossless_undifference_first_row_neon;
+    break;
+#endif
+  }
+  if (first_row == NULL)
+    return;
+  for (int ci = 0; ci < cinfo->num_components; ci++)
+    losslsd->predict_undifference[ci] = first_row;
+}
+
+/* the library's checks of Ss, Se, Ah and Al stay */
+static void lossless_predict_start_pass(j_decompress_ptr cinfo) {
+  (*lossless_lib_predict_start_pass)(cinfo);
+  lossless_first_rows(cinfo);
+}
+
+static void lossless_predict_process_restart(j_decompress_ptr cinfo) {
+  (*lossless_lib_predict_process_restart)(cinfo);
+  lossless_first_rows(cinfo);
+}
+
+/* lhuff_entropy_decoder of jdlhuff.c, its start_pass and process_restart stay the library's */
+typedef struct {
+  int ci, yoffset, MCU_width;
+} lossless_output_ptr_info;
+
+typedef struct {
+  huffd_common_fields;
+  d_derived_tbl *derived_tbls[NUM_HUFF_TBLS];
+  d_derived_tbl *cur_tbls[D_MAX_DATA_UNITS_IN_MCU];
+  JDIFFROW output_ptr[D_MAX_DATA_UNITS_IN_MCU];
+  int num_output_ptrs;
+  lossless_output_ptr_info output_ptr_info[D_MAX_DATA_UNITS_IN_MCU];
+  int output_ptr_index[D_MAX_DATA_UNITS_IN_MCU];
+} lossless_entropy_decoder;
+
+/* bits of the bit buffer, and the most a difference takes: a 16 bit code and 15 more bits */
+#define LOSSLESS_BUFFER_BITS ((int) sizeof(bit_buf_type) * 8)
+#define LOSSLESS_SAMPLE_BITS 31
+
+/* HUFF_EXTEND of jdhuff.c */
+#define LOSSLESS_EXTEND(x, s) ((x) < (1 << ((s) - 1)) ? (x) - (1 << (s)) + 1 : (x))
+
+/*
+ * decode_mcus of jdlhuff.c for nMCU MCUs of units samples, unit u of table tbls[u] written to
+ * ptrs[index[u]]. The bit buffer is filled in line up to LOSSLESS_BUFFER_BITS while the source has
+ * bytes up to the next marker, 8 at a time when none of them is 0xFF. A sample with fewer bits left
+ * in the buffer, at a marker or at the end of the source's buffer, or with a code longer than the
+ * lookahead goes through the library's macros and functions as decode_mcus runs them, and so does
+ * its suspension: the state is that of the start of the MCU.
+ */
+static inline __attribute__((always_inline)) JDIMENSION lossless_decode_units(j_decompress_ptr cinfo, lossless_entropy_decoder *entropy, JDIMENSION nMCU, int units, d_derived_tbl **tbls, JDIFFROW *ptrs, const int *index) {
+  BITREAD_STATE_VARS;
+  const JOCTET *next, *mcu_next;
+  size_t bytes, mcu_bytes;
+  bit_buf_type mcu_buffer;
+  int mcu_bits, marker;
+  JDIMENSION mcu;
+
+  BITREAD_LOAD_STATE(cinfo, entropy->bitstate);
+  next = br_state.next_input_byte;
+  bytes = br_state.bytes_in_buffer;
+  marker = cinfo->unread_marker;
+
+  for (mcu = 0; mcu < nMCU; mcu++) {
+    mcu_next = next;
+    mcu_bytes = bytes;
+    mcu_buffer = get_buffer;
+    mcu_bits = bits_left;
+    for (int u = 0; u < units; u++) {
+      d_derived_tbl *tbl = tbls[u];
+      int s, r;
+
+      if (bits_left < LOSSLESS_SAMPLE_BITS && !marker) {
+        unsigned long w;
+        if (bytes >= 8 && (memcpy(&w, next, 8), w = ~w, ((w - 0x0101010101010101UL) & ~w & 0x8080808080808080UL) == 0)) {
+          int k = (LOSSLESS_BUFFER_BITS - 1 - bits_left) >> 3;
+          w = __builtin_bswap64(~w);
+          get_buffer = (bit_buf_type) (((unsigned long) get_buffer << (8 * k)) | (w >> (64 - 8 * k)));
+          bits_left += 8 * k;
+          next += k;
+          bytes -= k;
+        } else {
+          while (bits_left <= LOSSLESS_BUFFER_BITS - 8 && bytes > 1) {
+            int c = *next;
+            if (c == 0xFF) {
+              if (next[1] != 0)
+                break;
+              next++;
+              bytes--;
+            }
+            next++;
+            bytes--;
+            get_buffer = (bit_buf_type) (((unsigned long) get_buffer << 8) | (unsigned) c);
+            bits_left += 8;
+          }
+        }
+      }
+      if (bits_left >= LOSSLESS_SAMPLE_BITS) {
+        int look = PEEK_BITS(HUFF_LOOKAHEAD);
+        int nb = tbl->look_nbits[look];
+        if (nb != 0) {
+          DROP_BITS(nb);
+          s = tbl->look_sym[look];
+          if (s == 16)
+            s = 32768;
+          else if (s) {
+            r = GET_BITS(s);
+            s = LOSSLESS_EXTEND(r, s);
+          }
+          *ptrs[index[u]]++ = (JDIFF) s;
+          continue;
+        }
+      }
+
+      br_state.next_input_byte = next;
+      br_state.bytes_in_buffer = bytes;
+      HUFF_DECODE(s, br_state, tbl, goto suspend, slow, FALSE);
+      if (s) {
+        if (s == 16)
+          s = 32768;
+        else {
+          CHECK_BIT_BUFFER(br_state, s, goto suspend);
+          r = GET_BITS(s);
+          s = LOSSLESS_EXTEND(r, s);
+        }
+      }
+      next = br_state.next_input_byte;
+      bytes = br_state.bytes_in_buffer;
+      marker = cinfo->unread_marker;
+      *ptrs[index[u]]++ = (JDIFF) s;
+    }
+  }
+
+  br_state.next_input_byte = next;
+  br_state.bytes_in_buffer = bytes;
+  BITREAD_SAVE_STATE(cinfo, entropy->bitstate);
+  return nMCU;
+
+suspend:
+  cinfo->src->next_input_byte = mcu_next;
+  cinfo->src->bytes_in_buffer = mcu_bytes;
+  entropy->bitstate.get_buffer = mcu_buffer;
+  entropy->bitstate.bits_left = mcu_bits;
+  return mcu;
+}
+
+/* out of data and the Cornell workaround go to the library */
+static JDIMENSION lossless_decode_mcus(j_decompress_ptr cinfo, JDIFFIMAGE diff_buf, JDIMENSION MCU_row_num, JDIMENSION MCU_col_num, JDIMENSION nMCU) {
+  j_lossless_d_ptr losslsd = (j_lossless_d_ptr) cinfo->codec;
+  lossless_entropy_decoder *entropy = (lossless_entropy_decoder *) losslsd->entropy_private;
+  d_derived_tbl *tbls[D_MAX_DATA_UNITS_IN_MCU];
+  JDIFFROW ptrs[D_MAX_DATA_UNITS_IN_MCU];
+  int index[D_MAX_DATA_UNITS_IN_MCU];
+  int units = cinfo->data_units_in_MCU;
+
+  if (entropy->insufficient_data || (cinfo->workaround_options & WORKAROUND_BUGGY_CORNELL_16BIT_JPEG_ENCODER))
+    return (*lossless_lib_decode_mcus)(cinfo, diff_buf, MCU_row_num, MCU_col_num, nMCU);
+
+  for (int p = 0; p < entropy->num_output_ptrs; p++) {
+    lossless_output_ptr_info *info = &entropy->output_ptr_info[p];
+    ptrs[p] = diff_buf[info->ci][MCU_row_num + info->yoffset] + MCU_col_num * info->MCU_width;
+  }
+  for (int u = 0; u < units; u++) {
+    tbls[u] = entropy->cur_tbls[u];
+    index[u] = entropy->output_ptr_index[u];
+  }
+  if (units == 1)
+    return lossless_decode_units(cinfo, entropy, nMCU, 1, tbls, ptrs, index);
+  return lossless_decode_units(cinfo, entropy, nMCU, units, tbls, ptrs, index);
+}
+
+void __real_jinit16_lhuff_decoder(j_decompress_ptr cinfo);
+void __real_jinit16_undifferencer(j_decompress_ptr cinfo);
+
+void __wrap_jinit16_lhuff_decoder(j_decompress_ptr cinfo) {
+  j_lossless_d_ptr losslsd = (j_lossless_d_ptr) cinfo->codec;
+
+  __real_jinit16_lhuff_decoder(cinfo);
+  lossless_lib_codec = losslsd;
+  pthread_once(&lossless_lib_huff_once, lossless_lib_huff_init);
+  if (ijg_simd_level() != IJG_SIMD_SCALAR)
+    losslsd->entropy_decode_mcus = lossless_decode_mcus;
+}
+
+void __wrap_jinit16_undifferencer(j_decompress_ptr cinfo) {
+  j_lossless_d_ptr losslsd = (j_lossless_d_ptr) cinfo->codec;
+
+  __real_jinit16_undifferencer(cinfo);
+  lossless_lib_codec = losslsd;
+  pthread_once(&lossless_lib_predict_once, lossless_lib_predict_init);
+  if (ijg_simd_level() != IJG_SIMD_SCALAR) {
+    losslsd->predict_start_pass = lossless_predict_start_pass;
+    losslsd->predict_process_restart = lossless_predict_process_restart;
+  }
+}
+
+static unsigned lossless_rand(unsigned *seed) {
+  *seed = *seed * 1103515245u + 12345u;
+  return *seed >> 16;
+}
+
+/*
+ * Undifferences rows of width random differences with predictor 1 .. 7, the variant of
+ * WORKAROUND_PREDICTOR6OVERFLOW when overflow is set, once at the current level and once in the
+ * library, with a restart halfway. Returns 1 when both give the same samples, 0 when not, -1 when
+ * the library is the current level. Meant for tests.
+ */
+int JPEGPredictorMatches(int predictor, int overflow, int width, unsigned seed) {
+  enum { rows = 16 };
+  struct jpeg_decompress_struct cinfo;
+  jpeg_lossless_d_codec codec;
+  JDIFF *diff, *lib, *simd;
+  int same = 1;
+
+  if (ijg_simd_level() == IJG_SIMD_SCALAR)
+    return -1;
+  diff = malloc(sizeof(JDIFF) * width * rows);
+  lib = malloc(sizeof(JDIFF) * width * rows);
+  simd = malloc(sizeof(JDIFF) * width * rows);
+  if (diff == NULL || lib == NULL || simd == NULL) {
+    free(diff);
+    free(lib);
+    free(simd);
+    return 0;
+  }
+  for (int i = 0; i < width * rows; i++)
+    diff[i] = (int) (lossless_rand(&seed) % 65536) - 32767;
+
+  memset(&cinfo, 0, sizeof(cinfo));
+  cinfo.codec = (struct jpeg_d_codec *) &codec;
+  cinfo.data_precision = 16;
+  cinfo.num_components = 1;
+  cinfo.Ss = predictor;
+  cinfo.Al = (int) (seed % 4);
+  cinfo.workaround_options = overflow ? WORKAROUND_PREDICTOR6OVERFLOW : 0;
+  for (int pass = 0; pass < 2; pass++) {
+    JDIFF *out = pass == 0 ? lib : simd;
+    if (pass == 0)
+      __real_jinit16_undifferencer(&cinfo);
+    else
+      __wrap_jinit16_undifferencer(&cinfo);
+    (*codec.predict_start_pass)(&cinfo);
+    for (int r = 0; r < rows; r++) {
+      if (r == rows / 2)
+        (*codec.predict_process_restart)(&cinfo);
+      (*codec.predict_undifference[0])(&cinfo, 0, diff + r * width, out + (r > 0 ? r - 1 : 0) * width, out + r * width, width);
+    }
+  }
+  for (int i = 0; i < width * rows; i++)
+    same = same && lib[i] == simd[i];
+  free(diff);
+  free(lib);
+  free(simd);
+  return same;
+}
+
+#else
+
+int JPEGPredictorMatches(int predictor, int overflow, int width, unsigned seed) {
+  return -1;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Undifferencing of the lossless predictors on LL_LANES samples at once, included by
+ * lossless16.h once per instruction set with these defined:
+ *
+ *   LL_NAME(x)     name of x for the instruction set
+ *   LL_TARGET      target attribute of the functions
+ *   LL_LANES       lanes of a vector, 4 or 8
+ *   LL_VI          int vector, LL_VI_U one at any address
+ *   LL_SCAN(v)     running sum of the lanes of v, lane i the sum of lanes 0 .. i
+ *   LL_LAST(v)     the last lane of v in every lane
+ *
+ * Predictors 1, 4 and 5 are Ra plus a term of the row above, so their row is a running sum of the
+ * differences and those terms, modulo 65536 as the library masks every sample. Predictors 2 and 3
+ * only read the row above. Every lane runs the arithmetic of jdpred.c, so the samples are the same
+ * bits as the library's.
+ */
+
+/* out[x] = Ra + diff[x] + term from x = start on, Ra being ra for the first one */
+static LL_TARGET inline __attribute__((always_inline)) void LL_NAME(running)(const JDIFF *diff, const JDIFF *prev, JDIFF *out, JDIMENSION x, JDIMENSION width, int ra, int predictor) {
+  LL_VI carry = (LL_VI) {0} + ra;
+
+  for (; x + LL_LANES <= width; x += LL_LANES) {
+    LL_VI d = *(const LL_VI_U *) &diff[x];
+    if (predictor != 1) {
+      LL_VI rb = *(const LL_VI_U *) &prev[x];
+      LL_VI rc = *(const LL_VI_U *) &prev[x - 1];
+      if (predictor == 4)
+        d += rb - rc;
+      else if (predictor == 5)
+        d += (rb - rc) >> 1;
+      else
+        d += (((rb << 16) >> 16) - ((rc << 16) >> 16)) >> 1;
+    }
+    d = (LL_SCAN(d) + carry) & 0xFFFF;
+    *(LL_VI_U *) &out[x] = d;
+    carry = LL_LAST(d);
+  }
+  ra = carry[0];
+  for (; x < width; x++)
+    out[x] = ra = (ra + diff[x] + lossless_term(predictor, prev, x)) & 0xFFFF;
+}
+
+static LL_TARGET void LL_NAME(undifference1)(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  out[0] = (diff[0] + prev[0]) & 0xFFFF;
+  LL_NAME(running)(diff, prev, out, 1, width, out[0], 1);
+}
+
+static LL_TARGET void LL_NAME(undifference2)(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  JDIMENSION x = 0;
+
+  for (; x + LL_LANES <= width; x += LL_LANES)
+    *(LL_VI_U *) &out[x] = (*(const LL_VI_U *) &diff[x] + *(const LL_VI_U *) &prev[x]) & 0xFFFF;
+  for (; x < width; x++)
+    out[x] = (diff[x] + prev[x]) & 0xFFFF;
+}
+
+static LL_TARGET void LL_NAME(undifference3)(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  JDIMENSION x = 1;
+
+  out[0] = (diff[0] + prev[0]) & 0xFFFF;
+  for (; x + LL_LANES <= width; x += LL_LANES)
+    *(LL_VI_U *) &out[x] = (*(const LL_VI_U *) &diff[x] + *(const LL_VI_U *) &prev[x - 1]) & 0xFFFF;
+  for (; x < width; x++)
+    out[x] = (diff[x] + prev[x - 1]) & 0xFFFF;
+}
+
+/* also predictor 4a, the casts to INT16 of PREDICTOR4A do not change a sum modulo 65536 */
+static LL_TARGET void LL_NAME(undifference4)(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  out[0] = (diff[0] + prev[0]) & 0xFFFF;
+  LL_NAME(running)(diff, prev, out, 1, width, out[0], 4);
+}
+
+static LL_TARGET void LL_NAME(undifference5)(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  out[0] = (diff[0] + prev[0]) & 0xFFFF;
+  LL_NAME(running)(diff, prev, out, 1, width, out[0], 5);
+}
+
+static LL_TARGET void LL_NAME(undifference5a)(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  out[0] = (diff[0] + prev[0]) & 0xFFFF;
+  LL_NAME(running)(diff, prev, out, 1, width, out[0], LOSSLESS_PREDICTOR5A);
+}
+
+/* the first row of a scan or restart interval predicts from 1 << (P - Pt - 1), then Ra */
+static LL_TARGET void LL_NAME(undifference_first_row)(j_decompress_ptr cinfo, int ci, JDIFFROW diff, JDIFFROW prev, JDIFFROW out, JDIMENSION width) {
+  j_lossless_d_ptr losslsd = (j_lossless_d_ptr) cinfo->codec;
+  int overflow = cinfo->workaround_options & WORKAROUND_PREDICTOR6OVERFLOW;
+
+  LL_NAME(running)(diff, prev, out, 0, width, 1 << (cinfo->data_precision - cinfo->Al - 1), 1);
+
+  switch (cinfo->Ss) {
+  case 1:
+    losslsd->predict_undifference[ci] = LL_NAME(undifference1);
+    break;
+  case 2:
+    losslsd->predict_undifference[ci] = LL_NAME(undifference2);
+    break;
+  case 3:
+    losslsd->predict_undifference[ci] = LL_NAME(undifference3);
+    break;
+  case 4:
+    losslsd->predict_undifference[ci] = LL_NAME(undifference4);
+    break;
+  case 5:
+    losslsd->predict_undifference[ci] = overflow ? LL_NAME(undifference5a) : LL_NAME(undifference5);
+    break;
+  case 6:
+    losslsd->predict_undifference[ci] = overflow ? lossless_undifference6a : lossless_undifference6;
+    break;
+  case 7:
+    losslsd->predict_undifference[ci] = overflow ? lossless_undifference7a : lossless_undifference7;
+    break;
+  }
+}
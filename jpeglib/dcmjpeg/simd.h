@@ -0,0 +1,63 @@
+#ifndef DCMJPEG_SIMD_H
+#define DCMJPEG_SIMD_H
+
+/*
+ * Runtime CPU dispatch for the DCT and color kernels of dct8.h and the lossless kernels of
+ * lossless16.h. The cgo flags build for the baseline of each platform, so the x86 kernels carry
+ * their instruction set in a target attribute and are only called after the CPU reported it. NEON
+ * is part of the arm64 baseline.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define IJG_SIMD_X86 1
+#include <immintrin.h>
+#define IJG_TARGET_AVX2 __attribute__((target("avx2")))
+typedef int ijg_vi8 __attribute__((vector_size(32), may_alias));
+typedef int ijg_vi8u __attribute__((vector_size(32), may_alias, aligned(4)));
+#elif defined(__aarch64__)
+#define IJG_SIMD_NEON 1
+#include <arm_neon.h>
+typedef int ijg_vi4 __attribute__((vector_size(16), may_alias));
+typedef int ijg_vi4u __attribute__((vector_size(16), may_alias, aligned(4)));
+#endif
+
+#define IJG_SIMD_SCALAR 0
+#define IJG_SIMD_AVX2   1
+#define IJG_SIMD_NEON   2
+
+/*
+ * Level forced by JPEGSetSIMDLevel, -1 when the best supported level is used. Shared by the
+ * codecs, dct8.h defines it.
+ */
+extern int ijg_simd_forced;
+
+static int ijg_simd_supported(int level) {
+  switch (level) {
+  case IJG_SIMD_SCALAR:
+    return 1;
+#if defined(IJG_SIMD_X86)
+  case IJG_SIMD_AVX2:
+    return __builtin_cpu_supports("avx2");
+#elif defined(IJG_SIMD_NEON)
+  case IJG_SIMD_NEON:
+    return 1;
+#endif
+  }
+  return 0;
+}
+
+static int ijg_simd_level(void) {
+  if (ijg_simd_forced >= 0)
+    return ijg_simd_forced;
+#if defined(IJG_SIMD_X86)
+  if (ijg_simd_supported(IJG_SIMD_AVX2))
+    return IJG_SIMD_AVX2;
+#elif defined(IJG_SIMD_NEON)
+  return IJG_SIMD_NEON;
+#endif
+  return IJG_SIMD_SCALAR;
+}
+
+int JPEGSetSIMDLevel(int level);
+
+#endif
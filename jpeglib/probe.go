@@ -0,0 +1,89 @@
+package jpeglib
+
+import (
+	"encoding/binary"
+	"errors"
+)
+
+// JPEGInfo - frame header of a JPEG codestream as read by JPEGprobe
+type JPEGInfo struct {
+	Width           int
+	Height          int
+	Components      int
+	Precision       int
+	Process         int // SOFn marker less 0xFFC0: 0 baseline, 1 extended, 2 progressive, 3 lossless, 8 and up arithmetic
+	RestartInterval int // MCUs between restart markers from DRI, 0 without restarts
+	MaxH, MaxV      int // largest horizontal and vertical sampling factors, the MCU is 8*MaxH x 8*MaxV
+}
+
+// Lossless - whether the frame uses the lossless process, which has no IDCT
+func (info JPEGInfo) Lossless() bool {
+	return info.Process == 3 || info.Process == 7 || info.Process == 11 || info.Process == 15
+}
+
+// RawSize - bytes DIJG8decode, DIJG12decode or DIJG16decode write for the frame
+func (info JPEGInfo) RawSize() int {
+	bytes := 1
+	if info.Precision > 8 {
+		bytes = 2
+	}
+	return info.Width * info.Height * info.Components * bytes
+}
+
+// JPEGprobe - reads the frame header of a JPEG codestream without decoding it, to size the output
+// buffer or check it against the DICOM tags. Markers are walked from SOI up to the first SOS
+func JPEGprobe(jpegData []byte) (JPEGInfo, error) {
+	var info JPEGInfo
+	if len(jpegData) < 4 || binary.BigEndian.Uint16(jpegData) != 0xFFD8 {
+		return info, errors.New("ERROR, JPEGprobe, no SOI marker")
+	}
+	frame := false
+	for pos := 2; pos+4 <= len(jpegData); {
+		if jpegData[pos] != 0xFF {
+			return info, errors.New("ERROR, JPEGprobe, marker expected")
+		}
+		marker := jpegData[pos+1]
+		if marker == 0xFF {
+			// fill byte
+			pos++
+			continue
+		}
+		length := int(binary.BigEndian.Uint16(jpegData[pos+2:]))
+		if length < 2 || pos+2+length > len(jpegData) {
+			return info, errors.New("ERROR, JPEGprobe, marker segment cut short")
+		}
+		segment := jpegData[pos+4 : pos+2+length]
+		switch {
+		case marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC:
+			if len(segment) < 6 || len(segment) < 6+3*int(segment[5]) || segment[5] == 0 {
+				return info, errors.New("ERROR, JPEGprobe, bad SOF marker")
+			}
+			info.Process = int(marker - 0xC0)
+			info.Precision = int(segment[0])
+			info.Height = int(binary.BigEndian.Uint16(segment[1:]))
+			info.Width = int(binary.BigEndian.Uint16(segment[3:]))
+			info.Components = int(segment[5])
+			for c := 0; c < info.Components; c++ {
+				info.MaxH = max(info.MaxH, int(segment[7+3*c]>>4))
+				info.MaxV = max(info.MaxV, int(segment[7+3*c]&0x0F))
+			}
+			frame = true
+		case marker == 0xDD:
+			if len(segment) < 2 {
+				return info, errors.New("ERROR, JPEGprobe, bad DRI marker")
+			}
+			info.RestartInterval = int(binary.BigEndian.Uint16(segment))
+		case marker == 0xDA:
+			if !frame {
+				return info, errors.New("ERROR, JPEGprobe, SOS before SOF")
+			}
+			if info.Width == 0 || info.Height == 0 {
+				// the height of a DNL frame is only known once the scan is decoded
+				return info, errors.New("ERROR, JPEGprobe, frame size not in SOF")
+			}
+			return info, nil
+		}
+		pos += 2 + length
+	}
+	return info, errors.New("ERROR, JPEGprobe, no SOS marker")
+}
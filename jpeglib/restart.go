@@ -0,0 +1,181 @@
+package jpeglib
+
+import (
+	"bytes"
+	"encoding/binary"
+	"runtime"
+)
+
+// eoi - the end of image marker closing every stripe
+var eoi = []byte{0xFF, 0xD9}
+
+// decodeRestart - runs a decoder batch with the frames coded in restart intervals split into
+// stripes, when there are fewer frames than threads, and folds the stripes back into their frames
+func decodeRestart(frames []Frame, threads int, bytesPerSample int, run func(frames []Frame, threads int) error) error {
+	if threads <= 0 {
+		threads = runtime.NumCPU()
+	}
+	if len(frames) == 0 || len(frames) >= threads {
+		return run(frames, threads)
+	}
+	stripes := (threads + len(frames) - 1) / len(frames)
+	batch := make([]Frame, 0, len(frames)*stripes)
+	owner := make([]int, 0, len(frames)*stripes)
+	split := false
+	for i := range frames {
+		f := &frames[i]
+		if len(f.Fragments) == 0 {
+			if parts, ok := restartStripes(f.Input, f.Output, bytesPerSample, stripes); ok {
+				batch = append(batch, parts...)
+				for range parts {
+					owner = append(owner, i)
+				}
+				split = true
+				continue
+			}
+		}
+		batch = append(batch, *f)
+		owner = append(owner, i)
+	}
+	if !split {
+		return run(frames, threads)
+	}
+
+	err := run(batch, threads)
+	for i := range frames {
+		frames[i].Size, frames[i].Err = len(frames[i].Output), nil
+	}
+	for k := range batch {
+		if f := &frames[owner[k]]; f.Err == nil && batch[k].Err != nil {
+			f.Size, f.Err = 0, batch[k].Err
+		}
+	}
+	return err
+}
+
+// restartStripes - splits a single scan Huffman frame, restarted at whole MCU rows, into stripes of
+// a multiple of 8 restart intervals, so each stripe starts on RST0 and decodes on its own: the
+// main header with the stripe height in SOF, the entropy coded data of its intervals read in place
+// and EOI. Each stripe writes its rows of output. Frames with components subsampled vertically are
+// not split, fancy upsampling reads the rows across a stripe boundary
+func restartStripes(jpegData []byte, output []byte, bytesPerSample int, stripes int) ([]Frame, bool) {
+	if stripes < 2 || len(jpegData) < 4 || binary.BigEndian.Uint16(jpegData) != 0xFFD8 {
+		return nil, false
+	}
+	sof, width, height, components, maxH, maxV, interval, scan := 0, 0, 0, 0, 0, 0, 0, 0
+	subsampled := false
+	for pos := 2; scan == 0; {
+		if pos+4 > len(jpegData) || jpegData[pos] != 0xFF {
+			return nil, false
+		}
+		marker := jpegData[pos+1]
+		if marker == 0xFF {
+			pos++
+			continue
+		}
+		length := int(binary.BigEndian.Uint16(jpegData[pos+2:]))
+		if length < 2 || pos+2+length > len(jpegData) {
+			return nil, false
+		}
+		segment := jpegData[pos+4 : pos+2+length]
+		switch {
+		case marker == 0xC0 || marker == 0xC1:
+			if len(segment) < 6 || segment[5] == 0 || len(segment) < 6+3*int(segment[5]) {
+				return nil, false
+			}
+			sof = pos
+			height = int(binary.BigEndian.Uint16(segment[1:]))
+			width = int(binary.BigEndian.Uint16(segment[3:]))
+			components = int(segment[5])
+			for c := 0; c < components; c++ {
+				maxH = max(maxH, int(segment[7+3*c]>>4))
+				maxV = max(maxV, int(segment[7+3*c]&0x0F))
+			}
+			for c := 0; c < components; c++ {
+				subsampled = subsampled || int(segment[7+3*c]&0x0F) != maxV
+			}
+		case marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC:
+			// progressive, lossless and arithmetic frames
+			return nil, false
+		case marker == 0xDD:
+			if len(segment) < 2 {
+				return nil, false
+			}
+			interval = int(binary.BigEndian.Uint16(segment))
+		case marker == 0xDA:
+			if sof == 0 || len(segment) < 1 || int(segment[0]) != components {
+				return nil, false
+			}
+			scan = pos + 2 + length
+		}
+		pos += 2 + length
+	}
+	if height == 0 || interval == 0 || (components > 1 && subsampled) {
+		return nil, false
+	}
+	mcuW, mcuH := 8, 8
+	if components > 1 {
+		mcuW, mcuH = 8*maxH, 8*maxV
+	}
+	mcusPerRow := (width + mcuW - 1) / mcuW
+	rowBytes := width * components * bytesPerSample
+	if interval%mcusPerRow != 0 || len(output) < height*rowBytes {
+		return nil, false
+	}
+	linesPerInterval := interval / mcusPerRow * mcuH
+
+	// the restart markers up to EOI, numbered RST0 to RST7 in turn; any other marker is a second scan
+	var markers []int
+	end := 0
+	for pos := scan; end == 0; {
+		k := bytes.IndexByte(jpegData[pos:], 0xFF)
+		if k < 0 || pos+k+1 >= len(jpegData) {
+			return nil, false
+		}
+		pos += k
+		switch next := jpegData[pos+1]; {
+		case next == 0x00 || next == 0xFF:
+			pos++
+		case next >= 0xD0 && next <= 0xD7:
+			if int(next-0xD0) != len(markers)%8 {
+				return nil, false
+			}
+			markers = append(markers, pos)
+			pos += 2
+		case next == 0xD9:
+			end = pos
+		default:
+			return nil, false
+		}
+	}
+	intervals := len(markers) + 1
+	if (intervals-1)*linesPerInterval >= height || intervals*linesPerInterval < height {
+		return nil, false
+	}
+	per := ((intervals+stripes-1)/stripes + 7) &^ 7
+	if per >= intervals {
+		return nil, false
+	}
+
+	parts := make([]Frame, 0, (intervals+per-1)/per)
+	for s := 0; s < intervals; s += per {
+		e := min(s+per, intervals)
+		first := s * linesPerInterval
+		lines := min(height, e*linesPerInterval) - first
+		header := append([]byte(nil), jpegData[:scan]...)
+		binary.BigEndian.PutUint16(header[sof+5:], uint16(lines))
+		start, stop := scan, end
+		if s > 0 {
+			start = markers[s-1] + 2
+		}
+		if e < intervals {
+			stop = markers[e-1]
+		}
+		parts = append(parts, Frame{
+			Input:     header,
+			Fragments: [][]byte{jpegData[start:stop], eoi},
+			Output:    output[first*rowBytes : (first+lines)*rowBytes],
+		})
+	}
+	return parts, true
+}
@@ -0,0 +1,48 @@
+package jpeglib
+
+/*
+#include <stdlib.h>
+
+// defined in dcmjpeg/dijg8.c, compiled by the platform file
+struct DJDIJG8DecoderStruct;
+int decoder8_decode_scaled(struct DJDIJG8DecoderStruct *dec, unsigned char *jpeg_data, int jpeg_size, int denom, unsigned char **raw, int *raw_size, int *width, int *height);
+*/
+import "C"
+import (
+	"errors"
+	"runtime"
+	"unsafe"
+)
+
+// DIJG8decodeScaled - JPEG File to RAW at 1/denom of the full size in each direction, denom 1, 2, 4
+// or 8, for previews and thumbnails. The scaling happens in the IDCT, so a 1/8 decode skips almost
+// all of the transform and upsampling work. The output size does not have to be known in advance,
+// returns the frame with its scaled width and height
+func DIJG8decodeScaled(jpegData []byte, denom int) ([]byte, int, int, error) {
+	dec, _ := jpegDecoder8Pool.Get().(*JPEGDecoder8)
+	if dec == nil {
+		return nil, 0, 0, errors.New("ERROR, Decode8 scaled, JPEG failed")
+	}
+	defer jpegDecoder8Pool.Put(dec)
+	return dec.DecodeScaled(jpegData, denom)
+}
+
+// DecodeScaled - JPEG File to RAW at a reduced size, see DIJG8decodeScaled
+func (d *JPEGDecoder8) DecodeScaled(jpegData []byte, denom int) ([]byte, int, int, error) {
+	var raw *C.uchar
+	var rawSize, width, height C.int
+	if d.dec == nil {
+		return nil, 0, 0, errors.New("ERROR, Decode8 scaled, JPEG decoder closed")
+	}
+	if len(jpegData) == 0 || (denom != 1 && denom != 2 && denom != 4 && denom != 8) {
+		return nil, 0, 0, errors.New("ERROR, Decode8 scaled, JPEG failed")
+	}
+	ok := C.decoder8_decode_scaled(d.dec, (*C.uchar)(unsafe.Pointer(&jpegData[0])), C.int(len(jpegData)), C.int(denom), &raw, &rawSize, &width, &height) == 1
+	runtime.KeepAlive(d)
+	if !ok {
+		return nil, 0, 0, errors.New("ERROR, Decode8 scaled, JPEG failed")
+	}
+	outData := C.GoBytes(unsafe.Pointer(raw), rawSize)
+	C.free(unsafe.Pointer(raw))
+	return outData, int(width), int(height), nil
+}
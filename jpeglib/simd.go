@@ -0,0 +1,55 @@
+package jpeglib
+
+/*
+// defined in dcmjpeg/dct8.h and dcmjpeg/lossless16.h, compiled by the platform files
+int JPEGSetSIMDLevel(int level);
+int JPEGIDCTMatches(int magnitude, int quant, unsigned seed);
+int JPEGFDCTMatches(unsigned seed);
+int JPEGColorMatches(int width, unsigned seed);
+int JPEGPredictorMatches(int predictor, int overflow, int width, unsigned seed);
+*/
+import "C"
+
+// Instruction sets of the 8 bit DCT and color kernels and the 16 bit lossless ones, see setSIMDLevel
+const (
+	simdScalar = 0
+	simdAVX2   = 1
+	simdNEON   = 2
+)
+
+// setSIMDLevel - forces the 8 and 16 bit kernels to one instruction set, -1 restores the automatic choice.
+// Returns the level in use, which differs from level when the CPU does not support it
+func setSIMDLevel(level int) int {
+	return int(C.JPEGSetSIMDLevel(C.int(level)))
+}
+
+// idctMatches - runs the inverse DCT on blocks of coefficients up to magnitude and quantization
+// values up to quant at the current level and in libijg8. Returns 1 when the samples are the
+// same, 0 when not, -1 when the current level is libijg8's own
+func idctMatches(magnitude int, quant int, seed uint32) int {
+	return int(C.JPEGIDCTMatches(C.int(magnitude), C.int(quant), C.uint(seed)))
+}
+
+// fdctMatches - runs the forward DCT on blocks of samples at the current level and in libijg8.
+// Returns 1 when the coefficients are the same, 0 when not, -1 when the current level is libijg8's own
+func fdctMatches(seed uint32) int {
+	return int(C.JPEGFDCTMatches(C.uint(seed)))
+}
+
+// colorMatches - converts rows of width YCbCr pixels to RGB at the current level and with the
+// color deconverter of libijg8. Returns 1 when the pixels are the same, 0 when not, -1 when the
+// current level is libijg8's own
+func colorMatches(width int, seed uint32) int {
+	return int(C.JPEGColorMatches(C.int(width), C.uint(seed)))
+}
+
+// predictorMatches - undifferences rows of width samples with a lossless predictor, 1 .. 7, at the
+// current level and in libijg16, with the overflow workaround of predictors 5 .. 7 when overflow is
+// true. Returns 1 when the samples are the same, 0 when not, -1 when the current level is libijg16's own
+func predictorMatches(predictor int, overflow bool, width int, seed uint32) int {
+	o := 0
+	if overflow {
+		o = 1
+	}
+	return int(C.JPEGPredictorMatches(C.int(predictor), C.int(o), C.int(width), C.uint(seed)))
+}
@@ -0,0 +1,86 @@
+package jpegls
+
+import (
+	"errors"
+	"fmt"
+	"runtime"
+	"sync"
+)
+
+// Frame - one frame of a batch call. Input holds the source data and Output receives the result,
+// after the call Size is the number of bytes written to Output and Err the outcome of the frame
+type Frame struct {
+	Input  []byte
+	Output []byte
+	Size   int
+	Err    error
+}
+
+// JLSdecodeBatch - JPEG-LS Files to RAW, every frame decoded on up to threads goroutines, 0 uses
+// one per CPU. Returns the first frame error
+func JLSdecodeBatch(frames []Frame, threads int) error {
+	return runBatch(frames, threads, false, "JLSdecode", func(f *Frame) {
+		f.Err = JLSdecode(f.Input, uint32(len(f.Input)), f.Output)
+		if f.Err == nil {
+			if w, h, s, p, err := JLSinfo(f.Input); err == nil {
+				f.Size = w * h * s * ((p + 7) / 8)
+			}
+		}
+	})
+}
+
+// JLSencodeBatch - RAW Files to JPEG-LS, frames of the same geometry encoded on up to threads
+// goroutines, each straight into its Output. A frame whose Output is too small gets
+// ErrBufferTooSmall with the size it needs. Returns the first frame error
+func JLSencodeBatch(frames []Frame, width uint16, height uint16, samples uint16, bitsa uint16, near int, threads int) error {
+	return runBatch(frames, threads, true, "JLSencode", func(f *Frame) {
+		f.Size, f.Err = JLSencodeTo(f.Input, width, height, samples, bitsa, f.Output, near)
+	})
+}
+
+// runBatch - hands the frames out to the goroutines in order of their index
+func runBatch(frames []Frame, threads int, encode bool, name string, run func(f *Frame)) error {
+	for i := range frames {
+		if len(frames[i].Input) == 0 || (!encode && len(frames[i].Output) == 0) {
+			return fmt.Errorf("ERROR, %s failed, frame %d has no data", name, i)
+		}
+		frames[i].Size, frames[i].Err = 0, nil
+	}
+	if threads <= 0 {
+		threads = runtime.NumCPU()
+	}
+	threads = min(threads, len(frames))
+
+	var wg sync.WaitGroup
+	var mu sync.Mutex
+	next := 0
+	for t := 0; t < threads; t++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for {
+				mu.Lock()
+				i := next
+				next++
+				mu.Unlock()
+				if i >= len(frames) {
+					return
+				}
+				run(&frames[i])
+			}
+		}()
+	}
+	wg.Wait()
+
+	var first error
+	for i := range frames {
+		f := &frames[i]
+		if f.Err != nil && !errors.Is(f.Err, ErrBufferTooSmall) {
+			f.Size = 0
+		}
+		if first == nil && f.Err != nil {
+			first = f.Err
+		}
+	}
+	return first
+}
@@ -0,0 +1,147 @@
+package jpegls
+
+import "math/bits"
+
+// bitWriter - writes the entropy coded segment of a scan. A byte after 0xFF carries only 7 bits,
+// its high bit is the stuffed zero that keeps the data apart from markers
+type bitWriter struct {
+	out []byte
+	acc uint64 // pending bits, the last n bits are valid
+	n   uint
+	ff  bool // the last byte written was 0xFF
+}
+
+// write - appends the n low bits of v, n up to 32
+func (w *bitWriter) write(v uint32, n uint) {
+	w.acc = w.acc<<n | uint64(v)&(1<<n-1)
+	w.n += n
+	for w.n >= 8 {
+		w.emit()
+	}
+}
+
+// zeros - appends n zero bits
+func (w *bitWriter) zeros(n int) {
+	for ; n > 32; n -= 32 {
+		w.write(0, 32)
+	}
+	w.write(0, uint(n))
+}
+
+func (w *bitWriter) emit() {
+	var b byte
+	if w.ff {
+		w.n -= 7
+		b = byte(w.acc>>w.n) & 0x7F
+	} else {
+		w.n -= 8
+		b = byte(w.acc >> w.n)
+	}
+	w.out = append(w.out, b)
+	w.ff = b == 0xFF
+}
+
+// flush - pads the last byte with zeros, a final 0xFF gets its stuffed byte so the marker after
+// the scan reads as a marker
+func (w *bitWriter) flush() {
+	if w.n > 0 && w.ff {
+		w.acc <<= 7 - w.n
+		w.n = 7
+		w.emit()
+	} else if w.n > 0 {
+		w.write(0, 8-w.n)
+	}
+	if w.ff {
+		w.out = append(w.out, 0)
+		w.ff = false
+	}
+}
+
+// bitReader - reads the entropy coded segment of a scan, dropping the stuffed bits. Past the end of
+// the segment, which a marker or the end of the data closes, it reads zeros and counts them
+type bitReader struct {
+	data []byte
+	pos  int
+	acc  uint64 // the next n bits, left aligned
+	n    uint
+	ff   bool
+	end  bool
+	over int // zero bits read past the end
+}
+
+func (r *bitReader) fill() {
+	for r.n <= 56 {
+		if r.end || r.pos >= len(r.data) {
+			r.end = true
+			r.n += 8
+			r.over += 8
+			continue
+		}
+		b := r.data[r.pos]
+		if r.ff {
+			if b&0x80 != 0 {
+				r.end = true
+				continue
+			}
+			r.acc |= uint64(b) << (57 - r.n)
+			r.n += 7
+		} else {
+			r.acc |= uint64(b) << (56 - r.n)
+			r.n += 8
+		}
+		r.ff = b == 0xFF
+		r.pos++
+	}
+}
+
+// read - the next n bits, n up to 32
+func (r *bitReader) read(n uint) int32 {
+	if n == 0 {
+		return 0
+	}
+	if r.n < n {
+		r.fill()
+	}
+	v := int32(r.acc >> (64 - n))
+	r.acc <<= n
+	r.n -= n
+	return v
+}
+
+func (r *bitReader) bit() bool {
+	if r.n == 0 {
+		r.fill()
+	}
+	v := r.acc>>63 != 0
+	r.acc <<= 1
+	r.n--
+	return v
+}
+
+// zeros - counts the zero bits up to the next one and consumes them with the one. Stops counting
+// at max, which no valid code reaches
+func (r *bitReader) zeros(max int32) int32 {
+	count := int32(0)
+	for {
+		if r.n < 32 {
+			r.fill()
+		}
+		z := uint(bits.LeadingZeros64(r.acc))
+		if z < r.n {
+			r.acc <<= z + 1
+			r.n -= z + 1
+			return count + int32(z)
+		}
+		count += int32(r.n)
+		r.acc = 0
+		r.n = 0
+		if count > max {
+			return count
+		}
+	}
+}
+
+// overrun - whether the decoder consumed bits beyond its data, the zeros read ahead are still in acc
+func (r *bitReader) overrun() bool {
+	return r.over > int(r.n)
+}
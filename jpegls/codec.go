@@ -0,0 +1,440 @@
+package jpegls
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+)
+
+// JPEG-LS markers, ITU-T T.87 / ISO 14495-1
+const (
+	markerSOI  = 0xD8
+	markerEOI  = 0xD9
+	markerSOS  = 0xDA
+	markerDRI  = 0xDD
+	markerSOF  = 0xF7 // SOF55, JPEG-LS frame
+	markerLSE  = 0xF8 // JPEG-LS preset parameters
+	markerAPP0 = 0xE0
+	markerAPPF = 0xEF
+	markerCOM  = 0xFE
+)
+
+// Interleave modes of a scan
+const (
+	interleaveNone   = 0
+	interleaveLine   = 1
+	interleaveSample = 2
+)
+
+// frame - geometry of a JPEG-LS frame
+type frame struct {
+	width, height int
+	components    int
+	precision     int
+	ids           [3]byte
+}
+
+// bytesPerSample - 1 for up to 8 bit samples, 2 (little endian) above
+func (f *frame) bytesPerSample() int {
+	if f.precision > 8 {
+		return 2
+	}
+	return 1
+}
+
+// planes - one line buffer pair per component with the edge samples, see scan.go
+type planes struct {
+	prev, cur [3][]int32
+}
+
+func newPlanes(width int, components int) *planes {
+	p := &planes{}
+	for c := 0; c < components; c++ {
+		p.prev[c] = make([]int32, width+2)
+		p.cur[c] = make([]int32, width+2)
+	}
+	return p
+}
+
+// next - swaps the lines of component c and sets up the edges of the new current line
+func (p *planes) next(c int, width int) {
+	p.prev[c], p.cur[c] = p.cur[c], p.prev[c]
+	p.prev[c][width+1] = p.prev[c][width]
+	p.cur[c][0] = p.prev[c][1]
+}
+
+// load - copies component c of line y of the raw frame into the current line
+func (f *frame) load(raw []byte, y int, c int, line []int32) {
+	stride := f.components * f.bytesPerSample()
+	row := raw[y*f.width*stride:]
+	if f.bytesPerSample() == 1 {
+		for x := 0; x < f.width; x++ {
+			line[x+1] = int32(row[x*stride+c])
+		}
+		return
+	}
+	for x := 0; x < f.width; x++ {
+		line[x+1] = int32(binary.LittleEndian.Uint16(row[x*stride+2*c:]))
+	}
+}
+
+// store - copies the current line of component c into line y of the raw frame
+func (f *frame) store(raw []byte, y int, c int, line []int32) {
+	stride := f.components * f.bytesPerSample()
+	row := raw[y*f.width*stride:]
+	if f.bytesPerSample() == 1 {
+		for x := 0; x < f.width; x++ {
+			row[x*stride+c] = byte(line[x+1])
+		}
+		return
+	}
+	for x := 0; x < f.width; x++ {
+		binary.LittleEndian.PutUint16(row[x*stride+2*c:], uint16(line[x+1]))
+	}
+}
+
+// JLSencodeBound - size of an output buffer that holds any encoded frame of this geometry. Frames
+// compress far below it, see JLSencodeTo
+func JLSencodeBound(width uint16, height uint16, samples uint16, bitsa uint16) int {
+	// every sample at most LIMIT bits, 7 of them per byte after stuffing
+	limit := 2 * (int(bitsa) + max(8, int(bitsa)))
+	return int(width)*int(height)*int(samples)*limit/7 + 64
+}
+
+// JLSencode - RAW File to JPEG-LS, samples 1 or 3 (interleaved RGB), bitsa 8 or 16 (little endian).
+// near 0 is lossless, above it every sample decodes within near of the source
+func JLSencode(rawData []byte, width uint16, height uint16, samples uint16, bitsa uint16, outData *[]byte, outSize *int, near int) error {
+	out, err := encode(rawData, width, height, samples, bitsa, nil, near, defaultInterleave(samples))
+	if err != nil {
+		return err
+	}
+	*outData = out
+	*outSize = len(out)
+	return nil
+}
+
+// JLSencodeTo - RAW File to JPEG-LS, written straight into outData. Returns the bytes written, or
+// ErrBufferTooSmall together with the size outData needs
+func JLSencodeTo(rawData []byte, width uint16, height uint16, samples uint16, bitsa uint16, outData []byte, near int) (int, error) {
+	out, err := encode(rawData, width, height, samples, bitsa, outData[:0:len(outData)], near, defaultInterleave(samples))
+	if err != nil {
+		return 0, err
+	}
+	if len(out) > len(outData) {
+		return len(out), ErrBufferTooSmall
+	}
+	return len(out), nil
+}
+
+// defaultInterleave - color is line interleaved, the mode most decoders handle fastest
+func defaultInterleave(samples uint16) int {
+	if samples > 1 {
+		return interleaveLine
+	}
+	return interleaveNone
+}
+
+func encode(rawData []byte, width uint16, height uint16, samples uint16, bitsa uint16, out []byte, near int, ilv int) ([]byte, error) {
+	f := frame{width: int(width), height: int(height), components: int(samples), precision: int(bitsa)}
+	if f.width == 0 || f.height == 0 || (f.components != 1 && f.components != 3) || (bitsa != 8 && bitsa != 16) {
+		return nil, errors.New("ERROR, JLSencode, unsupported image")
+	}
+	if len(rawData) < f.width*f.height*f.components*f.bytesPerSample() {
+		return nil, errors.New("ERROR, JLSencode, RAW data too short")
+	}
+	maxval := int32(1)<<f.precision - 1
+	if near < 0 || near > int(min(255, maxval/2)) {
+		return nil, errors.New("ERROR, JLSencode, invalid near")
+	}
+
+	out = append(out, 0xFF, markerSOI)
+	out = append(out, 0xFF, markerSOF)
+	out = binary.BigEndian.AppendUint16(out, uint16(8+3*f.components))
+	out = append(out, byte(f.precision))
+	out = binary.BigEndian.AppendUint16(out, height)
+	out = binary.BigEndian.AppendUint16(out, width)
+	out = append(out, byte(f.components))
+	for c := 0; c < f.components; c++ {
+		out = append(out, byte(c+1), 0x11, 0)
+	}
+
+	out = f.encodeScans(rawData, out, maxval, int32(near), ilv)
+	out = append(out, 0xFF, markerEOI)
+	return out, nil
+}
+
+// encodeScans - appends the scans of the frame in interleave mode ilv, one scan per component
+// without interleaving
+func (f *frame) encodeScans(rawData []byte, out []byte, maxval int32, near int32, ilv int) []byte {
+	scans, ns := 1, f.components
+	if ilv == interleaveNone {
+		scans, ns = f.components, 1
+	}
+	for first := 0; first < scans; first++ {
+		out = append(out, 0xFF, markerSOS)
+		out = binary.BigEndian.AppendUint16(out, uint16(6+2*ns))
+		out = append(out, byte(ns))
+		for c := first; c < first+ns; c++ {
+			out = append(out, byte(c+1), 0)
+		}
+		out = append(out, byte(near), byte(ilv), 0)
+
+		s := newScan(newParams(maxval, near, 0, 0, 0, 0), f.width)
+		s.w.out = out
+		lines := newPlanes(f.width, ns)
+		for y := 0; y < f.height; y++ {
+			for c := 0; c < ns; c++ {
+				lines.next(c, f.width)
+				f.load(rawData, y, first+c, lines.cur[c])
+			}
+			if ilv == interleaveSample {
+				s.encodeLinePixels(&lines.prev, &lines.cur, &s.runIndex[0])
+				continue
+			}
+			for c := 0; c < ns; c++ {
+				s.encodeLine(lines.prev[c], lines.cur[c], &s.runIndex[c])
+			}
+		}
+		s.w.flush()
+		out = s.w.out
+	}
+	return out
+}
+
+// JLSdecode - JPEG-LS File to RAW, 8 bit samples as bytes and deeper ones as little endian
+// words, color interleaved
+func JLSdecode(jlsData []byte, jlsSize uint32, outputData []byte) error {
+	if int(jlsSize) > len(jlsData) {
+		return errors.New("ERROR, JLSdecode, JPEG-LS data too short")
+	}
+	return decode(jlsData[:jlsSize], outputData)
+}
+
+// JLSinfo - geometry of a JPEG-LS frame: columns, rows, samples per pixel and bits per sample
+func JLSinfo(jlsData []byte) (int, int, int, int, error) {
+	d := decoder{data: jlsData}
+	if err := d.header(); err != nil {
+		return 0, 0, 0, 0, err
+	}
+	return d.f.width, d.f.height, d.f.components, d.f.precision, nil
+}
+
+// decoder - walks the markers of a JPEG-LS file
+type decoder struct {
+	data   []byte
+	pos    int
+	f      frame
+	preset [5]int32 // MAXVAL, T1, T2, T3, RESET of an LSE segment, 0 for the defaults
+}
+
+// marker - reads the next marker, skipping fill bytes
+func (d *decoder) marker() (byte, error) {
+	if d.pos+1 >= len(d.data) || d.data[d.pos] != 0xFF {
+		return 0, errors.New("ERROR, JLSdecode, marker expected")
+	}
+	d.pos++
+	for d.pos < len(d.data) && d.data[d.pos] == 0xFF {
+		d.pos++
+	}
+	if d.pos >= len(d.data) {
+		return 0, errors.New("ERROR, JLSdecode, marker expected")
+	}
+	m := d.data[d.pos]
+	d.pos++
+	return m, nil
+}
+
+// segment - the payload of the marker segment at pos, pos moves past it
+func (d *decoder) segment() ([]byte, error) {
+	if d.pos+2 > len(d.data) {
+		return nil, errors.New("ERROR, JLSdecode, segment truncated")
+	}
+	n := int(binary.BigEndian.Uint16(d.data[d.pos:]))
+	if n < 2 || d.pos+n > len(d.data) {
+		return nil, errors.New("ERROR, JLSdecode, segment truncated")
+	}
+	seg := d.data[d.pos+2 : d.pos+n]
+	d.pos += n
+	return seg, nil
+}
+
+// header - reads up to and including the frame header
+func (d *decoder) header() error {
+	if m, err := d.marker(); err != nil || m != markerSOI {
+		return errors.New("ERROR, JLSdecode, not a JPEG-LS file")
+	}
+	for {
+		m, err := d.marker()
+		if err != nil {
+			return err
+		}
+		seg, err := d.segment()
+		if err != nil {
+			return err
+		}
+		switch {
+		case m == markerSOF:
+			return d.frameHeader(seg)
+		case m == markerLSE:
+			if err := d.presets(seg); err != nil {
+				return err
+			}
+		case m == markerDRI:
+			if len(seg) >= 2 && binary.BigEndian.Uint16(seg) != 0 {
+				return errors.New("ERROR, JLSdecode, restart intervals not supported")
+			}
+		case m >= markerAPP0 && m <= markerAPPF, m == markerCOM:
+		case m >= 0xC0 && m <= 0xCF:
+			return errors.New("ERROR, JLSdecode, not a JPEG-LS frame")
+		}
+	}
+}
+
+func (d *decoder) frameHeader(seg []byte) error {
+	if len(seg) < 6 {
+		return errors.New("ERROR, JLSdecode, frame header truncated")
+	}
+	f := frame{precision: int(seg[0]), height: int(binary.BigEndian.Uint16(seg[1:])), width: int(binary.BigEndian.Uint16(seg[3:])), components: int(seg[5])}
+	if f.precision < 2 || f.precision > 16 || f.width == 0 || f.height == 0 {
+		return fmt.Errorf("ERROR, JLSdecode, unsupported frame %dx%d of %d bits", f.width, f.height, f.precision)
+	}
+	if (f.components != 1 && f.components != 3) || len(seg) < 6+3*f.components {
+		return fmt.Errorf("ERROR, JLSdecode, unsupported frame of %d components", f.components)
+	}
+	for c := 0; c < f.components; c++ {
+		f.ids[c] = seg[6+3*c]
+		if seg[7+3*c] != 0x11 {
+			return errors.New("ERROR, JLSdecode, subsampled components not supported")
+		}
+	}
+	d.f = f
+	return nil
+}
+
+func (d *decoder) presets(seg []byte) error {
+	if len(seg) < 1 {
+		return errors.New("ERROR, JLSdecode, LSE segment truncated")
+	}
+	if seg[0] != 1 {
+		return errors.New("ERROR, JLSdecode, mapping tables not supported")
+	}
+	if len(seg) < 11 {
+		return errors.New("ERROR, JLSdecode, LSE segment truncated")
+	}
+	for i := range d.preset {
+		d.preset[i] = int32(binary.BigEndian.Uint16(seg[1+2*i:]))
+	}
+	return nil
+}
+
+func decode(jlsData []byte, outputData []byte) error {
+	d := decoder{data: jlsData}
+	if err := d.header(); err != nil {
+		return err
+	}
+	f := &d.f
+	if len(outputData) < f.width*f.height*f.components*f.bytesPerSample() {
+		return errors.New("ERROR, JLSdecode, output buffer too small")
+	}
+	done := [3]bool{}
+	for {
+		m, err := d.marker()
+		if err != nil {
+			return err
+		}
+		if m == markerEOI {
+			break
+		}
+		seg, err := d.segment()
+		if err != nil {
+			return err
+		}
+		switch {
+		case m == markerSOS:
+			if err := d.scan(seg, outputData, &done); err != nil {
+				return err
+			}
+		case m == markerLSE:
+			if err := d.presets(seg); err != nil {
+				return err
+			}
+		case m == markerDRI:
+			if len(seg) >= 2 && binary.BigEndian.Uint16(seg) != 0 {
+				return errors.New("ERROR, JLSdecode, restart intervals not supported")
+			}
+		}
+	}
+	for c := 0; c < f.components; c++ {
+		if !done[c] {
+			return errors.New("ERROR, JLSdecode, component missing")
+		}
+	}
+	return nil
+}
+
+// scan - decodes the scan whose header is seg and whose data follows at pos into raw
+func (d *decoder) scan(seg []byte, raw []byte, done *[3]bool) error {
+	f := &d.f
+	if len(seg) < 1 || len(seg) < 1+2*int(seg[0])+3 {
+		return errors.New("ERROR, JLSdecode, scan header truncated")
+	}
+	ns := int(seg[0])
+	comps := make([]int, ns)
+	for i := 0; i < ns; i++ {
+		comps[i] = -1
+		for c := 0; c < f.components; c++ {
+			if f.ids[c] == seg[1+2*i] {
+				comps[i] = c
+			}
+		}
+		if comps[i] < 0 || done[comps[i]] {
+			return errors.New("ERROR, JLSdecode, invalid scan component")
+		}
+		if seg[2+2*i] != 0 {
+			return errors.New("ERROR, JLSdecode, mapping tables not supported")
+		}
+	}
+	near, ilv, pt := int32(seg[1+2*ns]), int(seg[2+2*ns]), seg[3+2*ns]
+	if pt != 0 {
+		return errors.New("ERROR, JLSdecode, point transform not supported")
+	}
+	maxval := d.preset[0]
+	if maxval == 0 {
+		maxval = int32(1)<<f.precision - 1
+	}
+	if near > min(255, maxval/2) || ilv > interleaveSample || (ns > 1 && ilv == interleaveNone) {
+		return errors.New("ERROR, JLSdecode, invalid scan parameters")
+	}
+
+	s := newScan(newParams(maxval, near, d.preset[1], d.preset[2], d.preset[3], d.preset[4]), f.width)
+	s.r.data = d.data[d.pos:]
+	lines := newPlanes(f.width, ns)
+	for y := 0; y < f.height; y++ {
+		if ns == 3 && ilv == interleaveSample {
+			for c := 0; c < 3; c++ {
+				lines.next(c, f.width)
+			}
+			s.decodeLinePixels(&lines.prev, &lines.cur, &s.runIndex[0])
+		} else {
+			for c := 0; c < ns; c++ {
+				lines.next(c, f.width)
+				s.decodeLine(lines.prev[c], lines.cur[c], &s.runIndex[c])
+			}
+		}
+		for c := 0; c < ns; c++ {
+			f.store(raw, y, comps[c], lines.cur[c])
+		}
+	}
+	if s.r.overrun() {
+		return errors.New("ERROR, JLSdecode, scan data truncated")
+	}
+	for _, c := range comps {
+		done[c] = true
+	}
+
+	// the scan ends at the first marker, a byte after 0xFF with its high bit set
+	for d.pos < len(d.data)-1 && !(d.data[d.pos] == 0xFF && d.data[d.pos+1]&0x80 != 0) {
+		d.pos++
+	}
+	return nil
+}
@@ -0,0 +1,216 @@
+package jpegls
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"math/rand"
+	"testing"
+)
+
+// t87Image - the 4x4 example image of ITU-T T.87 annex H.3 and its encoded form
+var t87Image = []byte{
+	0, 0, 90, 74,
+	68, 50, 43, 205,
+	64, 145, 145, 145,
+	100, 145, 145, 145,
+}
+
+var t87Encoded = []byte{
+	0xFF, 0xD8, 0xFF, 0xF7, 0x00, 0x0B, 0x08, 0x00, 0x04, 0x00, 0x04, 0x01, 0x01, 0x11, 0x00,
+	0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00,
+	0xC0, 0x00, 0x00, 0x6C, 0x80, 0x20, 0x8E, 0x01, 0xC0, 0x00, 0x00, 0x57, 0x40, 0x00, 0x00, 0x6E,
+	0xE6, 0x00, 0x00, 0x01, 0xBC, 0x18, 0x00, 0x00, 0x05, 0xD8, 0x00, 0x00, 0x91, 0x60,
+	0xFF, 0xD9,
+}
+
+// testImage - smooth gradients with noise and flat areas, so both the regular and the run mode are used
+func testImage(width, height, samples, bits int, seed int64) []byte {
+	rng := rand.New(rand.NewSource(seed))
+	maxval := 1<<bits - 1
+	bps := 1
+	if bits > 8 {
+		bps = 2
+	}
+	raw := make([]byte, width*height*samples*bps)
+	for y := 0; y < height; y++ {
+		for x := 0; x < width; x++ {
+			for c := 0; c < samples; c++ {
+				v := 0
+				if x > width/3 {
+					v = (x*7+y*3+c*40)*maxval/(8*(width+height)+120) + rng.Intn(5)
+				}
+				if y > height*2/3 {
+					v = rng.Intn(maxval + 1)
+				}
+				v = min(v, maxval)
+				i := (y*width+x)*samples + c
+				if bps == 1 {
+					raw[i] = byte(v)
+				} else {
+					binary.LittleEndian.PutUint16(raw[2*i:], uint16(v))
+				}
+			}
+		}
+	}
+	return raw
+}
+
+func Test_JLSencode(t *testing.T) {
+	var outData []byte
+	var outSize int
+	if err := JLSencode(t87Image, 4, 4, 1, 8, &outData, &outSize, 0); err != nil {
+		t.Fatalf("jpegls.JLSencode() error = %v", err)
+	}
+	if !bytes.Equal(outData[:outSize], t87Encoded) {
+		t.Errorf("jpegls.JLSencode() = % X, want % X", outData[:outSize], t87Encoded)
+	}
+	decoded := make([]byte, len(t87Image))
+	if err := JLSdecode(t87Encoded, uint32(len(t87Encoded)), decoded); err != nil {
+		t.Fatalf("jpegls.JLSdecode() error = %v", err)
+	}
+	if !bytes.Equal(decoded, t87Image) {
+		t.Errorf("jpegls.JLSdecode() = %v, want %v", decoded, t87Image)
+	}
+}
+
+func Test_JLSroundTrip(t *testing.T) {
+	type args struct {
+		width, height, samples, bits int
+		near                         int
+	}
+	tests := []struct {
+		name string
+		args args
+	}{
+		{name: "Should round trip gray 8 bit", args: args{width: 256, height: 200, samples: 1, bits: 8}},
+		{name: "Should round trip gray 16 bit", args: args{width: 200, height: 130, samples: 1, bits: 16}},
+		{name: "Should round trip RGB 8 bit", args: args{width: 160, height: 120, samples: 3, bits: 8}},
+		{name: "Should round trip odd sizes", args: args{width: 1, height: 37, samples: 3, bits: 8}},
+		{name: "Should round trip near lossless gray 8 bit", args: args{width: 256, height: 200, samples: 1, bits: 8, near: 3}},
+		{name: "Should round trip near lossless gray 16 bit", args: args{width: 99, height: 61, samples: 1, bits: 16, near: 2}},
+		{name: "Should round trip near lossless RGB 8 bit", args: args{width: 161, height: 77, samples: 3, bits: 8, near: 1}},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			a := tt.args
+			raw := testImage(a.width, a.height, a.samples, a.bits, int64(a.width))
+			var jlsData []byte
+			var jlsSize int
+			if err := JLSencode(raw, uint16(a.width), uint16(a.height), uint16(a.samples), uint16(a.bits), &jlsData, &jlsSize, a.near); err != nil {
+				t.Fatalf("jpegls.JLSencode() error = %v", err)
+			}
+			outData := make([]byte, len(raw))
+			if err := JLSdecode(jlsData, uint32(jlsSize), outData); err != nil {
+				t.Fatalf("jpegls.JLSdecode() error = %v", err)
+			}
+			if a.near == 0 {
+				if !bytes.Equal(outData, raw) {
+					t.Errorf("jpegls.JLSdecode() differs from the source")
+				}
+				return
+			}
+			for i := 0; i < len(raw); {
+				var want, got int
+				if a.bits > 8 {
+					want, got = int(binary.LittleEndian.Uint16(raw[i:])), int(binary.LittleEndian.Uint16(outData[i:]))
+					i += 2
+				} else {
+					want, got = int(raw[i]), int(outData[i])
+					i++
+				}
+				if abs32(int32(got-want)) > int32(a.near) {
+					t.Fatalf("jpegls.JLSdecode() sample %d = %d, want %d within %d", i, got, want, a.near)
+				}
+			}
+		})
+	}
+}
+
+func Test_JLSdecodeErrors(t *testing.T) {
+	var jlsData []byte
+	var jlsSize int
+	raw := testImage(64, 48, 1, 8, 1)
+	if err := JLSencode(raw, 64, 48, 1, 8, &jlsData, &jlsSize, 0); err != nil {
+		t.Fatalf("jpegls.JLSencode() error = %v", err)
+	}
+	tests := []struct {
+		name string
+		data []byte
+		out  int
+	}{
+		{name: "Should fail on a truncated scan", data: jlsData[:jlsSize/2], out: len(raw)},
+		{name: "Should fail on a small output buffer", data: jlsData, out: len(raw) - 1},
+		{name: "Should fail on a baseline JPEG", data: []byte{0xFF, 0xD8, 0xFF, 0xC0, 0x00, 0x0B, 8, 0, 4, 0, 4, 1, 1, 0x11, 0}, out: 16},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			if err := JLSdecode(tt.data, uint32(len(tt.data)), make([]byte, tt.out)); err == nil {
+				t.Errorf("jpegls.JLSdecode() error = nil, want an error")
+			}
+		})
+	}
+}
+
+func Test_JLSencodeBatch(t *testing.T) {
+	const width, height = 120, 90
+	frames := make([]Frame, 5)
+	for i := range frames {
+		frames[i].Input = testImage(width, height, 3, 8, int64(i))
+		frames[i].Output = make([]byte, JLSencodeBound(width, height, 3, 8))
+	}
+	// one frame without room, it gets the size it needs
+	frames[2].Output = frames[2].Output[:16]
+	err := JLSencodeBatch(frames, width, height, 3, 8, 0, 3)
+	if !errors.Is(err, ErrBufferTooSmall) || !errors.Is(frames[2].Err, ErrBufferTooSmall) {
+		t.Fatalf("jpegls.JLSencodeBatch() error = %v, want ErrBufferTooSmall", err)
+	}
+	frames[2].Output = make([]byte, frames[2].Size)
+	if err := JLSencodeBatch(frames[2:3], width, height, 3, 8, 0, 1); err != nil {
+		t.Fatalf("jpegls.JLSencodeBatch() error = %v", err)
+	}
+
+	decoded := make([]Frame, len(frames))
+	for i := range frames {
+		decoded[i] = Frame{Input: frames[i].Output[:frames[i].Size], Output: make([]byte, width*height*3)}
+	}
+	if err := JLSdecodeBatch(decoded, 0); err != nil {
+		t.Fatalf("jpegls.JLSdecodeBatch() error = %v", err)
+	}
+	for i := range decoded {
+		if decoded[i].Size != width*height*3 || !bytes.Equal(decoded[i].Output, frames[i].Input) {
+			t.Errorf("jpegls.JLSdecodeBatch() frame %d differs from the source", i)
+		}
+	}
+}
+
+func Test_JLSinterleave(t *testing.T) {
+	tests := []struct {
+		name string
+		ilv  int
+		near int
+	}{
+		{name: "Should decode a scan per component", ilv: interleaveNone},
+		{name: "Should decode line interleaved scans", ilv: interleaveLine},
+		{name: "Should decode sample interleaved scans", ilv: interleaveSample},
+		{name: "Should decode near lossless sample interleaved scans", ilv: interleaveSample, near: 2},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			raw := testImage(97, 65, 3, 8, 7)
+			jlsData, err := encode(raw, 97, 65, 3, 8, nil, tt.near, tt.ilv)
+			if err != nil {
+				t.Fatalf("jpegls.encode() error = %v", err)
+			}
+			outData := make([]byte, len(raw))
+			if err := JLSdecode(jlsData, uint32(len(jlsData)), outData); err != nil {
+				t.Fatalf("jpegls.JLSdecode() error = %v", err)
+			}
+			for i := range raw {
+				if abs32(int32(outData[i])-int32(raw[i])) > int32(tt.near) {
+					t.Fatalf("jpegls.JLSdecode() sample %d = %d, want %d within %d", i, outData[i], raw[i], tt.near)
+				}
+			}
+		})
+	}
+}
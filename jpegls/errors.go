@@ -0,0 +1,6 @@
+package jpegls
+
+import "errors"
+
+// ErrBufferTooSmall - the output buffer can not hold the encoded frame, the size it needs is returned with it
+var ErrBufferTooSmall = errors.New("ERROR, output buffer too small")
@@ -0,0 +1,530 @@
+package jpegls
+
+// Coding of one scan after ITU-T T.87: gradient contexts with median edge prediction and bias
+// correction, adaptive Golomb codes for the prediction errors and run mode for flat areas.
+// Lines are kept with one extra sample on either side, index 1 to width hold the samples,
+// index 0 and width+1 the edge values the standard defines.
+
+// runLengths - J, the order of the run length codes indexed by the run index
+var runLengths = [32]int{0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 9, 10, 11, 12, 13, 14, 15}
+
+const (
+	contexts  = 365
+	defReset  = 64
+	minBias   = -128
+	maxBias   = 127
+	maxRunIdx = 31
+)
+
+// params - coding parameters of a scan
+type params struct {
+	maxval, near int32
+	t1, t2, t3   int32
+	reset        int32
+	rng          int32 // RANGE, number of quantized error values
+	qbpp         int32 // bits of a quantized error value
+	limit        int32 // longest Golomb code
+}
+
+func bitsFor(v int32) int32 {
+	n := int32(0)
+	for (int32(1) << n) < v {
+		n++
+	}
+	return n
+}
+
+func clampThreshold(i, j, maxval int32) int32 {
+	if i > maxval || i < j {
+		return j
+	}
+	return i
+}
+
+// newParams - parameters for maxval and near, thresholds and reset left at 0 take the defaults of
+// the standard
+func newParams(maxval, near, t1, t2, t3, reset int32) params {
+	p := params{maxval: maxval, near: near, reset: reset}
+	if p.reset == 0 {
+		p.reset = defReset
+	}
+	// default thresholds, C.2.4.1.1
+	var d1, d2, d3 int32
+	if maxval >= 128 {
+		factor := (min(maxval, 4095) + 128) >> 8
+		d1 = clampThreshold(factor*(3-2)+2+3*near, near+1, maxval)
+		d2 = clampThreshold(factor*(7-3)+3+5*near, d1, maxval)
+		d3 = clampThreshold(factor*(21-4)+4+7*near, d2, maxval)
+	} else {
+		factor := 256 / (maxval + 1)
+		d1 = clampThreshold(max(2, 3/factor+3*near), near+1, maxval)
+		d2 = clampThreshold(max(3, 7/factor+5*near), d1, maxval)
+		d3 = clampThreshold(max(4, 21/factor+7*near), d2, maxval)
+	}
+	p.t1, p.t2, p.t3 = t1, t2, t3
+	if p.t1 == 0 {
+		p.t1 = d1
+	}
+	if p.t2 == 0 {
+		p.t2 = d2
+	}
+	if p.t3 == 0 {
+		p.t3 = d3
+	}
+	p.rng = (maxval+2*near)/(2*near+1) + 1
+	p.qbpp = bitsFor(p.rng)
+	bpp := max(2, bitsFor(maxval+1))
+	p.limit = 2 * (bpp + max(8, bpp))
+	return p
+}
+
+// quantize - region of a local gradient, -4 to 4
+func (p *params) quantize(d int32) int32 {
+	switch {
+	case d <= -p.t3:
+		return -4
+	case d <= -p.t2:
+		return -3
+	case d <= -p.t1:
+		return -2
+	case d < -p.near:
+		return -1
+	case d <= p.near:
+		return 0
+	case d < p.t1:
+		return 1
+	case d < p.t2:
+		return 2
+	case d < p.t3:
+		return 3
+	}
+	return 4
+}
+
+// context - signed context of the gradients around a sample, 0 selects run mode
+func (p *params) context(d1, d2, d3 int32) int32 {
+	return (p.quantize(d1)*9+p.quantize(d2))*9 + p.quantize(d3)
+}
+
+// errval - prediction error quantized for near-lossless coding and reduced modulo the range
+func (p *params) errval(d int32) int32 {
+	if p.near > 0 {
+		if d > 0 {
+			d = (d + p.near) / (2*p.near + 1)
+		} else {
+			d = -(p.near - d) / (2*p.near + 1)
+		}
+	}
+	if d < 0 {
+		d += p.rng
+	}
+	if d >= (p.rng+1)/2 {
+		d -= p.rng
+	}
+	return d
+}
+
+// reconstruct - the sample encoder and decoder agree on for prediction px and error e
+func (p *params) reconstruct(px, e int32) int32 {
+	v := px + e*(2*p.near+1)
+	if v < -p.near {
+		v += p.rng * (2*p.near + 1)
+	} else if v > p.maxval+p.near {
+		v -= p.rng * (2*p.near + 1)
+	}
+	return min(max(v, 0), p.maxval)
+}
+
+func predict(ra, rb, rc int32) int32 {
+	if rc >= max(ra, rb) {
+		return min(ra, rb)
+	}
+	if rc <= min(ra, rb) {
+		return max(ra, rb)
+	}
+	return ra + rb - rc
+}
+
+func abs32(v int32) int32 {
+	if v < 0 {
+		return -v
+	}
+	return v
+}
+
+// sign - 1 for v >= 0, -1 below
+func sign(v int32) int32 {
+	return v>>31 | 1
+}
+
+// regularContext - A, B, C and N of a regular mode context
+type regularContext struct {
+	a, b, c, n int32
+}
+
+func (c *regularContext) k() uint {
+	k := uint(0)
+	for int64(c.n)<<k < int64(c.a) {
+		k++
+	}
+	return k
+}
+
+func (c *regularContext) update(e int32, p *params) {
+	c.a += abs32(e)
+	c.b += e * (2*p.near + 1)
+	if c.n == p.reset {
+		c.a >>= 1
+		c.b >>= 1
+		c.n >>= 1
+	}
+	c.n++
+	if c.b+c.n <= 0 {
+		c.b += c.n
+		if c.b <= -c.n {
+			c.b = -c.n + 1
+		}
+		if c.c > minBias {
+			c.c--
+		}
+	} else if c.b > 0 {
+		c.b -= c.n
+		if c.b > 0 {
+			c.b = 0
+		}
+		if c.c < maxBias {
+			c.c++
+		}
+	}
+}
+
+// correction - -1 when the error of a k 0 code is mapped the other way round, else 0
+func (c *regularContext) correction(k uint, p *params) int32 {
+	if k != 0 || p.near != 0 || 2*c.b+c.n-1 >= 0 {
+		return 0
+	}
+	return -1
+}
+
+// runContext - A, N and Nn of the two run interruption contexts
+type runContext struct {
+	a, n, nn int32
+	ritype   int32
+}
+
+func (c *runContext) k() uint {
+	t := c.a + (c.n>>1)*c.ritype
+	k := uint(0)
+	for int64(c.n)<<k < int64(t) {
+		k++
+	}
+	return k
+}
+
+// mapped - whether error e maps to the odd code
+func (c *runContext) mapped(e int32, k uint) bool {
+	return (k == 0 && e > 0 && 2*c.nn < c.n) || (e < 0 && 2*c.nn >= c.n) || (e < 0 && k != 0)
+}
+
+// errval - the error of code t, EMErrval plus the interruption type
+func (c *runContext) errval(t int32, k uint) int32 {
+	odd := t&1 != 0
+	e := (t + t&1) / 2
+	if (k != 0 || 2*c.nn >= c.n) == odd {
+		return -e
+	}
+	return e
+}
+
+func (c *runContext) update(e int32, em int32, p *params) {
+	if e < 0 {
+		c.nn++
+	}
+	c.a += (em + 1 - c.ritype) >> 1
+	if c.n == p.reset {
+		c.a >>= 1
+		c.n >>= 1
+		c.nn >>= 1
+	}
+	c.n++
+}
+
+// scan - the adaptive state of one scan, contexts are shared by the components of the scan and
+// the run index is kept per component
+type scan struct {
+	p        params
+	width    int
+	regular  [contexts]regularContext
+	run      [2]runContext
+	runIndex [4]int
+	w        bitWriter
+	r        bitReader
+}
+
+func newScan(p params, width int) *scan {
+	s := &scan{p: p, width: width}
+	a := max(2, (p.rng+32)/64)
+	for i := range s.regular {
+		s.regular[i] = regularContext{a: a, n: 1}
+	}
+	for i := range s.run {
+		s.run[i] = runContext{a: a, n: 1, ritype: int32(i)}
+	}
+	return s
+}
+
+// golomb - writes m with the limited length Golomb code of order k
+func (s *scan) golomb(k uint, m int32, limit int32) {
+	high := m >> k
+	if high < limit-s.p.qbpp-1 {
+		s.w.zeros(int(high))
+		s.w.write(1, 1)
+		s.w.write(uint32(m), k)
+		return
+	}
+	s.w.zeros(int(limit - s.p.qbpp - 1))
+	s.w.write(1, 1)
+	s.w.write(uint32(m-1), uint(s.p.qbpp))
+}
+
+// ungolomb - reads a limited length Golomb code of order k
+func (s *scan) ungolomb(k uint, limit int32) int32 {
+	high := s.r.zeros(limit)
+	if high >= limit-s.p.qbpp-1 {
+		return s.r.read(uint(s.p.qbpp)) + 1
+	}
+	return high<<k | s.r.read(k)
+}
+
+func (s *scan) encodeRegular(qs int32, x int32, pred int32) int32 {
+	sg := sign(qs)
+	c := &s.regular[qs*sg]
+	k := c.k()
+	px := min(max(pred+sg*c.c, 0), s.p.maxval)
+	e := s.p.errval(sg * (x - px))
+	m := e ^ c.correction(k, &s.p)
+	s.golomb(k, m>>31^m<<1, s.p.limit)
+	c.update(e, &s.p)
+	return s.p.reconstruct(px, sg*e)
+}
+
+func (s *scan) decodeRegular(qs int32, pred int32) int32 {
+	sg := sign(qs)
+	c := &s.regular[qs*sg]
+	k := c.k()
+	px := min(max(pred+sg*c.c, 0), s.p.maxval)
+	m := s.ungolomb(k, s.p.limit)
+	e := m>>1 ^ -(m & 1)
+	e ^= c.correction(k, &s.p)
+	c.update(e, &s.p)
+	return s.p.reconstruct(px, sg*e)
+}
+
+func (s *scan) encodeRunLength(n int, eol bool, ri *int) {
+	for n >= 1<<runLengths[*ri] {
+		s.w.write(1, 1)
+		n -= 1 << runLengths[*ri]
+		*ri = min(*ri+1, maxRunIdx)
+	}
+	if eol {
+		if n != 0 {
+			s.w.write(1, 1)
+		}
+		return
+	}
+	// a zero and the rest of the run
+	s.w.write(uint32(n), uint(runLengths[*ri])+1)
+}
+
+func (s *scan) decodeRunLength(rem int, ri *int) int {
+	n := 0
+	for s.r.bit() {
+		count := min(1<<runLengths[*ri], rem-n)
+		n += count
+		if count == 1<<runLengths[*ri] {
+			*ri = min(*ri+1, maxRunIdx)
+		}
+		if n == rem {
+			return n
+		}
+	}
+	return min(n+int(s.r.read(uint(runLengths[*ri]))), rem)
+}
+
+func (s *scan) encodeInterruption(c *runContext, e int32, ri int) {
+	k := c.k()
+	em := 2*abs32(e) - c.ritype
+	if c.mapped(e, k) {
+		em--
+	}
+	s.golomb(k, em, s.p.limit-int32(runLengths[ri])-1)
+	c.update(e, em, &s.p)
+}
+
+func (s *scan) decodeInterruption(c *runContext, ri int) int32 {
+	k := c.k()
+	em := s.ungolomb(k, s.p.limit-int32(runLengths[ri])-1)
+	e := c.errval(em+c.ritype, k)
+	c.update(e, em, &s.p)
+	return e
+}
+
+// encodeLine - codes cur with prev above it, index 0 of cur and width+1 of prev set by the caller
+func (s *scan) encodeLine(prev, cur []int32, ri *int) {
+	p := &s.p
+	rb, rd := prev[0], prev[1]
+	for i := 1; i <= s.width; {
+		ra, rc := cur[i-1], rb
+		rb, rd = rd, prev[i+1]
+		if qs := p.context(rd-rb, rb-rc, rc-ra); qs != 0 {
+			cur[i] = s.encodeRegular(qs, cur[i], predict(ra, rb, rc))
+			i++
+			continue
+		}
+		// run of samples within near of the one before it
+		rem := s.width - i + 1
+		n := 0
+		for n < rem && abs32(cur[i+n]-ra) <= p.near {
+			cur[i+n] = ra
+			n++
+		}
+		s.encodeRunLength(n, n == rem, ri)
+		i += n
+		if n < rem {
+			x, rb := cur[i], prev[i]
+			if abs32(ra-rb) <= p.near {
+				e := p.errval(x - ra)
+				s.encodeInterruption(&s.run[1], e, *ri)
+				cur[i] = p.reconstruct(ra, e)
+			} else {
+				sg := sign(rb - ra)
+				e := p.errval(sg * (x - rb))
+				s.encodeInterruption(&s.run[0], e, *ri)
+				cur[i] = p.reconstruct(rb, sg*e)
+			}
+			*ri = max(*ri-1, 0)
+			i++
+		}
+		rb, rd = prev[i-1], prev[i]
+	}
+}
+
+// decodeLine - the way back of encodeLine
+func (s *scan) decodeLine(prev, cur []int32, ri *int) {
+	p := &s.p
+	rb, rd := prev[0], prev[1]
+	for i := 1; i <= s.width; {
+		ra, rc := cur[i-1], rb
+		rb, rd = rd, prev[i+1]
+		if qs := p.context(rd-rb, rb-rc, rc-ra); qs != 0 {
+			cur[i] = s.decodeRegular(qs, predict(ra, rb, rc))
+			i++
+			continue
+		}
+		rem := s.width - i + 1
+		n := s.decodeRunLength(rem, ri)
+		for j := i; j < i+n; j++ {
+			cur[j] = ra
+		}
+		i += n
+		if n < rem {
+			rb := prev[i]
+			if abs32(ra-rb) <= p.near {
+				cur[i] = p.reconstruct(ra, s.decodeInterruption(&s.run[1], *ri))
+			} else {
+				cur[i] = p.reconstruct(rb, sign(rb-ra)*s.decodeInterruption(&s.run[0], *ri))
+			}
+			*ri = max(*ri-1, 0)
+			i++
+		}
+		rb, rd = prev[i-1], prev[i]
+	}
+}
+
+// encodeLinePixels - codes a line of a sample interleaved scan of three components. Regular
+// mode codes each component in its own context, run mode needs all three flat and runs over
+// whole pixels
+func (s *scan) encodeLinePixels(prev, cur *[3][]int32, ri *int) {
+	p := &s.p
+	var qs [3]int32
+	for i := 1; i <= s.width; {
+		flat := true
+		for c := 0; c < 3; c++ {
+			ra, rb, rc, rd := cur[c][i-1], prev[c][i], prev[c][i-1], prev[c][i+1]
+			qs[c] = p.context(rd-rb, rb-rc, rc-ra)
+			flat = flat && qs[c] == 0
+		}
+		if !flat {
+			for c := 0; c < 3; c++ {
+				cur[c][i] = s.encodeRegular(qs[c], cur[c][i], predict(cur[c][i-1], prev[c][i], prev[c][i-1]))
+			}
+			i++
+			continue
+		}
+		rem := s.width - i + 1
+		n := 0
+		for n < rem && abs32(cur[0][i+n]-cur[0][i-1]) <= p.near && abs32(cur[1][i+n]-cur[1][i-1]) <= p.near && abs32(cur[2][i+n]-cur[2][i-1]) <= p.near {
+			for c := 0; c < 3; c++ {
+				cur[c][i+n] = cur[c][i-1]
+			}
+			n++
+		}
+		s.encodeRunLength(n, n == rem, ri)
+		i += n
+		if n < rem {
+			for c := 0; c < 3; c++ {
+				ra, rb := cur[c][i-1], prev[c][i]
+				sg := sign(rb - ra)
+				e := p.errval(sg * (cur[c][i] - rb))
+				s.encodeInterruption(&s.run[0], e, *ri)
+				cur[c][i] = p.reconstruct(rb, sg*e)
+			}
+			*ri = max(*ri-1, 0)
+			i++
+		}
+	}
+}
+
+// decodeLinePixels - decodes a line of a sample interleaved scan of three components. Regular
+// mode codes each component in its own context, run mode needs all three flat and runs over
+// whole pixels
+func (s *scan) decodeLinePixels(prev, cur *[3][]int32, ri *int) {
+	p := &s.p
+	var qs [3]int32
+	for i := 1; i <= s.width; {
+		flat := true
+		for c := 0; c < 3; c++ {
+			ra, rb, rc, rd := cur[c][i-1], prev[c][i], prev[c][i-1], prev[c][i+1]
+			qs[c] = p.context(rd-rb, rb-rc, rc-ra)
+			flat = flat && qs[c] == 0
+		}
+		if !flat {
+			for c := 0; c < 3; c++ {
+				cur[c][i] = s.decodeRegular(qs[c], predict(cur[c][i-1], prev[c][i], prev[c][i-1]))
+			}
+			i++
+			continue
+		}
+		rem := s.width - i + 1
+		n := s.decodeRunLength(rem, ri)
+		for c := 0; c < 3; c++ {
+			ra := cur[c][i-1]
+			for j := i; j < i+n; j++ {
+				cur[c][j] = ra
+			}
+		}
+		i += n
+		if n < rem {
+			var e [3]int32
+			for c := 0; c < 3; c++ {
+				e[c] = s.decodeInterruption(&s.run[0], *ri)
+			}
+			for c := 0; c < 3; c++ {
+				ra, rb := cur[c][i-1], prev[c][i]
+				cur[c][i] = p.reconstruct(rb, sign(rb-ra)*e[c])
+			}
+			*ri = max(*ri-1, 0)
+			i++
+		}
+	}
+}
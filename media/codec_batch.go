@@ -0,0 +1,256 @@
+package media
+
+import (
+	"errors"
+	"runtime"
+
+	"github.com/innovative-io/io-dicom/dictionary/transfersyntax"
+	"github.com/innovative-io/io-dicom/jpeglib"
+	"github.com/innovative-io/io-dicom/jpegls"
+	"github.com/innovative-io/io-dicom/openjpeg"
+	"github.com/innovative-io/io-dicom/transcoder"
+)
+
+// codecFrame - one frame handed to a batch codec: in is read, followed by fragments for a frame
+// split over several, out receives the result, size and err hold the outcome of the frame
+type codecFrame struct {
+	in        []byte
+	fragments [][]byte
+	out       []byte
+	size      int
+	err       error
+}
+
+// batchCodec - runs a batch of frames through one of the native codecs in a single cgo call
+type batchCodec func(frames []codecFrame, threads int) error
+
+func jpegBatch(run func(frames []jpeglib.Frame, threads int) error) batchCodec {
+	return func(frames []codecFrame, threads int) error {
+		batch := make([]jpeglib.Frame, len(frames))
+		for i := range frames {
+			batch[i] = jpeglib.Frame{Input: frames[i].in, Fragments: frames[i].fragments, Output: frames[i].out}
+		}
+		err := run(batch, threads)
+		for i := range frames {
+			frames[i].size, frames[i].err = batch[i].Size, batch[i].Err
+		}
+		return err
+	}
+}
+
+func j2kBatch(run func(frames []openjpeg.Frame, threads int) error) batchCodec {
+	return func(frames []codecFrame, threads int) error {
+		batch := make([]openjpeg.Frame, len(frames))
+		for i := range frames {
+			batch[i] = openjpeg.Frame{Input: frames[i].in, Fragments: frames[i].fragments, Output: frames[i].out}
+		}
+		err := run(batch, threads)
+		for i := range frames {
+			frames[i].size, frames[i].err = batch[i].Size, batch[i].Err
+		}
+		return err
+	}
+}
+
+func jlsBatch(run func(frames []jpegls.Frame, threads int) error) batchCodec {
+	return func(frames []codecFrame, threads int) error {
+		batch := make([]jpegls.Frame, len(frames))
+		for i := range frames {
+			// the JPEG-LS decoder reads one slice, a frame split over several fragments is joined
+			in := frames[i].in
+			if len(frames[i].fragments) > 0 {
+				in = joinFragments(append([][]byte{in}, frames[i].fragments...))
+			}
+			batch[i] = jpegls.Frame{Input: in, Output: frames[i].out}
+		}
+		err := run(batch, threads)
+		for i := range frames {
+			frames[i].size, frames[i].err = batch[i].Size, batch[i].Err
+		}
+		return err
+	}
+}
+
+// rleBatch - RLE Lossless frames one after the other, the segments of a frame are encoded
+// concurrently. Outputs hold RLEencodeBound, so no frame is retried
+func rleBatch(cols uint16, rows uint16, samples uint16, bitsa uint16) batchCodec {
+	return func(frames []codecFrame, threads int) error {
+		for i := range frames {
+			f := &frames[i]
+			f.size, f.err = transcoder.RLEencodeTo(f.in, f.out, cols, rows, samples, bitsa)
+			if f.err != nil {
+				return f.err
+			}
+		}
+		return nil
+	}
+}
+
+// frameDecoder - batch decoder for the frames of a compressed transfer syntax, nil when it is not
+// decoded by a native codec. With keepYCbCr YCbCr JPEG frames are not converted to RGB
+func frameDecoder(ts string, bitsa uint16, keepYCbCr bool) batchCodec {
+	switch ts {
+	case transfersyntax.JPEGLosslessSV1.UID, transfersyntax.JPEGLossless.UID:
+		if bitsa == 8 {
+			return jpegBatch(jpeglib.DIJG8decodeBatch)
+		}
+		return jpegBatch(jpeglib.DIJG16decodeBatch)
+	case transfersyntax.JPEGBaseline8Bit.UID:
+		if bitsa == 8 && keepYCbCr {
+			return jpegBatch(jpeglib.DIJG8decodeBatchYCbCr)
+		}
+		if bitsa == 8 {
+			return jpegBatch(jpeglib.DIJG8decodeBatch)
+		}
+		return jpegBatch(jpeglib.DIJG12decodeBatch)
+	case transfersyntax.JPEGExtended12Bit.UID:
+		return jpegBatch(jpeglib.DIJG12decodeBatch)
+	case transfersyntax.JPEG2000Lossless.UID, transfersyntax.JPEG2000.UID:
+		return j2kBatch(openjpeg.J2KdecodeBatch)
+	case transfersyntax.JPEGLSLossless.UID, transfersyntax.JPEGLSNearLossless.UID:
+		return jlsBatch(jpegls.JLSdecodeBatch)
+	}
+	return nil
+}
+
+// frameRawSize - bytes the frame decoder of ts writes for the codestream in data, read from its
+// header without decoding. ok is false when ts has no probe or the header can not be read, the
+// decoder reports those frames itself
+func frameRawSize(ts string, data []byte, bitsa uint16) (size int, ok bool) {
+	switch ts {
+	case transfersyntax.JPEGLosslessSV1.UID, transfersyntax.JPEGLossless.UID,
+		transfersyntax.JPEGBaseline8Bit.UID, transfersyntax.JPEGExtended12Bit.UID:
+		info, err := jpeglib.JPEGprobe(data)
+		if err != nil {
+			return 0, false
+		}
+		// frameDecoder picks the 8 bit decoder for 8 bit frames, the others write 16 bit samples
+		if bitsa == 8 {
+			return info.Width * info.Height * info.Components, true
+		}
+		return 2 * info.Width * info.Height * info.Components, true
+	case transfersyntax.JPEG2000Lossless.UID, transfersyntax.JPEG2000.UID:
+		info, err := openjpeg.J2Kprobe(data)
+		if err != nil || info.Subsampled {
+			return 0, false
+		}
+		return info.RawSize(), true
+	}
+	return 0, false
+}
+
+// decodedPhotoInt - photometric interpretation of PhotoInt frames once decoded from ts, "" when the
+// decoder leaves the samples as they are
+func decodedPhotoInt(ts string, PhotoInt string, bitsa uint16, keepYCbCr bool) string {
+	switch ts {
+	case transfersyntax.JPEGBaseline8Bit.UID:
+		if bitsa == 8 && (PhotoInt == "YBR_FULL" || PhotoInt == "YBR_FULL_422") {
+			if keepYCbCr {
+				return "YBR_FULL"
+			}
+			return "RGB"
+		}
+	case transfersyntax.RLELossless.UID:
+		if PhotoInt == "YBR_FULL" && !keepYCbCr {
+			return "RGB"
+		}
+	case transfersyntax.JPEG2000Lossless.UID, transfersyntax.JPEG2000.UID:
+		if PhotoInt == "YBR_RCT" || PhotoInt == "YBR_ICT" {
+			return "RGB"
+		}
+	}
+	return ""
+}
+
+// frameEncoder - batch encoder for frames of the given geometry into a compressed transfer syntax
+// and the output space a frame is expected to need, nil when ts is not encoded by a native codec
+func frameEncoder(ts string, RGB bool, cols uint16, rows uint16, bitsa uint16) (batchCodec, int) {
+	samples := uint16(1)
+	if RGB {
+		samples = 3
+	}
+	// raw size plus headers fits all but noise, frames that still do not fit are retried
+	bound := int(cols)*int(rows)*int(samples)*int(bitsa)/8 + 2048
+	switch ts {
+	case transfersyntax.JPEGLosslessSV1.UID:
+		if bitsa == 8 {
+			return jpegBatch(func(frames []jpeglib.Frame, threads int) error {
+				return jpeglib.EIJG8encodeBatch(frames, cols, rows, samples, 4, 0, threads)
+			}), bound
+		}
+		return jpegBatch(func(frames []jpeglib.Frame, threads int) error {
+			return jpeglib.EIJG16encodeBatch(frames, cols, rows, 1, 0, threads)
+		}), bound
+	case transfersyntax.JPEGBaseline8Bit.UID:
+		if RGB || bitsa == 8 {
+			return jpegBatch(func(frames []jpeglib.Frame, threads int) error {
+				return jpeglib.EIJG8encodeBatch(frames, cols, rows, samples, 0, 0, threads)
+			}), bound
+		}
+		return jpegBatch(func(frames []jpeglib.Frame, threads int) error {
+			return jpeglib.EIJG12encodeBatch(frames, cols, rows, 1, 0, 0, threads)
+		}), bound
+	case transfersyntax.JPEGExtended12Bit.UID:
+		return jpegBatch(func(frames []jpeglib.Frame, threads int) error {
+			return jpeglib.EIJG12encodeBatch(frames, cols, rows, 1, 0, 0, threads)
+		}), bound
+	case transfersyntax.JPEG2000Lossless.UID:
+		return j2kBatch(func(frames []openjpeg.Frame, threads int) error {
+			return openjpeg.J2KencodeBatch(frames, cols, rows, samples, bitsa, 0, threads)
+		}), openjpeg.J2KencodeBound(cols, rows, samples, bitsa)
+	case transfersyntax.JPEG2000.UID:
+		return j2kBatch(func(frames []openjpeg.Frame, threads int) error {
+			return openjpeg.J2KencodeBatch(frames, cols, rows, samples, bitsa, 10, threads)
+		}), openjpeg.J2KencodeBound(cols, rows, samples, bitsa)
+	case transfersyntax.RLELossless.UID:
+		return rleBatch(cols, rows, samples, bitsa), transcoder.RLEencodeBound(cols, rows, samples, bitsa)
+	case transfersyntax.JPEGLSLossless.UID:
+		return jlsBatch(func(frames []jpegls.Frame, threads int) error {
+			return jpegls.JLSencodeBatch(frames, cols, rows, samples, bitsa, 0, threads)
+		}), bound
+	case transfersyntax.JPEGLSNearLossless.UID:
+		return jlsBatch(func(frames []jpegls.Frame, threads int) error {
+			return jpegls.JLSencodeBatch(frames, cols, rows, samples, bitsa, 2, threads)
+		}), bound
+	}
+	return nil, 0
+}
+
+// encodeFrames - encodes every frame of img in batches of one frame per CPU into reused scratch
+// buffers, and hands each encoded frame to add in order
+func encodeFrames(encode batchCodec, bound int, img []byte, single uint32, frames uint32, add func(data []byte)) error {
+	threads := runtime.NumCPU()
+	batch := make([]codecFrame, threads)
+	for k := range batch {
+		batch[k].out = make([]byte, bound)
+	}
+	for start := uint32(0); start < frames; start += uint32(threads) {
+		n := frames - start
+		if n > uint32(threads) {
+			n = uint32(threads)
+		}
+		for k := uint32(0); k < n; k++ {
+			offset := (start + k) * single
+			batch[k].in = img[offset : offset+single]
+		}
+		if err := encode(batch[:n], threads); err != nil {
+			// frames that did not fit their scratch buffer are encoded again on their own
+			for k := uint32(0); k < n; k++ {
+				if !errors.Is(batch[k].err, jpeglib.ErrBufferTooSmall) && !errors.Is(batch[k].err, openjpeg.ErrBufferTooSmall) && !errors.Is(batch[k].err, jpegls.ErrBufferTooSmall) {
+					if batch[k].err != nil {
+						return batch[k].err
+					}
+					continue
+				}
+				batch[k].out = make([]byte, batch[k].size)
+				if err := encode(batch[k:k+1], 1); err != nil {
+					return err
+				}
+			}
+		}
+		for k := uint32(0); k < n; k++ {
+			add(batch[k].out[:batch[k].size])
+		}
+	}
+	return nil
+}
@@ -9,6 +9,7 @@ import (
 	"strings"
 	"time"
 
+	"github.com/innovative-io/io-dicom/colorspace"
 	"github.com/innovative-io/io-dicom/dictionary/sopclass"
 	"github.com/innovative-io/io-dicom/dictionary/tags"
 	"github.com/innovative-io/io-dicom/dictionary/transfersyntax"
@@ -29,6 +30,7 @@ type DcmObj interface {
 	SetBigEndian(bigEndian bool)
 	GetDate(tag *tags.Tag) time.Time
 	GetPixelData(frame int) ([]byte, error)
+	GetPixelDataReduced(frame int, level int) ([]byte, int, int, error)
 	GetTagAt(i int) *DcmTag
 	GetTag(tag *tags.Tag) *DcmTag
 	GetTagGE(group uint16, element uint16) *DcmTag
@@ -53,7 +55,7 @@ type DcmObj interface {
 	WriteStringGE(group uint16, element uint16, vr string, content string)
 	GetTransferSyntax() *transfersyntax.TransferSyntax
 	SetTransferSyntax(ts *transfersyntax.TransferSyntax)
-	ChangeTransferSynx(ts *transfersyntax.TransferSyntax) error
+	ChangeTransferSynx(ts *transfersyntax.TransferSyntax, opts ...TranscodeOption) error
 	TagCount() int
 	CreateSR(study DCMStudy, SeriesInstanceUID string, SOPInstanceUID string)
 	CreatePDF(study DCMStudy, SeriesInstanceUID string, SOPInstanceUID string, fileName string)
@@ -61,7 +63,7 @@ type DcmObj interface {
 	WriteToFile(fileName string) error
 	dumpSeq(indent int)
 	compress(i *int, img []byte, RGB bool, cols uint16, rows uint16, bitss uint16, bitsa uint16, pixelrep uint16, planar uint16, frames uint32, outTS string) error
-	uncompress(i int, img []byte, size uint32, frames uint32, bitsa uint16, PhotoInt string) error
+	uncompress(i int, img []byte, size uint32, frames uint32, bitsa uint16, PhotoInt string, keepYCbCr bool) error
 }
 
 type dcmObj struct {
@@ -135,6 +137,15 @@ func parseBufData(bufdata BufData) (DcmObj, error) {
 	}
 	bufdata.SetBigEndian(BigEndian)
 
+	if obj.TransferSyntax == transfersyntax.DeflatedExplicitVRLittleEndian {
+		// everything after the meta header is deflated explicit little endian
+		data, err := inflateDataset(bufdata.GetAllBytes()[bufdata.GetPosition():bufdata.GetSize()])
+		if err != nil {
+			return nil, err
+		}
+		bufdata = NewBufDataFromBytes(data)
+	}
+
 	if err := bufdata.ReadObj(obj); err != nil {
 		return nil, err
 	}
@@ -195,7 +206,8 @@ func (obj *dcmObj) SetTag(i int, tag *DcmTag) {
 
 func (obj *dcmObj) InsertTag(index int, tag *DcmTag) {
 	FillTag(tag)
-	obj.Tags = append(obj.Tags[:index+1], obj.Tags[index:]...)
+	obj.Tags = append(obj.Tags, nil)
+	copy(obj.Tags[index+1:], obj.Tags[index:])
 	obj.Tags[index] = tag
 }
 
@@ -362,7 +374,15 @@ func (obj *dcmObj) WriteToBytes() []byte {
 	SOPClassUID := obj.GetStringGE(0x08, 0x16)
 	SOPInstanceUID := obj.GetStringGE(0x08, 0x18)
 	bufdata.WriteMeta(SOPClassUID, SOPInstanceUID, obj.TransferSyntax.UID)
-	bufdata.WriteObj(obj)
+	if obj.TransferSyntax.UID == transfersyntax.DeflatedExplicitVRLittleEndian.UID {
+		// the meta header stays uncompressed, the data set follows as one deflate stream
+		dataset := NewEmptyBufData()
+		dataset.WriteObj(obj)
+		deflated := deflateDataset(dataset.GetAllBytes())
+		bufdata.Write(deflated, len(deflated))
+	} else {
+		bufdata.WriteObj(obj)
+	}
 	bufdata.SetPosition(0)
 	return bufdata.GetAllBytes()
 }
@@ -539,24 +559,23 @@ func (obj *dcmObj) GetPixelData(frame int) ([]byte, error) {
 				}
 
 				if tag.Length == 0xFFFFFFFF {
-					return obj.GetTagAt(i + 2 + frame).Data, nil
+					fragments, _, err := obj.frameFragments(i, frames)
+					if err != nil {
+						return nil, err
+					}
+					if frame < 0 || frame >= len(fragments) {
+						return nil, errors.New("invalid frame")
+					}
+					return joinFragments(fragments[frame]), nil
 				} else {
 					if RGB && (planar == 1) {
-						var img_offset, img_size uint32
-						img_size = size / frames
-						img := make([]byte, img_size)
-						for f := uint32(0); f < frames; f++ {
-							img_offset = img_size * f
-							for j := uint32(0); j < img_size/3; j++ {
-								img[3*j] = tag.Data[j+img_offset]
-								img[3*j+1] = tag.Data[j+img_size/3+img_offset]
-								img[3*j+2] = tag.Data[j+2*img_size/3+img_offset]
-							}
-							if f == uint32(frame) {
-								return img, nil
-							}
+						if uint32(frame) >= frames {
+							return nil, errors.New("invalid frame")
 						}
-						planar = 0
+						single := size / frames
+						img := make([]byte, single)
+						colorspace.PlanarToInterleaved(img, tag.Data[uint32(frame)*single:uint32(frame+1)*single], 3, int(bitsa+7)/8)
+						return img, nil
 					} else {
 						return tag.Data, nil
 					}
@@ -570,12 +589,42 @@ func (obj *dcmObj) GetPixelData(frame int) ([]byte, error) {
 	return nil, fmt.Errorf("there was an error getting pixel data")
 }
 
-func (obj *dcmObj) ChangeTransferSynx(outTS *transfersyntax.TransferSyntax) error {
+// GetPixelDataReduced - decodes a frame at 1/2^level of its resolution for previews, returns the
+// raw frame with its reduced columns and rows. JPEG 2000 pixel data skips the work for the dropped
+// resolutions, 8 bit JPEG Baseline scales in the IDCT for levels up to 3, other transfer syntaxes
+// are not supported
+func (obj *dcmObj) GetPixelDataReduced(frame int, level int) ([]byte, int, int, error) {
+	switch obj.TransferSyntax.UID {
+	case transfersyntax.JPEG2000Lossless.UID, transfersyntax.JPEG2000.UID:
+		fragment, err := obj.GetPixelData(frame)
+		if err != nil {
+			return nil, 0, 0, err
+		}
+		return openjpeg.J2KdecodeReduced(fragment, level)
+	case transfersyntax.JPEGBaseline8Bit.UID:
+		if obj.GetUShort(tags.BitsAllocated) != 8 || level < 0 || level > 3 {
+			return nil, 0, 0, fmt.Errorf("reduced decode not supported for level %d of transfer synxtax %s", level, obj.TransferSyntax.Name)
+		}
+		fragment, err := obj.GetPixelData(frame)
+		if err != nil {
+			return nil, 0, 0, err
+		}
+		return jpeglib.DIJG8decodeScaled(fragment, 1<<level)
+	default:
+		return nil, 0, 0, fmt.Errorf("reduced decode not supported for transfer synxtax %s", obj.TransferSyntax.Name)
+	}
+}
+
+// ChangeTransferSynx - converts the pixel data to outTS. With no options the image is decompressed
+// whole and compressed again, TranscodeOptions move compressed frames through a pipeline instead
+func (obj *dcmObj) ChangeTransferSynx(outTS *transfersyntax.TransferSyntax, opts ...TranscodeOption) error {
 	flag := false
+	options := newTranscodeOptions(opts)
 
 	var i int
 	var rows, cols, bitss, bitsa, planar, pixelrep uint16
 	var PhotoInt string
+	var photoIndex, planarIndex int
 	sq := 0
 	frames := uint32(0)
 	RGB := false
@@ -585,6 +634,13 @@ func (obj *dcmObj) ChangeTransferSynx(outTS *transfersyntax.TransferSyntax) erro
 		return nil
 	}
 
+	// deflate only wraps explicit little endian when the object is written, the tags stay as they are
+	if (obj.TransferSyntax.UID == transfersyntax.ExplicitVRLittleEndian.UID && outTS.UID == transfersyntax.DeflatedExplicitVRLittleEndian.UID) ||
+		(obj.TransferSyntax.UID == transfersyntax.DeflatedExplicitVRLittleEndian.UID && outTS.UID == transfersyntax.ExplicitVRLittleEndian.UID) {
+		obj.TransferSyntax = outTS
+		return nil
+	}
+
 	if !transfersyntax.SupportedTransferSyntax(outTS.UID) {
 		return fmt.Errorf("unsupported transfer synxtax %s", outTS.Name)
 	}
@@ -602,8 +658,10 @@ func (obj *dcmObj) ChangeTransferSynx(outTS *transfersyntax.TransferSyntax) erro
 					if !strings.Contains(PhotoInt, "MONO") {
 						RGB = true
 					}
+					photoIndex = i
 				case 0x06:
 					planar = tag.GetUShort()
+					planarIndex = i
 				case 0x08:
 					uframes, err := strconv.Atoi(tag.GetString())
 					if err != nil {
@@ -642,22 +700,39 @@ func (obj *dcmObj) ChangeTransferSynx(outTS *transfersyntax.TransferSyntax) erro
 				if size == 0 {
 					return errors.New("DcmObj::ConvertTransferSyntax, size=0")
 				}
+				if (tag.Length == 0xFFFFFFFF) && options.pipelined {
+					done, err := obj.transcodeFrames(&i, options, RGB, cols, rows, bitsa, frames, outTS.UID)
+					if err != nil {
+						return err
+					}
+					if done {
+						flag = true
+						continue
+					}
+				}
 				img := make([]byte, size)
+				photo := ""
 				if tag.Length == 0xFFFFFFFF {
-					obj.uncompress(i, img, size, frames, bitsa, PhotoInt)
+					// YCbCr is only kept when no encoder converts the frames again
+					encode, _ := frameEncoder(outTS.UID, RGB, cols, rows, bitsa)
+					keepYCbCr := options.keepYCbCr && encode == nil
+					if err := obj.uncompress(i, img, size, frames, bitsa, PhotoInt, keepYCbCr); err != nil {
+						return err
+					}
+					if encode == nil {
+						photo = decodedPhotoInt(obj.TransferSyntax.UID, PhotoInt, bitsa, keepYCbCr)
+					}
 				} else { // Uncompressed
-					if RGB && (planar == 1) { // change from planar=1 to planar=0
-						var img_offset, img_size uint32
-						img_size = size / frames
+					if RGB && (PhotoInt == "YBR_FULL_422") && (bitsa == 8) {
+						colorspace.YBRFull422ToRGB(img, tag.Data)
+						photo = "RGB"
+					} else if RGB && (planar == 1) { // change from planar=1 to planar=0
+						single := size / frames
 						for f := uint32(0); f < frames; f++ {
-							img_offset = img_size * f
-							for j := uint32(0); j < img_size/3; j++ {
-								img[3*j+img_offset] = tag.Data[j+img_offset]
-								img[3*j+1+img_offset] = tag.Data[j+img_size/3+img_offset]
-								img[3*j+2+img_offset] = tag.Data[j+2*img_size/3+img_offset]
-							}
+							colorspace.PlanarToInterleaved(img[f*single:(f+1)*single], tag.Data[f*single:(f+1)*single], 3, int(bitsa+7)/8)
 						}
 						planar = 0
+						obj.GetTagAt(planarIndex).Data = []byte{0, 0}
 					} else {
 						copy(img, tag.Data)
 					}
@@ -667,6 +742,14 @@ func (obj *dcmObj) ChangeTransferSynx(outTS *transfersyntax.TransferSyntax) erro
 				} else {
 					flag = true
 				}
+				if photo != "" {
+					photoTag := obj.GetTagAt(photoIndex)
+					photoTag.Data = []byte(photo)
+					if len(photoTag.Data)%2 == 1 {
+						photoTag.Data = append(photoTag.Data, 0x20)
+					}
+					photoTag.Length = uint32(len(photoTag.Data))
+				}
 			}
 		}
 		if ((tag.Group == 0xFFFE) && (tag.Element == 0xE00D)) || ((tag.Group == 0xFFFE) && (tag.Element == 0xE0DD)) {
@@ -815,384 +898,126 @@ func (obj *dcmObj) CreatePDF(study DCMStudy, SeriesInstanceUID string, SOPInstan
 }
 
 func (obj *dcmObj) compress(i *int, img []byte, RGB bool, cols uint16, rows uint16, bitss uint16, bitsa uint16, pixelrep uint16, planar uint16, frames uint32, outTS string) error {
-	var offset, size, jpeg_size, j uint32
-	var JPEGData []byte
-	var JPEGBytes, index int
+	var size uint32
+	var index int
+	var fragments fragmentBuffer
 
 	single := uint32(cols) * uint32(rows) * uint32(bitsa) / 8
-	size = single * frames
 	if RGB {
-		size = 3 * size
+		single = 3 * single
 	}
+	size = single * frames
 
 	index = *i
 	tag := obj.GetTagAt(index)
 
-	switch outTS {
-	case transfersyntax.JPEGLosslessSV1.UID:
-		tag.VR = "OB"
-		tag.Length = 0xFFFFFFFF
-		if tag.Data != nil {
-			tag.Data = nil
-		}
-		obj.SetTag(index, tag)
-		index++
-		newtag := &DcmTag{
-			Group:     0xFFFE,
-			Element:   0xE000,
-			Length:    0,
-			VR:        "DL",
-			Data:      nil,
-			BigEndian: obj.IsBigEndian(),
-		}
-		obj.InsertTag(index, newtag)
-		for j = 0; j < frames; j++ {
-			index++
-			offset = j * uint32(cols) * uint32(rows) * uint32(bitsa) / 8
-			if RGB {
-				offset = 3 * offset
-			}
-			if bitsa == 8 {
-				if RGB {
-					if err := jpeglib.EIJG8encode(img[offset:], cols, rows, 3, &JPEGData, &JPEGBytes, 4); err != nil {
-						return err
-					}
-				} else {
-					if err := jpeglib.EIJG8encode(img[offset:], cols, rows, 1, &JPEGData, &JPEGBytes, 4); err != nil {
-						return err
-					}
-				}
-			} else {
-				if err := jpeglib.EIJG16encode(img[offset/2:], cols, rows, 1, &JPEGData, &JPEGBytes, 0); err != nil {
-					return err
-				}
-			}
-			newtag = &DcmTag{
-				Group:     0xFFFE,
-				Element:   0xE000,
-				Length:    uint32(JPEGBytes),
-				VR:        "DL",
-				Data:      JPEGData,
-				BigEndian: obj.IsBigEndian(),
-			}
-			obj.InsertTag(index, newtag)
-			JPEGData = nil
-		}
-		index++
-		newtag = &DcmTag{
-			Group:     0xFFFE,
-			Element:   0xE0DD,
-			Length:    0,
-			VR:        "DL",
-			Data:      nil,
-			BigEndian: obj.IsBigEndian(),
-		}
-		obj.InsertTag(index, newtag)
-		*i = index
-	case transfersyntax.JPEGBaseline8Bit.UID:
-		tag.VR = "OB"
-		tag.Length = 0xFFFFFFFF
-		if tag.Data != nil {
-			tag.Data = nil
-		}
-		obj.SetTag(index, tag)
-		index++
-		newtag := &DcmTag{
-			Group:     0xFFFE,
-			Element:   0xE000,
-			Length:    0,
-			VR:        "DL",
-			Data:      nil,
-			BigEndian: obj.IsBigEndian(),
-		}
-		obj.InsertTag(index, newtag)
-		jpeg_size = 0
-		for j = 0; j < frames; j++ {
-			index++
-			offset = j * uint32(cols) * uint32(rows) * uint32(bitsa) / 8
-			if RGB {
-				offset = 3 * offset
-				if err := jpeglib.EIJG8encode(img[offset:], cols, rows, 3, &JPEGData, &JPEGBytes, 0); err != nil {
-					return err
-				}
-			} else {
-				if bitsa == 8 {
-					if err := jpeglib.EIJG8encode(img[offset:], cols, rows, 1, &JPEGData, &JPEGBytes, 0); err != nil {
-						return err
-					}
-				} else {
-					if err := jpeglib.EIJG12encode(img[offset:], cols, rows, 1, &JPEGData, &JPEGBytes, 0); err != nil {
-						return err
-					}
-				}
-			}
-			newtag = &DcmTag{
-				Group:     0xFFFE,
-				Element:   0xE000,
-				Length:    uint32(JPEGBytes),
-				VR:        "DL",
-				Data:      JPEGData,
-				BigEndian: obj.IsBigEndian(),
-			}
-			obj.InsertTag(index, newtag)
-			JPEGData = nil
-			jpeg_size = jpeg_size + uint32(JPEGBytes)
-		}
-		index++
-		newtag = &DcmTag{
-			Group:     0xFFFE,
-			Element:   0xE0DD,
-			Length:    0,
-			VR:        "DL",
-			Data:      nil,
-			BigEndian: obj.IsBigEndian(),
-		}
-		obj.InsertTag(index, newtag)
-		*i = index
-	case transfersyntax.JPEGExtended12Bit.UID:
-		tag.VR = "OB"
-		tag.Length = 0xFFFFFFFF
-		if tag.Data != nil {
-			tag.Data = nil
-		}
-		obj.SetTag(index, tag)
-		index++
-		newtag := &DcmTag{
-			Group:     0xFFFE,
-			Element:   0xE000,
-			Length:    0,
-			VR:        "DL",
-			Data:      nil,
-			BigEndian: obj.IsBigEndian(),
-		}
-		obj.InsertTag(index, newtag)
-		jpeg_size = 0
-		for j = 0; j < frames; j++ {
-			index++
-			offset = j * uint32(cols) * uint32(rows) * uint32(bitsa) / 8
-			if err := jpeglib.EIJG12encode(img[offset/2:], cols, rows, 1, &JPEGData, &JPEGBytes, 0); err != nil {
-				return err
-			}
-			newtag = &DcmTag{
-				Group:     0xFFFE,
-				Element:   0xE000,
-				Length:    uint32(JPEGBytes),
-				VR:        "DL",
-				Data:      JPEGData,
-				BigEndian: obj.IsBigEndian(),
-			}
-			obj.InsertTag(index, newtag)
-			JPEGData = nil
-			jpeg_size = jpeg_size + uint32(JPEGBytes)
-		}
-		index++
-		newtag = &DcmTag{
-			Group:     0xFFFE,
-			Element:   0xE0DD,
-			Length:    0,
-			VR:        "DL",
-			Data:      nil,
-			BigEndian: obj.IsBigEndian(),
+	encode, bound := frameEncoder(outTS, RGB, cols, rows, bitsa)
+	if encode == nil {
+		if bitss == 8 {
+			tag.VR = "OB"
+		} else {
+			tag.VR = "OW"
 		}
-		obj.InsertTag(index, newtag)
-		*i = index
-	case transfersyntax.JPEG2000Lossless.UID:
-		tag.VR = "OB"
-		tag.Length = 0xFFFFFFFF
+		tag.Length = size
 		if tag.Data != nil {
 			tag.Data = nil
 		}
+		tag.Data = make([]byte, tag.Length)
+		copy(tag.Data, img)
 		obj.SetTag(index, tag)
-		index++
-		newtag := &DcmTag{
-			Group:     0xFFFE,
-			Element:   0xE000,
-			Length:    0,
-			VR:        "DL",
-			Data:      nil,
-			BigEndian: obj.IsBigEndian(),
-		}
-		obj.InsertTag(index, newtag)
-		for j = 0; j < frames; j++ {
-			index++
-			offset = j * uint32(cols) * uint32(rows) * uint32(bitsa) / 8
-			if RGB {
-				offset = 3 * offset
-				if err := openjpeg.J2Kencode(img[offset:], cols, rows, 3, bitsa, &JPEGData, &JPEGBytes, 0); err != nil {
-					return err
-				}
-			} else {
-				if err := openjpeg.J2Kencode(img[offset:], cols, rows, 1, bitsa, &JPEGData, &JPEGBytes, 0); err != nil {
-					return err
-				}
-			}
-			newtag = &DcmTag{
-				Group:     0xFFFE,
-				Element:   0xE000,
-				Length:    uint32(JPEGBytes),
-				VR:        "DL",
-				Data:      JPEGData,
-				BigEndian: obj.IsBigEndian(),
-			}
-			obj.InsertTag(index, newtag)
-			JPEGData = nil
-		}
+		return nil
+	}
+
+	tag.VR = "OB"
+	tag.Length = 0xFFFFFFFF
+	if tag.Data != nil {
+		tag.Data = nil
+	}
+	obj.SetTag(index, tag)
+	index++
+	newtag := &DcmTag{
+		Group:     0xFFFE,
+		Element:   0xE000,
+		Length:    0,
+		VR:        "DL",
+		Data:      nil,
+		BigEndian: obj.IsBigEndian(),
+	}
+	obj.InsertTag(index, newtag)
+	// compressed frames are carved from one buffer instead of one allocation each
+	fragments.reserve(int(size / 4))
+	err := encodeFrames(encode, bound, img, single, frames, func(data []byte) {
 		index++
 		newtag = &DcmTag{
-			Group:     0xFFFE,
-			Element:   0xE0DD,
-			Length:    0,
-			VR:        "DL",
-			Data:      nil,
-			BigEndian: obj.IsBigEndian(),
-		}
-		obj.InsertTag(index, newtag)
-		*i = index
-	case transfersyntax.JPEG2000.UID:
-		tag.VR = "OB"
-		tag.Length = 0xFFFFFFFF
-		if tag.Data != nil {
-			tag.Data = nil
-		}
-		obj.SetTag(index, tag)
-		index++
-		newtag := &DcmTag{
 			Group:     0xFFFE,
 			Element:   0xE000,
-			Length:    0,
-			VR:        "DL",
-			Data:      nil,
-			BigEndian: obj.IsBigEndian(),
-		}
-		obj.InsertTag(index, newtag)
-		jpeg_size = 0
-		for j = 0; j < frames; j++ {
-			index++
-			offset = j * uint32(cols) * uint32(rows) * uint32(bitsa) / 8
-			if RGB {
-				offset = 3 * offset
-				if err := openjpeg.J2Kencode(img[offset:], cols, rows, 3, bitsa, &JPEGData, &JPEGBytes, 10); err != nil {
-					return err
-				}
-			} else {
-				if err := openjpeg.J2Kencode(img[offset:], cols, rows, 1, bitsa, &JPEGData, &JPEGBytes, 10); err != nil {
-					return err
-				}
-			}
-			newtag = &DcmTag{
-				Group:     0xFFFE,
-				Element:   0xE000,
-				Length:    uint32(JPEGBytes),
-				VR:        "DL",
-				Data:      JPEGData,
-				BigEndian: obj.IsBigEndian(),
-			}
-			obj.InsertTag(index, newtag)
-			JPEGData = nil
-			jpeg_size = jpeg_size + uint32(JPEGBytes)
-		}
-		index++
-		newtag = &DcmTag{
-			Group:     0xFFFE,
-			Element:   0xE0DD,
-			Length:    0,
+			Length:    uint32(len(data)),
 			VR:        "DL",
-			Data:      nil,
+			Data:      fragments.add(data),
 			BigEndian: obj.IsBigEndian(),
 		}
 		obj.InsertTag(index, newtag)
-		*i = index
-	default:
-		if bitss == 8 {
-			tag.VR = "OB"
-		} else {
-			tag.VR = "OW"
-		}
-		tag.Length = size
-		if tag.Data != nil {
-			tag.Data = nil
-		}
-		tag.Data = make([]byte, tag.Length)
-		copy(tag.Data, img)
-		obj.SetTag(index, tag)
+	})
+	if err != nil {
+		return err
 	}
+	index++
+	newtag = &DcmTag{
+		Group:     0xFFFE,
+		Element:   0xE0DD,
+		Length:    0,
+		VR:        "DL",
+		Data:      nil,
+		BigEndian: obj.IsBigEndian(),
+	}
+	obj.InsertTag(index, newtag)
+	*i = index
 	return nil
 }
 
-func (obj *dcmObj) uncompress(i int, img []byte, size uint32, frames uint32, bitsa uint16, PhotoInt string) error {
+func (obj *dcmObj) uncompress(i int, img []byte, size uint32, frames uint32, bitsa uint16, PhotoInt string, keepYCbCr bool) error {
 	var j, offset, single uint32
 	single = size / frames
 
-	obj.DelTag(i + 1) // Delete offset table.
+	// refused before any tag changes, the object keeps its offset table and fragments
 	switch obj.TransferSyntax.UID {
-	case transfersyntax.RLELossless.UID:
-		for j = 0; j < frames; j++ {
-			offset = j * single
-			tag := obj.GetTagAt(i + 1)
-			if err := transcoder.RLEdecode(tag.Data, img[offset:], tag.Length, single, PhotoInt); err != nil {
-				return err
-			}
-			obj.DelTag(i + 1)
+	case transfersyntax.HTJ2KLossless.UID, transfersyntax.HTJ2KLosslessRPCL.UID, transfersyntax.HTJ2K.UID:
+		return openjpeg.ErrHTJ2K
+	}
+	if decode := frameDecoder(obj.TransferSyntax.UID, bitsa, keepYCbCr); decode != nil {
+		fragments, end, err := obj.frameFragments(i, frames)
+		if err != nil {
+			return err
 		}
-		obj.DelTag(i + 1)
-	case transfersyntax.JPEGLosslessSV1.UID:
-	case transfersyntax.JPEGLossless.UID:
+		// every frame in one batch call, decoded in parallel by the native codec
+		batch := make([]codecFrame, frames)
 		for j = 0; j < frames; j++ {
 			offset = j * single
-			tag := obj.GetTagAt(i + 1)
-			if bitsa == 8 {
-				if err := jpeglib.DIJG8decode(tag.Data, tag.Length, img[offset:], single); err != nil {
-					return err
-				}
-			} else {
-				if err := jpeglib.DIJG16decode(tag.Data, tag.Length, img[offset:], single); err != nil {
-					return err
-				}
+			in := fragments[j][0]
+			// a codestream that disagrees with the tags is refused before any frame is decoded
+			if raw, ok := frameRawSize(obj.TransferSyntax.UID, in, bitsa); ok && raw != int(single) {
+				return fmt.Errorf("frame %d decodes to %d bytes, the image tags give %d", j, raw, single)
 			}
-			obj.DelTag(i + 1)
+			batch[j] = codecFrame{in: in, fragments: fragments[j][1:], out: img[offset : offset+single]}
 		}
-		obj.DelTag(i + 1)
-	case transfersyntax.JPEGBaseline8Bit.UID:
-		for j = 0; j < frames; j++ {
-			offset = j * single
-			tag := obj.GetTagAt(i + 1)
-			if bitsa == 8 {
-				if err := jpeglib.DIJG8decode(tag.Data, tag.Length, img[offset:], single); err != nil {
-					return err
-				}
-			} else {
-				if err := jpeglib.DIJG12decode(tag.Data, tag.Length, img[offset:], single); err != nil {
-					return err
-				}
-			}
-			obj.DelTag(i + 1)
-		}
-		obj.DelTag(i + 1)
-	case transfersyntax.JPEGExtended12Bit.UID:
-		for j = 0; j < frames; j++ {
-			offset = j * single
-			tag := obj.GetTagAt(i + 1)
-			if err := jpeglib.DIJG12decode(tag.Data, tag.Length, img[offset:], single); err != nil {
-				return err
-			}
-			obj.DelTag(i + 1)
+		if err := decode(batch, 0); err != nil {
+			return err
 		}
-		obj.DelTag(i + 1)
-	case transfersyntax.JPEG2000Lossless.UID:
-		for j = 0; j < frames; j++ {
-			offset = j * single
-			tag := obj.GetTagAt(i + 1)
-			if err := openjpeg.J2Kdecode(tag.Data, tag.Length, img[offset:]); err != nil {
-				return err
-			}
-			obj.DelTag(i + 1)
+		// offset table, fragments and the sequence delimiter
+		obj.Tags = append(obj.Tags[:i+1], obj.Tags[end+1:]...)
+		return nil
+	}
+	obj.DelTag(i + 1) // Delete offset table.
+	switch obj.TransferSyntax.UID {
+	case transfersyntax.RLELossless.UID:
+		if keepYCbCr && PhotoInt == "YBR_FULL" {
+			// the YBR_FULL segments are interleaved as they are
+			PhotoInt = "RGB"
 		}
-		obj.DelTag(i + 1)
-	case transfersyntax.JPEG2000.UID:
 		for j = 0; j < frames; j++ {
 			offset = j * single
 			tag := obj.GetTagAt(i + 1)
-			if err := openjpeg.J2Kdecode(tag.Data, tag.Length, img[offset:]); err != nil {
+			if err := transcoder.RLEdecode(tag.Data, img[offset:], tag.Length, single, PhotoInt); err != nil {
 				return err
 			}
 			obj.DelTag(i + 1)
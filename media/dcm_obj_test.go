@@ -1,9 +1,17 @@
 package media
 
 import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"os"
+	"strconv"
+	"strings"
 	"testing"
 
+	"github.com/innovative-io/io-dicom/colorspace"
 	"github.com/innovative-io/io-dicom/dictionary/transfersyntax"
+	"github.com/innovative-io/io-dicom/openjpeg"
 )
 
 func TestNewDCMObjFromFile(t *testing.T) {
@@ -84,7 +92,19 @@ func Test_dcmObj_ChangeTransferSynx(t *testing.T) {
 			name:     "Should change transfer synxtax to RLELossless",
 			fileName: "../samples/test2.dcm",
 			args:     args{transfersyntax.RLELossless},
-			wantErr:  true,
+			wantErr:  false,
+		},
+		{
+			name:     "Should change transfer synxtax from RLELossless to ExplicitVRLittleEndian",
+			fileName: "../samples/rle_gray.dcm",
+			args:     args{transfersyntax.ExplicitVRLittleEndian},
+			wantErr:  false,
+		},
+		{
+			name:     "Should change transfer synxtax of a color image to RLELossless",
+			fileName: "../samples/jpeg8.dcm",
+			args:     args{transfersyntax.RLELossless},
+			wantErr:  false,
 		},
 		{
 			name:     "Should change transfer synxtax to JPEGLosslessSV1",
@@ -116,6 +136,24 @@ func Test_dcmObj_ChangeTransferSynx(t *testing.T) {
 			args:     args{transfersyntax.JPEG2000},
 			wantErr:  false,
 		},
+		{
+			name:     "Should change transfer synxtax to JPEGLSLossless",
+			fileName: "../samples/test2.dcm",
+			args:     args{transfersyntax.JPEGLSLossless},
+			wantErr:  false,
+		},
+		{
+			name:     "Should change transfer synxtax to JPEGLSNearLossless",
+			fileName: "../samples/jpeg8.dcm",
+			args:     args{transfersyntax.JPEGLSNearLossless},
+			wantErr:  false,
+		},
+		{
+			name:     "Should not change transfer synxtax to HTJ2KLossless",
+			fileName: "../samples/test2.dcm",
+			args:     args{transfersyntax.HTJ2KLossless},
+			wantErr:  true,
+		},
 	}
 	for _, tt := range tests {
 		t.Run(tt.name, func(t *testing.T) {
@@ -129,3 +167,485 @@ func Test_dcmObj_ChangeTransferSynx(t *testing.T) {
 		})
 	}
 }
+
+func Test_dcmObj_ChangeTransferSynxPipelined(t *testing.T) {
+	type args struct {
+		frames string
+		outTS  *transfersyntax.TransferSyntax
+		opts   []TranscodeOption
+	}
+	tests := []struct {
+		name     string
+		fileName string
+		args     args
+		wantErr  bool
+	}{
+		{
+			name:     "Should transcode a multi-frame JPEGLosslessSV1 image to JPEG2000Lossless frame by frame",
+			fileName: "../samples/test2.dcm",
+			args:     args{frames: "10", outTS: transfersyntax.JPEG2000Lossless, opts: []TranscodeOption{WithTranscodeWorkers(2), WithMaxFramesInFlight(3)}},
+			wantErr:  false,
+		},
+		{
+			name:     "Should transcode a multi-frame JPEGLosslessSV1 image with the default pipeline",
+			fileName: "../samples/test2.dcm",
+			args:     args{frames: "10", outTS: transfersyntax.JPEG2000Lossless, opts: []TranscodeOption{WithTranscodeWorkers(0)}},
+			wantErr:  false,
+		},
+		{
+			name:     "Should transcode a multi-frame JPEGLosslessSV1 image to RLELossless frame by frame",
+			fileName: "../samples/test2.dcm",
+			args:     args{frames: "4", outTS: transfersyntax.RLELossless, opts: []TranscodeOption{WithTranscodeWorkers(2)}},
+			wantErr:  false,
+		},
+		{
+			name:     "Should transcode a multi-frame JPEGLosslessSV1 image to JPEGLSLossless frame by frame",
+			fileName: "../samples/test2.dcm",
+			args:     args{frames: "4", outTS: transfersyntax.JPEGLSLossless, opts: []TranscodeOption{WithTranscodeWorkers(2)}},
+			wantErr:  false,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			dcmObj, err := NewDCMObjFromFile(tt.fileName)
+			if err != nil {
+				panic(err)
+			}
+			frames, _ := strconv.Atoi(tt.args.frames)
+			pixel := dcmObj.GetTagGE(0x7FE0, 0x0010)
+			want := bytes.Repeat(pixel.Data, frames)
+			pixel.Data = want
+			pixel.Length = uint32(len(want))
+			for i, tag := range dcmObj.GetTags() {
+				if tag.Group == 0x0028 && tag.Element == 0x0010 {
+					dcmObj.InsertTag(i, &DcmTag{Group: 0x0028, Element: 0x0008, VR: "IS", Length: uint32(len(tt.args.frames)), Data: []byte(tt.args.frames)})
+					break
+				}
+			}
+			if err := dcmObj.ChangeTransferSynx(transfersyntax.JPEGLosslessSV1); err != nil {
+				t.Fatalf("dcmObj.ChangeTransferSynx() error = %v", err)
+			}
+			if err := dcmObj.ChangeTransferSynx(tt.args.outTS, tt.args.opts...); (err != nil) != tt.wantErr {
+				t.Fatalf("dcmObj.ChangeTransferSynx() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			fragments := 0
+			for _, tag := range dcmObj.GetTags() {
+				if tag.Group == 0xFFFE && tag.Element == 0xE000 && tag.Length > 0 && tag.Length != 0xFFFFFFFF {
+					fragments++
+				}
+			}
+			if fragments != frames {
+				t.Errorf("dcmObj.ChangeTransferSynx() fragments = %d, want %d", fragments, frames)
+			}
+			if err := dcmObj.ChangeTransferSynx(transfersyntax.ExplicitVRLittleEndian); err != nil {
+				t.Fatalf("dcmObj.ChangeTransferSynx() error = %v", err)
+			}
+			if got := dcmObj.GetTagGE(0x7FE0, 0x0010); !bytes.Equal(got.Data, want) {
+				t.Errorf("dcmObj.ChangeTransferSynx() pixel data differs from the source")
+			}
+		})
+	}
+}
+
+// jpegColorObj - the JPEGBaseline8Bit sample with its frame replaced by a YCbCr color JPEG
+func jpegColorObj() DcmObj {
+	dcmObj, err := NewDCMObjFromFile("../samples/jpeg8.dcm")
+	if err != nil {
+		panic(err)
+	}
+	jpegData, err := os.ReadFile("../samples/test8.jpg")
+	if err != nil {
+		panic(err)
+	}
+	if len(jpegData)%2 == 1 {
+		jpegData = append(jpegData, 0)
+	}
+	for i, tag := range dcmObj.GetTags() {
+		switch {
+		case tag.Group == 0x0028 && tag.Element == 0x0002:
+			tag.Data = []byte{3, 0}
+		case tag.Group == 0x0028 && tag.Element == 0x0004:
+			tag.Data = []byte("YBR_FULL_422")
+			tag.Length = uint32(len(tag.Data))
+		case tag.Group == 0x0028 && tag.Element == 0x0010:
+			tag.Data = []byte{0x6E, 0x04} // 1134
+		case tag.Group == 0x0028 && tag.Element == 0x0011:
+			tag.Data = []byte{0x28, 0x06} // 1576
+		case tag.Group == 0x0028 && (tag.Element == 0x0100 || tag.Element == 0x0101):
+			tag.Data = []byte{8, 0}
+		case tag.Group == 0x0028 && tag.Element == 0x0102:
+			tag.Data = []byte{7, 0}
+		case tag.Group == 0x7FE0 && tag.Element == 0x0010:
+			fragment := dcmObj.GetTagAt(i + 2)
+			fragment.Data = jpegData
+			fragment.Length = uint32(len(jpegData))
+		}
+	}
+	return dcmObj
+}
+
+func Test_dcmObj_ChangeTransferSynxYCbCr(t *testing.T) {
+	type args struct {
+		opts []TranscodeOption
+	}
+	tests := []struct {
+		name         string
+		args         args
+		wantPhotoInt string
+	}{
+		{
+			name:         "Should convert a YCbCr JPEGBaseline8Bit image to RGB",
+			args:         args{opts: nil},
+			wantPhotoInt: "RGB",
+		},
+		{
+			name:         "Should keep a YCbCr JPEGBaseline8Bit image in YCbCr",
+			args:         args{opts: []TranscodeOption{WithNativeYCbCr()}},
+			wantPhotoInt: "YBR_FULL",
+		},
+	}
+	want := jpegColorObj()
+	if err := want.ChangeTransferSynx(transfersyntax.ExplicitVRLittleEndian); err != nil {
+		t.Fatalf("dcmObj.ChangeTransferSynx() error = %v", err)
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			dcmObj := jpegColorObj()
+			if err := dcmObj.ChangeTransferSynx(transfersyntax.ExplicitVRLittleEndian, tt.args.opts...); err != nil {
+				t.Fatalf("dcmObj.ChangeTransferSynx() error = %v", err)
+			}
+			if got := strings.TrimSpace(dcmObj.GetStringGE(0x0028, 0x0004)); got != tt.wantPhotoInt {
+				t.Fatalf("dcmObj.ChangeTransferSynx() PhotometricInterpretation = %s, want %s", got, tt.wantPhotoInt)
+			}
+			got := dcmObj.GetTagGE(0x7FE0, 0x0010).Data
+			if tt.wantPhotoInt == "YBR_FULL" {
+				colorspace.YBRFullToRGB(got, got)
+			}
+			rgb := want.GetTagGE(0x7FE0, 0x0010).Data
+			if len(got) != 1576*1134*3 || len(got) != len(rgb) {
+				t.Fatalf("dcmObj.ChangeTransferSynx() pixel data %d bytes, want %d", len(got), 1576*1134*3)
+			}
+			for i := range rgb {
+				if d := int(got[i]) - int(rgb[i]); d < -1 || d > 1 {
+					t.Fatalf("dcmObj.ChangeTransferSynx() sample %d = %d as RGB, want %d", i, got[i], rgb[i])
+				}
+			}
+		})
+	}
+}
+
+// fragmentedObj - jpegColorObj with frames copies of its frame, each split over pieces fragments,
+// with or without a Basic Offset Table
+func fragmentedObj(frames int, pieces int, table bool) DcmObj {
+	obj := jpegColorObj().(*dcmObj)
+	pixel := 0
+	for pixel = range obj.Tags {
+		if obj.Tags[pixel].Group == 0x7FE0 && obj.Tags[pixel].Element == 0x0010 {
+			break
+		}
+	}
+	jpegData := obj.Tags[pixel+2].Data
+	var offsets []byte
+	var items []*DcmTag
+	offset := uint32(0)
+	for f := 0; f < frames; f++ {
+		offsets = binary.LittleEndian.AppendUint32(offsets, offset)
+		for k := 0; k < pieces; k++ {
+			// items hold an even number of bytes
+			start, end := (k*len(jpegData)/pieces)&^1, ((k+1)*len(jpegData)/pieces)&^1
+			if k == pieces-1 {
+				end = len(jpegData)
+			}
+			items = append(items, &DcmTag{Group: 0xFFFE, Element: 0xE000, VR: "DL", Data: jpegData[start:end], Length: uint32(end - start)})
+			offset += 8 + uint32(end-start)
+		}
+	}
+	if !table {
+		offsets = nil
+	}
+	items = append([]*DcmTag{{Group: 0xFFFE, Element: 0xE000, VR: "DL", Data: offsets, Length: uint32(len(offsets))}}, items...)
+	obj.Tags = append(obj.Tags[:pixel+1], append(items, obj.Tags[pixel+3:]...)...)
+	if frames > 1 {
+		for i, tag := range obj.Tags {
+			if tag.Group == 0x0028 && tag.Element == 0x0010 {
+				number := []byte(strconv.Itoa(frames) + " ")
+				obj.InsertTag(i, &DcmTag{Group: 0x0028, Element: 0x0008, VR: "IS", Data: number, Length: uint32(len(number))})
+				break
+			}
+		}
+	}
+	return obj
+}
+
+func Test_dcmObj_ChangeTransferSynxFragments(t *testing.T) {
+	type args struct {
+		frames int
+		pieces int
+		table  bool
+	}
+	tests := []struct {
+		name string
+		args args
+	}{
+		{
+			name: "Should decode a frame split over three fragments",
+			args: args{frames: 1, pieces: 3, table: false},
+		},
+		{
+			name: "Should decode frames split by the offset table",
+			args: args{frames: 2, pieces: 2, table: true},
+		},
+		{
+			name: "Should decode frames split where their codestream starts",
+			args: args{frames: 3, pieces: 3, table: false},
+		},
+	}
+	want := jpegColorObj()
+	jpegData, err := want.GetPixelData(0)
+	if err != nil {
+		t.Fatalf("dcmObj.GetPixelData() error = %v", err)
+	}
+	if err := want.ChangeTransferSynx(transfersyntax.ExplicitVRLittleEndian); err != nil {
+		t.Fatalf("dcmObj.ChangeTransferSynx() error = %v", err)
+	}
+	rgb := want.GetTagGE(0x7FE0, 0x0010).Data
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			dcmObj := fragmentedObj(tt.args.frames, tt.args.pieces, tt.args.table)
+			for f := 0; f < tt.args.frames; f++ {
+				got, err := dcmObj.GetPixelData(f)
+				if err != nil || !bytes.Equal(got, jpegData) {
+					t.Fatalf("dcmObj.GetPixelData(%d) error = %v, %d bytes, want the %d bytes of the frame", f, err, len(got), len(jpegData))
+				}
+			}
+			if err := dcmObj.ChangeTransferSynx(transfersyntax.ExplicitVRLittleEndian); err != nil {
+				t.Fatalf("dcmObj.ChangeTransferSynx() error = %v", err)
+			}
+			got := dcmObj.GetTagGE(0x7FE0, 0x0010).Data
+			if len(got) != tt.args.frames*len(rgb) {
+				t.Fatalf("dcmObj.ChangeTransferSynx() pixel data %d bytes, want %d", len(got), tt.args.frames*len(rgb))
+			}
+			for f := 0; f < tt.args.frames; f++ {
+				if !bytes.Equal(got[f*len(rgb):(f+1)*len(rgb)], rgb) {
+					t.Errorf("dcmObj.ChangeTransferSynx() frame %d differs from the frame decoded whole", f)
+				}
+			}
+		})
+	}
+}
+
+func Test_dcmObj_ChangeTransferSynxTagMismatch(t *testing.T) {
+	tests := []struct {
+		name    string
+		rows    uint16
+		outTS   *transfersyntax.TransferSyntax
+		opts    []TranscodeOption
+		wantErr bool
+	}{
+		{
+			name:    "Should decode frames that match the image tags",
+			rows:    1134,
+			outTS:   transfersyntax.ExplicitVRLittleEndian,
+			wantErr: false,
+		},
+		{
+			name:    "Should not decode frames larger than the image tags",
+			rows:    1000,
+			outTS:   transfersyntax.ExplicitVRLittleEndian,
+			wantErr: true,
+		},
+		{
+			name:    "Should not decode frames smaller than the image tags",
+			rows:    1200,
+			outTS:   transfersyntax.ExplicitVRLittleEndian,
+			wantErr: true,
+		},
+		{
+			name:    "Should transcode frame by frame frames that match the image tags",
+			rows:    1134,
+			outTS:   transfersyntax.JPEG2000Lossless,
+			opts:    []TranscodeOption{WithTranscodeWorkers(1)},
+			wantErr: false,
+		},
+		{
+			name:    "Should not transcode frame by frame frames smaller than the image tags",
+			rows:    1200,
+			outTS:   transfersyntax.JPEG2000Lossless,
+			opts:    []TranscodeOption{WithTranscodeWorkers(1)},
+			wantErr: true,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			dcmObj := jpegColorObj()
+			binary.LittleEndian.PutUint16(dcmObj.GetTagGE(0x0028, 0x0010).Data, tt.rows)
+			if err := dcmObj.ChangeTransferSynx(tt.outTS, tt.opts...); (err != nil) != tt.wantErr {
+				t.Errorf("dcmObj.ChangeTransferSynx() error = %v, wantErr %v", err, tt.wantErr)
+			}
+		})
+	}
+}
+
+func Test_dcmObj_ChangeTransferSynxHTJ2K(t *testing.T) {
+	tests := []struct {
+		name string
+		ts   *transfersyntax.TransferSyntax
+	}{
+		{name: "Should refuse HTJ2KLossless pixel data and keep its tags", ts: transfersyntax.HTJ2KLossless},
+		{name: "Should refuse HTJ2KLosslessRPCL pixel data and keep its tags", ts: transfersyntax.HTJ2KLosslessRPCL},
+		{name: "Should refuse HTJ2K pixel data and keep its tags", ts: transfersyntax.HTJ2K},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			dcmObj, err := NewDCMObjFromFile("../samples/test2.dcm")
+			if err != nil {
+				panic(err)
+			}
+			// Part 1 frames taken for HTJ2K, uncompress refuses them by the UID
+			if err := dcmObj.ChangeTransferSynx(transfersyntax.JPEG2000Lossless); err != nil {
+				t.Fatalf("dcmObj.ChangeTransferSynx() error = %v", err)
+			}
+			dcmObj.SetTransferSyntax(tt.ts)
+			want := append([]*DcmTag(nil), dcmObj.GetTags()...)
+			if err := dcmObj.ChangeTransferSynx(transfersyntax.ExplicitVRLittleEndian); !errors.Is(err, openjpeg.ErrHTJ2K) {
+				t.Fatalf("dcmObj.ChangeTransferSynx() error = %v, want %v", err, openjpeg.ErrHTJ2K)
+			}
+			got := dcmObj.GetTags()
+			if len(got) != len(want) {
+				t.Fatalf("dcmObj.ChangeTransferSynx() tags = %d, want %d", len(got), len(want))
+			}
+			for k := range want {
+				if got[k] != want[k] {
+					t.Errorf("dcmObj.ChangeTransferSynx() tag %d changed", k)
+				}
+			}
+		})
+	}
+}
+
+func Test_dcmObj_WriteToBytesDeflated(t *testing.T) {
+	tests := []struct {
+		name     string
+		fileName string
+	}{
+		{
+			name:     "Should deflate and inflate a gray image",
+			fileName: "../samples/test2.dcm",
+		},
+		{
+			name:     "Should deflate and inflate a color image",
+			fileName: "../samples/jpeg8.dcm",
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			dcmObj, err := NewDCMObjFromFile(tt.fileName)
+			if err != nil {
+				panic(err)
+			}
+			if err := dcmObj.ChangeTransferSynx(transfersyntax.ExplicitVRLittleEndian); err != nil {
+				t.Fatalf("dcmObj.ChangeTransferSynx() error = %v", err)
+			}
+			plain := dcmObj.WriteToBytes()
+			want := dcmObj.GetTagGE(0x7FE0, 0x0010).Data
+			if err := dcmObj.ChangeTransferSynx(transfersyntax.DeflatedExplicitVRLittleEndian); err != nil {
+				t.Fatalf("dcmObj.ChangeTransferSynx() error = %v", err)
+			}
+			deflated := dcmObj.WriteToBytes()
+			if len(deflated) >= len(plain) {
+				t.Errorf("dcmObj.WriteToBytes() deflated %d bytes, want less than %d", len(deflated), len(plain))
+			}
+			got, err := NewDCMObjFromBytes(deflated)
+			if err != nil {
+				t.Fatalf("NewDCMObjFromBytes() error = %v", err)
+			}
+			if got.GetTransferSyntax() != transfersyntax.DeflatedExplicitVRLittleEndian || got.TagCount() != dcmObj.TagCount() {
+				t.Fatalf("NewDCMObjFromBytes() = %s with %d tags, want %d tags", got.GetTransferSyntax().Name, got.TagCount(), dcmObj.TagCount())
+			}
+			if !bytes.Equal(got.GetTagGE(0x7FE0, 0x0010).Data, want) {
+				t.Errorf("NewDCMObjFromBytes() pixel data differs from the source")
+			}
+		})
+	}
+}
+
+func Test_dcmObj_GetPixelDataReduced(t *testing.T) {
+	type args struct {
+		outTS *transfersyntax.TransferSyntax
+		level int
+	}
+	tests := []struct {
+		name      string
+		fileName  string
+		args      args
+		wantCols  int
+		wantRows  int
+		wantPixel int
+		wantErr   bool
+	}{
+		{
+			name:      "Should decode a half resolution JPEG2000Lossless preview",
+			fileName:  "../samples/jpeg8.dcm",
+			args:      args{outTS: transfersyntax.JPEG2000Lossless, level: 1},
+			wantCols:  256,
+			wantRows:  256,
+			wantPixel: 2,
+			wantErr:   false,
+		},
+		{
+			name:      "Should decode an eighth resolution JPEG2000 preview",
+			fileName:  "../samples/test2.dcm",
+			args:      args{outTS: transfersyntax.JPEG2000, level: 3},
+			wantCols:  64,
+			wantRows:  64,
+			wantPixel: 2,
+			wantErr:   false,
+		},
+		{
+			name:      "Should decode a quarter resolution JPEGBaseline8Bit color preview",
+			args:      args{outTS: transfersyntax.JPEGBaseline8Bit, level: 2},
+			wantCols:  394,
+			wantRows:  284,
+			wantPixel: 3,
+			wantErr:   false,
+		},
+		{
+			name:    "Should not decode a sixteenth resolution JPEGBaseline8Bit preview",
+			args:    args{outTS: transfersyntax.JPEGBaseline8Bit, level: 4},
+			wantErr: true,
+		},
+		{
+			name:     "Should not decode a reduced ExplicitVRLittleEndian frame",
+			fileName: "../samples/test2.dcm",
+			args:     args{outTS: transfersyntax.ExplicitVRLittleEndian, level: 1},
+			wantErr:  true,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var dcmObj DcmObj
+			if tt.fileName == "" {
+				dcmObj = jpegColorObj()
+			} else {
+				var err error
+				dcmObj, err = NewDCMObjFromFile(tt.fileName)
+				if err != nil {
+					panic(err)
+				}
+				if err := dcmObj.ChangeTransferSynx(tt.args.outTS); err != nil {
+					t.Fatalf("dcmObj.ChangeTransferSynx() error = %v", err)
+				}
+			}
+			data, cols, rows, err := dcmObj.GetPixelDataReduced(0, tt.args.level)
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("dcmObj.GetPixelDataReduced() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			if tt.wantErr {
+				return
+			}
+			if cols != tt.wantCols || rows != tt.wantRows || len(data) != cols*rows*tt.wantPixel {
+				t.Errorf("dcmObj.GetPixelDataReduced() = %dx%d, %d bytes, want %dx%d", cols, rows, len(data), tt.wantCols, tt.wantRows)
+			}
+		})
+	}
+}
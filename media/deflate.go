@@ -0,0 +1,93 @@
+package media
+
+import (
+	"bytes"
+	"compress/flate"
+	"errors"
+	"io"
+	"runtime"
+	"sync"
+)
+
+const (
+	// deflateChunk - uncompressed bytes compressed by one goroutine
+	deflateChunk = 128 * 1024
+	// deflateWindow - the deflate window, each chunk is primed with this much of the previous one
+	deflateWindow = 32 * 1024
+)
+
+// inflateDataset - Deflated Explicit VR Little Endian data set to Explicit VR Little Endian. The
+// data set is a raw deflate stream (PS3.5 A.5), read until its final block. Not a streaming read:
+// the whole data set is inflated into memory, because parseBufData parses tags out of a BufData
+// that holds the complete object, and the file is already in memory when it gets here
+func inflateDataset(data []byte) ([]byte, error) {
+	fr := flate.NewReader(bytes.NewReader(data))
+	defer fr.Close()
+	var out bytes.Buffer
+	// data sets compress 2-10x, start big enough that most never grow more than once
+	out.Grow(4 * len(data))
+	if _, err := io.Copy(&out, fr); err != nil {
+		return nil, errors.New("ERROR, inflateDataset, " + err.Error())
+	}
+	return out.Bytes(), nil
+}
+
+// deflateDataset - Explicit VR Little Endian data set to a raw deflate stream. Chunks are compressed
+// in parallel, each primed with the tail of the chunk before it, and end on a sync flush so their
+// outputs concatenate into one valid stream; only the last chunk writes the final block. The data
+// set is serialized whole first, WriteToBytes returns the object as one byte slice
+func deflateDataset(data []byte) []byte {
+	chunks := (len(data) + deflateChunk - 1) / deflateChunk
+	if chunks <= 1 {
+		return deflateChunkAt(data, 0, len(data), true)
+	}
+	parts := make([][]byte, chunks)
+	threads := min(runtime.NumCPU(), chunks)
+	var wg sync.WaitGroup
+	var mu sync.Mutex
+	next := 0
+	for t := 0; t < threads; t++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for {
+				mu.Lock()
+				c := next
+				next++
+				mu.Unlock()
+				if c >= chunks {
+					return
+				}
+				start := c * deflateChunk
+				end := min(start+deflateChunk, len(data))
+				parts[c] = deflateChunkAt(data, start, end, c == chunks-1)
+			}
+		}()
+	}
+	wg.Wait()
+
+	size := 0
+	for _, p := range parts {
+		size += len(p)
+	}
+	out := make([]byte, 0, size)
+	for _, p := range parts {
+		out = append(out, p...)
+	}
+	return out
+}
+
+// deflateChunkAt - compresses data[start:end] with data[start-32K:start] as its dictionary
+func deflateChunkAt(data []byte, start int, end int, last bool) []byte {
+	var buf bytes.Buffer
+	buf.Grow((end - start) / 2)
+	// the level is valid, NewWriterDict can not fail
+	fw, _ := flate.NewWriterDict(&buf, flate.DefaultCompression, data[max(0, start-deflateWindow):start])
+	fw.Write(data[start:end])
+	if last {
+		fw.Close()
+	} else {
+		fw.Flush()
+	}
+	return buf.Bytes()
+}
@@ -0,0 +1,29 @@
+package media
+
+// fragmentBuffer - hands out encoded fragments carved from one growing buffer, so
+// encoding a multi-frame image allocates a handful of times instead of once per frame
+type fragmentBuffer struct {
+	buf []byte
+}
+
+// reserve - makes sure at least size bytes are free after the last fragment. Fragments
+// handed out earlier keep pointing at the buffer they were written to
+func (fb *fragmentBuffer) reserve(size int) {
+	if cap(fb.buf)-len(fb.buf) >= size {
+		return
+	}
+	grow := 2 * cap(fb.buf)
+	if grow < size {
+		grow = size
+	}
+	fb.buf = make([]byte, 0, grow)
+}
+
+// add - copies data behind the last fragment and returns the new fragment
+func (fb *fragmentBuffer) add(data []byte) []byte {
+	fb.reserve(len(data))
+	start := len(fb.buf)
+	fb.buf = append(fb.buf, data...)
+	// capped, so appending to a fragment never runs into the next one
+	return fb.buf[start:len(fb.buf):len(fb.buf)]
+}
@@ -0,0 +1,95 @@
+package media
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+)
+
+// frameFragments - the fragments of each frame of the encapsulated pixel data tag at i, with the
+// index of its sequence delimiter. A frame may span several fragments: one frame takes them all,
+// as many fragments as frames are one each, otherwise the Basic Offset Table or, when it is empty,
+// the fragments starting a new JPEG or J2K codestream mark where the frames begin
+func (obj *dcmObj) frameFragments(i int, frames uint32) ([][][]byte, int, error) {
+	var items [][]byte
+	end := i + 2
+	for ; end < len(obj.Tags); end++ {
+		tag := obj.Tags[end]
+		if tag.Group == 0xFFFE && tag.Element == 0xE0DD {
+			break
+		}
+		if tag.Group != 0xFFFE || tag.Element != 0xE000 {
+			return nil, 0, errors.New("DcmObj::frameFragments, item expected")
+		}
+		items = append(items, tag.Data[:tag.Length])
+	}
+	if end == len(obj.Tags) {
+		return nil, 0, errors.New("DcmObj::frameFragments, no sequence delimiter")
+	}
+	if frames == 0 {
+		frames = 1
+	}
+	if uint32(len(items)) < frames {
+		return nil, 0, fmt.Errorf("DcmObj::frameFragments, %d fragments for %d frames", len(items), frames)
+	}
+
+	result := make([][][]byte, frames)
+	switch {
+	case frames == 1:
+		result[0] = items
+		return result, end, nil
+	case uint32(len(items)) == frames:
+		for f := range result {
+			result[f] = items[f : f+1 : f+1]
+		}
+		return result, end, nil
+	}
+
+	// first fragment of every frame
+	starts := make([]int, 0, frames)
+	if table := obj.Tags[i+1]; table.Length >= 4*frames {
+		// offsets of the first item of each frame, counted from the first item, tag and length included
+		offset := uint32(0)
+		next := 0
+		for k, item := range items {
+			if next < int(frames) && offset == binary.LittleEndian.Uint32(table.Data[4*next:]) {
+				starts = append(starts, k)
+				next++
+			}
+			offset += 8 + uint32(len(item))
+		}
+	} else {
+		for k, item := range items {
+			if len(item) >= 2 && (binary.BigEndian.Uint16(item) == 0xFFD8 || binary.BigEndian.Uint16(item) == 0xFF4F) {
+				starts = append(starts, k)
+			}
+		}
+	}
+	if uint32(len(starts)) != frames || starts[0] != 0 {
+		return nil, 0, fmt.Errorf("DcmObj::frameFragments, can't split %d fragments into %d frames", len(items), frames)
+	}
+	for f := range result {
+		last := len(items)
+		if f+1 < len(starts) {
+			last = starts[f+1]
+		}
+		result[f] = items[starts[f]:last:last]
+	}
+	return result, end, nil
+}
+
+// joinFragments - the fragments of one frame as one slice, only copied when there are several
+func joinFragments(fragments [][]byte) []byte {
+	if len(fragments) == 1 {
+		return fragments[0]
+	}
+	size := 0
+	for _, fragment := range fragments {
+		size += len(fragment)
+	}
+	data := make([]byte, 0, size)
+	for _, fragment := range fragments {
+		data = append(data, fragment...)
+	}
+	return data
+}
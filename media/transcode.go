@@ -0,0 +1,320 @@
+package media
+
+import (
+	"errors"
+	"fmt"
+	"runtime"
+	"sync"
+
+	"github.com/innovative-io/io-dicom/dictionary/transfersyntax"
+	"github.com/innovative-io/io-dicom/jpeglib"
+	"github.com/innovative-io/io-dicom/jpegls"
+	"github.com/innovative-io/io-dicom/openjpeg"
+	"github.com/innovative-io/io-dicom/transcoder"
+)
+
+// TranscodeOption - tunes how ChangeTransferSynx decodes and moves frames between transfer syntaxes
+type TranscodeOption func(*transcodeOptions)
+
+type transcodeOptions struct {
+	pipelined bool
+	workers   int
+	inFlight  int
+	keepYCbCr bool
+}
+
+// WithTranscodeWorkers - decodes and encodes frames on n workers each, frame by frame from the old
+// fragments to the new ones. 0 uses one worker per CPU
+func WithTranscodeWorkers(n int) TranscodeOption {
+	return func(opts *transcodeOptions) {
+		opts.pipelined = true
+		opts.workers = n
+	}
+}
+
+// WithMaxFramesInFlight - caps the number of decoded frames held in memory while transcoding frame
+// by frame. 0 uses two per worker
+func WithMaxFramesInFlight(n int) TranscodeOption {
+	return func(opts *transcodeOptions) {
+		opts.pipelined = true
+		opts.inFlight = n
+	}
+}
+
+// WithNativeYCbCr - leaves YCbCr frames decoded to an uncompressed transfer syntax in YCbCr, written
+// as YBR_FULL, instead of converting them to RGB
+func WithNativeYCbCr() TranscodeOption {
+	return func(opts *transcodeOptions) {
+		opts.keepYCbCr = true
+	}
+}
+
+func newTranscodeOptions(opts []TranscodeOption) transcodeOptions {
+	var options transcodeOptions
+	for _, opt := range opts {
+		opt(&options)
+	}
+	if options.workers <= 0 {
+		options.workers = runtime.NumCPU()
+	}
+	if options.inFlight <= 0 {
+		options.inFlight = 2 * options.workers
+	}
+	return options
+}
+
+// pipelineFrame - a frame travelling from its decoder to its encoder
+type pipelineFrame struct {
+	index int
+	raw   []byte
+}
+
+// frameCodec - decodes or encodes the frame in into out and returns the bytes written. The per-frame
+// entry points take their native context from the codec's pool, so a pipeline worker reuses one
+// context from frame to frame where a batch call of one frame would create and destroy its own
+type frameCodec func(in []byte, out []byte) (int, error)
+
+// pooledFrameDecoder - the decoder frameDecoder picks for ts, one frame at a time, nil when ts is not
+// decoded by a native codec
+func pooledFrameDecoder(ts string, bitsa uint16) frameCodec {
+	var decode func(in []byte, out []byte) error
+	jpeg := func(run func(jpegData []byte, jpegSize uint32, outputData []byte, outputSize uint32) error) func(in []byte, out []byte) error {
+		return func(in []byte, out []byte) error {
+			return run(in, uint32(len(in)), out, uint32(len(out)))
+		}
+	}
+	switch ts {
+	case transfersyntax.JPEGLosslessSV1.UID, transfersyntax.JPEGLossless.UID:
+		if bitsa == 8 {
+			decode = jpeg(jpeglib.DIJG8decode)
+		} else {
+			decode = jpeg(jpeglib.DIJG16decode)
+		}
+	case transfersyntax.JPEGBaseline8Bit.UID:
+		if bitsa == 8 {
+			decode = jpeg(jpeglib.DIJG8decode)
+		} else {
+			decode = jpeg(jpeglib.DIJG12decode)
+		}
+	case transfersyntax.JPEGExtended12Bit.UID:
+		decode = jpeg(jpeglib.DIJG12decode)
+	case transfersyntax.JPEG2000Lossless.UID, transfersyntax.JPEG2000.UID:
+		decode = func(in []byte, out []byte) error {
+			return openjpeg.J2Kdecode(in, uint32(len(in)), out)
+		}
+	case transfersyntax.JPEGLSLossless.UID, transfersyntax.JPEGLSNearLossless.UID:
+		decode = func(in []byte, out []byte) error {
+			return jpegls.JLSdecode(in, uint32(len(in)), out)
+		}
+	default:
+		return nil
+	}
+	return func(in []byte, out []byte) (int, error) {
+		return len(out), decode(in, out)
+	}
+}
+
+// pooledFrameEncoder - the encoder frameEncoder picks for ts, one frame at a time, and the output
+// space a frame is expected to need, nil when ts is not encoded by a native codec
+func pooledFrameEncoder(ts string, RGB bool, cols uint16, rows uint16, bitsa uint16) (frameCodec, int) {
+	_, bound := frameEncoder(ts, RGB, cols, rows, bitsa)
+	samples := uint16(1)
+	if RGB {
+		samples = 3
+	}
+	switch ts {
+	case transfersyntax.JPEGLosslessSV1.UID:
+		if bitsa == 8 {
+			return func(in []byte, out []byte) (int, error) {
+				return jpeglib.EIJG8encodeTo(in, cols, rows, samples, out, 4)
+			}, bound
+		}
+		return func(in []byte, out []byte) (int, error) {
+			return jpeglib.EIJG16encodeTo(in, cols, rows, 1, out, 0)
+		}, bound
+	case transfersyntax.JPEGBaseline8Bit.UID:
+		if RGB || bitsa == 8 {
+			return func(in []byte, out []byte) (int, error) {
+				return jpeglib.EIJG8encodeTo(in, cols, rows, samples, out, 0)
+			}, bound
+		}
+		return func(in []byte, out []byte) (int, error) {
+			return jpeglib.EIJG12encodeTo(in, cols, rows, 1, out, 0)
+		}, bound
+	case transfersyntax.JPEGExtended12Bit.UID:
+		return func(in []byte, out []byte) (int, error) {
+			return jpeglib.EIJG12encodeTo(in, cols, rows, 1, out, 0)
+		}, bound
+	case transfersyntax.JPEG2000Lossless.UID:
+		return func(in []byte, out []byte) (int, error) {
+			return openjpeg.J2KencodeTo(in, cols, rows, samples, bitsa, out, 0)
+		}, bound
+	case transfersyntax.JPEG2000.UID:
+		return func(in []byte, out []byte) (int, error) {
+			return openjpeg.J2KencodeTo(in, cols, rows, samples, bitsa, out, 10)
+		}, bound
+	case transfersyntax.RLELossless.UID:
+		return func(in []byte, out []byte) (int, error) {
+			return transcoder.RLEencodeTo(in, out, cols, rows, samples, bitsa)
+		}, bound
+	case transfersyntax.JPEGLSLossless.UID:
+		return func(in []byte, out []byte) (int, error) {
+			return jpegls.JLSencodeTo(in, cols, rows, samples, bitsa, out, 0)
+		}, bound
+	case transfersyntax.JPEGLSNearLossless.UID:
+		return func(in []byte, out []byte) (int, error) {
+			return jpegls.JLSencodeTo(in, cols, rows, samples, bitsa, out, 2)
+		}, bound
+	}
+	return nil, 0
+}
+
+// transcodeFrames - moves the encapsulated pixel data at i from the current transfer syntax to outTS
+// one frame at a time. Decode workers fill at most inFlight raw frame buffers that encode workers
+// drain, so frame N+1 is decoded while frame N is encoded and the whole volume is never held
+// uncompressed. Frames whose header disagrees with the image tags are refused as in uncompress. The tag list is rebuilt once at the end. Returns false, when the pixel data is not
+// one fragment per frame or either side has no native codec, for the caller to take the serial path
+func (obj *dcmObj) transcodeFrames(i *int, options transcodeOptions, RGB bool, cols uint16, rows uint16, bitsa uint16, frames uint32, outTS string) (bool, error) {
+	decode := pooledFrameDecoder(obj.TransferSyntax.UID, bitsa)
+	encode, bound := pooledFrameEncoder(outTS, RGB, cols, rows, bitsa)
+	if decode == nil || encode == nil {
+		return false, nil
+	}
+	index := *i
+	// pixel data, offset table, one fragment per frame, sequence delimiter
+	end := index + 2 + int(frames)
+	if end >= len(obj.Tags) || obj.Tags[end].Group != 0xFFFE || obj.Tags[end].Element != 0xE0DD {
+		return false, nil
+	}
+	fragments := obj.Tags[index+2 : end]
+
+	single := uint32(cols) * uint32(rows) * uint32(bitsa) / 8
+	if RGB {
+		single = 3 * single
+	}
+	inFlight := options.inFlight
+	if inFlight > int(frames) {
+		inFlight = int(frames)
+	}
+	workers := options.workers
+	if workers > inFlight {
+		workers = inFlight
+	}
+
+	// raw frame buffers, taking one is what bounds the frames in flight
+	free := make(chan []byte, inFlight)
+	for k := 0; k < inFlight; k++ {
+		free <- make([]byte, single)
+	}
+	next := make(chan int)
+	decoded := make(chan pipelineFrame, inFlight)
+	done := make(chan struct{})
+	encoded := make([][]byte, frames)
+	var failOnce sync.Once
+	var failure error
+	fail := func(err error) {
+		failOnce.Do(func() {
+			failure = err
+			close(done)
+		})
+	}
+
+	go func() {
+		defer close(next)
+		for f := 0; f < int(frames); f++ {
+			select {
+			case next <- f:
+			case <-done:
+				return
+			}
+		}
+	}()
+
+	var decoders sync.WaitGroup
+	for w := 0; w < workers; w++ {
+		decoders.Add(1)
+		go func() {
+			defer decoders.Done()
+			for f := range next {
+				var raw []byte
+				select {
+				case raw = <-free:
+				case <-done:
+					return
+				}
+				in := fragments[f].Data[:fragments[f].Length]
+				// the same check as the serial path, before the decoder sees the codestream
+				if size, ok := frameRawSize(obj.TransferSyntax.UID, in, bitsa); ok && size != int(single) {
+					fail(fmt.Errorf("frame %d decodes to %d bytes, the image tags give %d", f, size, single))
+					return
+				}
+				if _, err := decode(in, raw); err != nil {
+					fail(err)
+					return
+				}
+				decoded <- pipelineFrame{index: f, raw: raw}
+			}
+		}()
+	}
+	go func() {
+		decoders.Wait()
+		close(decoded)
+	}()
+
+	var encoders sync.WaitGroup
+	for w := 0; w < workers; w++ {
+		encoders.Add(1)
+		go func() {
+			defer encoders.Done()
+			scratch := make([]byte, bound)
+			for p := range decoded {
+				size, err := encode(p.raw, scratch)
+				if errors.Is(err, jpeglib.ErrBufferTooSmall) || errors.Is(err, openjpeg.ErrBufferTooSmall) || errors.Is(err, jpegls.ErrBufferTooSmall) {
+					scratch = make([]byte, size)
+					size, err = encode(p.raw, scratch)
+				}
+				free <- p.raw
+				if err != nil {
+					fail(err)
+					continue
+				}
+				encoded[p.index] = append([]byte(nil), scratch[:size]...)
+			}
+		}()
+	}
+	encoders.Wait()
+	if failure != nil {
+		return true, failure
+	}
+
+	pixel := obj.Tags[index]
+	pixel.VR = "OB"
+	pixel.Data = nil
+	fresh := make([]*DcmTag, 0, len(obj.Tags))
+	fresh = append(fresh, obj.Tags[:index+1]...)
+	fresh = append(fresh, &DcmTag{
+		Group:     0xFFFE,
+		Element:   0xE000,
+		Length:    0,
+		VR:        "DL",
+		Data:      nil,
+		BigEndian: obj.IsBigEndian(),
+	})
+	for _, data := range encoded {
+		fresh = append(fresh, &DcmTag{
+			Group:     0xFFFE,
+			Element:   0xE000,
+			Length:    uint32(len(data)),
+			VR:        "DL",
+			Data:      data,
+			BigEndian: obj.IsBigEndian(),
+		})
+	}
+	fresh = append(fresh, obj.Tags[end:]...)
+	for _, tag := range fresh[index+1 : index+2+int(frames)] {
+		FillTag(tag)
+	}
+	obj.Tags = fresh
+	*i = index + 2 + int(frames)
+	return true, nil
+}
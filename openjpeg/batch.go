@@ -0,0 +1,140 @@
+package openjpeg
+
+/*
+#include "../jpeglib/dcmjpeg/batch.h"
+
+// defined in j2klib/decomj2k.c and j2klib/comj2k.c, compiled by the platform file
+int J2KDecodeBatch(codec_frame *frames, int count, int threads);
+int J2KEncodeBatch(codec_frame *frames, int count, int image_width, int image_height, int sample_pixel, int bitsallocated, int ratio, int threads);
+*/
+import "C"
+import (
+	"errors"
+	"fmt"
+	"runtime"
+	"unsafe"
+)
+
+// Frame - one frame of a batch call. Input holds the source data and Output receives the result,
+// after the call Size is the number of bytes written to Output and Err the outcome of the frame.
+// Fragments, for decoders, hold the rest of a frame split over several fragments: they are joined
+// on the native worker thread, as the OpenJPEG 1.5 stream reads a single buffer
+type Frame struct {
+	Input     []byte
+	Fragments [][]byte
+	Output    []byte
+	Size      int
+	Err       error
+}
+
+// J2KdecodeBatch - J2K Files to RAW, every frame in one cgo call decoded on up to threads
+// native threads, 0 uses one per CPU. Returns the first frame error
+func J2KdecodeBatch(frames []Frame, threads int) error {
+	for i := range frames {
+		if J2KisHT(frames[i].Input) {
+			frames[i].Size, frames[i].Err = 0, ErrHTJ2K
+			return ErrHTJ2K
+		}
+	}
+	return runBatch(frames, threads, false, "J2Kdecode", func(cframes *C.codec_frame, count C.int, threads C.int) {
+		C.J2KDecodeBatch(cframes, count, threads)
+	})
+}
+
+// J2KencodeBatch - RAW Files to J2K, frames of the same geometry encoded in one cgo call on up to
+// threads native threads, each straight into its Output. A frame whose Output is below
+// J2KencodeBound gets ErrBufferTooSmall with the size it needs. Returns the first frame error
+func J2KencodeBatch(frames []Frame, width uint16, height uint16, samples uint16, bitsa uint16, ratio int, threads int) error {
+	return runBatch(frames, threads, true, "J2KEncode", func(cframes *C.codec_frame, count C.int, threads C.int) {
+		C.J2KEncodeBatch(cframes, count, C.int(width), C.int(height), C.int(samples), C.int(bitsa), C.int(ratio), threads)
+	})
+}
+
+// runBatch - copies the frame descriptors to C memory with their Go buffers pinned, so one cgo
+// call hands every frame to the native threads, then reads the results back
+func runBatch(frames []Frame, threads int, encode bool, name string, run func(cframes *C.codec_frame, count C.int, threads C.int)) error {
+	if len(frames) == 0 {
+		return nil
+	}
+	for i := range frames {
+		if len(frames[i].Input) == 0 || (!encode && len(frames[i].Output) == 0) {
+			return fmt.Errorf("ERROR, %s failed, frame %d has no data", name, i)
+		}
+	}
+	if threads <= 0 {
+		threads = runtime.NumCPU()
+	}
+
+	var pinner runtime.Pinner
+	defer pinner.Unpin()
+	// zeroed: storing a Go pointer over a stale one left in reused C memory makes the write barrier
+	// hand the GC a pointer to a freed object
+	cframes := (*C.codec_frame)(C.calloc(C.size_t(len(frames)), C.size_t(unsafe.Sizeof(C.codec_frame{}))))
+	if cframes == nil {
+		return fmt.Errorf("ERROR, %s failed, out of memory", name)
+	}
+	defer C.free(unsafe.Pointer(cframes))
+	descriptors := unsafe.Slice(cframes, len(frames))
+	// the further fragments of every frame in one C array, each frame points at its own run
+	var fragments []C.codec_fragment
+	count := 0
+	for i := range frames {
+		count += len(frames[i].Fragments)
+	}
+	if count > 0 {
+		cfragments := (*C.codec_fragment)(C.calloc(C.size_t(count), C.size_t(unsafe.Sizeof(C.codec_fragment{}))))
+		if cfragments == nil {
+			return fmt.Errorf("ERROR, %s failed, out of memory", name)
+		}
+		defer C.free(unsafe.Pointer(cfragments))
+		fragments = unsafe.Slice(cfragments, count)
+	}
+	for i := range frames {
+		f := &frames[i]
+		d := &descriptors[i]
+		pinner.Pin(&f.Input[0])
+		d.input = (*C.uchar)(unsafe.Pointer(&f.Input[0]))
+		d.input_size = C.int(len(f.Input))
+		d.output = nil
+		if len(f.Output) > 0 {
+			pinner.Pin(&f.Output[0])
+			d.output = (*C.uchar)(unsafe.Pointer(&f.Output[0]))
+		}
+		d.output_size = C.int(len(f.Output))
+		if len(f.Fragments) > 0 {
+			d.fragments = &fragments[0]
+			d.fragment_count = C.int(len(f.Fragments))
+			for k, fragment := range f.Fragments {
+				if len(fragment) > 0 {
+					pinner.Pin(&fragment[0])
+					fragments[k].data = (*C.uchar)(unsafe.Pointer(&fragment[0]))
+					fragments[k].size = C.int(len(fragment))
+				}
+			}
+			fragments = fragments[len(f.Fragments):]
+		}
+	}
+
+	run(cframes, C.int(len(frames)), C.int(threads))
+
+	var first error
+	for i := range frames {
+		f := &frames[i]
+		d := &descriptors[i]
+		f.Size = int(d.size)
+		f.Err = nil
+		switch {
+		case d.status != 1 && encode && f.Size > len(f.Output):
+			f.Err = ErrBufferTooSmall
+		case d.status != 1:
+			f.Size = 0
+			f.Err = errors.New("ERROR, " + name + " failed")
+		case f.Size <= 0:
+			f.Err = errors.New("ERROR, " + name + " failed")
+		}
+		if first == nil && f.Err != nil {
+			first = f.Err
+		}
+	}
+	return first
+}
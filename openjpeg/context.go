@@ -0,0 +1,157 @@
+package openjpeg
+
+/*
+#include <stdlib.h>
+#include <stdbool.h>
+
+// defined in j2klib/decomj2k.c and j2klib/comj2k.c, compiled by the platform file
+struct J2KDecoderStruct;
+struct J2KDecoderStruct *J2KDecoderCreate(void);
+void J2KDecoderDestroy(struct J2KDecoderStruct *dec);
+bool J2KDecoderDecode(struct J2KDecoderStruct *dec, char *inputdata, int inputlength, char *raw, int rawsize);
+
+struct J2KEncoderStruct;
+struct J2KEncoderStruct *J2KEncoderCreate(void);
+void J2KEncoderDestroy(struct J2KEncoderStruct *enc);
+bool J2KEncoderEncode(struct J2KEncoderStruct *enc, char *raw_data, int image_width, int image_height, int sample_pixel, int bitsallocated, char **jpeg_data, int *encodedlength, int ratio);
+bool J2KEncoderEncodeTo(struct J2KEncoderStruct *enc, char *raw_data, int image_width, int image_height, int sample_pixel, int bitsallocated, char *buffer, int capacity, int *encodedlength, int ratio);
+*/
+import "C"
+import (
+	"errors"
+	"runtime"
+	"sync"
+	"unsafe"
+)
+
+// J2KDecoder - reusable J2K decoder, keeps the decoding parameters and event manager between
+// frames. A decoder is not safe for concurrent use, share it through a sync.Pool
+type J2KDecoder struct {
+	dec *C.struct_J2KDecoderStruct
+}
+
+// J2KEncoder - reusable J2K encoder, keeps the encoding parameters between frames.
+// An encoder is not safe for concurrent use
+type J2KEncoder struct {
+	enc *C.struct_J2KEncoderStruct
+}
+
+// j2kDecoderPool - decoders shared by J2Kdecode across frames and goroutines
+var j2kDecoderPool = sync.Pool{
+	New: func() interface{} {
+		dec, _ := NewJ2KDecoder()
+		return dec
+	},
+}
+
+// j2kEncoderPool - encoders shared by J2Kencode and J2KencodeTo
+var j2kEncoderPool = sync.Pool{
+	New: func() interface{} {
+		enc, _ := NewJ2KEncoder()
+		return enc
+	},
+}
+
+// NewJ2KDecoder - create a reusable J2K decoder
+func NewJ2KDecoder() (*J2KDecoder, error) {
+	dec := C.J2KDecoderCreate()
+	if dec == nil {
+		return nil, errors.New("ERROR, NewJ2KDecoder, can't create decoder")
+	}
+	d := &J2KDecoder{dec: dec}
+	runtime.SetFinalizer(d, (*J2KDecoder).Close)
+	return d, nil
+}
+
+// Decode - J2K File to RAW, fails when the image does not fit in outputData, see J2Kprobe
+func (d *J2KDecoder) Decode(j2kData []byte, j2kSize uint32, outputData []byte) error {
+	if d.dec == nil {
+		return errors.New("ERROR, J2Kdecode, decoder closed")
+	}
+	if len(j2kData) == 0 || len(outputData) == 0 {
+		return errors.New("ERROR, J2Kdecode, JPEG failed")
+	}
+	if J2KisHT(j2kData) {
+		return ErrHTJ2K
+	}
+	ok := C.J2KDecoderDecode(d.dec, (*C.char)(unsafe.Pointer(&j2kData[0])), C.int(j2kSize), (*C.char)(unsafe.Pointer(&outputData[0])), C.int(len(outputData)))
+	runtime.KeepAlive(d)
+	if ok {
+		return nil
+	}
+	return errors.New("ERROR, J2Kdecode, JPEG failed")
+}
+
+// Close - release the C side decoder, it can not be used afterwards
+func (d *J2KDecoder) Close() {
+	if d.dec != nil {
+		C.J2KDecoderDestroy(d.dec)
+		d.dec = nil
+		runtime.SetFinalizer(d, nil)
+	}
+}
+
+// NewJ2KEncoder - create a reusable J2K encoder
+func NewJ2KEncoder() (*J2KEncoder, error) {
+	enc := C.J2KEncoderCreate()
+	if enc == nil {
+		return nil, errors.New("ERROR, NewJ2KEncoder, can't create encoder")
+	}
+	e := &J2KEncoder{enc: enc}
+	runtime.SetFinalizer(e, (*J2KEncoder).Close)
+	return e, nil
+}
+
+// Encode - RAW File to J2K
+func (e *J2KEncoder) Encode(rawData []byte, width uint16, height uint16, samples uint16, bitsa uint16, outData *[]byte, outSize *int, ratio int) error {
+	var j2kData *C.char
+	var j2kSize C.int
+	if e.enc == nil {
+		return errors.New("ERROR, J2KEncode, encoder closed")
+	}
+	ok := C.J2KEncoderEncode(e.enc, (*C.char)(unsafe.Pointer(&rawData[0])), C.int(width), C.int(height), C.int(samples), C.int(bitsa), &j2kData, &j2kSize, C.int(ratio))
+	runtime.KeepAlive(e)
+	if ok {
+		if j2kSize > 0 {
+			*outData = C.GoBytes(unsafe.Pointer(j2kData), j2kSize)
+			*outSize = int(j2kSize)
+			C.free(unsafe.Pointer(j2kData))
+			return nil
+		}
+		C.free(unsafe.Pointer(j2kData))
+	}
+	return errors.New("ERROR, J2KEncode, JPEG failed")
+}
+
+// EncodeTo - RAW File to J2K, written straight into outData. Returns the bytes written,
+// or ErrBufferTooSmall together with the size outData needs, see J2KencodeBound
+func (e *J2KEncoder) EncodeTo(rawData []byte, width uint16, height uint16, samples uint16, bitsa uint16, outData []byte, ratio int) (int, error) {
+	var out *C.char
+	var j2kSize C.int
+	if e.enc == nil {
+		return 0, errors.New("ERROR, J2KEncode, encoder closed")
+	}
+	if len(outData) > 0 {
+		out = (*C.char)(unsafe.Pointer(&outData[0]))
+	}
+	ok := C.J2KEncoderEncodeTo(e.enc, (*C.char)(unsafe.Pointer(&rawData[0])), C.int(width), C.int(height), C.int(samples), C.int(bitsa), out, C.int(len(outData)), &j2kSize, C.int(ratio))
+	runtime.KeepAlive(e)
+	if ok {
+		if j2kSize > 0 {
+			return int(j2kSize), nil
+		}
+	}
+	if int(j2kSize) > len(outData) {
+		return int(j2kSize), ErrBufferTooSmall
+	}
+	return 0, errors.New("ERROR, J2KEncode, JPEG failed")
+}
+
+// Close - release the C side encoder, it can not be used afterwards
+func (e *J2KEncoder) Close() {
+	if e.enc != nil {
+		C.J2KEncoderDestroy(e.enc)
+		e.enc = nil
+		runtime.SetFinalizer(e, nil)
+	}
+}
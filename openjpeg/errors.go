@@ -0,0 +1,11 @@
+package openjpeg
+
+import "errors"
+
+// ErrBufferTooSmall - the output buffer can not hold the encoded frame, the size it needs is returned with it
+var ErrBufferTooSmall = errors.New("ERROR, output buffer too small")
+
+// ErrHTJ2K - the codestream or transfer syntax uses the High-Throughput block coder of JPEG 2000
+// Part 15. OpenJPEG 1.5 has no HT block coder and this package adds none, so HTJ2K frames are
+// neither decoded nor encoded; they are recognised only to be refused instead of decoded as noise
+var ErrHTJ2K = errors.New("ERROR, HTJ2K block coder not supported")
@@ -0,0 +1,48 @@
+package openjpeg
+
+import "encoding/binary"
+
+// J2K main header markers read by J2KisHT
+const (
+	markerSOC = 0xFF4F
+	markerSIZ = 0xFF51
+	markerCAP = 0xFF50
+	markerCOD = 0xFF52
+	markerSOT = 0xFF90
+)
+
+// J2KisHT - whether the main header of the codestream announces the High-Throughput block coder
+// of JPEG 2000 Part 15: Part 15 capabilities in Rsiz, a CAP marker or HT code-blocks in COD.
+// Such frames would decode as noise through the MQ coder of OpenJPEG 1.5, so the decoders
+// refuse them with ErrHTJ2K
+func J2KisHT(j2kData []byte) bool {
+	if len(j2kData) < 4 || binary.BigEndian.Uint16(j2kData) != markerSOC {
+		return false
+	}
+	for pos := 2; pos+4 <= len(j2kData); {
+		marker := binary.BigEndian.Uint16(j2kData[pos:])
+		length := int(binary.BigEndian.Uint16(j2kData[pos+2:]))
+		// the length counts itself, a shorter one is no marker segment and is not read
+		if marker < 0xFF00 || length < 2 {
+			return false
+		}
+		segment := j2kData[pos+4 : min(pos+2+length, len(j2kData))]
+		switch marker {
+		case markerSIZ:
+			if len(segment) >= 2 && binary.BigEndian.Uint16(segment)&0x4000 != 0 {
+				return true
+			}
+		case markerCAP:
+			return true
+		case markerCOD:
+			// Scod, progression, layers, MCT, levels, code-block width and height, code-block style
+			if len(segment) >= 9 && segment[8]&0x40 != 0 {
+				return true
+			}
+		case markerSOT:
+			return false
+		}
+		pos += 2 + length
+	}
+	return false
+}
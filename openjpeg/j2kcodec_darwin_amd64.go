@@ -1,34 +1,46 @@
 package openjpeg
 
 // #cgo CFLAGS: -I j2klib/include -I j2klib/darwin_amd64
-// #cgo LDFLAGS: -L j2klib/darwin_amd64 -lopenjpeg
+// #cgo LDFLAGS: -L j2klib/darwin_amd64 -lopenjpeg -lpthread
 // #include "j2klib/decomj2k.c"
 // #include "j2klib/comj2k.c"
 import  "C"
 import (
 	"errors"
-	"unsafe"
 )
 
 // J2Kdecode - J2K File to RAW
 func J2Kdecode(j2kData []byte, j2kSize uint32, outputData []byte) error {
-	if C.J2KDecode((*C.char)(unsafe.Pointer(&j2kData[0])), C.int(j2kSize), (*C.char)(unsafe.Pointer(&outputData[0]))) {
-		return nil
+	dec, _ := j2kDecoderPool.Get().(*J2KDecoder)
+	if dec == nil {
+		return errors.New("ERROR, J2Kdecode, JPEG failed")
 	}
-	return errors.New("ERROR, J2Kdecode, JPEG failed")
+	defer j2kDecoderPool.Put(dec)
+	return dec.Decode(j2kData, j2kSize, outputData)
 }
 
 // J2Kencode - RAW File to J2K
 func J2Kencode(rawData []byte, width uint16, height uint16, samples uint16, bitsa uint16, outData *[]byte, outSize *int, ratio int) error {
-	var j2kData *C.char
-	var j2kSize C.int
-	if C.J2KEncode((*C.char)(unsafe.Pointer(&rawData[0])), C.int(width), C.int(height), C.int(samples), C.int(bitsa), &j2kData, &j2kSize, C.int(ratio)) {
-		if j2kSize > 0 {
-			*outData = C.GoBytes(unsafe.Pointer(j2kData), j2kSize)
-			* outSize = int(j2kSize)
-			C.free(unsafe.Pointer(j2kData))
-			return nil
-		}
+	enc, _ := j2kEncoderPool.Get().(*J2KEncoder)
+	if enc == nil {
+		return errors.New("ERROR, J2KEncode, JPEG failed")
 	}
-	return errors.New("ERROR, J2KEncode, JPEG failed")
+	defer j2kEncoderPool.Put(enc)
+	return enc.Encode(rawData, width, height, samples, bitsa, outData, outSize, ratio)
+}
+
+// J2KencodeTo - RAW File to J2K, written straight into outData. Returns the bytes written,
+// or ErrBufferTooSmall together with the size outData needs, see J2KencodeBound
+func J2KencodeTo(rawData []byte, width uint16, height uint16, samples uint16, bitsa uint16, outData []byte, ratio int) (int, error) {
+	enc, _ := j2kEncoderPool.Get().(*J2KEncoder)
+	if enc == nil {
+		return 0, errors.New("ERROR, J2KEncode, JPEG failed")
+	}
+	defer j2kEncoderPool.Put(enc)
+	return enc.EncodeTo(rawData, width, height, samples, bitsa, outData, ratio)
+}
+
+// J2KencodeBound - size of the output buffer J2KencodeTo needs for one frame
+func J2KencodeBound(width uint16, height uint16, samples uint16, bitsa uint16) int {
+	return int(C.J2KEncodeBound(C.int(width), C.int(height), C.int(samples), C.int(bitsa)))
 }
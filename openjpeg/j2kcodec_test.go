@@ -1,6 +1,8 @@
 package openjpeg
 
 import (
+	"bytes"
+	"errors"
 	"os"
 	"testing"
 )
@@ -8,6 +10,7 @@ import (
 func Test_J2Kdecode(t *testing.T) {
 	type args struct {
 		fileName string
+		short    int
 	}
 	tests := []struct {
 		name    string
@@ -19,6 +22,11 @@ func Test_J2Kdecode(t *testing.T) {
 			args:    args{fileName: "../samples/test.j2k"},
 			wantErr: false,
 		},
+		{
+			name:    "Should not decode j2k image into a buffer one row short",
+			args:    args{fileName: "../samples/test.j2k", short: 1576 * 3},
+			wantErr: true,
+		},
 	}
 	for _, tt := range tests {
 		t.Run(tt.name, func(t *testing.T) {
@@ -26,12 +34,85 @@ func Test_J2Kdecode(t *testing.T) {
 			var outData []byte
 
 			if LoadFromFile(tt.args.fileName, &jpegData) {
-				outSize := 1576 * 1134 * 3 // Image Size, have to know in advance.
-				outData = make([]byte, outSize)
+				info, err := J2Kprobe(jpegData)
+				if err != nil {
+					t.Fatalf("openjpeg.J2Kprobe() error = %v", err)
+				}
+				outData = make([]byte, info.RawSize()-tt.args.short)
 
 				if err := J2Kdecode(jpegData, uint32(len(jpegData)), outData); (err != nil) != tt.wantErr {
 					t.Errorf("openjpeg.J2Kdecode() error = %v, wantErr %v", err, tt.wantErr)
 				}
+				frames := []Frame{{Input: jpegData, Output: outData}}
+				if err := J2KdecodeBatch(frames, 1); (err != nil) != tt.wantErr {
+					t.Errorf("openjpeg.J2KdecodeBatch() error = %v, wantErr %v", err, tt.wantErr)
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KdecodeBatchFragments(t *testing.T) {
+	var j2kData []byte
+	if !LoadFromFile("../samples/test.j2k", &j2kData) {
+		t.Fatalf("LoadFromFile() failed")
+	}
+	outSize := 1576 * 1134 * 3
+	whole := []Frame{{Input: j2kData, Output: make([]byte, outSize)}}
+	if err := J2KdecodeBatch(whole, 1); err != nil {
+		t.Fatalf("J2KdecodeBatch() error = %v", err)
+	}
+	third := len(j2kData) / 3
+	split := []Frame{{Input: j2kData[:third], Fragments: [][]byte{j2kData[third : 2*third], nil, j2kData[2*third:]}, Output: make([]byte, outSize)}}
+	if err := J2KdecodeBatch(split, 1); err != nil {
+		t.Fatalf("J2KdecodeBatch() fragments error = %v", err)
+	}
+	if !bytes.Equal(split[0].Output, whole[0].Output) {
+		t.Errorf("J2KdecodeBatch() frame from fragments differs from the whole frame")
+	}
+}
+
+func Test_J2Kprobe(t *testing.T) {
+	var j2kData []byte
+	LoadFromFile("../samples/test.j2k", &j2kData)
+	var tiledData []byte
+	LoadFromFile("../samples/tiled.j2k", &tiledData)
+
+	tests := []struct {
+		name    string
+		data    []byte
+		want    J2KInfo
+		wantErr bool
+	}{
+		{
+			name: "Should read the geometry of a single tile codestream",
+			data: j2kData,
+			want: J2KInfo{Width: 1576, Height: 1134, Components: 3, Precision: 8, TileWidth: 1576, TileHeight: 1134, TilesX: 1, TilesY: 1, Levels: 5, Reversible: true},
+		},
+		{
+			name: "Should read the tile grid of a tiled codestream",
+			data: tiledData,
+			want: J2KInfo{Width: 300, Height: 260, Components: 3, Precision: 8, TileWidth: 64, TileHeight: 64, TilesX: 5, TilesY: 5, Levels: 4, Reversible: true},
+		},
+		{
+			name:    "Should not read a main header cut short",
+			data:    j2kData[:40],
+			wantErr: true,
+		},
+		{
+			name:    "Should not read a JPEG file",
+			data:    []byte{0xFF, 0xD8, 0xFF, 0xDB, 0x00, 0x02},
+			wantErr: true,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			got, err := J2Kprobe(tt.data)
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("J2Kprobe() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			if !tt.wantErr && got != tt.want {
+				t.Errorf("J2Kprobe() = %+v, want %+v", got, tt.want)
 			}
 		})
 	}
@@ -67,6 +148,792 @@ func Test_J2Kencode(t *testing.T) {
 	}
 }
 
+func Test_J2KencodeTo(t *testing.T) {
+	type args struct {
+		fileName string
+		ratio    int
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should encode j2k lossy image into a caller buffer",
+			args:    args{fileName: "../samples/test.raw", ratio: 10},
+			wantErr: false,
+		},
+		{
+			name:    "Should encode j2k lossless image into a caller buffer",
+			args:    args{fileName: "../samples/test.raw", ratio: 0},
+			wantErr: false,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var jpegData []byte
+			var jpegSize int
+			rawData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &rawData) {
+				if err := J2Kencode(rawData, 1576, 1134, 3, 8, &jpegData, &jpegSize, tt.args.ratio); err != nil {
+					t.Fatalf("openjpeg.J2Kencode() error = %v", err)
+				}
+				size, err := J2KencodeTo(rawData, 1576, 1134, 3, 8, make([]byte, 1024), tt.args.ratio)
+				if !errors.Is(err, ErrBufferTooSmall) || size != J2KencodeBound(1576, 1134, 3, 8) {
+					t.Fatalf("openjpeg.J2KencodeTo() size = %v, error = %v, want ErrBufferTooSmall", size, err)
+				}
+				outData := make([]byte, size)
+				size, err = J2KencodeTo(rawData, 1576, 1134, 3, 8, outData, tt.args.ratio)
+				if (err != nil) != tt.wantErr {
+					t.Errorf("openjpeg.J2KencodeTo() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				if !bytes.Equal(outData[:size], jpegData) {
+					t.Errorf("openjpeg.J2KencodeTo() output differs from J2Kencode()")
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KEncoder(t *testing.T) {
+	type args struct {
+		fileName string
+		ratios   []int
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should reuse one encoder and decoder across frames",
+			args:    args{fileName: "../samples/test.raw", ratios: []int{0, 10}},
+			wantErr: false,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			rawData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &rawData) {
+				enc, err := NewJ2KEncoder()
+				if err != nil {
+					t.Fatalf("NewJ2KEncoder() error = %v", err)
+				}
+				defer enc.Close()
+				dec, err := NewJ2KDecoder()
+				if err != nil {
+					t.Fatalf("NewJ2KDecoder() error = %v", err)
+				}
+				defer dec.Close()
+				for _, ratio := range tt.args.ratios {
+					var j2kData []byte
+					var j2kSize int
+					if err := enc.Encode(rawData, 1576, 1134, 3, 8, &j2kData, &j2kSize, ratio); (err != nil) != tt.wantErr {
+						t.Fatalf("J2KEncoder.Encode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					outData := make([]byte, len(rawData))
+					if err := dec.Decode(j2kData, uint32(j2kSize), outData); (err != nil) != tt.wantErr {
+						t.Fatalf("J2KDecoder.Decode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					if ratio == 0 && !bytes.Equal(outData, rawData) {
+						t.Errorf("J2KDecoder.Decode() lossless frame differs from the source")
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KencodeBatch(t *testing.T) {
+	type args struct {
+		fileName string
+		count    int
+		threads  int
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should encode and decode a batch of lossless frames on native threads",
+			args:    args{fileName: "../samples/test.raw", count: 4, threads: 2},
+			wantErr: false,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			rawData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &rawData) {
+				var want []byte
+				var wantSize int
+				if err := J2Kencode(rawData, 1576, 1134, 3, 8, &want, &wantSize, 0); err != nil {
+					t.Fatalf("J2Kencode() error = %v", err)
+				}
+				bound := J2KencodeBound(1576, 1134, 3, 8)
+				frames := make([]Frame, tt.args.count)
+				for i := range frames {
+					frames[i].Input = rawData
+					frames[i].Output = make([]byte, bound)
+				}
+				if err := J2KencodeBatch(frames, 1576, 1134, 3, 8, 0, tt.args.threads); (err != nil) != tt.wantErr {
+					t.Fatalf("J2KencodeBatch() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				decoded := make([]Frame, tt.args.count)
+				for i := range frames {
+					if !bytes.Equal(frames[i].Output[:frames[i].Size], want) {
+						t.Errorf("J2KencodeBatch() frame %d output differs from J2Kencode", i)
+					}
+					decoded[i].Input = frames[i].Output[:frames[i].Size]
+					decoded[i].Output = make([]byte, len(rawData))
+				}
+				if err := J2KdecodeBatch(decoded, tt.args.threads); (err != nil) != tt.wantErr {
+					t.Fatalf("J2KdecodeBatch() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				for i := range decoded {
+					if !bytes.Equal(decoded[i].Output, rawData) {
+						t.Errorf("J2KdecodeBatch() frame %d differs from the source", i)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KdecodeSIMD(t *testing.T) {
+	type args struct {
+		fileName string
+		width    uint16
+		height   uint16
+		samples  uint16
+		bitsa    uint16
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should copy out gray 8 bit frames identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1576, height: 850, samples: 1, bitsa: 8},
+			wantErr: false,
+		},
+		{
+			name:    "Should copy out gray 16 bit frames identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1575, height: 425, samples: 1, bitsa: 16},
+			wantErr: false,
+		},
+		{
+			name:    "Should copy out RGB 8 bit frames identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1575, height: 283, samples: 3, bitsa: 8},
+			wantErr: false,
+		},
+	}
+	defer setSIMDLevel(-1)
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			rawData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &rawData) {
+				rawData = rawData[:int(tt.args.width)*int(tt.args.height)*int(tt.args.samples)*int(tt.args.bitsa)/8]
+				var j2kData []byte
+				var j2kSize int
+				if err := J2Kencode(rawData, tt.args.width, tt.args.height, tt.args.samples, tt.args.bitsa, &j2kData, &j2kSize, 0); err != nil {
+					t.Fatalf("J2Kencode() error = %v", err)
+				}
+				for _, level := range []int{simdScalar, simdSSE41, simdAVX2, simdNEON} {
+					if setSIMDLevel(level) != level {
+						continue
+					}
+					outData := make([]byte, len(rawData))
+					if err := J2Kdecode(j2kData, uint32(j2kSize), outData); (err != nil) != tt.wantErr {
+						t.Fatalf("J2Kdecode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					if !bytes.Equal(outData, rawData) {
+						t.Errorf("J2Kdecode() level %d output differs from the source", level)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KencodeSIMD(t *testing.T) {
+	type args struct {
+		fileName string
+		width    uint16
+		height   uint16
+		samples  uint16
+		bitsa    uint16
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should widen gray 8 bit frames identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1575, height: 850, samples: 1, bitsa: 8},
+			wantErr: false,
+		},
+		{
+			name:    "Should widen gray 16 bit frames identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1575, height: 425, samples: 1, bitsa: 16},
+			wantErr: false,
+		},
+		{
+			name:    "Should split RGB 8 bit frames identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1575, height: 283, samples: 3, bitsa: 8},
+			wantErr: false,
+		},
+		{
+			name:    "Should split RGB 16 bit frames identically on every instruction set",
+			args:    args{fileName: "../samples/test.raw", width: 1575, height: 141, samples: 3, bitsa: 16},
+			wantErr: false,
+		},
+	}
+	defer setSIMDLevel(-1)
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			rawData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &rawData) {
+				rawData = rawData[:int(tt.args.width)*int(tt.args.height)*int(tt.args.samples)*int(tt.args.bitsa)/8]
+				setSIMDLevel(simdScalar)
+				var want []byte
+				var wantSize int
+				if err := J2Kencode(rawData, tt.args.width, tt.args.height, tt.args.samples, tt.args.bitsa, &want, &wantSize, 0); err != nil {
+					t.Fatalf("J2Kencode() error = %v", err)
+				}
+				for _, level := range []int{simdSSE41, simdAVX2, simdNEON} {
+					if setSIMDLevel(level) != level {
+						continue
+					}
+					var j2kData []byte
+					var j2kSize int
+					if err := J2Kencode(rawData, tt.args.width, tt.args.height, tt.args.samples, tt.args.bitsa, &j2kData, &j2kSize, 0); (err != nil) != tt.wantErr {
+						t.Fatalf("J2Kencode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					if !bytes.Equal(j2kData, want) {
+						t.Errorf("J2Kencode() level %d codestream differs from the scalar one", level)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KwaveletSIMD(t *testing.T) {
+	type args struct {
+		fileName string
+		width    int
+		height   int
+		crop     int
+		ratio    int
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should run the wavelet transforms of a lossless frame identically on every instruction set",
+			args:    args{fileName: "../samples/tiled.j2k", width: 300, height: 260},
+			wantErr: false,
+		},
+		{
+			name:    "Should run the wavelet transforms of a lossy frame identically on every instruction set",
+			args:    args{fileName: "../samples/tiled.j2k", width: 300, height: 260, ratio: 10},
+			wantErr: false,
+		},
+		{
+			name:    "Should run the wavelet transforms of odd sizes identically on every instruction set",
+			args:    args{fileName: "../samples/tiled.j2k", width: 300, height: 260, crop: 3, ratio: 10},
+			wantErr: false,
+		},
+	}
+	defer setSIMDLevel(-1)
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			j2kData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &j2kData) {
+				setSIMDLevel(simdScalar)
+				rawData := make([]byte, tt.args.width*tt.args.height*3)
+				if err := J2Kdecode(j2kData, uint32(len(j2kData)), rawData); err != nil {
+					t.Fatalf("J2Kdecode() error = %v", err)
+				}
+				// drop the last crop columns and rows
+				width, height := tt.args.width-tt.args.crop, tt.args.height-tt.args.crop
+				for y := 0; y < height; y++ {
+					copy(rawData[y*width*3:(y+1)*width*3], rawData[y*tt.args.width*3:])
+				}
+				rawData = rawData[:width*height*3]
+				var want []byte
+				var wantSize int
+				if err := J2Kencode(rawData, uint16(width), uint16(height), 3, 8, &want, &wantSize, tt.args.ratio); err != nil {
+					t.Fatalf("J2Kencode() error = %v", err)
+				}
+				wantRaw := make([]byte, len(rawData))
+				if err := J2Kdecode(want, uint32(wantSize), wantRaw); err != nil {
+					t.Fatalf("J2Kdecode() error = %v", err)
+				}
+				for _, level := range []int{simdSSE41, simdAVX2, simdNEON} {
+					if setSIMDLevel(level) != level {
+						continue
+					}
+					var outData []byte
+					var outSize int
+					if err := J2Kencode(rawData, uint16(width), uint16(height), 3, 8, &outData, &outSize, tt.args.ratio); (err != nil) != tt.wantErr {
+						t.Fatalf("J2Kencode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					if !bytes.Equal(outData, want) {
+						t.Errorf("J2Kencode() level %d codestream differs from the scalar one", level)
+					}
+					outRaw := make([]byte, len(rawData))
+					if err := J2Kdecode(want, uint32(wantSize), outRaw); (err != nil) != tt.wantErr {
+						t.Fatalf("J2Kdecode() error = %v, wantErr %v", err, tt.wantErr)
+					}
+					if !bytes.Equal(outRaw, wantRaw) {
+						t.Errorf("J2Kdecode() level %d frame differs from the scalar one", level)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KwaveletKernels(t *testing.T) {
+	type args struct {
+		x0, y0, x1, y1 int
+		numresolutions int
+		numres         int
+	}
+	tests := []struct {
+		name string
+		args args
+	}{
+		{
+			name: "Should transform a tile component at the origin",
+			args: args{x0: 0, y0: 0, x1: 64, y1: 64, numresolutions: 6, numres: 6},
+		},
+		{
+			name: "Should transform a tile component with odd offsets and sizes",
+			args: args{x0: 3, y0: 7, x1: 154, y1: 110, numresolutions: 6, numres: 6},
+		},
+		{
+			name: "Should transform a tile component narrower than a vector",
+			args: args{x0: 1, y0: 0, x1: 6, y1: 37, numresolutions: 3, numres: 3},
+		},
+		{
+			name: "Should transform a tile component of one row and one column",
+			args: args{x0: 5, y0: 9, x1: 6, y1: 10, numresolutions: 2, numres: 2},
+		},
+		{
+			name: "Should inverse transform a tile component to a reduced resolution",
+			args: args{x0: 2, y0: 1, x1: 301, y1: 97, numresolutions: 6, numres: 3},
+		},
+	}
+	defer setSIMDLevel(-1)
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			for _, level := range []int{simdSSE41, simdAVX2, simdNEON} {
+				if setSIMDLevel(level) != level {
+					continue
+				}
+				for _, transform := range []int{dwtInverse53, dwtInverse97, dwtForward53, dwtForward97} {
+					numres := tt.args.numres
+					if transform == dwtForward53 || transform == dwtForward97 {
+						numres = tt.args.numresolutions
+					}
+					got := waveletMatches(transform, tt.args.x0, tt.args.y0, tt.args.x1, tt.args.y1, tt.args.numresolutions, numres, uint32(level*4+transform))
+					if got == 0 {
+						t.Errorf("waveletMatches() level %d transform %d differs from OpenJPEG", level, transform)
+					}
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KdecodeReduced(t *testing.T) {
+	type args struct {
+		fileName string
+		level    int
+	}
+	tests := []struct {
+		name       string
+		args       args
+		wantWidth  int
+		wantHeight int
+		wantErr    bool
+	}{
+		{
+			name:       "Should decode the full resolution at level 0",
+			args:       args{fileName: "../samples/test.raw", level: 0},
+			wantWidth:  1576,
+			wantHeight: 1134,
+			wantErr:    false,
+		},
+		{
+			name:       "Should decode a half resolution preview",
+			args:       args{fileName: "../samples/test.raw", level: 1},
+			wantWidth:  788,
+			wantHeight: 567,
+			wantErr:    false,
+		},
+		{
+			name:       "Should decode a quarter resolution preview",
+			args:       args{fileName: "../samples/test.raw", level: 2},
+			wantWidth:  394,
+			wantHeight: 284,
+			wantErr:    false,
+		},
+		{
+			name:    "Should fail beyond the decomposition levels",
+			args:    args{fileName: "../samples/test.raw", level: 12},
+			wantErr: true,
+		},
+	}
+	rawData := make([]byte, 0)
+	var j2kData []byte
+	var j2kSize int
+	if LoadFromFile("../samples/test.raw", &rawData) {
+		if err := J2Kencode(rawData, 1576, 1134, 3, 8, &j2kData, &j2kSize, 0); err != nil {
+			t.Fatalf("J2Kencode() error = %v", err)
+		}
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			outData, width, height, err := J2KdecodeReduced(j2kData, tt.args.level)
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("J2KdecodeReduced() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			if tt.wantErr {
+				return
+			}
+			if width != tt.wantWidth || height != tt.wantHeight || len(outData) != width*height*3 {
+				t.Errorf("J2KdecodeReduced() = %dx%d, %d bytes, want %dx%d", width, height, len(outData), tt.wantWidth, tt.wantHeight)
+			}
+			if tt.args.level == 0 && !bytes.Equal(outData, rawData) {
+				t.Errorf("J2KdecodeReduced() full resolution differs from the source")
+			}
+		})
+	}
+}
+
+func Test_J2KdecodeRegion(t *testing.T) {
+	type args struct {
+		fileName string
+		x        int
+		y        int
+		width    int
+		height   int
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should decode a region inside one tile",
+			args:    args{fileName: "../samples/tiled.j2k", x: 70, y: 60, width: 40, height: 30},
+			wantErr: false,
+		},
+		{
+			name:    "Should decode a region across tiles",
+			args:    args{fileName: "../samples/tiled.j2k", x: 50, y: 40, width: 133, height: 101},
+			wantErr: false,
+		},
+		{
+			name:    "Should decode a region at the image corner",
+			args:    args{fileName: "../samples/tiled.j2k", x: 250, y: 200, width: 50, height: 60},
+			wantErr: false,
+		},
+		{
+			name:    "Should decode a region of an untiled image",
+			args:    args{fileName: "../samples/test.j2k", x: 10, y: 20, width: 300, height: 200},
+			wantErr: false,
+		},
+		{
+			name:    "Should fail for a region outside the image",
+			args:    args{fileName: "../samples/tiled.j2k", x: 250, y: 200, width: 51, height: 60},
+			wantErr: true,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			j2kData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &j2kData) {
+				full, width, _, err := J2KdecodeReduced(j2kData, 0)
+				if err != nil {
+					t.Fatalf("J2KdecodeReduced() error = %v", err)
+				}
+				outData, err := J2KdecodeRegion(j2kData, tt.args.x, tt.args.y, tt.args.width, tt.args.height)
+				if (err != nil) != tt.wantErr {
+					t.Fatalf("J2KdecodeRegion() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				if tt.wantErr {
+					return
+				}
+				// both samples are 8 bit RGB
+				want := make([]byte, 0, tt.args.width*tt.args.height*3)
+				for y := tt.args.y; y < tt.args.y+tt.args.height; y++ {
+					want = append(want, full[3*(y*width+tt.args.x):3*(y*width+tt.args.x+tt.args.width)]...)
+				}
+				if !bytes.Equal(outData, want) {
+					t.Errorf("J2KdecodeRegion() differs from the same region of a full decode")
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KdecodeTile(t *testing.T) {
+	type args struct {
+		fileName string
+		tile     int
+	}
+	tests := []struct {
+		name       string
+		args       args
+		wantX      int
+		wantY      int
+		wantWidth  int
+		wantHeight int
+		wantErr    bool
+	}{
+		{
+			name:       "Should decode the clipped first tile",
+			args:       args{fileName: "../samples/tiled.j2k", tile: 0},
+			wantWidth:  61,
+			wantHeight: 57,
+			wantErr:    false,
+		},
+		{
+			name:       "Should decode an inner tile",
+			args:       args{fileName: "../samples/tiled.j2k", tile: 6},
+			wantX:      61,
+			wantY:      57,
+			wantWidth:  64,
+			wantHeight: 64,
+			wantErr:    false,
+		},
+		{
+			name:       "Should decode the clipped last tile",
+			args:       args{fileName: "../samples/tiled.j2k", tile: 24},
+			wantX:      253,
+			wantY:      249,
+			wantWidth:  47,
+			wantHeight: 11,
+			wantErr:    false,
+		},
+		{
+			name:    "Should fail for a tile outside the grid",
+			args:    args{fileName: "../samples/tiled.j2k", tile: 25},
+			wantErr: true,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			j2kData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &j2kData) {
+				x, y, _, _, err := J2KtileRegion(j2kData, tt.args.tile)
+				if (err != nil) != tt.wantErr {
+					t.Fatalf("J2KtileRegion() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				outData, width, height, err := J2KdecodeTile(j2kData, tt.args.tile)
+				if (err != nil) != tt.wantErr {
+					t.Fatalf("J2KdecodeTile() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				if tt.wantErr {
+					return
+				}
+				if x != tt.wantX || y != tt.wantY || width != tt.wantWidth || height != tt.wantHeight || len(outData) != width*height*3 {
+					t.Errorf("J2KdecodeTile() = %dx%d at %d,%d, want %dx%d at %d,%d", width, height, x, y, tt.wantWidth, tt.wantHeight, tt.wantX, tt.wantY)
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KencodeTiled(t *testing.T) {
+	type args struct {
+		width    uint16
+		height   uint16
+		samples  uint16
+		bitsa    uint16
+		tileSize int
+		ratio    int
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should encode RGB 8 bit tiles in parallel as one codestream",
+			args:    args{width: 300, height: 260, samples: 3, bitsa: 8, tileSize: 64},
+			wantErr: false,
+		},
+		{
+			name:    "Should encode gray 16 bit tiles clipped at the image edge",
+			args:    args{width: 300, height: 390, samples: 1, bitsa: 16, tileSize: 100},
+			wantErr: false,
+		},
+		{
+			name:    "Should encode gray 8 bit lossy tiles",
+			args:    args{width: 600, height: 390, samples: 1, bitsa: 8, tileSize: 128, ratio: 10},
+			wantErr: false,
+		},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			j2kData := make([]byte, 0)
+
+			if LoadFromFile("../samples/tiled.j2k", &j2kData) {
+				rawData := make([]byte, 300*260*3)
+				if err := J2Kdecode(j2kData, uint32(len(j2kData)), rawData); err != nil {
+					t.Fatalf("J2Kdecode() error = %v", err)
+				}
+				var serial, parallel []byte
+				var serialSize, parallelSize int
+				if err := J2KencodeTiled(rawData, tt.args.width, tt.args.height, tt.args.samples, tt.args.bitsa, tt.args.tileSize, &serial, &serialSize, tt.args.ratio, 1); err != nil {
+					t.Fatalf("J2KencodeTiled() error = %v", err)
+				}
+				if err := J2KencodeTiled(rawData, tt.args.width, tt.args.height, tt.args.samples, tt.args.bitsa, tt.args.tileSize, &parallel, &parallelSize, tt.args.ratio, 4); (err != nil) != tt.wantErr {
+					t.Fatalf("J2KencodeTiled() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				if tt.args.ratio == 0 && !bytes.Equal(parallel, serial) {
+					t.Errorf("J2KencodeTiled() parallel codestream differs from the serial one")
+				}
+				size := int(tt.args.width) * int(tt.args.height) * int(tt.args.samples) * int(tt.args.bitsa) / 8
+				outData := make([]byte, size)
+				if err := J2Kdecode(parallel, uint32(len(parallel)), outData); err != nil {
+					t.Fatalf("J2Kdecode() error = %v", err)
+				}
+				if tt.args.ratio == 0 && !bytes.Equal(outData, rawData[:size]) {
+					t.Errorf("J2KencodeTiled() frame does not decode back to the input")
+				}
+				_, _, width, height, err := J2KtileRegion(parallel, 0)
+				if err != nil || width != tt.args.tileSize || height != tt.args.tileSize {
+					t.Errorf("J2KtileRegion() = %dx%d, want %dx%d", width, height, tt.args.tileSize, tt.args.tileSize)
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KdecodeThreads(t *testing.T) {
+	type args struct {
+		fileName string
+		ratio    int
+	}
+	tests := []struct {
+		name    string
+		args    args
+		wantErr bool
+	}{
+		{
+			name:    "Should decode a lossless frame identically on several threads",
+			args:    args{fileName: "../samples/test.j2k"},
+			wantErr: false,
+		},
+		{
+			name:    "Should decode a tiled frame identically on several threads",
+			args:    args{fileName: "../samples/tiled.j2k"},
+			wantErr: false,
+		},
+		{
+			name:    "Should decode a lossy frame identically on several threads",
+			args:    args{fileName: "../samples/tiled.j2k", ratio: 10},
+			wantErr: false,
+		},
+	}
+	dec, err := NewJ2KDecoder()
+	if err != nil {
+		t.Fatalf("NewJ2KDecoder() error = %v", err)
+	}
+	defer dec.Close()
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			j2kData := make([]byte, 0)
+
+			if LoadFromFile(tt.args.fileName, &j2kData) {
+				if tt.args.ratio > 0 {
+					rawData := make([]byte, 300*260*3)
+					if err := J2Kdecode(j2kData, uint32(len(j2kData)), rawData); err != nil {
+						t.Fatalf("J2Kdecode() error = %v", err)
+					}
+					var outSize int
+					if err := J2Kencode(rawData, 300, 260, 3, 8, &j2kData, &outSize, tt.args.ratio); err != nil {
+						t.Fatalf("J2Kencode() error = %v", err)
+					}
+				}
+				dec.SetThreads(1)
+				want, _, _, err := dec.DecodeReduced(j2kData, 0)
+				if err != nil {
+					t.Fatalf("DecodeReduced() error = %v", err)
+				}
+				dec.SetThreads(4)
+				outData, _, _, err := dec.DecodeReduced(j2kData, 0)
+				if (err != nil) != tt.wantErr {
+					t.Fatalf("DecodeReduced() error = %v, wantErr %v", err, tt.wantErr)
+				}
+				if !bytes.Equal(outData, want) {
+					t.Errorf("DecodeReduced() frame decoded on 4 threads differs from the single threaded one")
+				}
+			}
+		})
+	}
+}
+
+func Test_J2KisHT(t *testing.T) {
+	var j2kData []byte
+	LoadFromFile("../samples/test.j2k", &j2kData)
+	// the same codestream with the HT code-block style set in COD
+	htData := append([]byte(nil), j2kData...)
+	cod := bytes.Index(htData, []byte{0xFF, 0x52})
+	htData[cod+12] |= 0x40
+
+	tests := []struct {
+		name    string
+		data    []byte
+		want    bool
+		wantErr error
+	}{
+		{name: "Should decode a Part 1 codestream", data: j2kData, want: false, wantErr: nil},
+		{name: "Should refuse HT code-blocks", data: htData, want: true, wantErr: ErrHTJ2K},
+		{name: "Should take a CAP marker for HTJ2K", data: []byte{0xFF, 0x4F, 0xFF, 0x50, 0x00, 0x02}, want: true},
+		{name: "Should stop at a marker length of zero", data: []byte{0xFF, 0x4F, 0xFF, 0x51, 0x00, 0x00, 0x00, 0x00}, want: false},
+		{name: "Should stop at a marker length of one", data: []byte{0xFF, 0x4F, 0xFF, 0x51, 0x00, 0x01, 0x40, 0x00}, want: false},
+		{name: "Should stop at a segment cut short", data: []byte{0xFF, 0x4F, 0xFF, 0x52, 0x00, 0x0C, 0x00}, want: false},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			if got := J2KisHT(tt.data); got != tt.want {
+				t.Fatalf("J2KisHT() = %v, want %v", got, tt.want)
+			}
+			if len(tt.data) < 100 {
+				return
+			}
+			outData := make([]byte, 1576*1134*3)
+			if err := J2Kdecode(tt.data, uint32(len(tt.data)), outData); !errors.Is(err, tt.wantErr) {
+				t.Errorf("J2Kdecode() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			frames := []Frame{{Input: tt.data, Output: outData}}
+			if err := J2KdecodeBatch(frames, 1); !errors.Is(err, tt.wantErr) {
+				t.Errorf("J2KdecodeBatch() error = %v, wantErr %v", err, tt.wantErr)
+			}
+		})
+	}
+}
+
 func LoadFromFile(FileName string, buffer *[]byte) bool {
 	file, err := os.Open(FileName)
 	if err != nil {
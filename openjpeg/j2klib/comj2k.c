@@ -5,6 +5,8 @@
 #include <assert.h>
 #include <string.h>
 #include "openjpeg.h"
+#include "../../jpeglib/dcmjpeg/batch.h"
+#include "region.h"
 
 #define J2K_CFMT 0
 
@@ -22,58 +24,41 @@ typedef  unsigned int        uint32_t;
  */
 extern int int_ceildivpow2(int a, int b);
 
+#include "deinterleave.h"
+
+/*
+ * The 8 and 16 bit fills split the whole frame in one run, each component plane holds w * h
+ * samples. Gray frames are widened in bulk, RGB frames split and widened by the kernels.
+ */
+static void rawtoimg_planes(opj_image_t *image, int numcomps, int **planes) {
+  for(int compno = 0; compno < numcomps; compno++)
+    planes[compno] = image->comps[compno].data;
+}
+
 void rawtoimg_fill8(int8_t *inputbuffer, int w, int h, int numcomps, opj_image_t *image) {
-  int8_t *p = inputbuffer;
-  for (int i = 0; i < w * h; i++)
-    {
-    for(int compno = 0; compno < numcomps; compno++)
-      {
-      /* compno : 0 = GREY, (0, 1, 2) = (R, G, B) */
-      image->comps[compno].data[i] = *p;
-      ++p;
-      }
-    }
+  int *planes[3];
+  rawtoimg_planes(image, numcomps, planes);
+  deinterleave8(j2k_simd_level(), (uint8_t *)inputbuffer, 1, numcomps, planes, w * h);
 }
 
 void rawtoimg_fillu8(uint8_t *inputbuffer, int w, int h, int numcomps, opj_image_t *image) {
-  uint8_t *p = inputbuffer;
-  for (int i = 0; i < w * h; i++)
-    {
-    for(int compno = 0; compno < numcomps; compno++)
-      {
-      /* compno : 0 = GREY, (0, 1, 2) = (R, G, B) */
-      image->comps[compno].data[i] = *p;
-      ++p;
-      }
-    }
+  int *planes[3];
+  rawtoimg_planes(image, numcomps, planes);
+  deinterleave8(j2k_simd_level(), inputbuffer, 0, numcomps, planes, w * h);
 }
 
 void rawtoimg_fill16(int16_t *inputbuffer, int w, int h, int numcomps, opj_image_t *image)
 {
-  int16_t *p = inputbuffer;
-  for (int i = 0; i < w * h; i++)
-    {
-    for(int compno = 0; compno < numcomps; compno++)
-      {
-      /* compno : 0 = GREY, (0, 1, 2) = (R, G, B) */
-      image->comps[compno].data[i] = *p;
-      ++p;
-      }
-    }
+  int *planes[3];
+  rawtoimg_planes(image, numcomps, planes);
+  deinterleave16(j2k_simd_level(), (uint16_t *)inputbuffer, 1, numcomps, planes, w * h);
 }
 
 void rawtoimg_fillu16(uint16_t *inputbuffer, int w, int h, int numcomps, opj_image_t *image)
 {
-  uint16_t *p = inputbuffer;
-  for (int i = 0; i < w * h; i++)
-    {
-    for(int compno = 0; compno < numcomps; compno++)
-      {
-      /* compno : 0 = GREY, (0, 1, 2) = (R, G, B) */
-      image->comps[compno].data[i] = *p;
-      ++p;
-      }
-    }
+  int *planes[3];
+  rawtoimg_planes(image, numcomps, planes);
+  deinterleave16(j2k_simd_level(), inputbuffer, 0, numcomps, planes, w * h);
 }
 
 void rawtoimg_fill32(int32_t *inputbuffer, int w, int h, int numcomps, opj_image_t *image)
@@ -200,42 +185,108 @@ opj_image_t* rawtoimage(char *inputbuffer, opj_cparameters_t *parameters, int im
 }
 
 /*
- * The following function was copy paste from image_to_j2k.c with part from convert.c
+ * Size of the working buffer OpenJPEG allocates for one frame when it owns the output,
+ * see opj_cio_open: 1.3 times the raw bits and 2000 bytes for the headers.
+ * Handing the encoder a buffer of this size gives the same codestream it would produce itself.
  */
-
-bool J2KEncode(char *raw_data, int image_width, int image_height, int sample_pixel, int bitsallocated, char **jpeg_data, int *encodedlength, int ratio)
+int J2KEncodeBound(int image_width, int image_height, int sample_pixel, int bitsallocated)
 {
-//// input_buffer is ONE image
-//// fragment_size is the size of this image (fragment)
-  bool bSuccess;
+  return (int) (0.1625 * image_width * image_height * sample_pixel * bitsallocated + 2000);
+}
+
+/*
+ * Reusable encoder: keeps the default encoding parameters, the comment and the event manager
+ * between frames. The OpenJPEG 1.5 codec handle only encodes a single image, so it is created
+ * per frame from a copy of these parameters.
+ */
+typedef struct J2KEncoderStruct {
   opj_cparameters_t parameters;  /* compression parameters */
   opj_event_mgr_t event_mgr;    /* event manager */
-  opj_image_t *image = NULL;
-  //quality = 100;
+} J2KEncoder;
 
+static void j2k_encoder_init(J2KEncoder *enc)
+{
   /*
   configure the event callbacks (not required)
   setting of each callback is optionnal
   */
-  memset(&event_mgr, 0, sizeof(opj_event_mgr_t));
+  memset(&enc->event_mgr, 0, sizeof(opj_event_mgr_t));
 //  event_mgr.error_handler = error_callback;
 //  event_mgr.warning_handler = warning_callback;
 //  event_mgr.info_handler = info_callback;
 
   /* set encoding parameters to default values */
-  memset(&parameters, 0, sizeof(parameters));
-  opj_set_default_encoder_parameters(&parameters);
+  memset(&enc->parameters, 0, sizeof(enc->parameters));
+  opj_set_default_encoder_parameters(&enc->parameters);
+
+  if(enc->parameters.cp_comment == NULL) {
+    const char comment[] = "Created by OpenJPEG version 1.5";
+    enc->parameters.cp_comment = (char*)malloc(strlen(comment) + 1);
+    if(enc->parameters.cp_comment) strcpy(enc->parameters.cp_comment, comment);
+  }
+}
+
+static void j2k_encoder_release(J2KEncoder *enc)
+{
+  if(enc->parameters.cp_comment) free(enc->parameters.cp_comment);
+  enc->parameters.cp_comment = NULL;
+}
+
+J2KEncoder *J2KEncoderCreate(void)
+{
+  J2KEncoder *enc = (J2KEncoder *)malloc(sizeof(J2KEncoder));
+  if (enc != NULL)
+    j2k_encoder_init(enc);
+  return enc;
+}
+
+void J2KEncoderDestroy(J2KEncoder *enc)
+{
+  if (enc == NULL)
+    return;
+  j2k_encoder_release(enc);
+  free(enc);
+}
+
+/* Tile grid of a tiled encode, the image starts at x0, y0 on the reference grid */
+typedef struct {
+  int tile_width;
+  int tile_height;
+  int x0;
+  int y0;
+  int numresolution;
+} j2k_tiling;
+
+/*
+ * The following function was copy paste from image_to_j2k.c with part from convert.c
+ *
+ * Encodes one frame into buffer when it is given (length bytes, at least J2KEncodeBound),
+ * otherwise into a buffer OpenJPEG allocates that is handed back through jpeg_data.
+ * With tiling the frame is cut into tiles, the grid anchored at the image origin.
+ */
+static bool j2k_encode(J2KEncoder *enc, char *raw_data, int image_width, int image_height, int sample_pixel, int bitsallocated,
+ unsigned char *buffer, int length, char **jpeg_data, int *encodedlength, int ratio, const j2k_tiling *tiling)
+{
+//// input_buffer is ONE image
+//// fragment_size is the size of this image (fragment)
+  bool bSuccess;
+  opj_cparameters_t parameters = enc->parameters;  /* compression parameters, the comment stays with enc */
+  opj_image_t *image = NULL;
+  //quality = 100;
 
    parameters.tcp_rates[0] = ratio;
   parameters.tcp_numlayers = 1;
   parameters.cp_disto_alloc = 1;
-
-  if(parameters.cp_comment == NULL) {
-    const char comment[] = "Created by OpenJPEG version 1.5";
-    parameters.cp_comment = (char*)malloc(strlen(comment) + 1);
-    strcpy(parameters.cp_comment, comment);
-    /* no need to delete parameters.cp_comment on exit */
-    //delete_comment = false;
+  if (tiling != NULL) {
+    parameters.tile_size_on = 1;
+    parameters.cp_tdx = tiling->tile_width;
+    parameters.cp_tdy = tiling->tile_height;
+    parameters.cp_tx0 = tiling->x0;
+    parameters.cp_ty0 = tiling->y0;
+    parameters.image_offset_x0 = tiling->x0;
+    parameters.image_offset_y0 = tiling->y0;
+    if (parameters.numresolution > tiling->numresolution)
+      parameters.numresolution = tiling->numresolution;
   }
 
   /* decode the source image */
@@ -256,44 +307,282 @@ bool J2KEncode(char *raw_data, int image_width, int image_height, int sample_pix
     opj_cinfo_t* cinfo = opj_create_compress(CODEC_J2K);
 
     /* catch events using our callbacks and give a local context */
-//    opj_set_event_mgr((opj_common_ptr)cinfo, &event_mgr, stderr);
+//    opj_set_event_mgr((opj_common_ptr)cinfo, &enc->event_mgr, stderr);
 
     /* setup the encoder parameters using the current image and using user parameters */
     opj_setup_encoder(cinfo, &parameters, image);
 
     /* open a byte stream for writing */
-    /* allocate memory for all tiles */
-    cio = opj_cio_open((opj_common_ptr)cinfo, NULL, 0);
+    /* write into the caller buffer, or let OpenJPEG allocate memory for all tiles */
+    if (buffer != NULL)
+      cio = opj_cio_open((opj_common_ptr)cinfo, buffer, length);
+    else
+      cio = opj_cio_open((opj_common_ptr)cinfo, NULL, 0);
 
     /* encode the image */
-    bSuccess = opj_encode(cinfo, cio, image, parameters.index);
-    if (!bSuccess) {
-      opj_cio_close(cio);
-      return false;
+    bSuccess = cio != NULL && opj_encode(cinfo, cio, image, parameters.index);
+    if (bSuccess) {
+      codestream_length = cio_tell(cio);
+      *encodedlength=codestream_length;
+      if (buffer == NULL) {
+#if defined(_WIN32)
+        /* the DLL allocates from its own heap, the caller frees with ours */
+        *jpeg_data = (char *)malloc(codestream_length);
+        bSuccess = *jpeg_data != NULL;
+        if (bSuccess)
+          memcpy(*jpeg_data, (char *)(cio->buffer), codestream_length);
+#else
+        /* keep the byte stream buffer for the caller instead of copying it, a stream opened
+           for reading does not free its buffer on close */
+        *jpeg_data = (char *)(cio->buffer);
+        cio->openmode = OPJ_STREAM_READ;
+#endif
+      }
     }
-    codestream_length = cio_tell(cio);
-
-    *jpeg_data = (char *)malloc(codestream_length);
-    *encodedlength=codestream_length;
-    printf("Encoded Length %d\r\n", codestream_length);
-    memcpy(*jpeg_data, (char *)(cio->buffer), codestream_length);
 //    fwrite((char*)(cio->buffer), codestream_length,1, fp);
 
     /* close and free the byte stream */
-    opj_cio_close(cio);
+    if (cio != NULL)
+      opj_cio_close(cio);
 
     /* free remaining compression structures */
     opj_destroy_compress(cinfo);
 
-      /* free user parameters structure */
-  //if(delete_comment) {
-    if(parameters.cp_comment) free(parameters.cp_comment);
-  //}
+      /* free user parameters structure, the comment belongs to the encoder */
   if(parameters.cp_matrice) free(parameters.cp_matrice);
 
   /* free image data */
   opj_image_destroy(image);
-  return true;
+  return bSuccess;
+}
+
+bool J2KEncoderEncode(J2KEncoder *enc, char *raw_data, int image_width, int image_height, int sample_pixel, int bitsallocated, char **jpeg_data, int *encodedlength, int ratio)
+{
+  return j2k_encode(enc, raw_data, image_width, image_height, sample_pixel, bitsallocated, NULL, 0, jpeg_data, encodedlength, ratio, NULL);
+}
+
+/*
+ * Encodes one frame straight into the caller's buffer. When capacity is below J2KEncodeBound
+ * nothing is encoded and encodedlength is set to the size the buffer needs.
+ */
+bool J2KEncoderEncodeTo(J2KEncoder *enc, char *raw_data, int image_width, int image_height, int sample_pixel, int bitsallocated, char *buffer, int capacity, int *encodedlength, int ratio)
+{
+  int bound = J2KEncodeBound(image_width, image_height, sample_pixel, bitsallocated);
+  if (buffer == NULL || capacity < bound) {
+    *encodedlength = bound;
+    return false;
+  }
+  return j2k_encode(enc, raw_data, image_width, image_height, sample_pixel, bitsallocated, (unsigned char *)buffer, capacity, NULL, encodedlength, ratio, NULL);
+}
+
+/* frame geometry shared by every frame of an encoder batch */
+typedef struct {
+  int image_width;
+  int image_height;
+  int sample_pixel;
+  int bitsallocated;
+  int ratio;
+} j2k_encoder_batch_args;
+
+static void *j2k_encoder_batch_create(void)
+{
+  return J2KEncoderCreate();
+}
+
+static void j2k_encoder_batch_destroy(void *ctx)
+{
+  J2KEncoderDestroy((J2KEncoder *) ctx);
+}
+
+static void j2k_encoder_batch_frame(void *ctx, codec_frame *frame, const void *args)
+{
+  const j2k_encoder_batch_args *a = (const j2k_encoder_batch_args *) args;
+  frame->status = J2KEncoderEncodeTo((J2KEncoder *) ctx, (char *) frame->input, a->image_width, a->image_height, a->sample_pixel, a->bitsallocated,
+    (char *) frame->output, frame->output_size, &frame->size, a->ratio);
+}
+
+/*
+ * Encodes count frames of the same geometry on up to threads native threads, each one straight into
+ * its output buffer. A frame with a size larger than output_size did not fit, see J2KEncoderEncodeTo.
+ * Returns the number of frames that failed.
+ */
+int J2KEncodeBatch(codec_frame *frames, int count, int image_width, int image_height, int sample_pixel, int bitsallocated, int ratio, int threads)
+{
+  j2k_encoder_batch_args args = {image_width, image_height, sample_pixel, bitsallocated, ratio};
+  codec_batch batch = {frames, count, 0, j2k_encoder_batch_create, j2k_encoder_batch_destroy, j2k_encoder_batch_frame, &args};
+  return codec_batch_run(&batch, threads);
+}
+
+/* frame and tile grid shared by the tiles of a tiled encode */
+typedef struct {
+  char *raw_data;
+  int image_width;
+  int image_height;
+  int sample_pixel;
+  int bitsallocated;
+  int ratio;
+  int tile_size;
+  int tiles_across;
+  int numresolution;
+  codec_frame *tiles;
+} j2k_tiled_args;
+
+/*
+ * Encodes one tile as a codestream of its own. The tile keeps its position on the reference grid
+ * and is the only tile of its grid, so its tile-parts are the ones a tiled encode of the whole
+ * frame writes for it.
+ */
+static void j2k_tiled_frame(void *ctx, codec_frame *frame, const void *args)
+{
+  const j2k_tiled_args *a = (const j2k_tiled_args *) args;
+  int tileno = (int)(frame - a->tiles);
+  int x0 = (tileno % a->tiles_across) * a->tile_size;
+  int y0 = (tileno / a->tiles_across) * a->tile_size;
+  int w = a->image_width - x0 < a->tile_size ? a->image_width - x0 : a->tile_size;
+  int h = a->image_height - y0 < a->tile_size ? a->image_height - y0 : a->tile_size;
+  int sample = a->bitsallocated <= 8 ? 1 : a->bitsallocated <= 16 ? 2 : 4;
+  int row = w * a->sample_pixel * sample;
+  int stride = a->image_width * a->sample_pixel * sample;
+  j2k_tiling tiling = {a->tile_size, a->tile_size, x0, y0, a->numresolution};
+  char *tile_data = NULL;
+
+  /* the tile rows, contiguous as rawtoimage reads them */
+  char *raw = (char *)malloc((size_t)row * h);
+  if (raw == NULL)
+    return;
+  for (int y = 0; y < h; y++)
+    memcpy(raw + (size_t)y * row, a->raw_data + (size_t)(y0 + y) * stride + (size_t)x0 * a->sample_pixel * sample, row);
+  frame->status = j2k_encode((J2KEncoder *) ctx, raw, w, h, a->sample_pixel, a->bitsallocated, NULL, 0, &tile_data, &frame->size, a->ratio, &tiling);
+  frame->output = (unsigned char *)tile_data;
+  free(raw);
+}
+
+/*
+ * Stitches the single tile codestreams into one: the main header of the first tile with SIZ
+ * widened to the whole frame, then the tile-parts of every tile numbered by their place in the
+ * grid. Returns NULL when the tiles do not share their coding parameters.
+ */
+static char *j2k_stitch_tiles(codec_frame *tiles, int count, int image_width, int image_height, int *length)
+{
+  j2k_siz first, siz;
+  int total = 0;
+  int n, header;
+
+  if (!j2k_read_siz(tiles[0].output, tiles[0].size, &first))
+    return NULL;
+  header = first.offset + 2 + (int)j2k_read16(tiles[0].output + first.offset + 2);
+  for (int t = 0; t < count; t++) {
+    const unsigned char *cs = tiles[t].output;
+    if (!j2k_read_siz(cs, tiles[t].size, &siz) || siz.main_end - siz.offset != first.main_end - first.offset)
+      return NULL;
+    /* COD, QCD and the rest of the main header after SIZ */
+    if (memcmp(cs + header, tiles[0].output + header, first.main_end - header) != 0)
+      return NULL;
+    total += tiles[t].size - siz.main_end;
+  }
+
+  unsigned char *out = (unsigned char *)malloc(first.main_end + total + 2);
+  if (out == NULL)
+    return NULL;
+  memcpy(out, tiles[0].output, first.main_end);
+  unsigned char *p = out + first.offset + 4;
+  j2k_write32(p + 2, image_width);
+  j2k_write32(p + 6, image_height);
+  j2k_write32(p + 10, 0);
+  j2k_write32(p + 14, 0);
+  j2k_write32(p + 26, 0);
+  j2k_write32(p + 30, 0);
+  n = first.main_end;
+
+  for (int t = 0; t < count; t++) {
+    const unsigned char *cs = tiles[t].output;
+    int pos = first.main_end;
+    int end = tiles[t].size;
+    if (end >= 2 && j2k_read16(cs + end - 2) == J2K_MARKER_EOC)
+      end -= 2;
+    while (pos + 12 <= end && j2k_read16(cs + pos) == J2K_MARKER_SOT) {
+      int psot = (int)j2k_read32(cs + pos + 6);
+      int size = psot != 0 ? psot : end - pos;
+      if (size < 14 || pos + size > end) {
+        free(out);
+        return NULL;
+      }
+      memcpy(out + n, cs + pos, size);
+      j2k_write16(out + n + 4, (unsigned int)t);
+      n += size;
+      pos += size;
+    }
+  }
+  j2k_write16(out + n, J2K_MARKER_EOC);
+  *length = n + 2;
+  return (char *)out;
+}
+
+/*
+ * Encodes one frame cut into tiles of tile_size x tile_size. With more than one thread the tiles
+ * are encoded in parallel, each on its own, and stitched into one codestream; lossless that is the
+ * codestream OpenJPEG writes for the tiled frame. One thread, or tiles that could not be stitched,
+ * leave the tiling to OpenJPEG. The codestream is handed back through jpeg_data, freed with free.
+ */
+bool J2KEncoderEncodeTiled(J2KEncoder *enc, char *raw_data, int image_width, int image_height, int sample_pixel, int bitsallocated, int tile_size, char **jpeg_data, int *encodedlength, int ratio, int threads)
+{
+  j2k_tiling tiling = {tile_size, tile_size, 0, 0, 0};
+  int across, down, count, smallest;
+  bool result = false;
+
+  if (tile_size <= 0 || (tile_size >= image_width && tile_size >= image_height))
+    return J2KEncoderEncode(enc, raw_data, image_width, image_height, sample_pixel, bitsallocated, jpeg_data, encodedlength, ratio);
+  across = (image_width + tile_size - 1) / tile_size;
+  down = (image_height + tile_size - 1) / tile_size;
+  count = across * down;
+  /* OpenJPEG 1.5 writes tile-parts it can not read back for tiles off the grid origin that are
+     smaller than their lowest resolution, the clipped edge tiles bound the decompositions */
+  smallest = tile_size;
+  if (image_width - (across - 1) * tile_size < smallest)
+    smallest = image_width - (across - 1) * tile_size;
+  if (image_height - (down - 1) * tile_size < smallest)
+    smallest = image_height - (down - 1) * tile_size;
+  tiling.numresolution = 1;
+  while ((1 << tiling.numresolution) <= smallest)
+    tiling.numresolution++;
+  if (threads > 1 && count > 1) {
+    codec_frame *tiles = (codec_frame *)calloc(count, sizeof(codec_frame));
+    if (tiles != NULL) {
+      j2k_tiled_args args = {raw_data, image_width, image_height, sample_pixel, bitsallocated, ratio, tile_size, across, tiling.numresolution, tiles};
+      codec_batch batch = {tiles, count, 0, j2k_encoder_batch_create, j2k_encoder_batch_destroy, j2k_tiled_frame, &args};
+      if (codec_batch_run(&batch, threads) == 0) {
+        *jpeg_data = j2k_stitch_tiles(tiles, count, image_width, image_height, encodedlength);
+        result = *jpeg_data != NULL;
+      }
+      for (int t = 0; t < count; t++)
+        if (tiles[t].output != NULL)
+          free(tiles[t].output);
+      free(tiles);
+    }
+    if (result)
+      return true;
+  }
+  return j2k_encode(enc, raw_data, image_width, image_height, sample_pixel, bitsallocated, NULL, 0, jpeg_data, encodedlength, ratio, &tiling);
+}
+
+bool J2KEncode(char *raw_data, int image_width, int image_height, int sample_pixel, int bitsallocated, char **jpeg_data, int *encodedlength, int ratio)
+{
+  J2KEncoder enc;
+  bool result;
+  j2k_encoder_init(&enc);
+  result = J2KEncoderEncode(&enc, raw_data, image_width, image_height, sample_pixel, bitsallocated, jpeg_data, encodedlength, ratio);
+  j2k_encoder_release(&enc);
+  return result;
+}
+
+bool J2KEncodeTo(char *raw_data, int image_width, int image_height, int sample_pixel, int bitsallocated, char *buffer, int capacity, int *encodedlength, int ratio)
+{
+  J2KEncoder enc;
+  bool result;
+  j2k_encoder_init(&enc);
+  result = J2KEncoderEncodeTo(&enc, raw_data, image_width, image_height, sample_pixel, bitsallocated, buffer, capacity, encodedlength, ratio);
+  j2k_encoder_release(&enc);
+  return result;
 }
 
 /*
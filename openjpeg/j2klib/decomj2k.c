@@ -6,6 +6,7 @@
 #include <assert.h>
 
 #include "openjpeg.h"
+#include "../../jpeglib/dcmjpeg/batch.h"
 
 #define J2K_CFMT 0
 #define JP2_CFMT 1
@@ -32,117 +33,293 @@ int int_ceildivpow2(int a, int b) {
   return (a + (1 << b) - 1) >> b;
 }
 
+#include "interleave.h"
+#include "region.h"
+#include "t1threads.h"
+#include "wavelet.h"
+
 /*
- * The following function was copy paste from j2k_to_image.c with part from convert.c
+ * Reusable decoder: keeps the decoding parameters and the event manager between frames.
+ * The OpenJPEG 1.5 codec handle only decodes a single codestream, so it is created per frame.
  */
-bool J2KDecode(char *inputdata, int inputlength, char *raw){
+typedef struct J2KDecoderStruct {
   opj_dparameters_t parameters;  /* decompression parameters */
   opj_event_mgr_t event_mgr;    /* event manager */
-  opj_image_t *image;
-  opj_dinfo_t* dinfo;  /* handle to a decompressor */
-  opj_cio_t *cio;
-  unsigned char *src = (unsigned char*)inputdata;
-  int file_length = inputlength;
+  int threads;                  /* T1 threads, 0 for the default of J2KSetDecodeThreads */
+} J2KDecoder;
 
+static void j2k_decoder_init(J2KDecoder *dec) {
   /* configure the event callbacks (not required) */
-  memset(&event_mgr, 0, sizeof(opj_event_mgr_t));
+  memset(&dec->event_mgr, 0, sizeof(opj_event_mgr_t));
 //  event_mgr.error_handler = error_callback;
 //  event_mgr.warning_handler = warning_callback;
 //  event_mgr.info_handler = info_callback;
 
   /* set decoding parameters to default values */
-  opj_set_default_decoder_parameters(&parameters);
- 
+  opj_set_default_decoder_parameters(&dec->parameters);
+
    // default blindly copied
-   parameters.cp_layer=0;
-   parameters.cp_reduce=0;
+   dec->parameters.cp_layer=0;
+   dec->parameters.cp_reduce=0;
 //   parameters.decod_format=-1;
 //   parameters.cod_format=-1;
 
      /* JPEG-2000 codestream */
-     parameters.decod_format = J2K_CFMT;
-     assert(parameters.decod_format == J2K_CFMT);
+     dec->parameters.decod_format = J2K_CFMT;
+     assert(dec->parameters.decod_format == J2K_CFMT);
+  dec->parameters.cod_format = PGX_DFMT;
+  assert(dec->parameters.cod_format == PGX_DFMT);
+  dec->threads = 0;
+}
+
+J2KDecoder *J2KDecoderCreate(void) {
+  J2KDecoder *dec = (J2KDecoder *)malloc(sizeof(J2KDecoder));
+  if (dec != NULL)
+    j2k_decoder_init(dec);
+  return dec;
+}
+
+void J2KDecoderDestroy(J2KDecoder *dec) {
+  free(dec);
+}
+
+/* Sets the threads decoding the code-blocks of a tile component, 0 for the default */
+void J2KDecoderSetThreads(J2KDecoder *dec, int threads) {
+  dec->threads = threads < 0 ? 0 : threads;
+}
+
+/*
+ * The following function was copy paste from j2k_to_image.c with part from convert.c
+ * Decodes the codestream leaving out the reduce highest resolution levels, 0 decodes it whole.
+ */
+static opj_image_t *j2k_decode_image(J2KDecoder *dec, char *inputdata, int inputlength, int reduce){
+  opj_image_t *image;
+  opj_dinfo_t* dinfo;  /* handle to a decompressor */
+  opj_cio_t *cio;
+  unsigned char *src = (unsigned char*)inputdata;
+  int file_length = inputlength;
+
       /* get a decoder handle */
       dinfo = opj_create_decompress(CODEC_J2K);
-  parameters.cod_format = PGX_DFMT;
-  assert(parameters.cod_format == PGX_DFMT);
-
 
       /* catch events using our callbacks and give a local context */
-      opj_set_event_mgr((opj_common_ptr)dinfo, &event_mgr, NULL);
+      opj_set_event_mgr((opj_common_ptr)dinfo, &dec->event_mgr, NULL);
 
       /* setup the decoder decoding parameters using user parameters */
-      opj_setup_decoder(dinfo, &parameters);
+      dec->parameters.cp_reduce = reduce;
+      opj_setup_decoder(dinfo, &dec->parameters);
+      dec->parameters.cp_reduce = 0;
 
       /* open a byte stream */
       cio = opj_cio_open((opj_common_ptr)dinfo, src, file_length);
 
-      /* decode the stream and fill the image structure */
+      /* decode the stream and fill the image structure, the T1 threads for t1threads.h */
+      j2k_t1_threads = dec->threads;
       image = opj_decode(dinfo, cio);
-      if(!image) {
-        opj_destroy_decompress(dinfo);
-        opj_cio_close(cio);
-        return 1;
-      }
-      
+      j2k_t1_threads = 0;
+
       /* close the byte stream */
       opj_cio_close(cio);
 
-   // Copy buffer
-   for (int compno = 0; compno < image->numcomps; compno++)
-   {
-      opj_image_comp_t *comp = &image->comps[compno];
-
-      int w = image->comps[compno].w;
-      int wr = int_ceildivpow2(image->comps[compno].w, image->comps[compno].factor);
-
-      //int h = image.comps[compno].h;
-      int hr = int_ceildivpow2(image->comps[compno].h, image->comps[compno].factor);
-
-      if (comp->prec <= 8)
-      {
-         uint8_t *data8 = (uint8_t*)raw + compno;
-         for (int i = 0; i < wr * hr; i++)
-         {
-            int v = image->comps[compno].data[i / wr * w + i % wr];
-            *data8 = (uint8_t)v;
-            data8 += image->numcomps;
-         }
-      }
-      else if (comp->prec <= 16)
-      {
-         uint16_t *data16 = (uint16_t*)raw + compno;
-         for (int i = 0; i < wr * hr; i++)
-         {
-            int v = image->comps[compno].data[i / wr * w + i % wr];
-            *data16 = (int16_t)v;
-            data16 += image->numcomps;
-         }
-      }
-      else
-      {
-         uint32_t *data32 = (uint32_t*)raw + compno;
-         for (int i = 0; i < wr * hr; i++)
-         {
-            int v = image->comps[compno].data[i / wr * w + i % wr];
-            *data32 = (uint32_t)v;
-            data32 += image->numcomps;
-         }
-      }
-      //free(image.comps[compno].data);
-   }
-
-
   /* free remaining structures */
   if(dinfo) {
     opj_destroy_decompress(dinfo);
   }
 
+  return image;
+}
+
+/* bytes interleave_image writes for the decoded image */
+static long long j2k_image_raw_size(opj_image_t *image) {
+  long long size = 0;
+  for (int compno = 0; compno < image->numcomps; compno++)
+  {
+    opj_image_comp_t *comp = &image->comps[compno];
+    int bytes = comp->prec <= 8 ? 1 : comp->prec <= 16 ? 2 : 4;
+    size += (long long)comp->w * comp->h * bytes;
+  }
+  return size;
+}
+
+/*
+ * Decodes the codestream into raw, which holds rawsize bytes. The frame is refused when the image
+ * does not fit, the size the caller took from the DICOM tags can disagree with the codestream.
+ */
+bool J2KDecoderDecode(J2KDecoder *dec, char *inputdata, int inputlength, char *raw, int rawsize){
+  opj_image_t *image = j2k_decode_image(dec, inputdata, inputlength, 0);
+  if(!image) {
+    return false;
+  }
+  if(j2k_image_raw_size(image) > rawsize) {
+    puts("ERROR, J2KDecoderDecode, rawsize < image size");
+    opj_image_destroy(image);
+    return false;
+  }
+
+   // Copy buffer
+   interleave_image(image, raw);
+
   /* free image data structure */
   opj_image_destroy(image);
 
   return true;
 }
+
+/*
+ * Decodes a preview at 1/2^reduce of the full size: OpenJPEG stops the inverse DWT early and
+ * skips the code-blocks of the dropped resolutions. The raw frame is allocated here, the
+ * caller releases it with free.
+ */
+bool J2KDecoderDecodeReduced(J2KDecoder *dec, char *inputdata, int inputlength, int reduce, char **raw, int *rawsize, int *width, int *height){
+  opj_image_t *image = j2k_decode_image(dec, inputdata, inputlength, reduce);
+  if(!image) {
+    return false;
+  }
+
+  int size = (int)j2k_image_raw_size(image);
+  *width = image->comps[0].w;
+  *height = image->comps[0].h;
+  *rawsize = size;
+  *raw = (char *)malloc(size > 0 ? size : 1);
+  if(*raw == NULL) {
+    opj_image_destroy(image);
+    return false;
+  }
+  interleave_image(image, *raw);
+  opj_image_destroy(image);
+
+  return true;
+}
+
+/*
+ * Decodes the region of w x h samples at x, y from the top left corner of the image, into a raw
+ * frame allocated here and released by the caller with free. Only the tiles the region touches
+ * are decoded, see region.h; a codestream that can not be taken apart is decoded whole and
+ * cropped. Images with subsampled or mixed components are not supported.
+ */
+bool J2KDecoderDecodeRegion(J2KDecoder *dec, char *inputdata, int inputlength, int x, int y, int w, int h, char **raw, int *rawsize){
+  const unsigned char *cs = (const unsigned char *)inputdata;
+  unsigned char *tiles;
+  int tileslength = 0;
+  j2k_siz siz;
+
+  if(!j2k_read_siz(cs, inputlength, &siz) || siz.subsampled || siz.mixed) {
+    return false;
+  }
+  if(x < 0 || y < 0 || w <= 0 || h <= 0 || (unsigned int)(x + w) > siz.x1 - siz.x0 || (unsigned int)(y + h) > siz.y1 - siz.y0) {
+    return false;
+  }
+
+  /* region and the tiles it touches on the reference grid */
+  unsigned int ax0 = siz.x0 + x, ay0 = siz.y0 + y;
+  unsigned int ax1 = ax0 + w, ay1 = ay0 + h;
+  int p0 = (ax0 - siz.tx0) / siz.tdx, p1 = (ax1 - 1 - siz.tx0) / siz.tdx;
+  int q0 = (ay0 - siz.ty0) / siz.tdy, q1 = (ay1 - 1 - siz.ty0) / siz.tdy;
+  unsigned int ux0 = siz.x0, uy0 = siz.y0;
+
+  opj_image_t *image;
+  tiles = j2k_extract_tiles(cs, inputlength, &siz, p0, q0, p1, q1, &tileslength);
+  if(tiles != NULL) {
+    unsigned int tx0 = j2k_tile_start(siz.tx0, siz.tdx, p0, siz.x1), ty0 = j2k_tile_start(siz.ty0, siz.tdy, q0, siz.y1);
+    ux0 = tx0 > siz.x0 ? tx0 : siz.x0;
+    uy0 = ty0 > siz.y0 ? ty0 : siz.y0;
+    image = j2k_decode_image(dec, (char *)tiles, tileslength, 0);
+    free(tiles);
+  } else {
+    image = j2k_decode_image(dec, inputdata, inputlength, 0);
+  }
+  if(!image) {
+    return false;
+  }
+
+  int cx = ax0 - ux0, cy = ay0 - uy0;
+  if(cx + w > image->comps[0].w || cy + h > image->comps[0].h) {
+    opj_image_destroy(image);
+    return false;
+  }
+  int bytes = image->comps[0].prec <= 8 ? 1 : image->comps[0].prec <= 16 ? 2 : 4;
+  *rawsize = w * h * image->numcomps * bytes;
+  *raw = (char *)malloc(*rawsize);
+  if(*raw == NULL) {
+    opj_image_destroy(image);
+    return false;
+  }
+  interleave_window(image, *raw, cx, cy, w, h);
+  opj_image_destroy(image);
+
+  return true;
+}
+
+/*
+ * Position and size of a tile in samples from the top left corner of the image, tiles are
+ * numbered across then down. Returns false for a tile outside the grid.
+ */
+bool J2KTileRegion(char *inputdata, int inputlength, int tile, int *x, int *y, int *w, int *h){
+  j2k_siz siz;
+
+  if(!j2k_read_siz((const unsigned char *)inputdata, inputlength, &siz) || tile < 0 || tile >= siz.tw * siz.th) {
+    return false;
+  }
+  unsigned int tx0 = j2k_tile_start(siz.tx0, siz.tdx, tile % siz.tw, siz.x1), ty0 = j2k_tile_start(siz.ty0, siz.tdy, tile / siz.tw, siz.y1);
+  unsigned int tx1 = j2k_tile_start(siz.tx0, siz.tdx, tile % siz.tw + 1, siz.x1), ty1 = j2k_tile_start(siz.ty0, siz.tdy, tile / siz.tw + 1, siz.y1);
+  if(tx0 < siz.x0) tx0 = siz.x0;
+  if(ty0 < siz.y0) ty0 = siz.y0;
+  *x = tx0 - siz.x0;
+  *y = ty0 - siz.y0;
+  *w = tx1 - tx0;
+  *h = ty1 - ty0;
+  return true;
+}
+
+static void *j2k_decoder_batch_create(void) {
+  return J2KDecoderCreate();
+}
+
+static void j2k_decoder_batch_destroy(void *ctx) {
+  J2KDecoderDestroy((J2KDecoder *) ctx);
+}
+
+/*
+ * The OpenJPEG 1.5 cio reads one memory buffer and has no callbacks to stream through, so a frame
+ * split over several fragments is joined on the worker thread, in C memory, and freed right after.
+ */
+static void j2k_decoder_batch_frame(void *ctx, codec_frame *frame, const void *args) {
+  unsigned char *input = frame->input;
+  int input_size = frame->input_size;
+
+  if (frame->fragment_count > 0) {
+    for (int f = 0; f < frame->fragment_count; f++)
+      input_size += frame->fragments[f].size;
+    input = (unsigned char *)malloc(input_size);
+    if (input == NULL) {
+      frame->status = 0;
+      frame->size = 0;
+      return;
+    }
+    memcpy(input, frame->input, frame->input_size);
+    for (int f = 0, n = frame->input_size; f < frame->fragment_count; n += frame->fragments[f++].size)
+      memcpy(input + n, frame->fragments[f].data, frame->fragments[f].size);
+  }
+  frame->status = J2KDecoderDecode((J2KDecoder *) ctx, (char *) input, input_size, (char *) frame->output, frame->output_size);
+  frame->size = frame->status ? frame->output_size : 0;
+  if (input != frame->input)
+    free(input);
+}
+
+/*
+ * Decodes count frames on up to threads native threads, returns the number of frames that failed.
+ */
+int J2KDecodeBatch(codec_frame *frames, int count, int threads) {
+  codec_batch batch = {frames, count, 0, j2k_decoder_batch_create, j2k_decoder_batch_destroy, j2k_decoder_batch_frame, NULL};
+  return codec_batch_run(&batch, threads);
+}
+
+bool J2KDecode(char *inputdata, int inputlength, char *raw, int rawsize){
+  J2KDecoder dec;
+  j2k_decoder_init(&dec);
+  return J2KDecoderDecode(&dec, inputdata, inputlength, raw, rawsize);
+}
+
 /*
 int FileSize(FILE *fp){
   int size;
@@ -0,0 +1,269 @@
+#ifndef J2KLIB_DEINTERLEAVE_H
+#define J2KLIB_DEINTERLEAVE_H
+
+#include "simd.h"
+
+/*
+ * Kernels splitting an interleaved raw frame of 1 or 3 components into the OpenJPEG component
+ * planes, widening every sample to an int. sgnd selects sign extension of the raw samples.
+ */
+
+static void deinterleave8_scalar(const uint8_t *src, int sgnd, int numcomps, int **planes, int n) {
+  for (int x = 0; x < n; x++)
+    for (int compno = 0; compno < numcomps; compno++, src++)
+      planes[compno][x] = sgnd ? (int)(int8_t)*src : (int)*src;
+}
+
+static void deinterleave16_scalar(const uint16_t *src, int sgnd, int numcomps, int **planes, int n) {
+  for (int x = 0; x < n; x++)
+    for (int compno = 0; compno < numcomps; compno++, src++)
+      planes[compno][x] = sgnd ? (int)(int16_t)*src : (int)*src;
+}
+
+#if defined(J2K_SIMD_X86)
+
+/* widens 16 bytes to 16 ints */
+J2K_TARGET_SSE41 static inline void widen8_sse41(__m128i v, int sgnd, int *dst) {
+  for (int k = 0; k < 4; k++) {
+    __m128i w = sgnd ? _mm_cvtepi8_epi32(v) : _mm_cvtepu8_epi32(v);
+    _mm_storeu_si128((__m128i *)(dst + 4 * k), w);
+    v = _mm_srli_si128(v, 4);
+  }
+}
+
+/* widens 8 words to 8 ints */
+J2K_TARGET_SSE41 static inline void widen16_sse41(__m128i v, int sgnd, int *dst) {
+  __m128i lo = sgnd ? _mm_cvtepi16_epi32(v) : _mm_cvtepu16_epi32(v);
+  __m128i hi = sgnd ? _mm_cvtepi16_epi32(_mm_srli_si128(v, 8)) : _mm_cvtepu16_epi32(_mm_srli_si128(v, 8));
+  _mm_storeu_si128((__m128i *)dst, lo);
+  _mm_storeu_si128((__m128i *)(dst + 4), hi);
+}
+
+/* splits 48 interleaved bytes, 16 pixels, into three byte planes */
+J2K_TARGET_SSE41 static inline void split8_sse41(const uint8_t *src, __m128i *r, __m128i *g, __m128i *b) {
+  __m128i a0 = _mm_loadu_si128((const __m128i *)src);
+  __m128i a1 = _mm_loadu_si128((const __m128i *)(src + 16));
+  __m128i a2 = _mm_loadu_si128((const __m128i *)(src + 32));
+  *r = _mm_or_si128(_mm_or_si128(
+      _mm_shuffle_epi8(a0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))),
+      _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)));
+  *g = _mm_or_si128(_mm_or_si128(
+      _mm_shuffle_epi8(a0, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))),
+      _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)));
+  *b = _mm_or_si128(_mm_or_si128(
+      _mm_shuffle_epi8(a0, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))),
+      _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)));
+}
+
+/* splits 48 interleaved bytes, 8 pixels of 16 bit, into three word planes */
+J2K_TARGET_SSE41 static inline void split16_sse41(const uint16_t *src, __m128i *r, __m128i *g, __m128i *b) {
+  __m128i a0 = _mm_loadu_si128((const __m128i *)src);
+  __m128i a1 = _mm_loadu_si128((const __m128i *)(src + 8));
+  __m128i a2 = _mm_loadu_si128((const __m128i *)(src + 16));
+  *r = _mm_or_si128(_mm_or_si128(
+      _mm_shuffle_epi8(a0, _mm_setr_epi8(0, 1, 6, 7, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 3, 8, 9, 14, 15, -1, -1, -1, -1))),
+      _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 4, 5, 10, 11)));
+  *g = _mm_or_si128(_mm_or_si128(
+      _mm_shuffle_epi8(a0, _mm_setr_epi8(2, 3, 8, 9, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 4, 5, 10, 11, -1, -1, -1, -1, -1, -1))),
+      _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 6, 7, 12, 13)));
+  *b = _mm_or_si128(_mm_or_si128(
+      _mm_shuffle_epi8(a0, _mm_setr_epi8(4, 5, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, 0, 1, 6, 7, 12, 13, -1, -1, -1, -1, -1, -1))),
+      _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 3, 8, 9, 14, 15)));
+}
+
+J2K_TARGET_SSE41 static void deinterleave8_sse41(const uint8_t *src, int sgnd, int numcomps, int **planes, int n) {
+  int x = 0;
+  if (numcomps == 1) {
+    for (; x + 16 <= n; x += 16)
+      widen8_sse41(_mm_loadu_si128((const __m128i *)(src + x)), sgnd, planes[0] + x);
+  } else if (numcomps == 3) {
+    for (; x + 16 <= n; x += 16) {
+      __m128i r, g, b;
+      split8_sse41(src + 3 * x, &r, &g, &b);
+      widen8_sse41(r, sgnd, planes[0] + x);
+      widen8_sse41(g, sgnd, planes[1] + x);
+      widen8_sse41(b, sgnd, planes[2] + x);
+    }
+  }
+  int *tail[3] = {planes[0] + x, numcomps > 1 ? planes[1] + x : NULL, numcomps > 2 ? planes[2] + x : NULL};
+  deinterleave8_scalar(src + numcomps * x, sgnd, numcomps, tail, n - x);
+}
+
+J2K_TARGET_SSE41 static void deinterleave16_sse41(const uint16_t *src, int sgnd, int numcomps, int **planes, int n) {
+  int x = 0;
+  if (numcomps == 1) {
+    for (; x + 8 <= n; x += 8)
+      widen16_sse41(_mm_loadu_si128((const __m128i *)(src + x)), sgnd, planes[0] + x);
+  } else if (numcomps == 3) {
+    for (; x + 8 <= n; x += 8) {
+      __m128i r, g, b;
+      split16_sse41(src + 3 * x, &r, &g, &b);
+      widen16_sse41(r, sgnd, planes[0] + x);
+      widen16_sse41(g, sgnd, planes[1] + x);
+      widen16_sse41(b, sgnd, planes[2] + x);
+    }
+  }
+  int *tail[3] = {planes[0] + x, numcomps > 1 ? planes[1] + x : NULL, numcomps > 2 ? planes[2] + x : NULL};
+  deinterleave16_scalar(src + numcomps * x, sgnd, numcomps, tail, n - x);
+}
+
+/* widens 16 bytes to 16 ints */
+J2K_TARGET_AVX2 static inline void widen8_avx2(__m128i v, int sgnd, int *dst) {
+  __m128i hi = _mm_srli_si128(v, 8);
+  _mm256_storeu_si256((__m256i *)dst, sgnd ? _mm256_cvtepi8_epi32(v) : _mm256_cvtepu8_epi32(v));
+  _mm256_storeu_si256((__m256i *)(dst + 8), sgnd ? _mm256_cvtepi8_epi32(hi) : _mm256_cvtepu8_epi32(hi));
+}
+
+/* widens 8 words to 8 ints */
+J2K_TARGET_AVX2 static inline void widen16_avx2(__m128i v, int sgnd, int *dst) {
+  _mm256_storeu_si256((__m256i *)dst, sgnd ? _mm256_cvtepi16_epi32(v) : _mm256_cvtepu16_epi32(v));
+}
+
+J2K_TARGET_AVX2 static void deinterleave8_avx2(const uint8_t *src, int sgnd, int numcomps, int **planes, int n) {
+  int x = 0;
+  if (numcomps == 1) {
+    for (; x + 16 <= n; x += 16)
+      widen8_avx2(_mm_loadu_si128((const __m128i *)(src + x)), sgnd, planes[0] + x);
+  } else if (numcomps == 3) {
+    for (; x + 16 <= n; x += 16) {
+      __m128i r, g, b;
+      split8_sse41(src + 3 * x, &r, &g, &b);
+      widen8_avx2(r, sgnd, planes[0] + x);
+      widen8_avx2(g, sgnd, planes[1] + x);
+      widen8_avx2(b, sgnd, planes[2] + x);
+    }
+  }
+  int *tail[3] = {planes[0] + x, numcomps > 1 ? planes[1] + x : NULL, numcomps > 2 ? planes[2] + x : NULL};
+  deinterleave8_scalar(src + numcomps * x, sgnd, numcomps, tail, n - x);
+}
+
+J2K_TARGET_AVX2 static void deinterleave16_avx2(const uint16_t *src, int sgnd, int numcomps, int **planes, int n) {
+  int x = 0;
+  if (numcomps == 1) {
+    for (; x + 8 <= n; x += 8)
+      widen16_avx2(_mm_loadu_si128((const __m128i *)(src + x)), sgnd, planes[0] + x);
+  } else if (numcomps == 3) {
+    for (; x + 8 <= n; x += 8) {
+      __m128i r, g, b;
+      split16_sse41(src + 3 * x, &r, &g, &b);
+      widen16_avx2(r, sgnd, planes[0] + x);
+      widen16_avx2(g, sgnd, planes[1] + x);
+      widen16_avx2(b, sgnd, planes[2] + x);
+    }
+  }
+  int *tail[3] = {planes[0] + x, numcomps > 1 ? planes[1] + x : NULL, numcomps > 2 ? planes[2] + x : NULL};
+  deinterleave16_scalar(src + numcomps * x, sgnd, numcomps, tail, n - x);
+}
+
+#elif defined(J2K_SIMD_NEON)
+
+/* widens 16 bytes to 16 ints */
+static inline void widen8_neon(uint8x16_t v, int sgnd, int *dst) {
+  if (sgnd) {
+    int16x8_t lo = vmovl_s8(vget_low_s8(vreinterpretq_s8_u8(v)));
+    int16x8_t hi = vmovl_s8(vget_high_s8(vreinterpretq_s8_u8(v)));
+    vst1q_s32(dst, vmovl_s16(vget_low_s16(lo)));
+    vst1q_s32(dst + 4, vmovl_s16(vget_high_s16(lo)));
+    vst1q_s32(dst + 8, vmovl_s16(vget_low_s16(hi)));
+    vst1q_s32(dst + 12, vmovl_s16(vget_high_s16(hi)));
+  } else {
+    uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+    uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+    vst1q_s32(dst, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(lo))));
+    vst1q_s32(dst + 4, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(lo))));
+    vst1q_s32(dst + 8, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(hi))));
+    vst1q_s32(dst + 12, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(hi))));
+  }
+}
+
+/* widens 8 words to 8 ints */
+static inline void widen16_neon(uint16x8_t v, int sgnd, int *dst) {
+  if (sgnd) {
+    int16x8_t s = vreinterpretq_s16_u16(v);
+    vst1q_s32(dst, vmovl_s16(vget_low_s16(s)));
+    vst1q_s32(dst + 4, vmovl_s16(vget_high_s16(s)));
+  } else {
+    vst1q_s32(dst, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v))));
+    vst1q_s32(dst + 4, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(v))));
+  }
+}
+
+static void deinterleave8_neon(const uint8_t *src, int sgnd, int numcomps, int **planes, int n) {
+  int x = 0;
+  if (numcomps == 1) {
+    for (; x + 16 <= n; x += 16)
+      widen8_neon(vld1q_u8(src + x), sgnd, planes[0] + x);
+  } else if (numcomps == 3) {
+    for (; x + 16 <= n; x += 16) {
+      uint8x16x3_t rgb = vld3q_u8(src + 3 * x);
+      widen8_neon(rgb.val[0], sgnd, planes[0] + x);
+      widen8_neon(rgb.val[1], sgnd, planes[1] + x);
+      widen8_neon(rgb.val[2], sgnd, planes[2] + x);
+    }
+  }
+  int *tail[3] = {planes[0] + x, numcomps > 1 ? planes[1] + x : NULL, numcomps > 2 ? planes[2] + x : NULL};
+  deinterleave8_scalar(src + numcomps * x, sgnd, numcomps, tail, n - x);
+}
+
+static void deinterleave16_neon(const uint16_t *src, int sgnd, int numcomps, int **planes, int n) {
+  int x = 0;
+  if (numcomps == 1) {
+    for (; x + 8 <= n; x += 8)
+      widen16_neon(vld1q_u16(src + x), sgnd, planes[0] + x);
+  } else if (numcomps == 3) {
+    for (; x + 8 <= n; x += 8) {
+      uint16x8x3_t rgb = vld3q_u16(src + 3 * x);
+      widen16_neon(rgb.val[0], sgnd, planes[0] + x);
+      widen16_neon(rgb.val[1], sgnd, planes[1] + x);
+      widen16_neon(rgb.val[2], sgnd, planes[2] + x);
+    }
+  }
+  int *tail[3] = {planes[0] + x, numcomps > 1 ? planes[1] + x : NULL, numcomps > 2 ? planes[2] + x : NULL};
+  deinterleave16_scalar(src + numcomps * x, sgnd, numcomps, tail, n - x);
+}
+
+#endif
+
+static void deinterleave8(int level, const uint8_t *src, int sgnd, int numcomps, int **planes, int n) {
+  switch (level) {
+#if defined(J2K_SIMD_X86)
+  case J2K_SIMD_AVX2:
+    deinterleave8_avx2(src, sgnd, numcomps, planes, n);
+    return;
+  case J2K_SIMD_SSE41:
+    deinterleave8_sse41(src, sgnd, numcomps, planes, n);
+    return;
+#elif defined(J2K_SIMD_NEON)
+  case J2K_SIMD_NEON:
+    deinterleave8_neon(src, sgnd, numcomps, planes, n);
+    return;
+#endif
+  }
+  deinterleave8_scalar(src, sgnd, numcomps, planes, n);
+}
+
+static void deinterleave16(int level, const uint16_t *src, int sgnd, int numcomps, int **planes, int n) {
+  switch (level) {
+#if defined(J2K_SIMD_X86)
+  case J2K_SIMD_AVX2:
+    deinterleave16_avx2(src, sgnd, numcomps, planes, n);
+    return;
+  case J2K_SIMD_SSE41:
+    deinterleave16_sse41(src, sgnd, numcomps, planes, n);
+    return;
+#elif defined(J2K_SIMD_NEON)
+  case J2K_SIMD_NEON:
+    deinterleave16_neon(src, sgnd, numcomps, planes, n);
+    return;
+#endif
+  }
+  deinterleave16_scalar(src, sgnd, numcomps, planes, n);
+}
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ * Wavelet transforms on DWT_LANES rows or columns at once, included by wavelet.h once per
+ * instruction set with these defined:
+ *
+ *   DWT_NAME(x)          name of x for the instruction set
+ *   DWT_TARGET           target attribute of the functions
+ *   DWT_LANES            lanes of a vector
+ *   DWT_VI, DWT_VF       int and float vectors, DWT_VI_U an int vector at any address
+ *   DWT_FIX_MUL(v, b)    fix_mul of fix.h on every lane
+ *   DWT_LIFT(w, s, c)    w + s * c, rounded like the library's 9/7 lifting step
+ *
+ * Each lane runs the arithmetic of dwt.c in OpenJPEG 1.5 on one row or column, lanes past the
+ * edge of the tile carry zeros and are not written back.
+ */
+
+/* Inverse 5/3 in 1-D, dwt_decode_1_ */
+static DWT_TARGET void DWT_NAME(dwt_decode_1)(DWT_VI *a, int dn, int sn, int cas) {
+  int i;
+  if (!cas) {
+    if ((dn > 0) || (sn > 1)) {
+      for (i = 0; i < sn; i++) DWT_S(i) -= (DWT_D_(i - 1) + DWT_D_(i) + 2) >> 2;
+      for (i = 0; i < dn; i++) DWT_D(i) += (DWT_S_(i) + DWT_S_(i + 1)) >> 1;
+    }
+  } else {
+    if (!sn && dn == 1)
+      DWT_S(0) /= 2;
+    else {
+      for (i = 0; i < sn; i++) DWT_D(i) -= (DWT_SS_(i) + DWT_SS_(i + 1) + 2) >> 2;
+      for (i = 0; i < dn; i++) DWT_S(i) += (DWT_DD_(i) + DWT_DD_(i - 1)) >> 1;
+    }
+  }
+}
+
+/* Forward 5/3 in 1-D, dwt_encode_1 */
+static DWT_TARGET void DWT_NAME(dwt_encode_1)(DWT_VI *a, int dn, int sn, int cas) {
+  int i;
+  if (!cas) {
+    if ((dn > 0) || (sn > 1)) {
+      for (i = 0; i < dn; i++) DWT_D(i) -= (DWT_S_(i) + DWT_S_(i + 1)) >> 1;
+      for (i = 0; i < sn; i++) DWT_S(i) += (DWT_D_(i - 1) + DWT_D_(i) + 2) >> 2;
+    }
+  } else {
+    if (!sn && dn == 1)
+      DWT_S(0) *= 2;
+    else {
+      for (i = 0; i < dn; i++) DWT_S(i) -= (DWT_DD_(i) + DWT_DD_(i - 1)) >> 1;
+      for (i = 0; i < sn; i++) DWT_D(i) += (DWT_SS_(i) + DWT_SS_(i + 1) + 2) >> 2;
+    }
+  }
+}
+
+/* Forward 9/7 in 1-D, dwt_encode_1_real: fixed point lifting */
+static DWT_TARGET void DWT_NAME(dwt_encode_1_real)(DWT_VI *a, int dn, int sn, int cas) {
+  int i;
+  if (!cas) {
+    if ((dn > 0) || (sn > 1)) {
+      for (i = 0; i < dn; i++) DWT_D(i) -= DWT_FIX_MUL(DWT_S_(i) + DWT_S_(i + 1), 12993);
+      for (i = 0; i < sn; i++) DWT_S(i) -= DWT_FIX_MUL(DWT_D_(i - 1) + DWT_D_(i), 434);
+      for (i = 0; i < dn; i++) DWT_D(i) += DWT_FIX_MUL(DWT_S_(i) + DWT_S_(i + 1), 7233);
+      for (i = 0; i < sn; i++) DWT_S(i) += DWT_FIX_MUL(DWT_D_(i - 1) + DWT_D_(i), 3633);
+      for (i = 0; i < dn; i++) DWT_D(i) = DWT_FIX_MUL(DWT_D(i), 5038);
+      for (i = 0; i < sn; i++) DWT_S(i) = DWT_FIX_MUL(DWT_S(i), 6659);
+    }
+  } else {
+    if ((sn > 0) || (dn > 1)) {
+      for (i = 0; i < dn; i++) DWT_S(i) -= DWT_FIX_MUL(DWT_DD_(i) + DWT_DD_(i - 1), 12993);
+      for (i = 0; i < sn; i++) DWT_D(i) -= DWT_FIX_MUL(DWT_SS_(i) + DWT_SS_(i + 1), 434);
+      for (i = 0; i < dn; i++) DWT_S(i) += DWT_FIX_MUL(DWT_DD_(i) + DWT_DD_(i - 1), 7233);
+      for (i = 0; i < sn; i++) DWT_D(i) += DWT_FIX_MUL(DWT_SS_(i) + DWT_SS_(i + 1), 3633);
+      for (i = 0; i < dn; i++) DWT_S(i) = DWT_FIX_MUL(DWT_S(i), 5038);
+      for (i = 0; i < sn; i++) DWT_D(i) = DWT_FIX_MUL(DWT_D(i), 6659);
+    }
+  }
+}
+
+/* v4dwt_decode_step1 */
+static DWT_TARGET void DWT_NAME(dwt_real_step1)(DWT_VF *w, int count, float c) {
+  for (int i = 0; i < count; i++)
+    w[i * 2] *= c;
+}
+
+/* v4dwt_decode_step2, the tail beyond the shorter band uses its last sample twice */
+static DWT_TARGET void DWT_NAME(dwt_real_step2)(DWT_VF *l, DWT_VF *w, int k, int m, float c) {
+  DWT_VF vc = (DWT_VF){0} + c;
+  DWT_VF t1 = l[0];
+  DWT_VF *last = l;
+  for (int i = 0; i < m; i++) {
+    DWT_VF t3 = w[0];
+    w[-1] = DWT_LIFT(w[-1], t1 + t3, vc);
+    t1 = t3;
+    last = w;
+    w += 2;
+  }
+  if (m >= k)
+    return;
+  vc = (vc + vc) * last[0];
+  for (; m < k; m++) {
+    w[-1] = w[-1] + vc;
+    w += 2;
+  }
+}
+
+/* Inverse 9/7 in 1-D, v4dwt_decode */
+static DWT_TARGET void DWT_NAME(dwt_decode_1_real)(DWT_VF *w, int dn, int sn, int cas) {
+  int a, b;
+  if (cas == 0) {
+    if (!((dn > 0) || (sn > 1)))
+      return;
+    a = 0;
+    b = 1;
+  } else {
+    if (!((sn > 0) || (dn > 1)))
+      return;
+    a = 1;
+    b = 0;
+  }
+  DWT_NAME(dwt_real_step1)(w + a, sn, DWT_K);
+  DWT_NAME(dwt_real_step1)(w + b, dn, DWT_C13318);
+  DWT_NAME(dwt_real_step2)(w + b, w + a + 1, sn, sn < dn - a ? sn : dn - a, DWT_DELTA);
+  DWT_NAME(dwt_real_step2)(w + a, w + b + 1, dn, dn < sn - b ? dn : sn - b, DWT_GAMMA);
+  DWT_NAME(dwt_real_step2)(w + b, w + a + 1, sn, sn < dn - a ? sn : dn - a, DWT_BETA);
+  DWT_NAME(dwt_real_step2)(w + a, w + b + 1, dn, dn < sn - b ? dn : sn - b, DWT_ALPHA);
+}
+
+static DWT_TARGET void DWT_NAME(dwt_1d)(DWT_VI *a, int dn, int sn, int cas, int transform) {
+  switch (transform) {
+  case DWT_INVERSE_53:
+    DWT_NAME(dwt_decode_1)(a, dn, sn, cas);
+    break;
+  case DWT_INVERSE_97:
+    DWT_NAME(dwt_decode_1_real)((DWT_VF *) a, dn, sn, cas);
+    break;
+  case DWT_FORWARD_53:
+    DWT_NAME(dwt_encode_1)(a, dn, sn, cas);
+    break;
+  case DWT_FORWARD_97:
+    DWT_NAME(dwt_encode_1_real)(a, dn, sn, cas);
+    break;
+  }
+}
+
+/*
+ * Moves count samples, stride vectors apart from mem[at], in from n <= DWT_LANES rows (lane_step
+ * w, step 1) or columns (lane_step 1, step w) of the component. Lanes past n are zeroed, so the
+ * float lanes stay finite.
+ */
+static DWT_TARGET void DWT_NAME(dwt_gather)(DWT_VI *mem, const int *src, int step, int lane_step, int n, int count, int at, int stride) {
+  if (lane_step == 1 && n == DWT_LANES) {
+    for (int k = 0; k < count; k++)
+      mem[at + k * stride] = *(const DWT_VI_U *) (src + k * step);
+    return;
+  }
+  if (n < DWT_LANES)
+    for (int k = 0; k < count; k++)
+      mem[at + k * stride] = (DWT_VI){0};
+  for (int l = 0; l < n; l++) {
+    const int *s = src + l * lane_step;
+    int *d = (int *) (mem + at) + l;
+    for (int k = 0; k < count; k++)
+      d[k * stride * DWT_LANES] = s[k * step];
+  }
+}
+
+/* the way back of dwt_gather, for the first n lanes */
+static DWT_TARGET void DWT_NAME(dwt_scatter)(const DWT_VI *mem, int *dst, int step, int lane_step, int n, int count, int at, int stride) {
+  if (lane_step == 1 && n == DWT_LANES) {
+    for (int k = 0; k < count; k++)
+      *(DWT_VI_U *) (dst + k * step) = mem[at + k * stride];
+    return;
+  }
+  for (int l = 0; l < n; l++) {
+    const int *s = (const int *) (mem + at) + l;
+    int *d = dst + l * lane_step;
+    for (int k = 0; k < count; k++)
+      d[k * step] = s[k * stride * DWT_LANES];
+  }
+}
+
+/*
+ * One pass over n <= DWT_LANES rows or columns of length sn + dn. The inverse transforms read the
+ * bands, low then high, and write the samples interleaved; the forward transforms do the opposite.
+ */
+static DWT_TARGET void DWT_NAME(dwt_pass)(DWT_VI *mem, int *data, int step, int lane_step, int n, int dn, int sn, int cas, int transform) {
+  if (transform == DWT_INVERSE_53 || transform == DWT_INVERSE_97) {
+    DWT_NAME(dwt_gather)(mem, data, step, lane_step, n, sn, cas, 2);
+    DWT_NAME(dwt_gather)(mem, data + sn * step, step, lane_step, n, dn, 1 - cas, 2);
+    DWT_NAME(dwt_1d)(mem, dn, sn, cas, transform);
+    DWT_NAME(dwt_scatter)(mem, data, step, lane_step, n, sn + dn, 0, 1);
+  } else {
+    DWT_NAME(dwt_gather)(mem, data, step, lane_step, n, sn + dn, 0, 1);
+    DWT_NAME(dwt_1d)(mem, dn, sn, cas, transform);
+    DWT_NAME(dwt_scatter)(mem, data, step, lane_step, n, sn, cas, 2);
+    DWT_NAME(dwt_scatter)(mem, data + sn * step, step, lane_step, n, dn, 1 - cas, 2);
+  }
+}
+
+/* Inverse transform of the tile component up to resolution numres - 1, dwt_decode_tile */
+static DWT_TARGET int DWT_NAME(dwt_decode)(opj_tcd_tilecomp_t *tilec, int numres, int transform) {
+  opj_tcd_resolution_t *tr = tilec->resolutions;
+  int rw = tr->x1 - tr->x0;
+  int rh = tr->y1 - tr->y0;
+  int w = tilec->x1 - tilec->x0;
+  DWT_VI *mem = (DWT_VI *) dwt_alloc(dwt_max_resolution(tr, numres), sizeof(DWT_VI));
+
+  if (mem == NULL)
+    return 0;
+  while (--numres) {
+    int sn_h = rw, sn_v = rh;
+    ++tr;
+    rw = tr->x1 - tr->x0;
+    rh = tr->y1 - tr->y0;
+    for (int j = 0; j < rh; j += DWT_LANES)
+      DWT_NAME(dwt_pass)(mem, tilec->data + j * w, 1, w, rh - j < DWT_LANES ? rh - j : DWT_LANES, rw - sn_h, sn_h, tr->x0 % 2, transform);
+    for (int j = 0; j < rw; j += DWT_LANES)
+      DWT_NAME(dwt_pass)(mem, tilec->data + j, w, 1, rw - j < DWT_LANES ? rw - j : DWT_LANES, rh - sn_v, sn_v, tr->y0 % 2, transform);
+  }
+  free(mem);
+  return 1;
+}
+
+/* Forward transform of the tile component, dwt_encode: columns first, then rows */
+static DWT_TARGET int DWT_NAME(dwt_encode)(opj_tcd_tilecomp_t *tilec, int transform) {
+  int w = tilec->x1 - tilec->x0;
+  int l = tilec->numresolutions - 1;
+  DWT_VI *mem = (DWT_VI *) dwt_alloc(dwt_max_resolution(tilec->resolutions, tilec->numresolutions), sizeof(DWT_VI));
+
+  if (mem == NULL)
+    return 0;
+  for (int i = 0; i < l; i++) {
+    opj_tcd_resolution_t *res = &tilec->resolutions[l - i];
+    opj_tcd_resolution_t *low = &tilec->resolutions[l - i - 1];
+    int rw = res->x1 - res->x0, rh = res->y1 - res->y0;
+    int rw1 = low->x1 - low->x0, rh1 = low->y1 - low->y0;
+    for (int j = 0; j < rw; j += DWT_LANES)
+      DWT_NAME(dwt_pass)(mem, tilec->data + j, w, 1, rw - j < DWT_LANES ? rw - j : DWT_LANES, rh - rh1, rh1, res->y0 % 2, transform);
+    for (int j = 0; j < rh; j += DWT_LANES)
+      DWT_NAME(dwt_pass)(mem, tilec->data + j * w, 1, w, rh - j < DWT_LANES ? rh - j : DWT_LANES, rw - rw1, rw1, res->x0 % 2, transform);
+  }
+  free(mem);
+  return 1;
+}
@@ -0,0 +1,285 @@
+#ifndef J2KLIB_INTERLEAVE_H
+#define J2KLIB_INTERLEAVE_H
+
+#include "simd.h"
+
+/*
+ * Row kernels turning OpenJPEG component planes (one int per sample) into the interleaved raw
+ * frame. Samples are truncated to the output width, as the scalar casts always did.
+ */
+
+static void interleave_gray8_scalar(const int *src, uint8_t *dst, int n) {
+  for (int x = 0; x < n; x++)
+    dst[x] = (uint8_t)src[x];
+}
+
+static void interleave_gray16_scalar(const int *src, uint16_t *dst, int n) {
+  for (int x = 0; x < n; x++)
+    dst[x] = (uint16_t)src[x];
+}
+
+static void interleave_rgb8_scalar(const int *r, const int *g, const int *b, uint8_t *dst, int n) {
+  for (int x = 0; x < n; x++) {
+    dst[3 * x] = (uint8_t)r[x];
+    dst[3 * x + 1] = (uint8_t)g[x];
+    dst[3 * x + 2] = (uint8_t)b[x];
+  }
+}
+
+#if defined(J2K_SIMD_X86)
+
+/* low byte of 16 ints, masking first so the saturating packs cannot clamp */
+J2K_TARGET_SSE41 static inline __m128i narrow8_sse41(const int *src) {
+  const __m128i mask = _mm_set1_epi32(0xFF);
+  __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)src), mask);
+  __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 4)), mask);
+  __m128i c = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 8)), mask);
+  __m128i d = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 12)), mask);
+  return _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, d));
+}
+
+/* stores 16 pixels of three byte planes as 48 interleaved bytes */
+J2K_TARGET_SSE41 static inline void store_rgb8_sse41(__m128i r, __m128i g, __m128i b, uint8_t *dst) {
+  const __m128i r0 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+  const __m128i g0 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+  const __m128i b0 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+  const __m128i r1 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+  const __m128i g1 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+  const __m128i b1 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+  const __m128i r2 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+  const __m128i g2 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+  const __m128i b2 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+  __m128i o0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r0), _mm_shuffle_epi8(g, g0)), _mm_shuffle_epi8(b, b0));
+  __m128i o1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r1), _mm_shuffle_epi8(g, g1)), _mm_shuffle_epi8(b, b1));
+  __m128i o2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r2), _mm_shuffle_epi8(g, g2)), _mm_shuffle_epi8(b, b2));
+  _mm_storeu_si128((__m128i *)dst, o0);
+  _mm_storeu_si128((__m128i *)(dst + 16), o1);
+  _mm_storeu_si128((__m128i *)(dst + 32), o2);
+}
+
+J2K_TARGET_SSE41 static void interleave_gray8_sse41(const int *src, uint8_t *dst, int n) {
+  int x = 0;
+  for (; x + 16 <= n; x += 16)
+    _mm_storeu_si128((__m128i *)(dst + x), narrow8_sse41(src + x));
+  interleave_gray8_scalar(src + x, dst + x, n - x);
+}
+
+J2K_TARGET_SSE41 static void interleave_gray16_sse41(const int *src, uint16_t *dst, int n) {
+  const __m128i mask = _mm_set1_epi32(0xFFFF);
+  int x = 0;
+  for (; x + 8 <= n; x += 8) {
+    __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + x)), mask);
+    __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + x + 4)), mask);
+    _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi32(a, b));
+  }
+  interleave_gray16_scalar(src + x, dst + x, n - x);
+}
+
+J2K_TARGET_SSE41 static void interleave_rgb8_sse41(const int *r, const int *g, const int *b, uint8_t *dst, int n) {
+  int x = 0;
+  for (; x + 16 <= n; x += 16)
+    store_rgb8_sse41(narrow8_sse41(r + x), narrow8_sse41(g + x), narrow8_sse41(b + x), dst + 3 * x);
+  interleave_rgb8_scalar(r + x, g + x, b + x, dst + 3 * x, n - x);
+}
+
+/* low byte of 32 ints, the packs work per 128-bit lane so the dwords are put back in order */
+J2K_TARGET_AVX2 static inline __m256i narrow8_avx2(const int *src) {
+  const __m256i mask = _mm256_set1_epi32(0xFF);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)src), mask);
+  __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(src + 8)), mask);
+  __m256i c = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(src + 16)), mask);
+  __m256i d = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(src + 24)), mask);
+  __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_packus_epi32(c, d));
+  return _mm256_permutevar8x32_epi32(packed, order);
+}
+
+J2K_TARGET_AVX2 static void interleave_gray8_avx2(const int *src, uint8_t *dst, int n) {
+  int x = 0;
+  for (; x + 32 <= n; x += 32)
+    _mm256_storeu_si256((__m256i *)(dst + x), narrow8_avx2(src + x));
+  interleave_gray8_sse41(src + x, dst + x, n - x);
+}
+
+J2K_TARGET_AVX2 static void interleave_gray16_avx2(const int *src, uint16_t *dst, int n) {
+  const __m256i mask = _mm256_set1_epi32(0xFFFF);
+  int x = 0;
+  for (; x + 16 <= n; x += 16) {
+    __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(src + x)), mask);
+    __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(src + x + 8)), mask);
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+    _mm256_storeu_si256((__m256i *)(dst + x), packed);
+  }
+  interleave_gray16_sse41(src + x, dst + x, n - x);
+}
+
+J2K_TARGET_AVX2 static void interleave_rgb8_avx2(const int *r, const int *g, const int *b, uint8_t *dst, int n) {
+  int x = 0;
+  for (; x + 32 <= n; x += 32) {
+    __m256i r8 = narrow8_avx2(r + x);
+    __m256i g8 = narrow8_avx2(g + x);
+    __m256i b8 = narrow8_avx2(b + x);
+    store_rgb8_sse41(_mm256_castsi256_si128(r8), _mm256_castsi256_si128(g8), _mm256_castsi256_si128(b8), dst + 3 * x);
+    store_rgb8_sse41(_mm256_extracti128_si256(r8, 1), _mm256_extracti128_si256(g8, 1), _mm256_extracti128_si256(b8, 1), dst + 3 * x + 48);
+  }
+  interleave_rgb8_sse41(r + x, g + x, b + x, dst + 3 * x, n - x);
+}
+
+#elif defined(J2K_SIMD_NEON)
+
+static inline uint8x16_t narrow8_neon(const int *src) {
+  uint16x8_t lo = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(src))), vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(src + 4))));
+  uint16x8_t hi = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(src + 8))), vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(src + 12))));
+  return vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+}
+
+static void interleave_gray8_neon(const int *src, uint8_t *dst, int n) {
+  int x = 0;
+  for (; x + 16 <= n; x += 16)
+    vst1q_u8(dst + x, narrow8_neon(src + x));
+  interleave_gray8_scalar(src + x, dst + x, n - x);
+}
+
+static void interleave_gray16_neon(const int *src, uint16_t *dst, int n) {
+  int x = 0;
+  for (; x + 8 <= n; x += 8) {
+    uint16x4_t a = vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(src + x)));
+    uint16x4_t b = vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(src + x + 4)));
+    vst1q_u16(dst + x, vcombine_u16(a, b));
+  }
+  interleave_gray16_scalar(src + x, dst + x, n - x);
+}
+
+static void interleave_rgb8_neon(const int *r, const int *g, const int *b, uint8_t *dst, int n) {
+  int x = 0;
+  for (; x + 16 <= n; x += 16) {
+    uint8x16x3_t rgb;
+    rgb.val[0] = narrow8_neon(r + x);
+    rgb.val[1] = narrow8_neon(g + x);
+    rgb.val[2] = narrow8_neon(b + x);
+    vst3q_u8(dst + 3 * x, rgb);
+  }
+  interleave_rgb8_scalar(r + x, g + x, b + x, dst + 3 * x, n - x);
+}
+
+#endif
+
+static void interleave_gray8(int level, const int *src, uint8_t *dst, int n) {
+  switch (level) {
+#if defined(J2K_SIMD_X86)
+  case J2K_SIMD_AVX2:
+    interleave_gray8_avx2(src, dst, n);
+    return;
+  case J2K_SIMD_SSE41:
+    interleave_gray8_sse41(src, dst, n);
+    return;
+#elif defined(J2K_SIMD_NEON)
+  case J2K_SIMD_NEON:
+    interleave_gray8_neon(src, dst, n);
+    return;
+#endif
+  }
+  interleave_gray8_scalar(src, dst, n);
+}
+
+static void interleave_gray16(int level, const int *src, uint16_t *dst, int n) {
+  switch (level) {
+#if defined(J2K_SIMD_X86)
+  case J2K_SIMD_AVX2:
+    interleave_gray16_avx2(src, dst, n);
+    return;
+  case J2K_SIMD_SSE41:
+    interleave_gray16_sse41(src, dst, n);
+    return;
+#elif defined(J2K_SIMD_NEON)
+  case J2K_SIMD_NEON:
+    interleave_gray16_neon(src, dst, n);
+    return;
+#endif
+  }
+  interleave_gray16_scalar(src, dst, n);
+}
+
+static void interleave_rgb8(int level, const int *r, const int *g, const int *b, uint8_t *dst, int n) {
+  switch (level) {
+#if defined(J2K_SIMD_X86)
+  case J2K_SIMD_AVX2:
+    interleave_rgb8_avx2(r, g, b, dst, n);
+    return;
+  case J2K_SIMD_SSE41:
+    interleave_rgb8_sse41(r, g, b, dst, n);
+    return;
+#elif defined(J2K_SIMD_NEON)
+  case J2K_SIMD_NEON:
+    interleave_rgb8_neon(r, g, b, dst, n);
+    return;
+#endif
+  }
+  interleave_rgb8_scalar(r, g, b, dst, n);
+}
+
+/*
+ * Copies the window of cw x ch samples at cx, cy of the decoded image to raw, row by row. Gray
+ * 8/16 bit and 8 bit RGB images with equally sized components take the kernels above, anything
+ * else the generic per component loop, where a window other than the whole image needs components
+ * without subsampling. OpenJPEG already reports the component size of a reduced decode.
+ */
+static void interleave_window(opj_image_t *image, char *raw, int cx, int cy, int cw, int ch) {
+  int level = j2k_simd_level();
+  int numcomps = image->numcomps;
+  opj_image_comp_t *comps = image->comps;
+  int w = comps[0].w;
+
+  int uniform = 1;
+  for (int compno = 1; compno < numcomps; compno++)
+    if (comps[compno].w != comps[0].w || comps[compno].h != comps[0].h || (comps[compno].prec <= 8) != (comps[0].prec <= 8))
+      uniform = 0;
+
+  if (uniform && numcomps == 1 && comps[0].prec <= 8) {
+    for (int y = 0; y < ch; y++)
+      interleave_gray8(level, comps[0].data + (cy + y) * w + cx, (uint8_t *)raw + y * cw, cw);
+    return;
+  }
+  if (uniform && numcomps == 1 && comps[0].prec <= 16) {
+    for (int y = 0; y < ch; y++)
+      interleave_gray16(level, comps[0].data + (cy + y) * w + cx, (uint16_t *)raw + y * cw, cw);
+    return;
+  }
+  if (uniform && numcomps == 3 && comps[0].prec <= 8) {
+    for (int y = 0; y < ch; y++) {
+      int offset = (cy + y) * w + cx;
+      interleave_rgb8(level, comps[0].data + offset, comps[1].data + offset, comps[2].data + offset, (uint8_t *)raw + 3 * y * cw, cw);
+    }
+    return;
+  }
+
+  for (int compno = 0; compno < numcomps; compno++) {
+    opj_image_comp_t *comp = &comps[compno];
+    int full = cx == 0 && cy == 0 && cw == w && ch == comps[0].h;
+    int rw = full ? comp->w : cw;
+    int rh = full ? comp->h : ch;
+    for (int y = 0; y < rh; y++) {
+      const int *src = comp->data + (cy + y) * comp->w + cx;
+      if (comp->prec <= 8) {
+        uint8_t *data8 = (uint8_t *)raw + y * rw * numcomps + compno;
+        for (int x = 0; x < rw; x++, data8 += numcomps)
+          *data8 = (uint8_t)src[x];
+      } else if (comp->prec <= 16) {
+        uint16_t *data16 = (uint16_t *)raw + y * rw * numcomps + compno;
+        for (int x = 0; x < rw; x++, data16 += numcomps)
+          *data16 = (int16_t)src[x];
+      } else {
+        uint32_t *data32 = (uint32_t *)raw + y * rw * numcomps + compno;
+        for (int x = 0; x < rw; x++, data32 += numcomps)
+          *data32 = (uint32_t)src[x];
+      }
+    }
+  }
+}
+
+/* Copies the whole decoded image to raw */
+static void interleave_image(opj_image_t *image, char *raw) {
+  interleave_window(image, raw, 0, 0, image->comps[0].w, image->comps[0].h);
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef J2KLIB_REGION_H
+#define J2KLIB_REGION_H
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Codestream surgery for region decodes. OpenJPEG 1.5 has no decode area, so the codestream is
+ * rewritten to hold only the tiles a region touches: SIZ shrinks the image and the tile grid to
+ * those tiles and the tile-parts of every other tile are dropped. Tiles keep their position on the
+ * reference grid, so code-block partitions and wavelet boundaries and with them the decoded
+ * samples are the same as in a full decode.
+ */
+
+#define J2K_MARKER_SOC 0xFF4F
+#define J2K_MARKER_SIZ 0xFF51
+#define J2K_MARKER_TLM 0xFF55
+#define J2K_MARKER_PLM 0xFF57
+#define J2K_MARKER_PPM 0xFF60
+#define J2K_MARKER_SOT 0xFF90
+#define J2K_MARKER_EOC 0xFFD9
+
+/* Image and tile geometry from the SIZ marker segment, in reference grid coordinates */
+typedef struct j2k_siz {
+  unsigned int x1, y1;    /* Xsiz, Ysiz */
+  unsigned int x0, y0;    /* XOsiz, YOsiz */
+  unsigned int tdx, tdy;  /* XTsiz, YTsiz */
+  unsigned int tx0, ty0;  /* XTOsiz, YTOsiz */
+  int numcomps;
+  int prec, sgnd;         /* of the first component */
+  int mixed;              /* components differ in precision or signedness */
+  int subsampled;         /* a component is subsampled */
+  int tw, th;             /* tiles across and down */
+  int offset;             /* position of the SIZ marker */
+  int main_end;           /* position of the first SOT marker */
+  int ppm;                /* main header holds packed packet headers */
+} j2k_siz;
+
+static unsigned int j2k_read16(const unsigned char *p) {
+  return ((unsigned int)p[0] << 8) | p[1];
+}
+
+static unsigned int j2k_read32(const unsigned char *p) {
+  return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+}
+
+static void j2k_write16(unsigned char *p, unsigned int v) {
+  p[0] = (unsigned char)(v >> 8);
+  p[1] = (unsigned char)v;
+}
+
+static void j2k_write32(unsigned char *p, unsigned int v) {
+  p[0] = (unsigned char)(v >> 24);
+  p[1] = (unsigned char)(v >> 16);
+  p[2] = (unsigned char)(v >> 8);
+  p[3] = (unsigned char)v;
+}
+
+static unsigned int j2k_ceildiv(unsigned int a, unsigned int b) {
+  return (unsigned int)(((unsigned long long)a + b - 1) / b);
+}
+
+/* start of tile row or column t, clamped to the image end */
+static unsigned int j2k_tile_start(unsigned int origin, unsigned int size, int t, unsigned int end) {
+  unsigned long long v = origin + (unsigned long long)t * size;
+  return v < end ? (unsigned int)v : end;
+}
+
+/*
+ * Reads SIZ and walks the main header up to the first tile-part. Returns 0 when the data is not
+ * a J2K codestream or the header is cut short.
+ */
+static int j2k_read_siz(const unsigned char *cs, int len, j2k_siz *siz) {
+  int pos = 2;
+  int found = 0;
+
+  memset(siz, 0, sizeof(*siz));
+  if (len < 4 || j2k_read16(cs) != J2K_MARKER_SOC)
+    return 0;
+  while (pos + 4 <= len) {
+    unsigned int marker = j2k_read16(cs + pos);
+    unsigned int length = j2k_read16(cs + pos + 2);
+    if (marker == J2K_MARKER_SOT) {
+      siz->main_end = pos;
+      return found;
+    }
+    if ((marker >> 8) != 0xFF || length < 2 || pos + 2 + (int)length > len)
+      return 0;
+    if (marker == J2K_MARKER_SIZ) {
+      const unsigned char *p = cs + pos + 4;
+      if (length < 38)
+        return 0;
+      siz->offset = pos;
+      siz->x1 = j2k_read32(p + 2);
+      siz->y1 = j2k_read32(p + 6);
+      siz->x0 = j2k_read32(p + 10);
+      siz->y0 = j2k_read32(p + 14);
+      siz->tdx = j2k_read32(p + 18);
+      siz->tdy = j2k_read32(p + 22);
+      siz->tx0 = j2k_read32(p + 26);
+      siz->ty0 = j2k_read32(p + 30);
+      siz->numcomps = (int)j2k_read16(p + 34);
+      if (siz->numcomps < 1 || length < 38 + 3 * (unsigned int)siz->numcomps)
+        return 0;
+      if (siz->x1 <= siz->x0 || siz->y1 <= siz->y0 || siz->tdx == 0 || siz->tdy == 0 || siz->tx0 > siz->x0 || siz->ty0 > siz->y0)
+        return 0;
+      siz->prec = (p[36] & 0x7F) + 1;
+      siz->sgnd = p[36] >> 7;
+      for (int c = 0; c < siz->numcomps; c++) {
+        if (p[36 + 3 * c] != p[36])
+          siz->mixed = 1;
+        if (p[37 + 3 * c] != 1 || p[38 + 3 * c] != 1)
+          siz->subsampled = 1;
+      }
+      siz->tw = (int)j2k_ceildiv(siz->x1 - siz->tx0, siz->tdx);
+      siz->th = (int)j2k_ceildiv(siz->y1 - siz->ty0, siz->tdy);
+      found = 1;
+    }
+    if (marker == J2K_MARKER_PPM)
+      siz->ppm = 1;
+    pos += 2 + length;
+  }
+  return 0;
+}
+
+/*
+ * Builds a codestream holding only the tiles p0..p1 across and q0..q1 down, which are numbered
+ * again from 0 in the smaller tile grid. TLM and PLM index every tile of the original and are left
+ * out. Returns NULL when the codestream can not be taken apart, the caller decodes it whole.
+ */
+static unsigned char *j2k_extract_tiles(const unsigned char *cs, int len, const j2k_siz *siz, int p0, int q0, int p1, int q1, int *outlen) {
+  unsigned char *out;
+  int pos, n = 0;
+
+  if (siz->ppm)
+    return NULL;
+  out = (unsigned char *)malloc(len + 2);
+  if (out == NULL)
+    return NULL;
+
+  /* main header without the tile length markers */
+  for (pos = 0; pos < siz->main_end;) {
+    unsigned int marker = j2k_read16(cs + pos);
+    int size = marker == J2K_MARKER_SOC ? 2 : 2 + (int)j2k_read16(cs + pos + 2);
+    if (marker != J2K_MARKER_TLM && marker != J2K_MARKER_PLM) {
+      memcpy(out + n, cs + pos, size);
+      if (marker == J2K_MARKER_SIZ) {
+        unsigned char *p = out + n + 4;
+        unsigned int tx0 = j2k_tile_start(siz->tx0, siz->tdx, p0, siz->x1);
+        unsigned int ty0 = j2k_tile_start(siz->ty0, siz->tdy, q0, siz->y1);
+        j2k_write32(p + 2, j2k_tile_start(siz->tx0, siz->tdx, p1 + 1, siz->x1));
+        j2k_write32(p + 6, j2k_tile_start(siz->ty0, siz->tdy, q1 + 1, siz->y1));
+        j2k_write32(p + 10, tx0 > siz->x0 ? tx0 : siz->x0);
+        j2k_write32(p + 14, ty0 > siz->y0 ? ty0 : siz->y0);
+        j2k_write32(p + 26, tx0);
+        j2k_write32(p + 30, ty0);
+      }
+      n += size;
+    }
+    pos += size;
+  }
+
+  /* tile-parts of the selected tiles */
+  while (pos + 12 <= len && j2k_read16(cs + pos) == J2K_MARKER_SOT) {
+    int tile = (int)j2k_read16(cs + pos + 4);
+    int psot = (int)j2k_read32(cs + pos + 6);
+    int size = psot != 0 ? psot : len - pos;
+    int p = tile % siz->tw;
+    int q = tile / siz->tw;
+    if (psot != 0 && (psot < 14 || pos + psot > len))
+      break;
+    if (p >= p0 && p <= p1 && q >= q0 && q <= q1) {
+      memcpy(out + n, cs + pos, size);
+      j2k_write16(out + n + 4, (unsigned int)((p - p0) + (q - q0) * (p1 - p0 + 1)));
+      n += size;
+    }
+    pos += size;
+  }
+  if (n < 2 || j2k_read16(out + n - 2) != J2K_MARKER_EOC) {
+    j2k_write16(out + n, J2K_MARKER_EOC);
+    n += 2;
+  }
+  *outlen = n;
+  return out;
+}
+
+#endif
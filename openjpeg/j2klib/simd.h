@@ -0,0 +1,71 @@
+#ifndef J2KLIB_SIMD_H
+#define J2KLIB_SIMD_H
+
+/*
+ * Runtime CPU dispatch for the pixel kernels. The cgo flags build for the baseline of each
+ * platform, so the x86 kernels carry their instruction set in a target attribute and are only
+ * called after the CPU reported it. NEON is part of the arm64 baseline.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define J2K_SIMD_X86 1
+#include <immintrin.h>
+#define J2K_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define J2K_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__aarch64__)
+#define J2K_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define J2K_SIMD_SCALAR 0
+#define J2K_SIMD_SSE41  1
+#define J2K_SIMD_AVX2   2
+#define J2K_SIMD_NEON   3
+
+/* Level forced by J2KSetSIMDLevel, -1 when the best supported level is used. */
+static int j2k_simd_forced = -1;
+
+static int j2k_simd_supported(int level) {
+  switch (level) {
+  case J2K_SIMD_SCALAR:
+    return 1;
+#if defined(J2K_SIMD_X86)
+  case J2K_SIMD_SSE41:
+    return __builtin_cpu_supports("sse4.1");
+  case J2K_SIMD_AVX2:
+    return __builtin_cpu_supports("avx2");
+#elif defined(J2K_SIMD_NEON)
+  case J2K_SIMD_NEON:
+    return 1;
+#endif
+  }
+  return 0;
+}
+
+static int j2k_simd_level(void) {
+  if (j2k_simd_forced >= 0)
+    return j2k_simd_forced;
+#if defined(J2K_SIMD_X86)
+  if (j2k_simd_supported(J2K_SIMD_AVX2))
+    return J2K_SIMD_AVX2;
+  if (j2k_simd_supported(J2K_SIMD_SSE41))
+    return J2K_SIMD_SSE41;
+#elif defined(J2K_SIMD_NEON)
+  return J2K_SIMD_NEON;
+#endif
+  return J2K_SIMD_SCALAR;
+}
+
+/*
+ * Forces the kernels to one instruction set, -1 restores the automatic choice. Returns the level
+ * now in use, unsupported levels are ignored. Meant for tests comparing the kernels.
+ */
+int J2KSetSIMDLevel(int level) {
+  if (level < 0)
+    j2k_simd_forced = -1;
+  else if (j2k_simd_supported(level))
+    j2k_simd_forced = level;
+  return j2k_simd_level();
+}
+
+#endif
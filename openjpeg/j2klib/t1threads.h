@@ -0,0 +1,209 @@
+#ifndef J2KLIB_T1THREADS_H
+#define J2KLIB_T1THREADS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tcdtypes.h"
+#include "../../jpeglib/dcmjpeg/batch.h"
+
+/*
+ * Threaded T1 decode. OpenJPEG 1.5 decodes the code-blocks of a tile component one after the
+ * other in t1_decode_cblks. The linux platform files link with --wrap=t1_decode_cblks, so the call
+ * from tcd_decode_tile lands here and the code-blocks are handed out to native threads in runs.
+ * Every run goes through the library's own t1_decode_cblks on a component that holds only that
+ * run: the resolutions below it without bands, one band and one precinct with the run's
+ * code-blocks. A code-block writes its own samples of the component, so the result is the same
+ * as the single threaded decode.
+ *
+ * The thread count comes from j2k_t1_threads, which j2k_decode_image sets around opj_decode on
+ * the decoding thread; the library calls t1_decode_cblks on that same thread.
+ *
+ * This relies on the internals of the OpenJPEG 1.5 the platform archives are built from:
+ *   - tcdtypes.h pulls in the library's private tcd.h and t1.h, so opj_tcd_tilecomp_t,
+ *     opj_tcd_precinct_t and opj_t1_t must have the layout of the archive's build.
+ *   - t1_decode_cblks owns the code-block array of every precinct it decodes: it frees each
+ *     code-block's data and segs, then the cblks.dec array itself. A run holds a malloc'd copy of
+ *     its code-blocks, so the library frees the copy and the data; the precincts' original
+ *     arrays are freed and cleared here, and tcd_free_decode_tile skips a NULL cblks.dec.
+ * A library update has to be checked against both before the wrap is kept.
+ */
+
+/* Default for decoders without their own thread count, see J2KSetDecodeThreads */
+static int j2k_decode_threads = 1;
+
+/* T1 threads of the decode running on this thread, 0 for the default; see j2k_decode_image */
+static __thread int j2k_t1_threads;
+
+/* Sets the T1 threads of decoders that do not set their own, values below 1 mean one */
+void J2KSetDecodeThreads(int threads) {
+  __atomic_store_n(&j2k_decode_threads, threads < 1 ? 1 : threads, __ATOMIC_RELAXED);
+}
+
+/* T1 threads for a decoder asking for threads, 0 for the default */
+static int j2k_threads_for(int threads) {
+  return threads > 0 ? threads : __atomic_load_n(&j2k_decode_threads, __ATOMIC_RELAXED);
+}
+
+#if defined(__linux__)
+
+#define T1_RUNS_PER_THREAD 4
+
+void __real_t1_decode_cblks(opj_t1_t *t1, opj_tcd_tilecomp_t *tilec, opj_tccp_t *tccp);
+
+/* A run of code-blocks of one precinct, dressed up as a tile component of its own */
+typedef struct {
+  opj_tcd_tilecomp_t tilec;
+  opj_tcd_precinct_t precinct;
+  opj_tcd_resolution_t *resolutions;
+} t1_run;
+
+typedef struct {
+  opj_common_ptr cinfo;
+  opj_tccp_t *tccp;
+  t1_run *runs;
+  codec_frame *frames;
+} t1_runs_args;
+
+static void *t1_run_create(void) {
+  return t1_create(NULL);
+}
+
+static void t1_run_destroy(void *ctx) {
+  t1_destroy((opj_t1_t *) ctx);
+}
+
+static void t1_run_frame(void *ctx, codec_frame *frame, const void *args) {
+  const t1_runs_args *a = (const t1_runs_args *) args;
+  opj_t1_t *t1 = (opj_t1_t *) ctx;
+  t1_run *run = &a->runs[frame - a->frames];
+
+  t1->cinfo = a->cinfo;
+  __real_t1_decode_cblks(t1, &run->tilec, a->tccp);
+  frame->status = 1;
+}
+
+/*
+ * Sets up a run of count code-blocks from first in precinct precno of the band. The run owns a
+ * copy of its code-blocks, which t1_decode_cblks frees together with their data.
+ */
+static int t1_run_init(t1_run *run, opj_tcd_tilecomp_t *tilec, int resno, int bandno, int precno, int first, int count) {
+  opj_tcd_resolution_t *res = &tilec->resolutions[resno];
+  opj_tcd_band_t *band = &res->bands[bandno];
+  opj_tcd_precinct_t *precinct = &band->precincts[precno];
+
+  run->resolutions = (opj_tcd_resolution_t *) malloc((resno + 1) * sizeof(opj_tcd_resolution_t));
+  run->precinct = *precinct;
+  run->precinct.cblks.dec = (opj_tcd_cblk_dec_t *) malloc(count * sizeof(opj_tcd_cblk_dec_t));
+  if (run->resolutions == NULL || run->precinct.cblks.dec == NULL) {
+    free(run->resolutions);
+    free(run->precinct.cblks.dec);
+    run->resolutions = NULL;
+    run->precinct.cblks.dec = NULL;
+    return 0;
+  }
+  memcpy(run->precinct.cblks.dec, precinct->cblks.dec + first, count * sizeof(opj_tcd_cblk_dec_t));
+  run->precinct.cw = count;
+  run->precinct.ch = 1;
+
+  /* the lower resolutions only place the band, their code-blocks belong to other runs */
+  memcpy(run->resolutions, tilec->resolutions, (resno + 1) * sizeof(opj_tcd_resolution_t));
+  for (int r = 0; r < resno; r++)
+    run->resolutions[r].numbands = 0;
+  run->resolutions[resno].numbands = 1;
+  run->resolutions[resno].pw = 1;
+  run->resolutions[resno].ph = 1;
+  run->resolutions[resno].bands[0] = *band;
+  run->resolutions[resno].bands[0].precincts = &run->precinct;
+
+  run->tilec = *tilec;
+  run->tilec.numresolutions = resno + 1;
+  run->tilec.resolutions = run->resolutions;
+  return 1;
+}
+
+/*
+ * Cuts the code-blocks of the tile component into runs of at most length, or counts the runs
+ * when run is NULL. Returns the number of runs, -1 when a run could not be set up.
+ */
+static int t1_runs_init(t1_run *run, opj_tcd_tilecomp_t *tilec, int length) {
+  int runs = 0;
+  for (int resno = 0; resno < tilec->numresolutions; resno++) {
+    opj_tcd_resolution_t *res = &tilec->resolutions[resno];
+    for (int bandno = 0; bandno < res->numbands; bandno++) {
+      for (int precno = 0; precno < res->pw * res->ph; precno++) {
+        opj_tcd_precinct_t *precinct = &res->bands[bandno].precincts[precno];
+        int count = precinct->cw * precinct->ch;
+        for (int first = 0; first < count; first += length) {
+          if (run != NULL && !t1_run_init(&run[runs], tilec, resno, bandno, precno, first, count - first < length ? count - first : length))
+            return -1;
+          runs++;
+        }
+      }
+    }
+  }
+  return runs;
+}
+
+void __wrap_t1_decode_cblks(opj_t1_t *t1, opj_tcd_tilecomp_t *tilec, opj_tccp_t *tccp) {
+  int threads = j2k_threads_for(j2k_t1_threads);
+  int length, runs;
+  t1_run *run;
+  codec_frame *frames;
+
+  /* single code-blocks first, then runs short enough to keep every thread busy until the end */
+  runs = t1_runs_init(NULL, tilec, 1);
+  if (threads <= 1 || runs < 2) {
+    __real_t1_decode_cblks(t1, tilec, tccp);
+    return;
+  }
+  length = runs / (threads * T1_RUNS_PER_THREAD);
+  if (length < 1)
+    length = 1;
+  runs = t1_runs_init(NULL, tilec, length);
+
+  run = (t1_run *) calloc(runs, sizeof(t1_run));
+  frames = (codec_frame *) calloc(runs, sizeof(codec_frame));
+  if (run == NULL || frames == NULL || t1_runs_init(run, tilec, length) < 0) {
+    /* nothing decoded yet, the runs give back their copies and the library does it all */
+    for (int i = 0; run != NULL && i < runs; i++) {
+      free(run[i].precinct.cblks.dec);
+      free(run[i].resolutions);
+    }
+    free(run);
+    free(frames);
+    __real_t1_decode_cblks(t1, tilec, tccp);
+    return;
+  }
+
+  {
+    t1_runs_args args = {t1->cinfo, tccp, run, frames};
+    codec_batch batch = {frames, runs, 0, t1_run_create, t1_run_destroy, t1_run_frame, &args};
+    codec_batch_run(&batch, threads);
+  }
+  /* runs left by a thread that could not get a T1 handle */
+  for (int i = 0; i < runs; i++)
+    if (!frames[i].status)
+      __real_t1_decode_cblks(t1, &run[i].tilec, tccp);
+
+  /* the runs freed their copies, the precincts' own code-block arrays are left; cleared like
+     t1_decode_cblks does, so tcd_free_decode_tile passes over them */
+  for (int resno = 0; resno < tilec->numresolutions; resno++) {
+    opj_tcd_resolution_t *res = &tilec->resolutions[resno];
+    for (int bandno = 0; bandno < res->numbands; bandno++)
+      for (int precno = 0; precno < res->pw * res->ph; precno++) {
+        opj_tcd_precinct_t *precinct = &res->bands[bandno].precincts[precno];
+        free(precinct->cblks.dec);
+        precinct->cblks.dec = NULL;
+      }
+  }
+  for (int i = 0; i < runs; i++)
+    free(run[i].resolutions);
+  free(frames);
+  free(run);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef J2KLIB_TCDTYPES_H
+#define J2KLIB_TCDTYPES_H
+
+/*
+ * OpenJPEG's internal tile structures, for the stages the linux builds take over from the
+ * library through --wrap, see t1threads.h and wavelet.h.
+ */
+
+#include <stdio.h>
+
+#include "openjpeg.h"
+#include "bio.h"
+#include "tgt.h"
+
+/* coding parameters only pass through here, j2k.h would clash with the codec's own j2k_encode */
+typedef struct opj_tccp opj_tccp_t;
+typedef struct opj_tcp opj_tcp_t;
+typedef struct opj_cp opj_cp_t;
+
+#include "tcd.h"
+#include "mqc.h"
+#include "raw.h"
+#include "t1.h"
+
+#endif
@@ -0,0 +1,280 @@
+#ifndef J2KLIB_WAVELET_H
+#define J2KLIB_WAVELET_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd.h"
+#include "tcdtypes.h"
+
+/*
+ * SIMD wavelet transforms. OpenJPEG 1.5 runs the 5/3 and 9/7 transforms of a tile component one
+ * row or column at a time (the inverse 9/7 four at a time with SSE). The linux platform files link
+ * with --wrap for dwt_encode, dwt_encode_real, dwt_decode and dwt_decode_real, so the calls from
+ * tcd land here and run on 4 or 8 rows or columns per vector at the level j2k_simd_level picks.
+ * The scalar level calls the library itself. Every lane repeats the library's arithmetic, integer
+ * lifting for 5/3, fix_mul for the forward 9/7 and float lifting for the inverse 9/7, so the
+ * coefficients and samples are the same bits as the library's.
+ */
+
+#if defined(__linux__) && (defined(J2K_SIMD_X86) || defined(J2K_SIMD_NEON))
+
+#define DWT_INVERSE_53 0
+#define DWT_INVERSE_97 1
+#define DWT_FORWARD_53 2
+#define DWT_FORWARD_97 3
+
+/* inverse 9/7 lifting constants of dwt.c */
+#define DWT_ALPHA  1.586134342f
+#define DWT_BETA   0.052980118f
+#define DWT_GAMMA -0.882911075f
+#define DWT_DELTA -0.443506852f
+#define DWT_K      1.230174105f
+#define DWT_C13318 1.625732422f
+
+/* low band samples S and high band samples D of an interleaved signal, clamped at the edges */
+#define DWT_S(i) a[(i) * 2]
+#define DWT_D(i) a[1 + (i) * 2]
+#define DWT_S_(i) ((i) < 0 ? DWT_S(0) : ((i) >= sn ? DWT_S(sn - 1) : DWT_S(i)))
+#define DWT_D_(i) ((i) < 0 ? DWT_D(0) : ((i) >= dn ? DWT_D(dn - 1) : DWT_D(i)))
+#define DWT_SS_(i) ((i) < 0 ? DWT_S(0) : ((i) >= dn ? DWT_S(dn - 1) : DWT_S(i)))
+#define DWT_DD_(i) ((i) < 0 ? DWT_D(0) : ((i) >= sn ? DWT_D(sn - 1) : DWT_D(i)))
+
+/* largest width or height of the resolutions above the lowest, dwt_max_resolution */
+static int dwt_max_resolution(opj_tcd_resolution_t *r, int i) {
+  int mr = 1;
+  while (--i) {
+    r++;
+    if (mr < r->x1 - r->x0)
+      mr = r->x1 - r->x0;
+    if (mr < r->y1 - r->y0)
+      mr = r->y1 - r->y0;
+  }
+  return mr;
+}
+
+/* signal buffer of n vectors and a few spare ones, aligned for the widest vector */
+static void *dwt_alloc(int n, size_t size) {
+  void *mem = NULL;
+  if (posix_memalign(&mem, 32, (n + 5) * size) != 0)
+    return NULL;
+  return mem;
+}
+
+#if defined(J2K_SIMD_X86)
+
+typedef int dwt_vi4 __attribute__((vector_size(16), may_alias));
+typedef int dwt_vi4u __attribute__((vector_size(16), may_alias, aligned(4)));
+typedef float dwt_vf4 __attribute__((vector_size(16), may_alias));
+typedef int dwt_vi8 __attribute__((vector_size(32), may_alias));
+typedef int dwt_vi8u __attribute__((vector_size(32), may_alias, aligned(4)));
+typedef float dwt_vf8 __attribute__((vector_size(32), may_alias));
+
+/* fix_mul on 4 lanes: 64 bit products of the even and the odd lanes, rounded and narrowed */
+J2K_TARGET_SSE41 static inline __m128i dwt_fix_mul_sse41(__m128i a, int b) {
+  __m128i vb = _mm_set1_epi32(b);
+  __m128i bit = _mm_set1_epi64x(4096);
+  __m128i even = _mm_mul_epi32(a, vb);
+  __m128i odd = _mm_mul_epi32(_mm_srli_epi64(a, 32), vb);
+  even = _mm_srli_epi64(_mm_add_epi64(even, _mm_and_si128(even, bit)), 13);
+  odd = _mm_slli_epi64(_mm_srli_epi64(_mm_add_epi64(odd, _mm_and_si128(odd, bit)), 13), 32);
+  return _mm_blend_epi16(even, odd, 0xCC);
+}
+
+J2K_TARGET_AVX2 static inline __m256i dwt_fix_mul_avx2(__m256i a, int b) {
+  __m256i vb = _mm256_set1_epi32(b);
+  __m256i bit = _mm256_set1_epi64x(4096);
+  __m256i even = _mm256_mul_epi32(a, vb);
+  __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), vb);
+  even = _mm256_srli_epi64(_mm256_add_epi64(even, _mm256_and_si256(even, bit)), 13);
+  odd = _mm256_slli_epi64(_mm256_srli_epi64(_mm256_add_epi64(odd, _mm256_and_si256(odd, bit)), 13), 32);
+  return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+/* the library's inverse 9/7 multiplies and adds separately */
+#define DWT_LIFT(w, s, c) ((w) + (s) * (c))
+
+#define DWT_NAME(x) x##_sse41
+#define DWT_TARGET J2K_TARGET_SSE41
+#define DWT_LANES 4
+#define DWT_VI dwt_vi4
+#define DWT_VI_U dwt_vi4u
+#define DWT_VF dwt_vf4
+#define DWT_FIX_MUL(v, b) ((dwt_vi4) dwt_fix_mul_sse41((__m128i) (v), (b)))
+#include "dwt_lanes.h"
+#undef DWT_NAME
+#undef DWT_TARGET
+#undef DWT_LANES
+#undef DWT_VI
+#undef DWT_VI_U
+#undef DWT_VF
+#undef DWT_FIX_MUL
+
+#define DWT_NAME(x) x##_avx2
+#define DWT_TARGET J2K_TARGET_AVX2
+#define DWT_LANES 8
+#define DWT_VI dwt_vi8
+#define DWT_VI_U dwt_vi8u
+#define DWT_VF dwt_vf8
+#define DWT_FIX_MUL(v, b) ((dwt_vi8) dwt_fix_mul_avx2((__m256i) (v), (b)))
+#include "dwt_lanes.h"
+
+#elif defined(J2K_SIMD_NEON)
+
+typedef int dwt_vi4 __attribute__((vector_size(16), may_alias));
+typedef int dwt_vi4u __attribute__((vector_size(16), may_alias, aligned(4)));
+typedef float dwt_vf4 __attribute__((vector_size(16), may_alias));
+
+static inline int32x4_t dwt_fix_mul_neon(int32x4_t a, int b) {
+  int64x2_t bit = vdupq_n_s64(4096);
+  int64x2_t lo = vmull_n_s32(vget_low_s32(a), b);
+  int64x2_t hi = vmull_high_n_s32(a, b);
+  lo = vaddq_s64(lo, vandq_s64(lo, bit));
+  hi = vaddq_s64(hi, vandq_s64(hi, bit));
+  return vcombine_s32(vshrn_n_s64(lo, 13), vshrn_n_s64(hi, 13));
+}
+
+/* the arm64 library fuses the multiply and add of its lifting loop and nothing else */
+#define DWT_LIFT(w, s, c) ((dwt_vf4) vfmaq_f32((float32x4_t) (w), (float32x4_t) (s), (float32x4_t) (c)))
+
+#define DWT_NAME(x) x##_neon
+#if defined(__clang__)
+#define DWT_TARGET
+#else
+#define DWT_TARGET __attribute__((optimize("fp-contract=off")))
+#endif
+#define DWT_LANES 4
+#define DWT_VI dwt_vi4
+#define DWT_VI_U dwt_vi4u
+#define DWT_VF dwt_vf4
+#define DWT_FIX_MUL(v, b) ((dwt_vi4) dwt_fix_mul_neon((int32x4_t) (v), (b)))
+#include "dwt_lanes.h"
+
+#endif
+
+/* runs the transform at the current level, 0 when the library has to */
+static int dwt_simd(opj_tcd_tilecomp_t *tilec, int numres, int transform) {
+  int forward = transform == DWT_FORWARD_53 || transform == DWT_FORWARD_97;
+  switch (j2k_simd_level()) {
+#if defined(J2K_SIMD_X86)
+  case J2K_SIMD_AVX2:
+    return forward ? dwt_encode_avx2(tilec, transform) : dwt_decode_avx2(tilec, numres, transform);
+  case J2K_SIMD_SSE41:
+    return forward ? dwt_encode_sse41(tilec, transform) : dwt_decode_sse41(tilec, numres, transform);
+#elif defined(J2K_SIMD_NEON)
+  case J2K_SIMD_NEON:
+    return forward ? dwt_encode_neon(tilec, transform) : dwt_decode_neon(tilec, numres, transform);
+#endif
+  }
+  return 0;
+}
+
+void __real_dwt_encode(opj_tcd_tilecomp_t *tilec);
+void __real_dwt_encode_real(opj_tcd_tilecomp_t *tilec);
+void __real_dwt_decode(opj_tcd_tilecomp_t *tilec, int numres);
+void __real_dwt_decode_real(opj_tcd_tilecomp_t *tilec, int numres);
+
+void __wrap_dwt_encode(opj_tcd_tilecomp_t *tilec) {
+  if (!dwt_simd(tilec, tilec->numresolutions, DWT_FORWARD_53))
+    __real_dwt_encode(tilec);
+}
+
+void __wrap_dwt_encode_real(opj_tcd_tilecomp_t *tilec) {
+  if (!dwt_simd(tilec, tilec->numresolutions, DWT_FORWARD_97))
+    __real_dwt_encode_real(tilec);
+}
+
+void __wrap_dwt_decode(opj_tcd_tilecomp_t *tilec, int numres) {
+  if (!dwt_simd(tilec, numres, DWT_INVERSE_53))
+    __real_dwt_decode(tilec, numres);
+}
+
+void __wrap_dwt_decode_real(opj_tcd_tilecomp_t *tilec, int numres) {
+  if (!dwt_simd(tilec, numres, DWT_INVERSE_97))
+    __real_dwt_decode_real(tilec, numres);
+}
+
+/* tile component (x0, y0)-(x1, y1) laid out like tcd does, with samples from seed */
+static int dwt_test_tilec(opj_tcd_tilecomp_t *tilec, opj_tcd_resolution_t *res, int x0, int y0, int x1, int y1, int numresolutions, int transform, unsigned seed) {
+  int n = (x1 - x0) * (y1 - y0);
+
+  memset(tilec, 0, sizeof(*tilec));
+  tilec->x0 = x0;
+  tilec->y0 = y0;
+  tilec->x1 = x1;
+  tilec->y1 = y1;
+  tilec->numresolutions = numresolutions;
+  tilec->resolutions = res;
+  for (int r = 0; r < numresolutions; r++) {
+    int level = numresolutions - 1 - r;
+    memset(&res[r], 0, sizeof(res[r]));
+    res[r].x0 = (x0 + (1 << level) - 1) >> level;
+    res[r].y0 = (y0 + (1 << level) - 1) >> level;
+    res[r].x1 = (x1 + (1 << level) - 1) >> level;
+    res[r].y1 = (y1 + (1 << level) - 1) >> level;
+  }
+  tilec->data = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+  if (tilec->data == NULL)
+    return 0;
+  for (int i = 0; i < n; i++) {
+    seed = seed * 1103515245u + 12345u;
+    if (transform == DWT_INVERSE_97) {
+      /* the inverse 9/7 works on the float coefficients t1 leaves in the component */
+      float f = (float) ((int) (seed >> 16) % 4001 - 2000) * 0.37f;
+      memcpy(&tilec->data[i], &f, sizeof(f));
+    } else {
+      tilec->data[i] = (int) (seed >> 16) % 4096 - 2048;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Runs transform (DWT_INVERSE_53 .. DWT_FORWARD_97) on a tile component of numresolutions
+ * resolutions, the inverse ones up to numres, once at the current level and once in the library.
+ * Returns 1 when both give the same bits, 0 when not, -1 when the library is the current level.
+ * Meant for tests, the codestreams of the encoder only reach the 5/3 transforms.
+ */
+int J2KWaveletMatches(int transform, int x0, int y0, int x1, int y1, int numresolutions, int numres, unsigned seed) {
+  opj_tcd_resolution_t res[2][33];
+  opj_tcd_tilecomp_t simd, lib;
+  int matches = -1;
+
+  if (numresolutions < 1 || numresolutions > 33 || numres < 1 || numres > numresolutions)
+    return 0;
+  if (!dwt_test_tilec(&simd, res[0], x0, y0, x1, y1, numresolutions, transform, seed) ||
+      !dwt_test_tilec(&lib, res[1], x0, y0, x1, y1, numresolutions, transform, seed)) {
+    free(simd.data);
+    return 0;
+  }
+  if (dwt_simd(&simd, numres, transform)) {
+    switch (transform) {
+    case DWT_INVERSE_53:
+      __real_dwt_decode(&lib, numres);
+      break;
+    case DWT_INVERSE_97:
+      __real_dwt_decode_real(&lib, numres);
+      break;
+    case DWT_FORWARD_53:
+      __real_dwt_encode(&lib);
+      break;
+    case DWT_FORWARD_97:
+      __real_dwt_encode_real(&lib);
+      break;
+    }
+    matches = memcmp(simd.data, lib.data, (x1 - x0) * (y1 - y0) * sizeof(int)) == 0;
+  }
+  free(simd.data);
+  free(lib.data);
+  return matches;
+}
+
+#else
+
+int J2KWaveletMatches(int transform, int x0, int y0, int x1, int y1, int numresolutions, int numres, unsigned seed) {
+  return -1;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+package openjpeg
+
+import (
+	"encoding/binary"
+	"errors"
+)
+
+// J2KInfo - image and tile geometry of a J2K codestream as read by J2Kprobe
+type J2KInfo struct {
+	Width       int
+	Height      int
+	Components  int
+	Precision   int  // of the first component
+	Signed      bool // of the first component
+	Mixed       bool // components differ in precision or signedness
+	Subsampled  bool // a component is subsampled
+	TileWidth   int
+	TileHeight  int
+	TilesX      int
+	TilesY      int
+	Levels      int  // decomposition levels from COD, the most J2KdecodeReduced can drop
+	Reversible  bool // 5-3 wavelet, the codestream can be lossless
+	HighThrough bool // HT block coder, see J2KisHT
+}
+
+// RawSize - bytes J2Kdecode writes for the frame, images with subsampled components are not supported
+func (info J2KInfo) RawSize() int {
+	bytes := 1
+	if info.Precision > 16 {
+		bytes = 4
+	} else if info.Precision > 8 {
+		bytes = 2
+	}
+	return info.Width * info.Height * info.Components * bytes
+}
+
+// J2Kprobe - reads SIZ and COD from the main header of a J2K codestream without decoding it, to
+// size the output buffer or check it against the DICOM tags
+func J2Kprobe(j2kData []byte) (J2KInfo, error) {
+	var info J2KInfo
+	if len(j2kData) < 4 || binary.BigEndian.Uint16(j2kData) != markerSOC {
+		return info, errors.New("ERROR, J2Kprobe, no SOC marker")
+	}
+	siz := false
+	for pos := 2; pos+4 <= len(j2kData); {
+		marker := binary.BigEndian.Uint16(j2kData[pos:])
+		length := int(binary.BigEndian.Uint16(j2kData[pos+2:]))
+		if marker == markerSOT {
+			if !siz {
+				return info, errors.New("ERROR, J2Kprobe, no SIZ marker")
+			}
+			return info, nil
+		}
+		if marker < 0xFF00 || length < 2 || pos+2+length > len(j2kData) {
+			return info, errors.New("ERROR, J2Kprobe, marker segment cut short")
+		}
+		segment := j2kData[pos+4 : pos+2+length]
+		switch marker {
+		case markerSIZ:
+			// Rsiz, Xsiz, Ysiz, XOsiz, YOsiz, XTsiz, YTsiz, XTOsiz, YTOsiz, Csiz and Ssiz, XRsiz, YRsiz per component
+			if len(segment) < 36 {
+				return info, errors.New("ERROR, J2Kprobe, bad SIZ marker")
+			}
+			x1, y1 := binary.BigEndian.Uint32(segment[2:]), binary.BigEndian.Uint32(segment[6:])
+			x0, y0 := binary.BigEndian.Uint32(segment[10:]), binary.BigEndian.Uint32(segment[14:])
+			tdx, tdy := binary.BigEndian.Uint32(segment[18:]), binary.BigEndian.Uint32(segment[22:])
+			tx0, ty0 := binary.BigEndian.Uint32(segment[26:]), binary.BigEndian.Uint32(segment[30:])
+			info.Components = int(binary.BigEndian.Uint16(segment[34:]))
+			if info.Components < 1 || len(segment) < 36+3*info.Components {
+				return info, errors.New("ERROR, J2Kprobe, bad SIZ marker")
+			}
+			if x1 <= x0 || y1 <= y0 || tdx == 0 || tdy == 0 || tx0 > x0 || ty0 > y0 {
+				return info, errors.New("ERROR, J2Kprobe, bad SIZ geometry")
+			}
+			info.Width, info.Height = int(x1-x0), int(y1-y0)
+			info.TileWidth, info.TileHeight = int(tdx), int(tdy)
+			info.TilesX = int((uint64(x1-tx0) + uint64(tdx) - 1) / uint64(tdx))
+			info.TilesY = int((uint64(y1-ty0) + uint64(tdy) - 1) / uint64(tdy))
+			info.Precision = int(segment[36]&0x7F) + 1
+			info.Signed = segment[36]&0x80 != 0
+			for c := 0; c < info.Components; c++ {
+				if segment[36+3*c] != segment[36] {
+					info.Mixed = true
+				}
+				if segment[37+3*c] != 1 || segment[38+3*c] != 1 {
+					info.Subsampled = true
+				}
+			}
+			info.HighThrough = binary.BigEndian.Uint16(segment)&0x4000 != 0
+			siz = true
+		case markerCAP:
+			info.HighThrough = true
+		case markerCOD:
+			// Scod, progression, layers, MCT, levels, code-block width and height, code-block style, transform
+			if len(segment) < 10 {
+				return info, errors.New("ERROR, J2Kprobe, bad COD marker")
+			}
+			info.Levels = int(segment[5])
+			info.HighThrough = info.HighThrough || segment[8]&0x40 != 0
+			info.Reversible = segment[9] == 1
+		}
+		pos += 2 + length
+	}
+	return info, errors.New("ERROR, J2Kprobe, no SOT marker")
+}
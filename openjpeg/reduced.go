@@ -0,0 +1,51 @@
+package openjpeg
+
+/*
+#include <stdlib.h>
+#include <stdbool.h>
+
+// defined in j2klib/decomj2k.c, compiled by the platform file
+struct J2KDecoderStruct;
+bool J2KDecoderDecodeReduced(struct J2KDecoderStruct *dec, char *inputdata, int inputlength, int reduce, char **raw, int *rawsize, int *width, int *height);
+*/
+import "C"
+import (
+	"errors"
+	"runtime"
+	"unsafe"
+)
+
+// J2KdecodeReduced - J2K File to RAW at 1/2^level of the full resolution in each direction, for
+// previews and thumbnails. Only the first resolution levels are decoded, level can not exceed the
+// decomposition levels of the codestream. Returns the frame with its reduced width and height
+func J2KdecodeReduced(j2kData []byte, level int) ([]byte, int, int, error) {
+	dec, _ := j2kDecoderPool.Get().(*J2KDecoder)
+	if dec == nil {
+		return nil, 0, 0, errors.New("ERROR, J2KdecodeReduced, JPEG failed")
+	}
+	defer j2kDecoderPool.Put(dec)
+	return dec.DecodeReduced(j2kData, level)
+}
+
+// DecodeReduced - J2K File to RAW at a reduced resolution, see J2KdecodeReduced
+func (d *J2KDecoder) DecodeReduced(j2kData []byte, level int) ([]byte, int, int, error) {
+	var raw *C.char
+	var rawSize, width, height C.int
+	if d.dec == nil {
+		return nil, 0, 0, errors.New("ERROR, J2KdecodeReduced, decoder closed")
+	}
+	if len(j2kData) == 0 || level < 0 {
+		return nil, 0, 0, errors.New("ERROR, J2KdecodeReduced, JPEG failed")
+	}
+	if J2KisHT(j2kData) {
+		return nil, 0, 0, ErrHTJ2K
+	}
+	ok := C.J2KDecoderDecodeReduced(d.dec, (*C.char)(unsafe.Pointer(&j2kData[0])), C.int(len(j2kData)), C.int(level), &raw, &rawSize, &width, &height)
+	runtime.KeepAlive(d)
+	if !ok {
+		return nil, 0, 0, errors.New("ERROR, J2KdecodeReduced, JPEG failed")
+	}
+	outData := C.GoBytes(unsafe.Pointer(raw), rawSize)
+	C.free(unsafe.Pointer(raw))
+	return outData, int(width), int(height), nil
+}
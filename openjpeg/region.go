@@ -0,0 +1,75 @@
+package openjpeg
+
+/*
+#include <stdlib.h>
+#include <stdbool.h>
+
+// defined in j2klib/decomj2k.c, compiled by the platform file
+struct J2KDecoderStruct;
+bool J2KDecoderDecodeRegion(struct J2KDecoderStruct *dec, char *inputdata, int inputlength, int x, int y, int w, int h, char **raw, int *rawsize);
+bool J2KTileRegion(char *inputdata, int inputlength, int tile, int *x, int *y, int *w, int *h);
+*/
+import "C"
+import (
+	"errors"
+	"runtime"
+	"unsafe"
+)
+
+// J2KdecodeRegion - J2K File to RAW for the width x height samples at x, y from the top left corner
+// of the image. Only the tiles the region touches are decoded and the frame holds just the region,
+// so a viewer can pan across a large tiled image. Images with subsampled components are not supported
+func J2KdecodeRegion(j2kData []byte, x int, y int, width int, height int) ([]byte, error) {
+	dec, _ := j2kDecoderPool.Get().(*J2KDecoder)
+	if dec == nil {
+		return nil, errors.New("ERROR, J2KdecodeRegion, JPEG failed")
+	}
+	defer j2kDecoderPool.Put(dec)
+	return dec.DecodeRegion(j2kData, x, y, width, height)
+}
+
+// J2KdecodeTile - J2K File to RAW for a single tile, tiles are numbered across then down.
+// Returns the frame with the width and height of the tile, see J2KtileRegion for its position
+func J2KdecodeTile(j2kData []byte, tile int) ([]byte, int, int, error) {
+	x, y, width, height, err := J2KtileRegion(j2kData, tile)
+	if err != nil {
+		return nil, 0, 0, err
+	}
+	outData, err := J2KdecodeRegion(j2kData, x, y, width, height)
+	return outData, width, height, err
+}
+
+// J2KtileRegion - position and size of a tile in samples from the top left corner of the image
+func J2KtileRegion(j2kData []byte, tile int) (int, int, int, int, error) {
+	var x, y, w, h C.int
+	if len(j2kData) == 0 {
+		return 0, 0, 0, 0, errors.New("ERROR, J2KtileRegion, JPEG failed")
+	}
+	if !C.J2KTileRegion((*C.char)(unsafe.Pointer(&j2kData[0])), C.int(len(j2kData)), C.int(tile), &x, &y, &w, &h) {
+		return 0, 0, 0, 0, errors.New("ERROR, J2KtileRegion, invalid tile")
+	}
+	return int(x), int(y), int(w), int(h), nil
+}
+
+// DecodeRegion - J2K File to RAW for a region of the image, see J2KdecodeRegion
+func (d *J2KDecoder) DecodeRegion(j2kData []byte, x int, y int, width int, height int) ([]byte, error) {
+	var raw *C.char
+	var rawSize C.int
+	if d.dec == nil {
+		return nil, errors.New("ERROR, J2KdecodeRegion, decoder closed")
+	}
+	if len(j2kData) == 0 {
+		return nil, errors.New("ERROR, J2KdecodeRegion, JPEG failed")
+	}
+	if J2KisHT(j2kData) {
+		return nil, ErrHTJ2K
+	}
+	ok := C.J2KDecoderDecodeRegion(d.dec, (*C.char)(unsafe.Pointer(&j2kData[0])), C.int(len(j2kData)), C.int(x), C.int(y), C.int(width), C.int(height), &raw, &rawSize)
+	runtime.KeepAlive(d)
+	if !ok {
+		return nil, errors.New("ERROR, J2KdecodeRegion, JPEG failed")
+	}
+	outData := C.GoBytes(unsafe.Pointer(raw), rawSize)
+	C.free(unsafe.Pointer(raw))
+	return outData, nil
+}
@@ -0,0 +1,38 @@
+package openjpeg
+
+/*
+// defined in j2klib/simd.h, compiled by the platform file
+int J2KSetSIMDLevel(int level);
+// defined in j2klib/wavelet.h
+int J2KWaveletMatches(int transform, int x0, int y0, int x1, int y1, int numresolutions, int numres, unsigned seed);
+*/
+import "C"
+
+// Instruction sets of the pixel kernels, see setSIMDLevel
+const (
+	simdScalar = 0
+	simdSSE41  = 1
+	simdAVX2   = 2
+	simdNEON   = 3
+)
+
+// setSIMDLevel - forces the pixel kernels to one instruction set, -1 restores the automatic choice.
+// Returns the level in use, which differs from level when the CPU does not support it
+func setSIMDLevel(level int) int {
+	return int(C.J2KSetSIMDLevel(C.int(level)))
+}
+
+// Wavelet transforms of the J2K codec, see waveletMatches
+const (
+	dwtInverse53 = 0
+	dwtInverse97 = 1
+	dwtForward53 = 2
+	dwtForward97 = 3
+)
+
+// waveletMatches - runs a wavelet transform on a tile component (x0, y0)-(x1, y1) of numresolutions
+// resolutions, decoded up to numres, at the current level and in OpenJPEG itself. Returns 1 when
+// the results are the same bits, 0 when not, -1 when the current level is OpenJPEG's own
+func waveletMatches(transform int, x0 int, y0 int, x1 int, y1 int, numresolutions int, numres int, seed uint32) int {
+	return int(C.J2KWaveletMatches(C.int(transform), C.int(x0), C.int(y0), C.int(x1), C.int(y1), C.int(numresolutions), C.int(numres), C.uint(seed)))
+}
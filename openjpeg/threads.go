@@ -0,0 +1,34 @@
+package openjpeg
+
+/*
+// defined in j2klib/t1threads.h and j2klib/decomj2k.c, compiled by the platform file
+struct J2KDecoderStruct;
+void J2KSetDecodeThreads(int threads);
+void J2KDecoderSetThreads(struct J2KDecoderStruct *dec, int threads);
+*/
+import "C"
+import (
+	"runtime"
+)
+
+// SetDecodeThreads - native threads decoding the code-blocks of a frame in J2Kdecode and every
+// decoder without threads of its own, 0 for one per CPU. The decoded frame does not depend on the
+// threads. Linux only, elsewhere frames are decoded on one thread
+func SetDecodeThreads(threads int) {
+	if threads <= 0 {
+		threads = runtime.NumCPU()
+	}
+	C.J2KSetDecodeThreads(C.int(threads))
+}
+
+// SetThreads - native threads decoding the code-blocks of a frame, 0 for SetDecodeThreads
+func (d *J2KDecoder) SetThreads(threads int) {
+	if d.dec == nil {
+		return
+	}
+	if threads < 0 {
+		threads = 0
+	}
+	C.J2KDecoderSetThreads(d.dec, C.int(threads))
+	runtime.KeepAlive(d)
+}
@@ -0,0 +1,56 @@
+package openjpeg
+
+/*
+#include <stdlib.h>
+#include <stdbool.h>
+
+// defined in j2klib/comj2k.c, compiled by the platform file
+struct J2KEncoderStruct;
+bool J2KEncoderEncodeTiled(struct J2KEncoderStruct *enc, char *raw_data, int image_width, int image_height, int sample_pixel, int bitsallocated, int tile_size, char **jpeg_data, int *encodedlength, int ratio, int threads);
+*/
+import "C"
+import (
+	"errors"
+	"runtime"
+	"unsafe"
+)
+
+// J2KencodeTiled - RAW File to J2K cut into tiles of tileSize x tileSize, the tiles encoded on up to
+// threads native threads (0 for one per CPU) and joined into one codestream. Lossless the codestream
+// is the same as a single threaded tiled encode. Smaller tiles decode faster by region, see
+// J2KdecodeTile, at some cost in compression
+func J2KencodeTiled(rawData []byte, width uint16, height uint16, samples uint16, bitsa uint16, tileSize int, outData *[]byte, outSize *int, ratio int, threads int) error {
+	enc, _ := j2kEncoderPool.Get().(*J2KEncoder)
+	if enc == nil {
+		return errors.New("ERROR, J2KEncodeTiled, JPEG failed")
+	}
+	defer j2kEncoderPool.Put(enc)
+	return enc.EncodeTiled(rawData, width, height, samples, bitsa, tileSize, outData, outSize, ratio, threads)
+}
+
+// EncodeTiled - RAW File to J2K cut into tiles, see J2KencodeTiled
+func (e *J2KEncoder) EncodeTiled(rawData []byte, width uint16, height uint16, samples uint16, bitsa uint16, tileSize int, outData *[]byte, outSize *int, ratio int, threads int) error {
+	var j2kData *C.char
+	var j2kSize C.int
+	if e.enc == nil {
+		return errors.New("ERROR, J2KEncodeTiled, encoder closed")
+	}
+	if len(rawData) == 0 || tileSize < 0 {
+		return errors.New("ERROR, J2KEncodeTiled, JPEG failed")
+	}
+	if threads <= 0 {
+		threads = runtime.NumCPU()
+	}
+	ok := C.J2KEncoderEncodeTiled(e.enc, (*C.char)(unsafe.Pointer(&rawData[0])), C.int(width), C.int(height), C.int(samples), C.int(bitsa), C.int(tileSize), &j2kData, &j2kSize, C.int(ratio), C.int(threads))
+	runtime.KeepAlive(e)
+	if ok {
+		if j2kSize > 0 {
+			*outData = C.GoBytes(unsafe.Pointer(j2kData), j2kSize)
+			*outSize = int(j2kSize)
+			C.free(unsafe.Pointer(j2kData))
+			return nil
+		}
+		C.free(unsafe.Pointer(j2kData))
+	}
+	return errors.New("ERROR, J2KEncodeTiled, JPEG failed")
+}
@@ -4,95 +4,319 @@ import (
 	"encoding/binary"
 	"fmt"
 	"strings"
+	"sync"
+
+	"github.com/innovative-io/io-dicom/colorspace"
 )
 
+// rleHeaderSize - segment count and the offsets of up to 15 segments
+const rleHeaderSize = 64
+
+// GetUint32 - little endian value of the first length bytes of in, missing bytes read as 0
 func GetUint32(in []byte, length int) uint32 {
-	c := make([]byte, length)
-	copy(c, in)
-	return binary.LittleEndian.Uint32(c)
+	var c [4]byte
+	copy(c[:], in[:min(length, len(in))])
+	return binary.LittleEndian.Uint32(c[:])
 }
 
+// ReadSegment - decodes segment i, seg_size bytes at seg_offset of in, into the rawSize bytes at
+// i*rawSize of out
 func ReadSegment(in []byte, out []byte, seg_offset uint32, seg_size uint32, i uint32, rawSize uint32) error {
-	var count int8
-	out_offset := i * rawSize
-	in_offset := seg_offset
-
-	for (out_offset - i*rawSize) < rawSize {
-		count = int8(in[in_offset])
-		in_offset++
-		if count >= 0 {
-			copy(out[out_offset:out_offset+uint32(count+1)], in[in_offset:in_offset+uint32(count+1)])
-			in_offset += uint32(count + 1)
-			out_offset += uint32(count + 1)
-		} else {
-			if (count <= -1) && (count >= -127) {
-				newByte := in[in_offset]
-				in_offset++
-				for j := uint32(0); j < uint32(-count+1); j++ {
-					out[j+out_offset] = newByte
+	if uint64(seg_offset)+uint64(seg_size) > uint64(len(in)) || uint64(i+1)*uint64(rawSize) > uint64(len(out)) {
+		return fmt.Errorf("ERROR, overflow decoding RLE")
+	}
+	r := segmentReader{seg: in[seg_offset : seg_offset+seg_size]}
+	return r.read(out[i*rawSize : (i+1)*rawSize])
+}
+
+// segmentReader - PackBits decoder of one segment that can stop anywhere, inside a run too, and
+// carry on with the next call
+type segmentReader struct {
+	seg []byte
+	i   int  // next byte of seg
+	lit int  // literal bytes left of the current run
+	rep int  // copies left of the current replicate run
+	v   byte // the byte replicated
+}
+
+// read - decodes the next len(dst) bytes of the segment into dst
+func (r *segmentReader) read(dst []byte) error {
+	// the rest of a run cut by the last call
+	if r.lit > 0 {
+		n := min(r.lit, len(dst))
+		if r.i+n > len(r.seg) {
+			return fmt.Errorf("ERROR, RLE segment too short")
+		}
+		copy(dst, r.seg[r.i:r.i+n])
+		r.i += n
+		r.lit -= n
+		dst = dst[n:]
+	}
+	if r.rep > 0 {
+		n := min(r.rep, len(dst))
+		fill(dst[:n], r.v)
+		r.rep -= n
+		dst = dst[n:]
+	}
+	seg, i := r.seg, r.i
+	for len(dst) > 0 {
+		if i >= len(seg) {
+			return fmt.Errorf("ERROR, RLE segment too short")
+		}
+		count := int(seg[i])
+		i++
+		switch {
+		case count < 128: // count+1 literal bytes
+			n := count + 1
+			if i+n > len(seg) {
+				return fmt.Errorf("ERROR, RLE segment too short")
+			}
+			if n <= 16 && len(dst) >= 16 && i+16 <= len(seg) {
+				// short runs as one 16 byte move, the bytes past the run are overwritten next
+				*(*[16]byte)(dst) = *(*[16]byte)(seg[i:])
+			} else {
+				if n > len(dst) {
+					r.lit = n - len(dst)
+					n = len(dst)
 				}
-				out_offset += uint32(-count + 1)
-				if in_offset-seg_offset > seg_size {
-					return fmt.Errorf("ERROR, overflow decoding RLE")
+				copy(dst[:n], seg[i:i+n])
+			}
+			i += n
+			dst = dst[n:]
+		case count > 128: // 257-count copies of the next byte
+			if i >= len(seg) {
+				return fmt.Errorf("ERROR, RLE segment too short")
+			}
+			n := 257 - count
+			if n <= 16 && len(dst) >= 16 {
+				v := uint64(seg[i]) * 0x0101010101010101
+				binary.LittleEndian.PutUint64(dst, v)
+				binary.LittleEndian.PutUint64(dst[8:], v)
+			} else {
+				if n > len(dst) {
+					r.rep, r.v = n-len(dst), seg[i]
+					n = len(dst)
 				}
+				fill(dst[:n], seg[i])
 			}
+			i++
+			dst = dst[n:]
 		}
 	}
+	r.i = i
 	return nil
 }
 
-func RLEdecode(in []byte, out []byte, length uint32, size uint32, PhotoInt string) error {
-	var segment_count, offset, i uint32
-	var segment_offset [15]uint32
-	var segment_length [15]uint32
-
-	offset = 0
-	for i := 0; i < 15; i++ {
-		segment_offset[i] = 0
-		segment_length[i] = 0
+// fill - sets every byte of run to v, doubling what is already set with copy, which moves whole
+// vectors at a time
+func fill(run []byte, v byte) {
+	if len(run) <= 16 {
+		for k := range run {
+			run[k] = v
+		}
+		return
 	}
-
-	segment_count = GetUint32(in, 4)
-	for i := 0; i < 15; i++ {
-		offset = offset + 4
-		segment_offset[i] = GetUint32(in[offset:], 4)
+	run[0] = v
+	for k := 1; k < len(run); k *= 2 {
+		copy(run[k:], run[:k])
 	}
+}
+
+// rleChunk - pixels decoded per segment before they are interleaved into the frame, small enough
+// for the planes to stay in the L1 cache
+const rleChunk = 2048
 
-	segment_offset[segment_count] = length
-	temp := make([]byte, size)
-	for i = 0; i < segment_count; i++ {
-		segment_length[i] = segment_offset[i+1] - segment_offset[i]
-		ReadSegment(in, temp, segment_offset[i], segment_length[i], i, size/segment_count)
+// RLEdecode - DICOM RLE Lossless frame to RAW, little endian for 16 bits: MONO in 1 or 2
+// segments, RGB in 3 or 6 and YBR_FULL in 3, converted to RGB. The segments are decoded a chunk
+// at a time and interleaved into the frame from the cache, one pass over the output
+func RLEdecode(in []byte, out []byte, length uint32, size uint32, PhotoInt string) error {
+	if length > uint32(len(in)) || length < rleHeaderSize {
+		return fmt.Errorf("ERROR, RLE header too short")
+	}
+	in = in[:length]
+	segments := int(binary.LittleEndian.Uint32(in))
+	samples := 3
+	if strings.Contains(PhotoInt, "MONO") {
+		samples = 1
+	}
+	ybr := PhotoInt == "YBR_FULL"
+	if segments == 0 || segments%samples != 0 || segments/samples > 2 ||
+		(samples == 3 && PhotoInt != "RGB" && !(ybr && segments == 3)) {
+		return fmt.Errorf("ERROR, format not supported")
+	}
+	pixels := int(size) / segments
+	if len(out) < pixels*segments {
+		return fmt.Errorf("ERROR, overflow decoding RLE")
 	}
 
-	offset = size / segment_count
-	if (strings.Contains(PhotoInt, "MONO")) && (segment_count == 2) {
-		for i = 0; i < size/segment_count; i++ {
-			out[2*i] = temp[i+offset]
-			out[2*i+1] = temp[i]
+	var readers [6]segmentReader
+	for s := 0; s < segments; s++ {
+		start := binary.LittleEndian.Uint32(in[4+4*s:])
+		end := length
+		if s+1 < segments {
+			end = binary.LittleEndian.Uint32(in[8+4*s:])
 		}
-	} else if (strings.Contains(PhotoInt, "MONO")) && (segment_count == 1) {
-		for i = 0; i < size; i++ {
-			out[i] = temp[i]
+		if start < rleHeaderSize || start > end || end > length {
+			return fmt.Errorf("ERROR, invalid RLE segment offset")
 		}
-	} else if (PhotoInt == "YBR_FULL") && (segment_count == 3) {
-		var Y, Cb, Cr float32
-		for i = 0; i < size/segment_count; i++ {
-			Y = float32(temp[i])
-			Cb = float32(temp[i+offset])
-			Cr = float32(temp[i+2*offset])
-			out[3*i] = byte(Y + 1.402*(Cr-128.0))
-			out[3*i+1] = byte(Y - 0.344136*(Cb-128.0) - 0.714136*(Cr-128.0))
-			out[3*i+2] = byte(Y + 1.772*(Cb-128.0))
+		readers[s].seg = in[start:end]
+	}
+	if segments == 1 {
+		return readers[0].read(out[:pixels])
+	}
+
+	var planes [6][rleChunk]byte
+	for done := 0; done < pixels; done += rleChunk {
+		n := min(rleChunk, pixels-done)
+		for s := 0; s < segments; s++ {
+			if err := readers[s].read(planes[s][:n]); err != nil {
+				return err
+			}
 		}
-	} else if (PhotoInt == "RGB") && (segment_count == 3) {
-		for i = 0; i < size/segment_count; i++ {
-			out[3*i] = temp[i]
-			out[3*i+1] = temp[i+offset]
-			out[3*i+2] = temp[i+2*offset]
+		dst := out[done*segments : (done+n)*segments]
+		switch {
+		case segments == 2:
+			interleave16(dst, planes[0][:n], planes[1][:n])
+		case ybr:
+			colorspace.YBRPlanesToRGB(dst, planes[0][:n], planes[1][:n], planes[2][:n])
+		case segments == 3:
+			interleave8(dst, planes[0][:n], planes[1][:n], planes[2][:n])
+		default:
+			interleave48(dst, &planes, n)
 		}
-	} else {
-		return fmt.Errorf("ERROR, format not supported")
 	}
 	return nil
 }
+
+// interleave16 - little endian samples from the planes of their high and low bytes
+func interleave16(dst []byte, hi []byte, lo []byte) {
+	hi = hi[:len(lo)]
+	dst = dst[:2*len(lo)]
+	for k := range lo {
+		binary.LittleEndian.PutUint16(dst[2*k:], uint16(hi[k])<<8|uint16(lo[k]))
+	}
+}
+
+// interleave48 - little endian RGB from the high and low byte planes of the three samples
+func interleave48(dst []byte, planes *[6][rleChunk]byte, n int) {
+	dst = dst[:6*n]
+	for k := 0; k < n; k++ {
+		p := dst[6*k : 6*k+6 : 6*k+6]
+		p[0], p[1] = planes[1][k], planes[0][k]
+		p[2], p[3] = planes[3][k], planes[2][k]
+		p[4], p[5] = planes[5][k], planes[4][k]
+	}
+}
+
+func interleave8(dst []byte, r []byte, g []byte, b []byte) {
+	g = g[:len(r)]
+	b = b[:len(r)]
+	for k := range r {
+		p := dst[3*k : 3*k+3 : 3*k+3]
+		p[0], p[1], p[2] = r[k], g[k], b[k]
+	}
+}
+
+// RLEencodeBound - size of an output buffer that holds any RLE frame of this geometry: every row
+// of every segment as literal runs of at most 128 bytes, and a pad byte per segment
+func RLEencodeBound(width uint16, height uint16, samples uint16, bitsa uint16) int {
+	segments := int(samples) * int(bitsa/8)
+	row := int(width) + (int(width)+127)/128
+	return rleHeaderSize + segments*(int(height)*row+1)
+}
+
+// RLEencode - RAW frame to DICOM RLE Lossless, samples 1 or 3 (interleaved RGB), bitsa 8 or 16
+// (little endian). Every byte plane is a segment of its own, most significant byte first, and the
+// segments are encoded concurrently
+func RLEencode(in []byte, width uint16, height uint16, samples uint16, bitsa uint16) ([]byte, error) {
+	out := make([]byte, RLEencodeBound(width, height, samples, bitsa))
+	size, err := RLEencodeTo(in, out, width, height, samples, bitsa)
+	if err != nil {
+		return nil, err
+	}
+	return out[:size], nil
+}
+
+// RLEencodeTo - RAW frame to DICOM RLE Lossless, written straight into out, which has to hold
+// RLEencodeBound bytes. Returns the bytes written
+func RLEencodeTo(in []byte, out []byte, width uint16, height uint16, samples uint16, bitsa uint16) (int, error) {
+	if width == 0 || height == 0 || (samples != 1 && samples != 3) || (bitsa != 8 && bitsa != 16) {
+		return 0, fmt.Errorf("ERROR, RLEencode, format not supported")
+	}
+	bps := int(bitsa / 8)
+	segments := int(samples) * bps
+	if len(in) < int(width)*int(height)*segments {
+		return 0, fmt.Errorf("ERROR, RLEencode, RAW data too short")
+	}
+	if len(out) < RLEencodeBound(width, height, samples, bitsa) {
+		return 0, fmt.Errorf("ERROR, RLEencode, output buffer too small")
+	}
+
+	// each segment is packed into its own slice of out, placed as if every segment took its bound,
+	// then moved down behind the one before it
+	bound := (RLEencodeBound(width, height, samples, bitsa) - rleHeaderSize) / segments
+	sizes := make([]int, segments)
+	var wg sync.WaitGroup
+	for s := 0; s < segments; s++ {
+		wg.Add(1)
+		go func(s int) {
+			defer wg.Done()
+			// sample s / bps, byte s % bps of it counted from the most significant one
+			first := (s/bps)*bps + bps - 1 - s%bps
+			sizes[s] = packSegment(out[rleHeaderSize+s*bound:rleHeaderSize+(s+1)*bound], in, first, segments, int(width), int(height))
+		}(s)
+	}
+	wg.Wait()
+
+	for i := range out[:rleHeaderSize] {
+		out[i] = 0
+	}
+	binary.LittleEndian.PutUint32(out, uint32(segments))
+	offset := rleHeaderSize
+	for s := 0; s < segments; s++ {
+		binary.LittleEndian.PutUint32(out[4+4*s:], uint32(offset))
+		offset += copy(out[offset:], out[rleHeaderSize+s*bound:rleHeaderSize+s*bound+sizes[s]])
+	}
+	return offset, nil
+}
+
+// packSegment - PackBits encodes the byte plane that starts at first and steps by stride through
+// in, row by row so no run crosses a row. Returns the segment size, padded to an even length
+func packSegment(out []byte, in []byte, first int, stride int, width int, height int) int {
+	n := 0
+	row := make([]byte, width)
+	for y := 0; y < height; y++ {
+		for x, k := 0, first+y*width*stride; x < width; x, k = x+1, k+stride {
+			row[x] = in[k]
+		}
+		for i := 0; i < width; {
+			// a replicate run of three or more
+			j := i + 1
+			for j < width && j-i < 128 && row[j] == row[i] {
+				j++
+			}
+			if j-i >= 3 {
+				out[n] = byte(1 - (j - i))
+				out[n+1] = row[i]
+				n += 2
+				i = j
+				continue
+			}
+			// a literal run up to the next replicate run
+			start := i
+			for i < width && i-start < 128 {
+				if i+2 < width && row[i] == row[i+1] && row[i] == row[i+2] {
+					break
+				}
+				i++
+			}
+			out[n] = byte(i - start - 1)
+			n += 1 + copy(out[n+1:], row[start:i])
+		}
+	}
+	if n%2 != 0 {
+		out[n] = 0
+		n++
+	}
+	return n
+}
@@ -0,0 +1,76 @@
+package transcoder
+
+import (
+	"bytes"
+	"math/rand"
+	"testing"
+)
+
+func TestRLEroundTrip(t *testing.T) {
+	type args struct {
+		width, height, samples, bitsa uint16
+		PhotoInt                      string
+	}
+	tests := []struct {
+		name string
+		args args
+	}{
+		{name: "Should round trip gray 8 bit", args: args{width: 512, height: 7, samples: 1, bitsa: 8, PhotoInt: "MONOCHROME2"}},
+		{name: "Should round trip gray 16 bit", args: args{width: 3001, height: 3, samples: 1, bitsa: 16, PhotoInt: "MONOCHROME2"}},
+		{name: "Should round trip RGB 8 bit", args: args{width: 1500, height: 4, samples: 3, bitsa: 8, PhotoInt: "RGB"}},
+		{name: "Should round trip RGB 16 bit", args: args{width: 999, height: 5, samples: 3, bitsa: 16, PhotoInt: "RGB"}},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			a := tt.args
+			rng := rand.New(rand.NewSource(int64(a.width)))
+			in := make([]byte, int(a.width)*int(a.height)*int(a.samples)*int(a.bitsa/8))
+			// noise, short runs and runs longer than 128 bytes
+			for i := 0; i < len(in); {
+				n := 1 + rng.Intn(300)
+				v := byte(rng.Intn(4))
+				for k := 0; k < n && i < len(in); k, i = k+1, i+1 {
+					in[i] = v
+					if n < 20 {
+						in[i] = byte(rng.Intn(256))
+					}
+				}
+			}
+			rle, err := RLEencode(in, a.width, a.height, a.samples, a.bitsa)
+			if err != nil {
+				t.Fatalf("RLEencode() error = %v", err)
+			}
+			out := make([]byte, len(in))
+			if err := RLEdecode(rle, out, uint32(len(rle)), uint32(len(in)), a.PhotoInt); err != nil {
+				t.Fatalf("RLEdecode() error = %v", err)
+			}
+			if !bytes.Equal(out, in) {
+				t.Errorf("RLEdecode() differs from the source")
+			}
+			if err := RLEdecode(rle, out, uint32(len(rle))/2, uint32(len(in)), a.PhotoInt); err == nil {
+				t.Errorf("RLEdecode() of a truncated frame error = nil, want an error")
+			}
+		})
+	}
+}
+
+func TestRLEdecodeYBR(t *testing.T) {
+	// gray, white and saturated red in YBR_FULL
+	in := []byte{128, 255, 76}
+	cb := []byte{128, 128, 85}
+	cr := []byte{128, 128, 255}
+	want := []byte{128, 128, 128, 255, 255, 255, 254, 0, 0}
+	rle := make([]byte, 64, 128)
+	rle[0] = 3
+	for s, plane := range [][]byte{in, cb, cr} {
+		rle[4+4*s] = byte(len(rle))
+		rle = append(rle, 2, plane[0], plane[1], plane[2], 0x80, 0)
+	}
+	out := make([]byte, 9)
+	if err := RLEdecode(rle, out, uint32(len(rle)), 9, "YBR_FULL"); err != nil {
+		t.Fatalf("RLEdecode() error = %v", err)
+	}
+	if !bytes.Equal(out, want) {
+		t.Errorf("RLEdecode() = %v, want %v", out, want)
+	}
+}